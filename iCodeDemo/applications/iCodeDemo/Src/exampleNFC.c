@@ -1875,6 +1875,16 @@ static void writeNFCVSingleBlock(void)
  {
      int resp;
     /* Initialize the platform */
+	/* Apply the RT profile to this thread, which runs the RFAL worker */
+	resp = pltf_rt_init(NULL);
+	if (resp != ERR_NONE)
+		return false;
+
+	/* Record the SPI and IRQ traffic if PLTF_TRACE names a file */
+	resp = pltf_trace_init();
+	if (resp != ERR_NONE)
+		return false;
+
 	/* Initialize GPIO */
   	resp = gpio_init();
 	if(resp != ERR_NONE)
@@ -1890,6 +1900,12 @@ static void writeNFCVSingleBlock(void)
 	if (resp != ERR_NONE)
 		return false;
 
+    /* Start the LED indicators, LED changes are applied off the RF path */
+    platformLedsInitialize();
+
+    /* Show the scheduling actually obtained for the IRQ and worker threads */
+    pltf_rt_report();
+
     /* Force both LEDs off at the beginning */
     platformLedOff(PLATFORM_LED_FIELD_PORT,PLATFORM_LED_FIELD_PIN);
     platformLedOff(LED_TAG_READ_PORT, LED_TAG_READ_PIN); 
@@ -1973,4 +1989,10 @@ int main(void)
        fflush (stdout) ;
 
     } while(option != 'e');
+
+    /* Make sure the LEDs reflect the last state before exiting */
+    platformLedsFlush();
+
+    /* Close the trace, if recording */
+    pltf_trace_stop();
 }
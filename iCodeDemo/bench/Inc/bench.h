@@ -0,0 +1,235 @@
+
+/******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; COPYRIGHT 2018 STMicroelectronics</center></h2>
+  *
+  * Licensed under ST MYLIBERTY SOFTWARE LICENSE AGREEMENT (the "License");
+  * You may not use this file except in compliance with the License.
+  * You may obtain a copy of the License at:
+  *
+  *        http://www.st.com/myliberty
+  *
+  * Unless required by applicable law or agreed to in writing, software 
+  * distributed under the License is distributed on an "AS IS" BASIS, 
+  * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied,
+  * AND SPECIFICALLY DISCLAIMING THE IMPLIED WARRANTIES OF MERCHANTABILITY,
+  * FITNESS FOR A PARTICULAR PURPOSE, AND NON-INFRINGEMENT.
+  * See the License for the specific language governing permissions and
+  * limitations under the License.
+  *
+******************************************************************************/
+
+/*! \file bench.h
+ *
+ *  \brief Measurement and report harness of the benchmarks
+ *  
+ *  A benchmark runs an operation a number of times between
+ *  bench_op_begin() and bench_op_end(), each run being framed by
+ *  bench_sample_start() and bench_sample_end(). The harness keeps the
+ *  latency of every run and adds up the CPU time of the process, the CPU
+ *  cycles spent in user space and, on the simulated reader, the SPI
+ *  traffic of the reader. bench_op_end() reduces them to one result row:
+ *  latency distribution, operations and items (e.g. tags resolved) per
+ *  second, CPU time, cycles, SPI calls and bytes per operation.
+ *  
+ *  Operations too short for the clock are measured in batches: a sample
+ *  framed by bench_sample_start() and bench_sample_end_runs() covers
+ *  several runs, its latency is shared out evenly between them. Calling
+ *  bench_cache_evict() before a sample measures it with cold data caches.
+ *  
+ *  Built with PLTF_SIM the latencies are taken from the virtual clock of
+ *  the reader: they are what the driver would take on the modelled bus
+ *  and tags, or what it took on the hardware when a trace is replayed.
+ *  On the hardware, or with BENCH_HOST_CLOCK for programs which do not
+ *  drive the reader, they are taken from CLOCK_MONOTONIC and the SPI
+ *  columns are left empty. The cycles come from the CPU performance
+ *  counters (perf events), the column is left empty where the kernel
+ *  does not give access to them.
+ *  
+ *  The rows are written as CSV or JSON, so that runs of different builds
+ *  can be compared with the usual tools.
+ *
+ */
+
+#ifndef BENCH_H
+#define BENCH_H
+
+/*
+ ******************************************************************************
+ * INCLUDES
+ ******************************************************************************
+ */
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "st_errno.h"
+
+/*
+ ******************************************************************************
+ * GLOBAL DEFINES
+ ******************************************************************************
+ */
+#ifndef BENCH_SAMPLES_MAX
+#define BENCH_SAMPLES_MAX	4096	/* Runs kept per operation, the others only count */
+#endif
+
+#define BENCH_ROWS_MAX		256	/* Result rows of one run */
+
+#ifndef BENCH_EVICT_MAX
+#define BENCH_EVICT_MAX		(32 * 1024 * 1024)	/* Largest buffer walked by bench_cache_evict() */
+#endif
+
+/*
+ ******************************************************************************
+ * GLOBAL TYPES
+ ******************************************************************************
+ */
+/* Output format */
+typedef enum {
+	BENCH_FORMAT_CSV = 0,
+	BENCH_FORMAT_JSON
+}benchFormat;
+
+/* Result of one operation */
+typedef struct {
+	char		group[16];	/* Technology or kernel family, e.g. "nfcv" */
+	char		name[32];	/* Operation */
+	uint32_t	param;		/* Tags, blocks or bytes, 0 if none */
+	uint32_t	samples;	/* Samples, of one run or a batch of runs */
+	uint32_t	errors;		/* Samples that did not return ERR_NONE */
+	double		minUs;
+	double		p50Us;
+	double		p90Us;
+	double		p99Us;
+	double		maxUs;
+	double		meanUs;
+	double		opsPerSec;	/* Runs per second of latency */
+	double		itemsPerSec;	/* Items per second of latency, 0 if not counted */
+	double		cpuUsPerOp;	/* CPU time of the process per run */
+	bool		spi;		/* SPI counters below are valid */
+	double		spiCallsPerOp;
+	double		spiBytesPerOp;
+	double		nsPerItem;	/* Latency per item, 0 if not counted */
+	bool		cycles;		/* Cycle counter below is valid */
+	double		cyclesPerOp;	/* User space CPU cycles per run */
+}benchRow;
+
+/* Operation being measured */
+typedef struct {
+	benchRow	row;
+	uint64_t	lat[BENCH_SAMPLES_MAX];	/* Latencies in ns */
+	uint64_t	t0;			/* Start of the current run */
+	uint64_t	cpu0;
+	uint64_t	cpuNs;			/* CPU time of all runs */
+	uint64_t	cyc0;
+	uint64_t	cycles;			/* CPU cycles of all runs */
+	uint64_t	runs;			/* Runs of all samples */
+	uint64_t	items;			/* Items of all runs */
+	uint32_t	spiCalls0;
+	uint32_t	spiBytes0;
+	uint64_t	spiCalls;
+	uint64_t	spiBytes;
+}benchOp;
+
+/*
+ ******************************************************************************
+ * GLOBAL FUNCTION PROTOTYPES
+ ******************************************************************************
+ */
+
+/*! 
+ *****************************************************************************
+ * \brief  Time of the benchmark clock in ns
+ * Virtual time of the reader bound to the calling thread with PLTF_SIM,
+ * CLOCK_MONOTONIC otherwise.
+ *****************************************************************************
+ */
+uint64_t bench_time_ns(void);
+
+/*! 
+ *****************************************************************************
+ * \brief  CPU time used by the process in ns
+ *****************************************************************************
+ */
+uint64_t bench_cpu_ns(void);
+
+/*! 
+ *****************************************************************************
+ * \brief  Name of the benchmark clock: "sim", "replay", "hw" or "host"
+ *****************************************************************************
+ */
+const char *bench_clock_name(void);
+
+/*! 
+ *****************************************************************************
+ * \brief  Measure an operation
+ * \param[in]	: op, reset by the call
+ * \param[in]	: group and name of the operation
+ * \param[in]	: param, e.g. the number of tags or blocks
+ *****************************************************************************
+ */
+void bench_op_begin(benchOp *op, const char *group, const char *name, uint32_t param);
+
+/*! 
+ *****************************************************************************
+ * \brief  Frame one run of the operation
+ * \param[in]	: op
+ * \param[in]	: err, return code of the run, counted as an error if not ERR_NONE
+ * \param[in]	: items handled by the run, e.g. tags resolved, 0 if not counted
+ *****************************************************************************
+ */
+void bench_sample_start(benchOp *op);
+void bench_sample_end(benchOp *op, ReturnCode err, uint32_t items);
+
+/*! 
+ *****************************************************************************
+ * \brief  End a sample of several runs
+ * Each run is given the mean latency of the sample.
+ * \param[in]	: op
+ * \param[in]	: err, first error of the runs, ERR_NONE if none
+ * \param[in]	: items handled by all the runs, 0 if not counted
+ * \param[in]	: runs in the sample
+ *****************************************************************************
+ */
+void bench_sample_end_runs(benchOp *op, ReturnCode err, uint32_t items, uint32_t runs);
+
+/*! 
+ *****************************************************************************
+ * \brief  Evict the data caches
+ * Writes then reads a buffer larger than the last level cache (bounded to
+ * BENCH_EVICT_MAX), so that the next sample finds none of its data in the
+ * caches. The instruction caches are left as they are.
+ *****************************************************************************
+ */
+void bench_cache_evict(void);
+
+/*! 
+ *****************************************************************************
+ * \brief  Reduce the runs to a result row and keep it for bench_report()
+ * \param[in]	: op
+ * \return the row, NULL if there were no runs or too many rows
+ *****************************************************************************
+ */
+const benchRow *bench_op_end(benchOp *op);
+
+/*! 
+ *****************************************************************************
+ * \brief  Write the rows kept so far
+ * \param[in]	: out, stream to write to
+ * \param[in]	: format
+ * \param[in]	: suite, name of the benchmark program, part of the JSON output
+ *****************************************************************************
+ */
+void bench_report(FILE *out, benchFormat format, const char *suite);
+
+/*! 
+ *****************************************************************************
+ * \brief  Parse a format name, "csv" or "json"
+ * \return ERR_PARAM	: unknown name
+ * \return ERR_NONE	: No error
+ *****************************************************************************
+ */
+ReturnCode bench_format_parse(const char *name, benchFormat *format);
+
+#endif /* BENCH_H */
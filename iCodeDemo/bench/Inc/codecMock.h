@@ -0,0 +1,90 @@
+
+/******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; COPYRIGHT 2018 STMicroelectronics</center></h2>
+  *
+  * Licensed under ST MYLIBERTY SOFTWARE LICENSE AGREEMENT (the "License");
+  * You may not use this file except in compliance with the License.
+  * You may obtain a copy of the License at:
+  *
+  *        http://www.st.com/myliberty
+  *
+  * Unless required by applicable law or agreed to in writing, software 
+  * distributed under the License is distributed on an "AS IS" BASIS, 
+  * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied,
+  * AND SPECIFICALLY DISCLAIMING THE IMPLIED WARRANTIES OF MERCHANTABILITY,
+  * FITNESS FOR A PARTICULAR PURPOSE, AND NON-INFRINGEMENT.
+  * See the License for the specific language governing permissions and
+  * limitations under the License.
+  *
+******************************************************************************/
+
+/*! \file codecMock.h
+ *
+ *  \brief Chip, RF layer and peers standing in for the reader under the codec benchmarks
+ *  
+ *  The codec benchmark links the RFAL sources of the kernels it measures
+ *  and nothing below them. This module provides what they call:
+ *  rfalChipChangeRegBits() and rfalChipChangeTestRegBits() count the
+ *  register writes of the analog configuration, the transceive functions
+ *  of the RF layer hand the frame to a peer answering at once, the
+ *  timers are always expired and no IRQ is ever waited for.
+ *  
+ *  The peers are an ISO-DEP PICC echoing every APDU, chained both ways,
+ *  and an NFC-DEP target answering the ATR_REQ, acknowledging chained
+ *  I-PDUs and echoing the last one. They answer without DID nor NAD.
+ *
+ */
+
+#ifndef CODEC_MOCK_H
+#define CODEC_MOCK_H
+
+/*
+ ******************************************************************************
+ * INCLUDES
+ ******************************************************************************
+ */
+#include <stdint.h>
+#include "st_errno.h"
+
+/*
+ ******************************************************************************
+ * GLOBAL TYPES
+ ******************************************************************************
+ */
+/* Peer answering the frames of the RF layer */
+typedef enum {
+	CODEC_PEER_NONE = 0,	/* No answer, transceive times out */
+	CODEC_PEER_ISODEP,
+	CODEC_PEER_NFCDEP
+}codecPeer;
+
+/*
+ ******************************************************************************
+ * GLOBAL FUNCTION PROTOTYPES
+ ******************************************************************************
+ */
+
+/*! 
+ *****************************************************************************
+ * \brief  Put a peer in the field, in its initial state
+ *****************************************************************************
+ */
+void codec_mock_peer(codecPeer peer);
+
+/*! 
+ *****************************************************************************
+ * \brief  Register writes made so far on the mock chip
+ *****************************************************************************
+ */
+uint32_t codec_mock_reg_writes(void);
+
+/*! 
+ *****************************************************************************
+ * \brief  Frames exchanged so far with the peer
+ *****************************************************************************
+ */
+uint32_t codec_mock_frames(void);
+
+#endif /* CODEC_MOCK_H */
@@ -0,0 +1,366 @@
+
+/******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; COPYRIGHT 2018 STMicroelectronics</center></h2>
+  *
+  * Licensed under ST MYLIBERTY SOFTWARE LICENSE AGREEMENT (the "License");
+  * You may not use this file except in compliance with the License.
+  * You may obtain a copy of the License at:
+  *
+  *        http://www.st.com/myliberty
+  *
+  * Unless required by applicable law or agreed to in writing, software 
+  * distributed under the License is distributed on an "AS IS" BASIS, 
+  * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied,
+  * AND SPECIFICALLY DISCLAIMING THE IMPLIED WARRANTIES OF MERCHANTABILITY,
+  * FITNESS FOR A PARTICULAR PURPOSE, AND NON-INFRINGEMENT.
+  * See the License for the specific language governing permissions and
+  * limitations under the License.
+  *
+******************************************************************************/
+
+/*! \file bench.c
+ *
+ *  \brief Measurement and report harness of the benchmarks
+ *  
+ */
+
+/*
+ ******************************************************************************
+ * INCLUDES
+ ******************************************************************************
+ */
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#include "bench.h"
+#ifdef PLTF_SIM
+#include "pltf_sim.h"
+#endif
+
+/*
+ ******************************************************************************
+ * DEFINES
+ ******************************************************************************
+ */
+/* Latencies from the virtual clock of the simulated reader */
+#if defined(PLTF_SIM) && !defined(BENCH_HOST_CLOCK)
+#define BENCH_SIM_CLOCK
+#endif
+
+#define BENCH_EVICT_DEFAULT	(8 * 1024 * 1024)	/* Cache size assumed when the system does not tell */
+
+/*
+ ******************************************************************************
+ * STATIC VARIABLES
+ ******************************************************************************
+ */
+static benchRow rows[BENCH_ROWS_MAX];
+static uint32_t rowCnt = 0;
+static int cyclesFd = -2;		/* Cycle counter, -2 not opened yet, -1 not available */
+static uint8_t *evictBuf = NULL;
+static size_t evictLen = 0;
+
+/*
+ ******************************************************************************
+ * LOCAL FUNCTIONS
+ ******************************************************************************
+ */
+static uint64_t bench_clock(clockid_t id)
+{
+	struct timespec ts;
+
+	clock_gettime(id, &ts);
+	return ((uint64_t)ts.tv_sec * 1000000000ULL) + (uint64_t)ts.tv_nsec;
+}
+
+static int bench_cmp(const void *a, const void *b)
+{
+	uint64_t x = *(const uint64_t *)a;
+	uint64_t y = *(const uint64_t *)b;
+
+	return (x > y) - (x < y);
+}
+
+/* Nearest rank percentile of sorted latencies, in us */
+static double bench_pct(const uint64_t *lat, uint32_t n, uint32_t pct)
+{
+	uint32_t rank = (uint32_t)(((uint64_t)pct * n + 99) / 100);
+
+	if (rank == 0)
+		rank = 1;
+	return lat[rank - 1] / 1000.0;
+}
+
+static void bench_spi_counters(uint32_t *calls, uint32_t *bytes)
+{
+#ifdef BENCH_SIM_CLOCK
+	pltfSimStats st;
+
+	pltf_sim_get_stats(&st);
+	*calls = st.spiCalls;
+	*bytes = st.spiBytes;
+#else
+	*calls = 0;
+	*bytes = 0;
+#endif
+}
+
+/* User space cycles of the calling thread, opened on first use */
+static bool bench_cycles_open(void)
+{
+	struct perf_event_attr attr;
+
+	if (cyclesFd == -2) {
+		memset(&attr, 0, sizeof(attr));
+		attr.type = PERF_TYPE_HARDWARE;
+		attr.size = sizeof(attr);
+		attr.config = PERF_COUNT_HW_CPU_CYCLES;
+		attr.exclude_kernel = 1;
+		attr.exclude_hv = 1;
+		cyclesFd = (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+		if (cyclesFd < 0)
+			cyclesFd = -1;
+	}
+
+	return (cyclesFd >= 0);
+}
+
+static uint64_t bench_cycles(void)
+{
+	uint64_t val = 0;
+
+	if ((cyclesFd >= 0) && (read(cyclesFd, &val, sizeof(val)) != sizeof(val)))
+		val = 0;
+	return val;
+}
+
+/* Twice the last level cache, L3 or L2 */
+static size_t bench_evict_len(void)
+{
+	long len = -1;
+
+#ifdef _SC_LEVEL3_CACHE_SIZE
+	len = sysconf(_SC_LEVEL3_CACHE_SIZE);
+	if (len <= 0)
+		len = sysconf(_SC_LEVEL2_CACHE_SIZE);
+#endif
+	if (len <= 0)
+		len = BENCH_EVICT_DEFAULT;
+
+	len *= 2;
+	return (len > BENCH_EVICT_MAX) ? BENCH_EVICT_MAX : (size_t)len;
+}
+
+/* Empty CSV field or JSON null for counters the platform does not have */
+static void bench_put_opt(FILE *out, benchFormat format, bool valid, double val)
+{
+	if (valid)
+		fprintf(out, "%.1f", val);
+	else if (format == BENCH_FORMAT_JSON)
+		fprintf(out, "null");
+}
+
+/*
+ ******************************************************************************
+ * GLOBAL FUNCTIONS
+ ******************************************************************************
+ */
+uint64_t bench_time_ns(void)
+{
+#ifdef BENCH_SIM_CLOCK
+	return pltf_sim_time_ns();
+#else
+	return bench_clock(CLOCK_MONOTONIC);
+#endif
+}
+
+uint64_t bench_cpu_ns(void)
+{
+	return bench_clock(CLOCK_PROCESS_CPUTIME_ID);
+}
+
+const char *bench_clock_name(void)
+{
+#if defined(BENCH_HOST_CLOCK)
+	return "host";
+#elif defined(PLTF_SIM)
+	const char *replay = getenv(PLTF_SIM_REPLAY_ENV);
+
+	return ((replay != NULL) && (*replay != '\0')) ? "replay" : "sim";
+#else
+	return "hw";
+#endif
+}
+
+void bench_op_begin(benchOp *op, const char *group, const char *name, uint32_t param)
+{
+	memset(op, 0, sizeof(*op));
+	snprintf(op->row.group, sizeof(op->row.group), "%s", group);
+	snprintf(op->row.name, sizeof(op->row.name), "%s", name);
+	op->row.param = param;
+#ifdef BENCH_SIM_CLOCK
+	op->row.spi = true;
+#endif
+	op->row.cycles = bench_cycles_open();
+}
+
+void bench_sample_start(benchOp *op)
+{
+	bench_spi_counters(&op->spiCalls0, &op->spiBytes0);
+	op->cyc0 = bench_cycles();
+	op->cpu0 = bench_cpu_ns();
+	op->t0 = bench_time_ns();
+}
+
+void bench_sample_end(benchOp *op, ReturnCode err, uint32_t items)
+{
+	bench_sample_end_runs(op, err, items, 1);
+}
+
+void bench_sample_end_runs(benchOp *op, ReturnCode err, uint32_t items, uint32_t runs)
+{
+	uint64_t t = bench_time_ns();
+	uint32_t calls, bytes;
+
+	op->cpuNs += bench_cpu_ns() - op->cpu0;
+	op->cycles += bench_cycles() - op->cyc0;
+	bench_spi_counters(&calls, &bytes);
+	op->spiCalls += calls - op->spiCalls0;
+	op->spiBytes += bytes - op->spiBytes0;
+
+	if (runs == 0)
+		runs = 1;
+	if (op->row.samples < BENCH_SAMPLES_MAX)
+		op->lat[op->row.samples] = (t - op->t0) / runs;
+	op->row.samples++;
+	if (err != ERR_NONE)
+		op->row.errors++;
+	op->runs += runs;
+	op->items += items;
+}
+
+void bench_cache_evict(void)
+{
+	volatile uint8_t *p;
+	uint8_t sum = 0;
+	size_t i;
+
+	if (evictBuf == NULL) {
+		evictLen = bench_evict_len();
+		evictBuf = malloc(evictLen);
+		if (evictBuf == NULL)
+			return;
+	}
+
+	/* One access per cache line is enough, the buffer is written so
+	 * that dirty lines of the sample data are written back as well */
+	p = evictBuf;
+	for (i = 0; i < evictLen; i += 64)
+		p[i] = (uint8_t)i;
+	for (i = 0; i < evictLen; i += 64)
+		sum += p[i];
+	p[0] = sum;
+}
+
+const benchRow *bench_op_end(benchOp *op)
+{
+	benchRow *r = &op->row;
+	uint32_t n = (r->samples < BENCH_SAMPLES_MAX) ? r->samples : BENCH_SAMPLES_MAX;
+	uint64_t sum = 0;
+	uint32_t i;
+
+	if ((n == 0) || (rowCnt >= BENCH_ROWS_MAX))
+		return NULL;
+
+	qsort(op->lat, n, sizeof(op->lat[0]), bench_cmp);
+	for (i = 0; i < n; i++)
+		sum += op->lat[i];
+
+	r->minUs = op->lat[0] / 1000.0;
+	r->p50Us = bench_pct(op->lat, n, 50);
+	r->p90Us = bench_pct(op->lat, n, 90);
+	r->p99Us = bench_pct(op->lat, n, 99);
+	r->maxUs = op->lat[n - 1] / 1000.0;
+	r->meanUs = (sum / 1000.0) / n;
+	/* Items per run times runs per second of latency */
+	if (sum > 0) {
+		r->opsPerSec = n * 1e9 / sum;
+		r->itemsPerSec = ((double)op->items / op->runs) * r->opsPerSec;
+	}
+	if (op->items > 0)
+		r->nsPerItem = ((double)sum / n) / ((double)op->items / op->runs);
+	r->cpuUsPerOp = (op->cpuNs / 1000.0) / op->runs;
+	r->cyclesPerOp = (double)op->cycles / op->runs;
+	r->spiCallsPerOp = (double)op->spiCalls / op->runs;
+	r->spiBytesPerOp = (double)op->spiBytes / op->runs;
+
+	rows[rowCnt] = *r;
+	return &rows[rowCnt++];
+}
+
+void bench_report(FILE *out, benchFormat format, const char *suite)
+{
+	const benchRow *r;
+	uint32_t i;
+
+	if (format == BENCH_FORMAT_JSON)
+		fprintf(out, "{\n  \"suite\": \"%s\",\n  \"clock\": \"%s\",\n  \"results\": [\n", suite, bench_clock_name());
+	else
+		fprintf(out, "group,name,param,samples,errors,min_us,p50_us,p90_us,p99_us,max_us,mean_us,"
+			"ops_per_s,items_per_s,cpu_us_per_op,spi_calls_per_op,spi_bytes_per_op,"
+			"ns_per_item,cycles_per_op\n");
+
+	for (i = 0; i < rowCnt; i++) {
+		r = &rows[i];
+		if (format == BENCH_FORMAT_JSON) {
+			fprintf(out, "    { \"group\": \"%s\", \"name\": \"%s\", \"param\": %u, "
+				"\"samples\": %u, \"errors\": %u, "
+				"\"min_us\": %.3f, \"p50_us\": %.3f, \"p90_us\": %.3f, \"p99_us\": %.3f, "
+				"\"max_us\": %.3f, \"mean_us\": %.3f, \"ops_per_s\": %.1f, \"items_per_s\": %.1f, "
+				"\"cpu_us_per_op\": %.1f, \"spi_calls_per_op\": ",
+				r->group, r->name, r->param, r->samples, r->errors,
+				r->minUs, r->p50Us, r->p90Us, r->p99Us, r->maxUs, r->meanUs,
+				r->opsPerSec, r->itemsPerSec, r->cpuUsPerOp);
+			bench_put_opt(out, format, r->spi, r->spiCallsPerOp);
+			fprintf(out, ", \"spi_bytes_per_op\": ");
+			bench_put_opt(out, format, r->spi, r->spiBytesPerOp);
+			fprintf(out, ", \"ns_per_item\": %.2f, \"cycles_per_op\": ", r->nsPerItem);
+			bench_put_opt(out, format, r->cycles, r->cyclesPerOp);
+			fprintf(out, " }%s\n", ((i + 1) < rowCnt) ? "," : "");
+		} else {
+			fprintf(out, "%s,%s,%u,%u,%u,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.1f,%.1f,%.1f,",
+				r->group, r->name, r->param, r->samples, r->errors,
+				r->minUs, r->p50Us, r->p90Us, r->p99Us, r->maxUs, r->meanUs,
+				r->opsPerSec, r->itemsPerSec, r->cpuUsPerOp);
+			bench_put_opt(out, format, r->spi, r->spiCallsPerOp);
+			fprintf(out, ",");
+			bench_put_opt(out, format, r->spi, r->spiBytesPerOp);
+			fprintf(out, ",%.2f,", r->nsPerItem);
+			bench_put_opt(out, format, r->cycles, r->cyclesPerOp);
+			fprintf(out, "\n");
+		}
+	}
+
+	if (format == BENCH_FORMAT_JSON)
+		fprintf(out, "  ]\n}\n");
+}
+
+ReturnCode bench_format_parse(const char *name, benchFormat *format)
+{
+	if (!strcmp(name, "csv"))
+		*format = BENCH_FORMAT_CSV;
+	else if (!strcmp(name, "json"))
+		*format = BENCH_FORMAT_JSON;
+	else
+		return ERR_PARAM;
+
+	return ERR_NONE;
+}
@@ -0,0 +1,1024 @@
+
+/******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; COPYRIGHT 2018 STMicroelectronics</center></h2>
+  *
+  * Licensed under ST MYLIBERTY SOFTWARE LICENSE AGREEMENT (the "License");
+  * You may not use this file except in compliance with the License.
+  * You may obtain a copy of the License at:
+  *
+  *        http://www.st.com/myliberty
+  *
+  * Unless required by applicable law or agreed to in writing, software 
+  * distributed under the License is distributed on an "AS IS" BASIS, 
+  * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied,
+  * AND SPECIFICALLY DISCLAIMING THE IMPLIED WARRANTIES OF MERCHANTABILITY,
+  * FITNESS FOR A PARTICULAR PURPOSE, AND NON-INFRINGEMENT.
+  * See the License for the specific language governing permissions and
+  * limitations under the License.
+  *
+******************************************************************************/
+
+/*! \file codecBench.c
+ *
+ *  \brief CPU cost of the codec kernels of the RFAL
+ *  
+ *  Runs, with nothing but the CPU involved: the NFC-V VCD coding in 1 of
+ *  4 and 1 of 256, the VICC decoding, the CRC, the analog configuration
+ *  search and apply, hex2str() of the logger and the ISO-DEP and NFC-DEP
+ *  header build and parse of an exchange. The chip, the RF layer and the
+ *  peers are the mocks of codecMock.c.
+ *  
+ *  Each kernel is measured on frames of the sizes met in the field: an
+ *  inventory, a 32 byte block and a 1 KB message, the item counted being
+ *  the byte. Warm samples are batches of runs following a run which
+ *  loads the caches, cold samples are single runs after the data caches
+ *  have been evicted.
+ *  
+ *  Before they are measured, the NFC-V VCD coding, the VICC decoding and
+ *  each CRC engine are checked against copies of the bit by bit coder,
+ *  decoder and CRC they replaced: a mismatch is reported on stderr and the
+ *  run exits with 1. --check runs these checks alone, as the ctest does.
+ *
+ */
+
+/*
+ ******************************************************************************
+ * INCLUDES
+ ******************************************************************************
+ */
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include "bench.h"
+#include "codecMock.h"
+#include "st_errno.h"
+#include "platform.h"
+#include "st25r3911.h"
+#include "rfal_rf.h"
+#include "rfal_crc.h"
+#include "rfal_iso15693_2.h"
+#include "rfal_analogConfig.h"
+#include "rfal_isoDep.h"
+#include "rfal_nfcDep.h"
+#include "logger.h"
+
+/*
+ ******************************************************************************
+ * DEFINES
+ ******************************************************************************
+ */
+#define CODEC_ITERATIONS	100	/* Default samples per kernel, frame and cache state */
+#define CODEC_RUNS		32	/* Default runs per warm sample */
+#define CODEC_FRAME_MAX		1024	/* Largest frame */
+#define CODEC_VCD_CHUNK		ST25R3911_FIFO_DEPTH	/* The RFAL codes a FIFO at a time */
+#define CODEC_VCD_CODED_MAX	0xFFFF	/* Largest chunk the NFC-V coder takes */
+#define CODEC_VCD_CHECK_SHORT	40	/* Frames checked of every length up to this one */
+#define CODEC_VICC_CHECK_SHORT	40	/* Responses checked of every length up to this one */
+#define CODEC_VICC_CHECK_RANDOM	20000	/* Random streams checked */
+#define CODEC_VICC_MAX		((2 * (CODEC_FRAME_MAX + 2)) + 4)	/* Manchester coded frame, SOF and EOF */
+#define CODEC_HEX_MAX		32	/* Longest hex2str(), its strings hold 63 bytes */
+#define CODEC_FWT		rfalConvMsTo1fc(20)	/* Frame wait time, never waited for */
+#define CODEC_NFCDEP_CHUNK	(RFAL_NFCDEP_FRAME_SIZE_MAX_LEN - 3)	/* Payload of a PDU: frame less CMD0, CMD1 and PFB */
+#define CODEC_NFCDEP_PDUS	((CODEC_FRAME_MAX + CODEC_NFCDEP_CHUNK - 1) / CODEC_NFCDEP_CHUNK)
+
+/* Analog configurations set when entering a mode, and one the table does not have */
+#define CODEC_AC_POLL_NFCA_TX	(RFAL_ANALOG_CONFIG_POLL | RFAL_ANALOG_CONFIG_TECH_NFCA | RFAL_ANALOG_CONFIG_BITRATE_COMMON | RFAL_ANALOG_CONFIG_TX)
+#define CODEC_AC_POLL_NFCV_RX	(RFAL_ANALOG_CONFIG_POLL | RFAL_ANALOG_CONFIG_TECH_NFCV | RFAL_ANALOG_CONFIG_BITRATE_COMMON | RFAL_ANALOG_CONFIG_RX)
+#define CODEC_AC_LISTEN_AP2P_RX	(RFAL_ANALOG_CONFIG_LISTEN | RFAL_ANALOG_CONFIG_TECH_AP2P | RFAL_ANALOG_CONFIG_BITRATE_424 | RFAL_ANALOG_CONFIG_RX)
+#define CODEC_AC_MISSING	(RFAL_ANALOG_CONFIG_POLL | RFAL_ANALOG_CONFIG_TECH_NFCF | RFAL_ANALOG_CONFIG_BITRATE_848 | RFAL_ANALOG_CONFIG_TX)
+
+/*
+ ******************************************************************************
+ * LOCAL DATA TYPES
+ ******************************************************************************
+ */
+typedef struct {
+	benchFormat	format;
+	const char	*out;		/* File the results go to, stdout if NULL */
+	uint32_t	iterations;
+	uint32_t	runs;		/* Runs per warm sample */
+	const char	*groups;	/* Groups to run, all if NULL */
+	bool		check;		/* Only check the kernels against their references */
+}codecOptions;
+
+/* One run of a kernel on a frame of len bytes */
+typedef ReturnCode (*codecKernel)(uint16_t len);
+
+/*
+ ******************************************************************************
+ * STATIC VARIABLES
+ ******************************************************************************
+ */
+static codecOptions opt = { BENCH_FORMAT_CSV, NULL, CODEC_ITERATIONS, CODEC_RUNS, NULL, false };
+static benchOp op;
+
+/* INVENTORY, WRITE SINGLE BLOCK of 32 bytes and 1 KB, CRC excluded */
+static const uint16_t vcdFrames[] = { 3, 35, CODEC_FRAME_MAX };
+/* Answers to an INVENTORY, a READ SINGLE BLOCK of 32 bytes and 1 KB, CRC excluded */
+static const uint16_t viccFrames[] = { 10, 33, CODEC_FRAME_MAX };
+/* UID and block of the NFC-V demo */
+static const uint16_t hexFrames[] = { 8, CODEC_HEX_MAX };
+/* Case 1 command, UPDATE BINARY of 32 bytes and 1 KB */
+static const uint16_t apduFrames[] = { 4, 37, CODEC_FRAME_MAX };
+
+static uint8_t frame[CODEC_FRAME_MAX + 2];
+static uint8_t coded[CODEC_VCD_CHUNK];
+static uint8_t vcdIn[2][CODEC_FRAME_MAX];
+static uint8_t vcdOut[2][CODEC_VCD_CODED_MAX];
+static uint8_t vicc[CODEC_VICC_MAX];
+static uint16_t viccLen;
+static uint8_t decoded[CODEC_FRAME_MAX + 4];
+static uint8_t viccOut[2][CODEC_FRAME_MAX + 4];
+static uint32_t viccSeed = 1;
+static rfalAnalogConfigId analogId;
+static uint16_t analogTblSize;
+static rfalIsoDepApduBufFormat apduTx;
+static rfalIsoDepApduBufFormat apduRx;
+static rfalIsoDepBufFormat apduTmp;
+static rfalNfcDepBufFormat depTx[CODEC_NFCDEP_PDUS];
+static rfalNfcDepBufFormat depRx;
+
+/*
+ ******************************************************************************
+ * LOCAL FUNCTIONS - HARNESS
+ ******************************************************************************
+ */
+static bool codec_group(const char *name)
+{
+	const char *p = opt.groups;
+	size_t len = strlen(name);
+
+	if (p == NULL)
+		return true;
+
+	while (*p != '\0') {
+		if (!strncmp(p, name, len) && ((p[len] == ',') || (p[len] == '\0')))
+			return true;
+		p += strcspn(p, ",");
+		if (*p == ',')
+			p++;
+	}
+
+	return false;
+}
+
+/* Warm and cold rows of a kernel on one frame size, items are the bytes */
+static void codec_measure(const char *group, const char *name, codecKernel kernel, uint16_t len, uint32_t items)
+{
+	char rowName[32];
+	ReturnCode err, res;
+	uint32_t i, r;
+
+	snprintf(rowName, sizeof(rowName), "%s_warm", name);
+	bench_op_begin(&op, group, rowName, len);
+	kernel(len);
+	for (i = 0; i < opt.iterations; i++) {
+		err = ERR_NONE;
+		bench_sample_start(&op);
+		for (r = 0; r < opt.runs; r++) {
+			res = kernel(len);
+			if (res != ERR_NONE)
+				err = res;
+		}
+		bench_sample_end_runs(&op, err, items * opt.runs, opt.runs);
+	}
+	bench_op_end(&op);
+
+	snprintf(rowName, sizeof(rowName), "%s_cold", name);
+	bench_op_begin(&op, group, rowName, len);
+	for (i = 0; i < opt.iterations; i++) {
+		bench_cache_evict();
+		bench_sample_start(&op);
+		err = kernel(len);
+		bench_sample_end(&op, err, items);
+	}
+	bench_op_end(&op);
+}
+
+static void codec_fill(uint8_t *buf, uint16_t len, uint8_t seed)
+{
+	uint16_t i;
+
+	for (i = 0; i < len; i++)
+		buf[i] = (uint8_t)((i * 131) + seed);
+}
+
+/* Cost of the measurement itself */
+static ReturnCode codec_empty(uint16_t len)
+{
+	(void)len;
+	return ERR_NONE;
+}
+
+/*
+ ******************************************************************************
+ * LOCAL FUNCTIONS - NFC-V CODING
+ ******************************************************************************
+ */
+/* A frame coded a FIFO at a time, flags and CRC added as the RFAL sends it */
+static ReturnCode codec_vcd(uint16_t len)
+{
+	uint16_t offset = 0;
+	uint16_t total, outLen;
+	ReturnCode err;
+
+	do {
+		err = iso15693VCDCode(frame, len, true, true, false, &total, &offset, coded, sizeof(coded), &outLen);
+	} while (err == ERR_AGAIN);
+
+	return err;
+}
+
+static void codec_vcd_run(iso15693VcdCoding_t coding, const char *name)
+{
+	const struct iso15693StreamConfig *stream;
+	iso15693PhyConfig_t cfg = { coding, false };
+	uint32_t i;
+
+	iso15693PhyConfigure(&cfg, &stream);
+	for (i = 0; i < (sizeof(vcdFrames) / sizeof(vcdFrames[0])); i++) {
+		codec_fill(frame, vcdFrames[i], 0x26);
+		codec_measure("vcd", name, codec_vcd, vcdFrames[i], vcdFrames[i]);
+	}
+}
+
+/* The coder of the RFAL before its table driven version, bit by bit, the
+ * reference of codec_vcd_check() */
+static ReturnCode codec_vcd_ref_byte(iso15693VcdCoding_t coding, uint8_t data, uint8_t *outbuf, uint16_t maxOutBufLen, uint16_t *outBufLen)
+{
+	static const uint8_t pulse[] = { 0x02, 0x08, 0x20, 0x80 };
+	uint8_t tmp = data;
+	uint16_t a, n = ((coding == ISO15693_VCD_CODING_1_4) ? 4 : 64);
+
+	*outBufLen = 0;
+	if (maxOutBufLen < n)
+		return ERR_NOMEM;
+
+	for (a = 0; a < n; a++) {
+		if (coding == ISO15693_VCD_CODING_1_4) {
+			*outbuf = pulse[tmp & 0x3];
+			tmp >>= 2;
+		} else {
+			*outbuf = ((tmp < 4) ? pulse[tmp] : 0);
+			tmp -= 4;
+		}
+		outbuf++;
+		(*outBufLen)++;
+	}
+
+	return ERR_NONE;
+}
+
+static ReturnCode codec_vcd_ref(iso15693VcdCoding_t coding, uint8_t *buffer, uint16_t length, bool sendCrc, bool sendFlags, bool picopassMode,
+				uint16_t *subbit_total_length, uint16_t *offset, uint8_t *outbuf, uint16_t outBufSize, uint16_t *actOutBufSize)
+{
+	ReturnCode err = ERR_NONE;
+	uint8_t transbuf[2];
+	uint16_t crc = 0;
+	uint16_t filled;
+	uint8_t crc_len = (sendCrc ? 2 : 0);
+	bool oneOf4 = (coding == ISO15693_VCD_CODING_1_4);
+
+	*actOutBufSize = 0;
+	*subbit_total_length = (1 + ((length + crc_len) * (oneOf4 ? 4 : 64)) + 1);
+	if (oneOf4 ? (outBufSize < 5) : (outBufSize < ((*offset != 0) ? 64 : 65)))
+		return ERR_NOMEM;
+	if (length == 0)
+		*subbit_total_length = 1;
+
+	if ((length != 0) && (*offset == 0) && sendFlags && !picopassMode) {
+		buffer[0] |= ISO15693_REQ_FLAG_HIGH_DATARATE;
+		buffer[0] &= ~ISO15693_REQ_FLAG_TWO_SUBCARRIERS;
+	}
+
+	if ((length != 0) && (*offset == 0)) {
+		*outbuf++ = (oneOf4 ? 0x21 : 0x81);
+		(*actOutBufSize)++;
+		outBufSize--;
+	}
+
+	while ((*offset < length) && (err == ERR_NONE)) {
+		err = codec_vcd_ref_byte(coding, buffer[*offset], outbuf, outBufSize, &filled);
+		(*actOutBufSize) += filled;
+		outbuf += filled;
+		outBufSize -= filled;
+		if (err == ERR_NONE)
+			(*offset)++;
+	}
+	if (err != ERR_NONE)
+		return ERR_AGAIN;
+
+	while ((err == ERR_NONE) && sendCrc && (*offset < (length + 2))) {
+		if (crc == 0) {
+			crc = rfalCrcCalculateCcitt((picopassMode ? 0xE012 : 0xFFFF), (picopassMode ? (buffer + 1) : buffer),
+						    (picopassMode ? (length - 1) : length));
+			crc = (picopassMode ? crc : ~crc);
+		}
+		transbuf[0] = (crc & 0xff);
+		transbuf[1] = ((crc >> 8) & 0xff);
+		err = codec_vcd_ref_byte(coding, transbuf[*offset - length], outbuf, outBufSize, &filled);
+		(*actOutBufSize) += filled;
+		outbuf += filled;
+		outBufSize -= filled;
+		if (err == ERR_NONE)
+			(*offset)++;
+	}
+	if (err != ERR_NONE)
+		return ERR_AGAIN;
+
+	*outbuf = 0x04;
+	(*actOutBufSize)++;
+
+	return ERR_NONE;
+}
+
+/* Every call of the coder, chunk by chunk, against the reference: return
+ * code, coded bytes, offset, length in subbits and request flags. With an
+ * odd seed another frame is coded between the calls */
+static bool codec_vcd_check_frame(iso15693VcdCoding_t coding, uint16_t len, uint16_t chunk, bool sendCrc, bool sendFlags, bool picopass, uint8_t seed)
+{
+	uint16_t offset[2] = { 0, 0 }, total[2], outLen[2];
+	uint16_t otherOffset, otherTotal, otherLen;
+	ReturnCode err[2];
+	uint32_t calls = 0;
+
+	codec_fill(vcdIn[0], len, seed);
+	codec_fill(vcdIn[1], len, seed);
+
+	do {
+		err[0] = codec_vcd_ref(coding, vcdIn[0], len, sendCrc, sendFlags, picopass, &total[0], &offset[0], vcdOut[0], chunk, &outLen[0]);
+		err[1] = iso15693VCDCode(vcdIn[1], len, sendCrc, sendFlags, picopass, &total[1], &offset[1], vcdOut[1], chunk, &outLen[1]);
+
+		/* Another frame coded in between: the next call catches up on the CRC */
+		if (seed & 1) {
+			otherOffset = 0;
+			iso15693VCDCode(frame, 3, true, true, false, &otherTotal, &otherOffset, coded, sizeof(coded), &otherLen);
+		}
+
+		if ((err[0] != err[1]) || (offset[0] != offset[1]) || (total[0] != total[1]) || (outLen[0] != outLen[1])
+		    || memcmp(vcdOut[0], vcdOut[1], outLen[0]) || ((len != 0) && (vcdIn[0][0] != vcdIn[1][0])))
+			return false;
+	} while ((err[0] == ERR_AGAIN) && (++calls < (2U * (CODEC_FRAME_MAX + 2))));
+
+	return true;
+}
+
+static ReturnCode codec_vcd_check(iso15693VcdCoding_t coding, const char *name)
+{
+	static const uint16_t lens[] = { 256, 257, 300, CODEC_FRAME_MAX };
+	const struct iso15693StreamConfig *stream;
+	iso15693PhyConfig_t cfg = { coding, false };
+	uint16_t chunks[] = { 4, 5, 6, 7, 9, 63, 64, 65, 66, 67, CODEC_VCD_CHUNK, 129, 130, 131, 1000, CODEC_VCD_CODED_MAX };
+	uint16_t len, c, f, i;
+	uint32_t frames = 0, failed = 0;
+
+	iso15693PhyConfigure(&cfg, &stream);
+
+	/* Short frames, then frames with every byte value */
+	for (i = 0; i < (CODEC_VCD_CHECK_SHORT + 1 + (sizeof(lens) / sizeof(lens[0]))); i++) {
+		len = ((i <= CODEC_VCD_CHECK_SHORT) ? i : lens[i - CODEC_VCD_CHECK_SHORT - 1]);
+		for (c = 0; c < (sizeof(chunks) / sizeof(chunks[0])); c++) {
+			for (f = 0; f < 8; f++) {
+				/* The PicoPass CRC leaves out the first byte, there must be one */
+				if ((len == 0) && (f & 4))
+					continue;
+				frames++;
+				if (!codec_vcd_check_frame(coding, len, chunks[c], (f & 1), (f & 2), (f & 4), (uint8_t)(len + f))) {
+					if (failed++ == 0)
+						fprintf(stderr, "Error: %s coding of %u bytes in chunks of %u (crc %u, flags %u, picopass %u) differs from the reference\n",
+							name, len, chunks[c], (f & 1), ((f >> 1) & 1), ((f >> 2) & 1));
+				}
+			}
+		}
+	}
+
+	if (failed != 0) {
+		fprintf(stderr, "Error: %s coding, %u of %u frames differ from the reference\n", name, failed, frames);
+		return ERR_INTERNAL;
+	}
+
+	return ERR_NONE;
+}
+
+/* VICC frame as the chip delivers it in stream mode: SOF, data and CRC
+ * Manchester coded, EOF. Logic 0 is (1,0), logic 1 is (0,1) */
+static void codec_vicc_encode(uint16_t len)
+{
+	static const uint8_t sof[] = { 1, 1, 1, 0, 1 };
+	static const uint8_t eof[] = { 1, 0, 1, 1, 1 };
+	uint32_t pos = 0;
+	uint16_t crc, i;
+	uint8_t k;
+
+	codec_fill(frame, len, 0x00);
+	crc = ~rfalCrcCalculateCcitt(0xFFFF, frame, len);
+	frame[len] = (uint8_t)(crc & 0xFF);
+	frame[len + 1] = (uint8_t)(crc >> 8);
+
+	memset(vicc, 0, sizeof(vicc));
+	for (k = 0; k < sizeof(sof); k++, pos++)
+		vicc[pos / 8] |= (sof[k] << (pos % 8));
+	for (i = 0; i < (len + 2); i++) {
+		for (k = 0; k < 8; k++) {
+			pos += ((frame[i] >> k) & 1);
+			vicc[pos / 8] |= (1 << (pos % 8));
+			pos += 2 - ((frame[i] >> k) & 1);
+		}
+	}
+	for (k = 0; k < sizeof(eof); k++, pos++)
+		vicc[pos / 8] |= (eof[k] << (pos % 8));
+
+	viccLen = (uint16_t)((pos + 7) / 8);
+}
+
+/* Decoded into a buffer with room for the CRC and a spare byte, as the RFAL does */
+static ReturnCode codec_vicc(uint16_t len)
+{
+	uint16_t pos, bits;
+	ReturnCode err;
+
+	err = iso15693VICCDecode(vicc, viccLen, decoded, len + 4, &pos, &bits, 0, false);
+	if ((err == ERR_NONE) && (pos != (len + 2)))
+		return ERR_INTERNAL;
+	return err;
+}
+
+/* The decoder of the RFAL before its table driven version, pair by pair,
+ * the reference of codec_vicc_check() */
+static ReturnCode codec_vicc_ref(const uint8_t *inBuf, uint16_t inBufLen, uint8_t *outBuf, uint16_t outBufLen,
+				 uint16_t *outBufPos, uint16_t *bitsBeforeCol, uint16_t ignoreBits, bool picopassMode)
+{
+	ReturnCode err = ERR_NONE;
+	uint16_t crc, mp, bp;
+	uint8_t man;
+
+	*bitsBeforeCol = 0;
+	*outBufPos = 0;
+
+	if ((inBuf[0] & 0x1f) != 0x17)
+		return ERR_FRAMING;
+	if (outBufLen == 0)
+		return ERR_NONE;
+
+	memset(outBuf, 0, outBufLen);
+
+	for (mp = 5, bp = 0; mp < ((inBufLen * 8) - 2); mp += 2) {
+		man = ((inBuf[mp / 8] >> (mp % 8)) & 0x1);
+		man |= (((inBuf[(mp + 1) / 8] >> ((mp + 1) % 8)) & 0x1) << 1);
+		if (man == 1)
+			bp++;
+		if (man == 2) {
+			outBuf[bp / 8] |= (1 << (bp % 8));
+			bp++;
+		}
+		if (((bp % 8) == 0) && ((inBuf[mp / 8] & 0xe0) == 0xa0) && (inBuf[(mp / 8) + 1] == 0x03))
+			break;
+		if ((man == 0) || (man == 3)) {
+			if (bp >= ignoreBits) {
+				err = ERR_RF_COLLISION;
+				break;
+			}
+			bp++;
+		}
+		if (bp >= (outBufLen * 8))
+			break;
+	}
+
+	*outBufPos = bp / 8;
+	*bitsBeforeCol = bp;
+
+	if (err != ERR_NONE)
+		return err;
+	if (((bp % 8) != 0) || (*outBufPos <= 2))
+		return ERR_CRC;
+
+	crc = rfalCrcCalculateCcitt((picopassMode ? 0xE012 : 0xFFFF), outBuf, (*outBufPos - 2));
+	crc = (picopassMode ? crc : ~crc);
+	if (((crc & 0xff) != outBuf[*outBufPos - 2]) || (((crc >> 8) & 0xff) != outBuf[*outBufPos - 1]))
+		return ERR_CRC;
+
+	return ERR_NONE;
+}
+
+static uint32_t codec_vicc_rand(void)
+{
+	viccSeed = (viccSeed * 1103515245U) + 12345U;
+	return (viccSeed >> 8);
+}
+
+/* Received bit position of Manchester pair p, after the SOF */
+static void codec_vicc_pair(uint16_t p, uint8_t man)
+{
+	uint16_t pos = (5 + (2 * p));
+
+	vicc[pos / 8] = (uint8_t)((vicc[pos / 8] & ~(1 << (pos % 8))) | ((man & 1) << (pos % 8)));
+	pos++;
+	vicc[pos / 8] = (uint8_t)((vicc[pos / 8] & ~(1 << (pos % 8))) | (((man >> 1) & 1) << (pos % 8)));
+}
+
+/* Decodes vicc with the decoder and the reference: return code, positions and output buffer */
+static bool codec_vicc_check_frame(uint16_t inLen, uint16_t outLen, uint16_t ignoreBits, bool picopass)
+{
+	uint16_t pos[2], bits[2];
+	ReturnCode err[2];
+
+	memset(viccOut, 0x5A, sizeof(viccOut));
+	err[0] = codec_vicc_ref(vicc, inLen, viccOut[0], outLen, &pos[0], &bits[0], ignoreBits, picopass);
+	err[1] = iso15693VICCDecode(vicc, inLen, viccOut[1], outLen, &pos[1], &bits[1], ignoreBits, picopass);
+
+	return ((err[0] == err[1]) && (pos[0] == pos[1]) && (bits[0] == bits[1]) && !memcmp(viccOut[0], viccOut[1], sizeof(viccOut[0])));
+}
+
+static ReturnCode codec_vicc_check(void)
+{
+	static const uint16_t lens[] = { 255, 256, CODEC_FRAME_MAX };
+	uint16_t outLens[6], ignore[5];
+	uint16_t len, pairs, col, i, o, g, t;
+	uint32_t frames = 0, failed = 0;
+	bool pico;
+
+	/* Responses as received, cut short, and with a collision, also an ignored one */
+	for (i = 0; i < (CODEC_VICC_CHECK_SHORT + 1 + (sizeof(lens) / sizeof(lens[0]))); i++) {
+		len = ((i <= CODEC_VICC_CHECK_SHORT) ? i : lens[i - CODEC_VICC_CHECK_SHORT - 1]);
+		pairs = (8 * (len + 2));
+		col = (uint16_t)(codec_vicc_rand() % pairs);
+		outLens[0] = 0; outLens[1] = 1; outLens[2] = ((len + 2) / 2);
+		outLens[3] = (len + 1); outLens[4] = (len + 2); outLens[5] = (len + 4);
+		ignore[0] = 0; ignore[1] = col; ignore[2] = (col + 1); ignore[3] = ((col + 8) & ~7); ignore[4] = 0xFFFF;
+
+		for (t = 0; t < 3; t++) {
+			codec_vicc_encode(len);
+			if (t == 1)
+				codec_vicc_pair(col, 0x0);
+			if (t == 2)
+				codec_vicc_pair(col, 0x3);
+			for (o = 0; o < 6; o++) {
+				for (g = 0; g < 5; g++) {
+					for (pico = false; ; pico = true) {
+						frames += 2;
+						if (!codec_vicc_check_frame(viccLen, outLens[o], ignore[g], pico)
+						    || !codec_vicc_check_frame((viccLen - 1 - (col % 3)), outLens[o], ignore[g], pico)) {
+							if (failed++ == 0)
+								fprintf(stderr, "Error: VICC decoding of %u bytes (collision %u at pair %u, out %u, ignore %u) differs from the reference\n",
+									len, t, col, outLens[o], ignore[g]);
+						}
+						if (pico)
+							break;
+					}
+				}
+			}
+		}
+	}
+
+	/* Random streams after a SOF, EOF patterns and collisions included */
+	for (i = 0; i < CODEC_VICC_CHECK_RANDOM; i++) {
+		len = (uint16_t)(1 + (codec_vicc_rand() % 64));
+		for (t = 0; t <= len; t++)
+			vicc[t] = (uint8_t)codec_vicc_rand();
+		if ((i % 4) != 0)
+			vicc[0] = (uint8_t)((vicc[0] & 0xe0) | 0x17);
+		/* Mostly valid pairs, so that the table takes whole bytes */
+		for (t = 0; t < ((4 * len) - 3); t++) {
+			if ((codec_vicc_rand() % 16) != 0)
+				codec_vicc_pair(t, (uint8_t)(1 + (codec_vicc_rand() & 1)));
+		}
+		if ((len > 2) && ((i % 3) == 0)) {
+			t = (uint16_t)(2 + (2 * (codec_vicc_rand() % ((len - 1) / 2))));
+			vicc[t] = (uint8_t)((vicc[t] & 0x1f) | 0xa0);
+			vicc[t + 1] = 0x03;
+		}
+		frames++;
+		if (!codec_vicc_check_frame(len, (uint16_t)(codec_vicc_rand() % 40), (uint16_t)(codec_vicc_rand() % 300), ((i % 2) != 0))) {
+			if (failed++ == 0)
+				fprintf(stderr, "Error: VICC decoding of random stream %u of %u bytes differs from the reference\n", i, len);
+		}
+	}
+
+	if (failed != 0) {
+		fprintf(stderr, "Error: VICC decoding, %u of %u responses differ from the reference\n", failed, frames);
+		return ERR_INTERNAL;
+	}
+
+	return ERR_NONE;
+}
+
+static ReturnCode codec_vicc_run(void)
+{
+	ReturnCode err;
+	uint32_t i;
+
+	err = codec_vicc_check();
+	if (opt.check)
+		return err;
+
+	for (i = 0; i < (sizeof(viccFrames) / sizeof(viccFrames[0])); i++) {
+		codec_vicc_encode(viccFrames[i]);
+		codec_measure("vicc", "decode", codec_vicc, viccFrames[i], viccFrames[i] + 2);
+	}
+
+	return err;
+}
+
+/*
+ ******************************************************************************
+ * LOCAL FUNCTIONS - CRC, ANALOG CONFIGURATION, LOGGER
+ ******************************************************************************
+ */
+static ReturnCode codec_crc(uint16_t len)
+{
+	volatile uint16_t crc;
+
+	crc = rfalCrcCalculateCcitt(0xFFFF, frame, len);
+	(void)crc;
+	return ERR_NONE;
+}
+
+/* The CRC of the RFAL before its engines, the reference of codec_crc_check() */
+static uint16_t codec_crc_ref(uint16_t crc, const uint8_t *buf, uint16_t len)
+{
+	uint8_t dat;
+	uint16_t i;
+
+	for (i = 0; i < len; i++) {
+		dat = (uint8_t)(buf[i] ^ (crc & 0xFF));
+		dat ^= (uint8_t)(dat << 4);
+		crc = (crc >> 8) ^ ((uint16_t)dat << 8) ^ ((uint16_t)dat << 3) ^ ((uint16_t)dat >> 4);
+	}
+
+	return crc;
+}
+
+/* Every preload with every byte and with a frame of several folds, then
+ * every length and alignment up to a few folds, and a frame in pieces */
+static ReturnCode codec_crc_check(const char *name)
+{
+	static const uint16_t preloads[] = { 0xFFFF, 0xE012 };
+	rfalCrcContext ctx;
+	uint32_t pre, failed = 0;
+	uint16_t b, len, align, k, piece;
+
+	codec_fill(frame, sizeof(frame), 0xA7);
+
+	for (pre = 0; pre <= 0xFFFF; pre++) {
+		for (b = 0; b <= 0xFF; b++) {
+			decoded[0] = (uint8_t)b;
+			if (rfalCrcCalculateCcitt((uint16_t)pre, decoded, 1) != codec_crc_ref((uint16_t)pre, decoded, 1))
+				failed++;
+		}
+		if (rfalCrcCalculateCcitt((uint16_t)pre, frame, 64) != codec_crc_ref((uint16_t)pre, frame, 64))
+			failed++;
+	}
+
+	for (k = 0; k < (sizeof(preloads) / sizeof(preloads[0])); k++) {
+		for (align = 0; align < 16; align++) {
+			for (len = 0; len <= 300; len++) {
+				if (rfalCrcCalculateCcitt(preloads[k], &frame[align], len) != codec_crc_ref(preloads[k], &frame[align], len))
+					failed++;
+			}
+		}
+		if (rfalCrcCalculateCcitt(preloads[k], frame, CODEC_FRAME_MAX) != codec_crc_ref(preloads[k], frame, CODEC_FRAME_MAX))
+			failed++;
+
+		/* As the blocks of a response arrive */
+		rfalCrcInitCcitt(&ctx, preloads[k]);
+		for (len = 0, piece = 1; len < CODEC_FRAME_MAX; len += piece, piece = (uint16_t)((piece * 7) % 97) + 1)
+			rfalCrcUpdateCcitt(&ctx, &frame[len], ((piece < (CODEC_FRAME_MAX - len)) ? piece : (CODEC_FRAME_MAX - len)));
+		if (rfalCrcGetCcitt(&ctx) != codec_crc_ref(preloads[k], frame, CODEC_FRAME_MAX))
+			failed++;
+	}
+
+	if (failed != 0) {
+		fprintf(stderr, "Error: CRC engine %s, %u results differ from the reference\n", name, failed);
+		return ERR_INTERNAL;
+	}
+
+	return ERR_NONE;
+}
+
+static ReturnCode codec_crc_run(void)
+{
+	static const struct {
+		rfalCrcEngine	engine;
+		const char	*name;
+	} engines[] = {
+		{ RFAL_CRC_ENGINE_BYTE, "ccitt_byte" },
+		{ RFAL_CRC_ENGINE_SLICE8, "ccitt_slice8" },
+		{ RFAL_CRC_ENGINE_CLMUL, "ccitt_clmul" },
+		{ RFAL_CRC_ENGINE_AUTO, "ccitt" },
+	};
+	ReturnCode err = ERR_NONE;
+	uint32_t i, e;
+
+	for (e = 0; e < (sizeof(engines) / sizeof(engines[0])); e++) {
+		/* No carry-less multiply on this CPU: no row */
+		if (rfalCrcSetEngineCcitt(engines[e].engine) != ERR_NONE)
+			continue;
+
+		if (codec_crc_check(engines[e].name) != ERR_NONE)
+			err = ERR_INTERNAL;
+		if (opt.check)
+			continue;
+		for (i = 0; i < (sizeof(vcdFrames) / sizeof(vcdFrames[0])); i++) {
+			codec_fill(frame, vcdFrames[i], 0x5A);
+			codec_measure("crc", engines[e].name, codec_crc, vcdFrames[i], vcdFrames[i]);
+		}
+	}
+
+	return err;
+}
+
+static ReturnCode codec_analog(uint16_t len)
+{
+	(void)len;
+	return rfalSetAnalogConfig(analogId);
+}
+
+/* The whole table is searched on every call, its bytes are the items;
+ * the parameter is the register writes of the configuration */
+static void codec_analog_one(rfalAnalogConfigId id, const char *name)
+{
+	uint32_t writes;
+
+	analogId = id;
+	writes = codec_mock_reg_writes();
+	rfalSetAnalogConfig(id);
+	writes = codec_mock_reg_writes() - writes;
+
+	codec_measure("analog", name, codec_analog, (uint16_t)writes, analogTblSize);
+}
+
+static void codec_analog_run(void)
+{
+	static uint8_t tbl[RFAL_ANALOG_CONFIG_TBL_SIZE];
+
+	rfalAnalogConfigInitialize();
+	if (rfalAnalogConfigListReadRaw(tbl, sizeof(tbl), &analogTblSize) != ERR_NONE)
+		analogTblSize = 0;
+
+	codec_analog_one(RFAL_ANALOG_CONFIG_TECH_CHIP, "chip");
+	codec_analog_one(CODEC_AC_POLL_NFCA_TX, "poll_nfca_tx");
+	codec_analog_one(CODEC_AC_POLL_NFCV_RX, "poll_nfcv_rx");
+	codec_analog_one(CODEC_AC_LISTEN_AP2P_RX, "listen_ap2p_424_rx");
+	codec_analog_one(CODEC_AC_MISSING, "missing");
+}
+
+static ReturnCode codec_hex(uint16_t len)
+{
+	const char *str = hex2str(frame, len);
+
+	return (str[(2 * len) - 1] != '\0') && (str[2 * len] == '\0') ? ERR_NONE : ERR_INTERNAL;
+}
+
+static void codec_hex_run(void)
+{
+	uint32_t i;
+
+	for (i = 0; i < (sizeof(hexFrames) / sizeof(hexFrames[0])); i++) {
+		codec_fill(frame, hexFrames[i], 0xE0);
+		codec_measure("hex", "hex2str", codec_hex, hexFrames[i], hexFrames[i]);
+	}
+}
+
+/*
+ ******************************************************************************
+ * LOCAL FUNCTIONS - ISO-DEP, NFC-DEP
+ ******************************************************************************
+ */
+/* One APDU echoed by the PICC, chained both ways past the frame size */
+static ReturnCode codec_isodep(uint16_t len)
+{
+	rfalIsoDepApduTxRxParam param;
+	uint16_t rxLen = 0;
+	ReturnCode err;
+
+	param.txBuf = &apduTx;
+	param.txBufLen = len;
+	param.rxBuf = &apduRx;
+	param.rxLen = &rxLen;
+	param.tmpBuf = &apduTmp;
+	param.FWT = CODEC_FWT;
+	param.dFWT = 0;
+	param.FSx = RFAL_ISODEP_FSX_256;
+	param.ourFSx = RFAL_ISODEP_FSX_256;
+	param.DID = RFAL_ISODEP_NO_DID;
+
+	err = rfalIsoDepStartApduTransceive(param);
+	if (err != ERR_NONE)
+		return err;
+
+	do {
+		err = rfalIsoDepGetApduTransceiveStatus();
+	} while (err == ERR_BUSY);
+
+	if ((err == ERR_NONE) && (rxLen != len))
+		return ERR_INTERNAL;
+	return err;
+}
+
+static void codec_isodep_run(void)
+{
+	uint32_t i;
+
+	rfalIsoDepInitialize();
+	codec_mock_peer(CODEC_PEER_ISODEP);
+
+	for (i = 0; i < (sizeof(apduFrames) / sizeof(apduFrames[0])); i++) {
+		/* Chaining moves the blocks sent to the front of the APDU buffer */
+		codec_fill(apduTx.apdu, apduFrames[i], 0x00);
+		codec_fill(frame, apduFrames[i], 0x00);
+		if ((codec_isodep(apduFrames[i]) != ERR_NONE) || memcmp(apduRx.apdu, frame, apduFrames[i]))
+			printf("Error: ISO-DEP echo of %u bytes failed\n", apduFrames[i]);
+		codec_measure("isodep", "apdu", codec_isodep, apduFrames[i], apduFrames[i]);
+	}
+
+	codec_mock_peer(CODEC_PEER_NONE);
+}
+
+/* One message in chained I-PDUs of the largest size, the target echoes the last */
+static ReturnCode codec_nfcdep(uint16_t len)
+{
+	rfalNfcDepTxRxParam param;
+	uint16_t rxLen, chunk;
+	bool rxChaining = false;
+	ReturnCode err = ERR_NONE;
+	uint32_t pdu;
+
+	param.rxBuf = &depRx;
+	param.rxLen = &rxLen;
+	param.isRxChaining = &rxChaining;
+	param.FWT = RFAL_NFCDEP_MAX_FWT;
+	param.dFWT = 0;
+	param.FSx = RFAL_NFCDEP_FRAME_SIZE_MAX_LEN;
+	param.DID = RFAL_NFCDEP_DID_NO;
+
+	for (pdu = 0; (err == ERR_NONE) && ((pdu * CODEC_NFCDEP_CHUNK) < len); pdu++) {
+		chunk = len - (pdu * CODEC_NFCDEP_CHUNK);
+		if (chunk > CODEC_NFCDEP_CHUNK)
+			chunk = CODEC_NFCDEP_CHUNK;
+
+		param.txBuf = &depTx[pdu];
+		param.txBufLen = chunk;
+		param.isTxChaining = ((pdu + 1) * CODEC_NFCDEP_CHUNK) < len;
+
+		rfalNfcDepStartTransceive(&param);
+		do {
+			err = rfalNfcDepGetTransceiveStatus();
+		} while (err == ERR_BUSY);
+	}
+
+	if ((err == ERR_NONE) && (rxLen != chunk))
+		return ERR_INTERNAL;
+	return err;
+}
+
+static void codec_nfcdep_run(void)
+{
+	static uint8_t nfcid3[RFAL_NFCDEP_NFCID3_LEN] = { 0x01, 0xFE, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E, 0x0F, 0x00, 0x00 };
+	rfalNfcDepAtrParam atr;
+	rfalNfcDepAtrRes atrRes;
+	uint8_t atrResLen;
+	uint32_t i, pdu;
+
+	codec_mock_peer(CODEC_PEER_NFCDEP);
+
+	memset(&atr, 0, sizeof(atr));
+	atr.commMode = RFAL_NFCDEP_COMM_PASSIVE;
+	atr.nfcid = nfcid3;
+	atr.nfcidLen = sizeof(nfcid3);
+	atr.DID = RFAL_NFCDEP_DID_NO;
+	atr.NAD = RFAL_NFCDEP_NAD_NO;
+	atr.LR = RFAL_NFCDEP_LR_254;
+	if (rfalNfcDepATR(&atr, &atrRes, &atrResLen) != ERR_NONE) {
+		printf("Error: NFC-DEP activation failed\n");
+		codec_mock_peer(CODEC_PEER_NONE);
+		return;
+	}
+
+	for (pdu = 0; pdu < CODEC_NFCDEP_PDUS; pdu++)
+		codec_fill(depTx[pdu].inf, CODEC_NFCDEP_CHUNK, (uint8_t)pdu);
+	for (i = 0; i < (sizeof(apduFrames) / sizeof(apduFrames[0])); i++)
+		codec_measure("nfcdep", "dep", codec_nfcdep, apduFrames[i], apduFrames[i]);
+
+	codec_mock_peer(CODEC_PEER_NONE);
+}
+
+/*
+ ******************************************************************************
+ * LOCAL FUNCTIONS - SETUP
+ ******************************************************************************
+ */
+static void codec_usage(const char *prog)
+{
+	fprintf(stderr, "Usage: %s [options]\n"
+		"  -f, --format csv|json   output format (csv)\n"
+		"  -o, --out FILE          write the results to FILE (stdout)\n"
+		"  -n, --iterations N      samples per kernel, frame and cache state (%u)\n"
+		"  -r, --runs N            runs per warm sample (%u)\n"
+		"  -g, --groups LIST       comma separated groups: harness,vcd,vicc,crc,analog,hex,isodep,nfcdep (all)\n"
+		"  -c, --check             only check the vcd, vicc and crc kernels against their references\n",
+		prog, CODEC_ITERATIONS, CODEC_RUNS);
+}
+
+/*
+ ******************************************************************************
+ * MAIN FUNCTION
+ ******************************************************************************
+ */
+int main(int argc, char *argv[])
+{
+	static const struct option longOpts[] = {
+		{ "format", required_argument, NULL, 'f' },
+		{ "out", required_argument, NULL, 'o' },
+		{ "iterations", required_argument, NULL, 'n' },
+		{ "runs", required_argument, NULL, 'r' },
+		{ "groups", required_argument, NULL, 'g' },
+		{ "check", no_argument, NULL, 'c' },
+		{ "help", no_argument, NULL, 'h' },
+		{ NULL, 0, NULL, 0 }
+	};
+	FILE *out = stdout;
+	bool failed = false;	/* A check against a reference failed */
+	int c;
+
+	while ((c = getopt_long(argc, argv, "f:o:n:r:g:ch", longOpts, NULL)) != -1) {
+		switch (c) {
+		case 'f':
+			if (bench_format_parse(optarg, &opt.format) != ERR_NONE) {
+				codec_usage(argv[0]);
+				return 1;
+			}
+			break;
+		case 'o':
+			opt.out = optarg;
+			break;
+		case 'n':
+			opt.iterations = strtoul(optarg, NULL, 0);
+			break;
+		case 'r':
+			opt.runs = strtoul(optarg, NULL, 0);
+			if (opt.runs == 0) {
+				codec_usage(argv[0]);
+				return 1;
+			}
+			break;
+		case 'g':
+			opt.groups = optarg;
+			break;
+		case 'c':
+			opt.check = true;
+			break;
+		default:
+			codec_usage(argv[0]);
+			return 1;
+		}
+	}
+
+	if (!opt.check && codec_group("harness"))
+		codec_measure("harness", "empty", codec_empty, 0, 0);
+	if (codec_group("vcd")) {
+		failed |= (codec_vcd_check(ISO15693_VCD_CODING_1_4, "1of4") != ERR_NONE);
+		failed |= (codec_vcd_check(ISO15693_VCD_CODING_1_256, "1of256") != ERR_NONE);
+		if (!opt.check) {
+			codec_vcd_run(ISO15693_VCD_CODING_1_4, "1of4");
+			codec_vcd_run(ISO15693_VCD_CODING_1_256, "1of256");
+		}
+	}
+	if (codec_group("vicc"))
+		failed |= (codec_vicc_run() != ERR_NONE);
+	if (codec_group("crc"))
+		failed |= (codec_crc_run() != ERR_NONE);
+
+	/* Nothing measured, no results */
+	if (opt.check) {
+		printf("codec checks %s\n", failed ? "failed" : "passed");
+		return (failed ? 1 : 0);
+	}
+
+	if (codec_group("analog"))
+		codec_analog_run();
+	if (codec_group("hex"))
+		codec_hex_run();
+	if (codec_group("isodep"))
+		codec_isodep_run();
+	if (codec_group("nfcdep"))
+		codec_nfcdep_run();
+
+	if (opt.out != NULL) {
+		out = fopen(opt.out, "w");
+		if (out == NULL) {
+			printf("Error: cannot open %s\n", opt.out);
+			return 1;
+		}
+	}
+	bench_report(out, opt.format, "codec");
+	if (out != stdout)
+		fclose(out);
+
+	/* The results are kept, but a run with a wrong kernel fails */
+	return (failed ? 1 : 0);
+}
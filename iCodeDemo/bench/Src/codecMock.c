@@ -0,0 +1,434 @@
+
+/******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; COPYRIGHT 2018 STMicroelectronics</center></h2>
+  *
+  * Licensed under ST MYLIBERTY SOFTWARE LICENSE AGREEMENT (the "License");
+  * You may not use this file except in compliance with the License.
+  * You may obtain a copy of the License at:
+  *
+  *        http://www.st.com/myliberty
+  *
+  * Unless required by applicable law or agreed to in writing, software 
+  * distributed under the License is distributed on an "AS IS" BASIS, 
+  * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied,
+  * AND SPECIFICALLY DISCLAIMING THE IMPLIED WARRANTIES OF MERCHANTABILITY,
+  * FITNESS FOR A PARTICULAR PURPOSE, AND NON-INFRINGEMENT.
+  * See the License for the specific language governing permissions and
+  * limitations under the License.
+  *
+******************************************************************************/
+
+/*! \file codecMock.c
+ *
+ *  \brief Chip, RF layer and peers standing in for the reader under the codec benchmarks
+ *  
+ */
+
+/*
+ ******************************************************************************
+ * INCLUDES
+ ******************************************************************************
+ */
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "codecMock.h"
+#include "platform.h"
+#include "rfal_rf.h"
+#include "rfal_chip.h"
+#include "rfal_nfcb.h"
+#include "rfal_nfcf.h"
+#include "rfal_isoDep.h"
+#include "rfal_nfcDep.h"
+
+/*
+ ******************************************************************************
+ * DEFINES
+ ******************************************************************************
+ */
+#define CODEC_MOCK_DATA_MAX	RFAL_ISODEP_APDU_MAX_LEN	/* Largest message echoed */
+
+/* ISO-DEP blocks of the PICC, no DID nor NAD */
+#define CODEC_ISODEP_I		0x02	/* I-block, | block number */
+#define CODEC_ISODEP_CHAINING	0x10
+#define CODEC_ISODEP_R_ACK	0xA2	/* R(ACK), | block number */
+#define CODEC_ISODEP_S_DSL	0xC2
+#define CODEC_ISODEP_BN		0x01
+#define CODEC_ISODEP_INF_MAX	(RFAL_ISODEP_FSX_256 - 1 - 2)	/* FSD less PCB and CRC */
+
+/* NFC-DEP PDUs of the target, no DID nor NAD */
+#define CODEC_NFCDEP_REQ	0xD4
+#define CODEC_NFCDEP_RES	0xD5
+#define CODEC_NFCDEP_ATR_REQ	0x00
+#define CODEC_NFCDEP_DEP_REQ	0x06
+#define CODEC_NFCDEP_RLS_REQ	0x0A
+#define CODEC_NFCDEP_PFB_TYPE	0xE0
+#define CODEC_NFCDEP_PFB_I	0x00
+#define CODEC_NFCDEP_PFB_R_ACK	0x40	/* R-PDU ACK, | PNI */
+#define CODEC_NFCDEP_PFB_MI	0x10
+#define CODEC_NFCDEP_PFB_PNI	0x03
+#define CODEC_NFCDEP_HDR_LEN	4	/* LEN, CMD0, CMD1, PFB */
+#define CODEC_NFCDEP_TO		0x0E	/* ATR_RES TO: WT 14 */
+#define CODEC_NFCDEP_PP_LR254	0x30	/* ATR_RES PP: frames up to 254 bytes */
+
+/*
+ ******************************************************************************
+ * LOCAL DATA TYPES
+ ******************************************************************************
+ */
+typedef struct {
+	codecPeer	peer;
+	ReturnCode	status;			/* Status of the last transceive, ERR_BUSY until polled */
+	ReturnCode	rxStatus;		/* Status of the answer of the peer */
+	uint8_t		rx[CODEC_MOCK_DATA_MAX];	/* Answer of the peer */
+	uint16_t	rxLen;
+	uint8_t		*rxBuf;			/* Where the caller receives it */
+	uint16_t	rxBufLen;
+	uint16_t	*actLen;
+	uint32_t	regWrites;
+	uint32_t	frames;
+	uint8_t		data[CODEC_MOCK_DATA_MAX];	/* Message received, echoed back */
+	uint16_t	dataLen;
+	uint16_t	dataPos;		/* Next byte echoed, dataLen while receiving */
+}codecMock;
+
+/*
+ ******************************************************************************
+ * GLOBAL VARIABLES
+ ******************************************************************************
+ */
+__thread pltfReader pltfReaderCurrent PLTF_READER_TLS = PLTF_READER_DEFAULT;
+
+/*
+ ******************************************************************************
+ * STATIC VARIABLES
+ ******************************************************************************
+ */
+static codecMock mock;
+
+/*
+ ******************************************************************************
+ * LOCAL FUNCTIONS - PEERS
+ ******************************************************************************
+ */
+/* Keep the INF of a block or PDU, the message ends with the last one */
+static ReturnCode codec_mock_keep(const uint8_t *inf, uint16_t len)
+{
+	if (mock.dataPos < mock.dataLen)
+		mock.dataLen = 0;	/* New message while echoing the previous */
+	if ((mock.dataLen + len) > sizeof(mock.data))
+		return ERR_NOMEM;
+
+	memcpy(&mock.data[mock.dataLen], inf, len);
+	mock.dataLen += len;
+	mock.dataPos = mock.dataLen;
+	return ERR_NONE;
+}
+
+/* Next I-block of the echo, numbered as the block it answers */
+static uint16_t codec_isodep_echo(uint8_t bn, uint8_t *rx)
+{
+	uint16_t len = mock.dataLen - mock.dataPos;
+
+	rx[0] = CODEC_ISODEP_I | bn;
+	if (len > CODEC_ISODEP_INF_MAX) {
+		len = CODEC_ISODEP_INF_MAX;
+		rx[0] |= CODEC_ISODEP_CHAINING;
+	}
+	memcpy(&rx[1], &mock.data[mock.dataPos], len);
+	mock.dataPos += len;
+	if (mock.dataPos == mock.dataLen)
+		mock.dataLen = mock.dataPos = 0;
+
+	return len + 1;
+}
+
+static ReturnCode codec_isodep_picc(const uint8_t *tx, uint16_t txLen, uint8_t *rx, uint16_t *rxLen)
+{
+	uint8_t pcb = tx[0];
+	ReturnCode err;
+
+	if (pcb == CODEC_ISODEP_S_DSL) {
+		rx[0] = CODEC_ISODEP_S_DSL;
+		*rxLen = 1;
+		return ERR_NONE;
+	}
+
+	/* R(ACK) of a chained answer */
+	if ((pcb & ~CODEC_ISODEP_BN) == CODEC_ISODEP_R_ACK) {
+		if (mock.dataPos >= mock.dataLen)
+			return ERR_TIMEOUT;
+		*rxLen = codec_isodep_echo(pcb & CODEC_ISODEP_BN, rx);
+		return ERR_NONE;
+	}
+
+	if ((pcb & ~(CODEC_ISODEP_BN | CODEC_ISODEP_CHAINING)) != CODEC_ISODEP_I)
+		return ERR_TIMEOUT;
+
+	err = codec_mock_keep(&tx[1], txLen - 1);
+	if (err != ERR_NONE)
+		return err;
+
+	if (pcb & CODEC_ISODEP_CHAINING) {
+		rx[0] = CODEC_ISODEP_R_ACK | (pcb & CODEC_ISODEP_BN);
+		*rxLen = 1;
+		return ERR_NONE;
+	}
+
+	mock.dataPos = 0;
+	*rxLen = codec_isodep_echo(pcb & CODEC_ISODEP_BN, rx);
+	return ERR_NONE;
+}
+
+static ReturnCode codec_nfcdep_target(const uint8_t *tx, uint16_t txLen, uint8_t *rx, uint16_t *rxLen)
+{
+	uint8_t pfb;
+	uint16_t len;
+
+	if ((txLen < 2) || (tx[0] != CODEC_NFCDEP_REQ))
+		return ERR_TIMEOUT;
+
+	rx[1] = CODEC_NFCDEP_RES;
+	rx[2] = tx[1] + 1;
+
+	switch (tx[1]) {
+	case CODEC_NFCDEP_ATR_REQ:
+		/* NFCID3 and DID of the initiator, no high bit rates, no general bytes */
+		if (txLen < (2 + RFAL_NFCDEP_NFCID3_LEN + 1))
+			return ERR_TIMEOUT;
+		memcpy(&rx[3], &tx[2], RFAL_NFCDEP_NFCID3_LEN + 1);
+		len = 3 + RFAL_NFCDEP_NFCID3_LEN + 1;
+		rx[len++] = 0x00;
+		rx[len++] = 0x00;
+		rx[len++] = CODEC_NFCDEP_TO;
+		rx[len++] = CODEC_NFCDEP_PP_LR254;
+		break;
+
+	case CODEC_NFCDEP_DEP_REQ:
+		if (txLen < 3)
+			return ERR_TIMEOUT;
+		pfb = tx[2];
+		if ((pfb & CODEC_NFCDEP_PFB_TYPE) != CODEC_NFCDEP_PFB_I)
+			return ERR_TIMEOUT;
+
+		if (pfb & CODEC_NFCDEP_PFB_MI) {
+			if (codec_mock_keep(&tx[3], txLen - 3) != ERR_NONE)
+				return ERR_NOMEM;
+			rx[3] = CODEC_NFCDEP_PFB_R_ACK | (pfb & CODEC_NFCDEP_PFB_PNI);
+			len = CODEC_NFCDEP_HDR_LEN;
+			break;
+		}
+
+		/* Echo of the last I-PDU, with its PNI */
+		mock.dataLen = mock.dataPos = 0;
+		rx[3] = CODEC_NFCDEP_PFB_I | (pfb & CODEC_NFCDEP_PFB_PNI);
+		memcpy(&rx[CODEC_NFCDEP_HDR_LEN], &tx[3], txLen - 3);
+		len = CODEC_NFCDEP_HDR_LEN + txLen - 3;
+		break;
+
+	case CODEC_NFCDEP_RLS_REQ:
+		len = 3;
+		break;
+
+	default:
+		return ERR_TIMEOUT;
+	}
+
+	rx[0] = (uint8_t)len;	/* LEN counts itself */
+	*rxLen = len;
+	return ERR_NONE;
+}
+
+/*
+ ******************************************************************************
+ * GLOBAL FUNCTIONS
+ ******************************************************************************
+ */
+void codec_mock_peer(codecPeer peer)
+{
+	mock.peer = peer;
+	mock.status = ERR_NONE;
+	mock.dataLen = 0;
+	mock.dataPos = 0;
+}
+
+uint32_t codec_mock_reg_writes(void)
+{
+	return mock.regWrites;
+}
+
+uint32_t codec_mock_frames(void)
+{
+	return mock.frames;
+}
+
+/*
+ ******************************************************************************
+ * GLOBAL FUNCTIONS - CHIP
+ ******************************************************************************
+ */
+ReturnCode rfalChipChangeRegBits(uint16_t reg, uint8_t valueMask, uint8_t value)
+{
+	(void)reg;
+	(void)valueMask;
+	(void)value;
+	mock.regWrites++;
+	return ERR_NONE;
+}
+
+ReturnCode rfalChipChangeTestRegBits(uint16_t reg, uint8_t valueMask, uint8_t value)
+{
+	(void)reg;
+	(void)valueMask;
+	(void)value;
+	mock.regWrites++;
+	return ERR_NONE;
+}
+
+/*
+ ******************************************************************************
+ * GLOBAL FUNCTIONS - RF LAYER
+ ******************************************************************************
+ */
+/* The peer answers the frame as it is sent, the answer is received on the
+ * next status poll: the caller may still work on the previous one */
+ReturnCode rfalTransceiveBlockingTx(uint8_t *txBuf, uint16_t txBufLen, uint8_t *rxBuf, uint16_t rxBufLen, uint16_t *actLen, uint32_t flags, uint32_t fwt)
+{
+	(void)flags;
+	(void)fwt;
+
+	mock.frames++;
+	mock.rxBuf = rxBuf;
+	mock.rxBufLen = rxBufLen;
+	mock.actLen = actLen;
+	mock.rxLen = 0;
+
+	if ((txBuf == NULL) || (txBufLen == 0))
+		mock.rxStatus = ERR_TIMEOUT;
+	else if (mock.peer == CODEC_PEER_ISODEP)
+		mock.rxStatus = codec_isodep_picc(txBuf, txBufLen, mock.rx, &mock.rxLen);
+	else if (mock.peer == CODEC_PEER_NFCDEP)
+		mock.rxStatus = codec_nfcdep_target(txBuf, txBufLen, mock.rx, &mock.rxLen);
+	else
+		mock.rxStatus = ERR_TIMEOUT;
+
+	mock.status = ERR_BUSY;
+	return ERR_NONE;
+}
+
+ReturnCode rfalGetTransceiveStatus(void)
+{
+	if (mock.status != ERR_BUSY)
+		return mock.status;
+
+	mock.status = mock.rxStatus;
+	if ((mock.status == ERR_NONE) && (mock.rxLen > mock.rxBufLen))
+		mock.status = ERR_NOMEM;
+	if (mock.status == ERR_NONE)
+		memcpy(mock.rxBuf, mock.rx, mock.rxLen);
+	if (mock.actLen != NULL)
+		*mock.actLen = (mock.status == ERR_NONE) ? rfalConvBytesToBits(mock.rxLen) : 0;
+
+	return mock.status;
+}
+
+ReturnCode rfalTransceiveBlockingTxRx(uint8_t *txBuf, uint16_t txBufLen, uint8_t *rxBuf, uint16_t rxBufLen, uint16_t *actLen, uint32_t flags, uint32_t fwt)
+{
+	ReturnCode err;
+
+	err = rfalTransceiveBlockingTx(txBuf, txBufLen, rxBuf, rxBufLen, actLen, flags, fwt);
+	if (err != ERR_NONE)
+		return err;
+
+	err = rfalGetTransceiveStatus();
+	if (actLen != NULL)
+		*actLen = rfalConvBitsToBytes(*actLen);
+	return err;
+}
+
+void rfalWorker(void)
+{
+}
+
+/* Nothing is waited for: the peer answered within the call */
+void rfalIrqWaitPrepare(rfalIrqWaiter *w)
+{
+	w->seq = 0;
+	w->start = 0;
+}
+
+void rfalIrqWaitNext(const rfalIrqWaiter *w)
+{
+	(void)w;
+}
+
+ReturnCode rfalSetMode(rfalMode mode, rfalBitRate txBR, rfalBitRate rxBR)
+{
+	(void)mode;
+	(void)txBR;
+	(void)rxBR;
+	return ERR_NONE;
+}
+
+ReturnCode rfalSetBitRate(rfalBitRate txBR, rfalBitRate rxBR)
+{
+	(void)txBR;
+	(void)rxBR;
+	return ERR_NONE;
+}
+
+ReturnCode rfalGetBitRate(rfalBitRate *txBR, rfalBitRate *rxBR)
+{
+	if (txBR != NULL)
+		*txBR = RFAL_BR_106;
+	if (rxBR != NULL)
+		*rxBR = RFAL_BR_106;
+	return ERR_NONE;
+}
+
+void rfalSetErrorHandling(rfalEHandling eHandling)
+{
+	(void)eHandling;
+}
+
+void rfalSetFDTPoll(uint32_t fdt)
+{
+	(void)fdt;
+}
+
+uint32_t rfalNfcbTR2ToFDT(uint8_t tr2Code)
+{
+	(void)tr2Code;
+	return 0;
+}
+
+ReturnCode rfalNfcfPollerInitialize(rfalBitRate bitRate)
+{
+	(void)bitRate;
+	return ERR_NONE;
+}
+
+/*
+ ******************************************************************************
+ * GLOBAL FUNCTIONS - PLATFORM
+ ******************************************************************************
+ */
+/* Nothing is waited for: timers are expired as soon as created */
+uint32_t timerCalculateTimer(uint16_t time)
+{
+	(void)time;
+	return 0;
+}
+
+bool timerIsExpired(uint32_t timer)
+{
+	(void)timer;
+	return true;
+}
+
+void timerDelay(uint16_t time)
+{
+	(void)time;
+}
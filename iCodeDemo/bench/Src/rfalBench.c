@@ -0,0 +1,1028 @@
+
+/******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; COPYRIGHT 2018 STMicroelectronics</center></h2>
+  *
+  * Licensed under ST MYLIBERTY SOFTWARE LICENSE AGREEMENT (the "License");
+  * You may not use this file except in compliance with the License.
+  * You may obtain a copy of the License at:
+  *
+  *        http://www.st.com/myliberty
+  *
+  * Unless required by applicable law or agreed to in writing, software 
+  * distributed under the License is distributed on an "AS IS" BASIS, 
+  * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied,
+  * AND SPECIFICALLY DISCLAIMING THE IMPLIED WARRANTIES OF MERCHANTABILITY,
+  * FITNESS FOR A PARTICULAR PURPOSE, AND NON-INFRINGEMENT.
+  * See the License for the specific language governing permissions and
+  * limitations under the License.
+  *
+******************************************************************************/
+
+/*! \file rfalBench.c
+ *
+ *  \brief Throughput and latency of the RFAL pollers
+ *  
+ *  Runs per technology: detection rounds, collision resolution of 1 to
+ *  64 tags, block reads and writes, ISO-DEP activation and APDU round
+ *  trips, the multi-technology detection loop of exampleNFC.c and the
+ *  NFC-V read and write commands of the demo as a whole. Block reads also
+ *  run through the transceive queue, keeping it full.
+ *  
+ *  Built with PLTF_SIM the benchmark attaches the tags each run needs to
+ *  the simulated reader. With PLTF_SIM_REPLAY naming a trace recorded by
+ *  the same runs on the hardware (PLTF_TRACE), the runs are replayed
+ *  with the recorded timing. On the hardware the runs use whatever tags
+ *  lie on the antenna, writes put back the data read before.
+ *
+ */
+
+/*
+ ******************************************************************************
+ * INCLUDES
+ ******************************************************************************
+ */
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include "bench.h"
+#include "st_errno.h"
+#include "platform.h"
+#include "rfal_rf.h"
+#include "rfal_nfca.h"
+#include "rfal_nfcb.h"
+#include "rfal_nfcf.h"
+#include "rfal_nfcv.h"
+#include "rfal_isoDep.h"
+#include "rfal_queue.h"
+#include "rfal_analogConfig.h"
+#ifdef PLTF_SIM
+#include "pltf_sim.h"
+#endif
+
+/*
+ ******************************************************************************
+ * DEFINES
+ ******************************************************************************
+ */
+#define BENCH_TAGS_MAX		64	/* Largest collision resolution */
+#define BENCH_ITERATIONS	100	/* Default runs per operation */
+#define BENCH_NFCV_BLOCKS	16	/* Blocks read and written back */
+#define BENCH_NFCV_BLOCK_LEN	4	/* Block size of the ICODE SLIX */
+#define BENCH_NFCV_TAG_BLOCKS	80	/* Memory of the simulated tag, an ICODE SLIX2 */
+#define BENCH_NFCV_WRITE_BLOCKS	28	/* Blocks of an encoding station write, 112 bytes */
+#define BENCH_RF_BUF_LEN	256
+#define BENCH_FWT		rfalConvMsTo1fc(20)	/* Frame wait time of the raw commands */
+
+/* Technologies a run puts in the field */
+#define BENCH_TECH_NFCV		0x01
+#define BENCH_TECH_T2T		0x02
+#define BENCH_TECH_ISODEP	0x04
+#define BENCH_TECH_NFCF		0x08
+
+/*
+ ******************************************************************************
+ * LOCAL DATA TYPES
+ ******************************************************************************
+ */
+typedef struct {
+	benchFormat	format;
+	const char	*out;		/* File the results go to, stdout if NULL */
+	uint32_t	iterations;
+	uint32_t	tagsMax;	/* Largest tag count of the sweeps */
+	const char	*groups;	/* Groups to run, all if NULL */
+}benchOptions;
+
+/* Block reads run through the transceive queue */
+typedef struct {
+	uint8_t		blocks;		/* Blocks to read */
+	uint8_t		next;		/* Next block to submit */
+	ReturnCode	err;		/* First error */
+}benchQueueRun;
+
+/*
+ ******************************************************************************
+ * STATIC VARIABLES
+ ******************************************************************************
+ */
+static benchOptions opt = { BENCH_FORMAT_CSV, NULL, BENCH_ITERATIONS, BENCH_TAGS_MAX, NULL };
+static benchOp op;
+static uint8_t rxBuf[BENCH_RF_BUF_LEN];
+static uint8_t nfcvData[BENCH_NFCV_BLOCKS * BENCH_NFCV_BLOCK_LEN];
+static uint8_t nfcvDump[RFAL_NFCV_MAX_BLOCKS * RFAL_NFCV_MAX_BLOCK_LEN];
+static uint8_t nfcvSecStatus[RFAL_NFCV_MAX_BLOCKS];
+static uint8_t queueRx[RFAL_QUEUE_DEPTH][BENCH_RF_BUF_LEN];
+static rfalIsoDepApduBufFormat apduTx;
+static rfalIsoDepApduBufFormat apduRx;
+static rfalIsoDepBufFormat apduTmp;
+
+#ifdef PLTF_SIM
+static pltfSimNfcv simNfcv[BENCH_TAGS_MAX];
+static pltfSimT2t simT2t[BENCH_TAGS_MAX];
+static pltfSimFelica simFelica[BENCH_TAGS_MAX];
+static pltfSimIsoDep simIsoDep;
+static pltfSimTag *simTags[(3 * BENCH_TAGS_MAX) + 1];
+static uint32_t simTagCnt = 0;
+#endif
+
+/*
+ ******************************************************************************
+ * LOCAL FUNCTIONS - FIELD
+ ******************************************************************************
+ */
+#ifdef PLTF_SIM
+static void bench_sim_attach(pltfSimTag *tag)
+{
+	if (pltf_sim_tag_attach(tag) == ERR_NONE)
+		simTags[simTagCnt++] = tag;
+}
+#endif
+
+/* Put n tags of each technology in \a techs in the field of the simulated
+ * reader, fresh from the factory. The field is switched off so that the
+ * next run powers them. Nothing is attached on the hardware */
+static void bench_field(uint32_t techs, uint32_t n)
+{
+#ifdef PLTF_SIM
+	uint32_t i;
+
+	while (simTagCnt > 0)
+		pltf_sim_tag_detach(simTags[--simTagCnt]);
+
+	/* NFC-V tags share the 16 slots and differ in the next UID byte: the
+	 * NFC-V poller only resolves collisions past the first UID byte */
+	for (i = 0; i < n; i++) {
+		if (techs & BENCH_TECH_NFCV) {
+			uint8_t uid[8] = { (uint8_t)(i & 0x0F), (uint8_t)(i >> 4), 0xA5, 0x5A, 0x00, 0x01, 0x04, 0xE0 };
+
+			pltf_sim_nfcv_init(&simNfcv[i], uid, BENCH_NFCV_TAG_BLOCKS, BENCH_NFCV_BLOCK_LEN);
+			bench_sim_attach(&simNfcv[i].tag);
+		}
+		if (techs & BENCH_TECH_T2T) {
+			uint8_t uid[7] = { 0x04, 0x53, 0x00, (uint8_t)i, 0x1A, 0x2B, 0x80 };
+
+			pltf_sim_t2t_init(&simT2t[i], uid);
+			bench_sim_attach(&simT2t[i].tag);
+		}
+		if (techs & BENCH_TECH_NFCF) {
+			uint8_t idm[8] = { 0x01, 0x2E, 0x00, 0x00, 0x00, 0x00, 0x00, (uint8_t)i };
+
+			pltf_sim_felica_init(&simFelica[i], idm);
+			bench_sim_attach(&simFelica[i].tag);
+		}
+	}
+	if ((techs & BENCH_TECH_ISODEP) && (n > 0)) {
+		uint8_t uid[4] = { 0x08, 0x00, 0x00, 0x3C };
+
+		pltf_sim_isodep_init(&simIsoDep, uid);
+		bench_sim_attach(&simIsoDep.tag);
+	}
+#else
+	(void)techs;
+	(void)n;
+#endif
+
+	rfalFieldOff();
+}
+
+/* Tag counts of the collision resolution sweeps: 1, 2, 4... up to max.
+ * The hardware only has the tags on the antenna, one run with 0 */
+static uint32_t bench_sweep_first(void)
+{
+#ifdef PLTF_SIM
+	return 1;
+#else
+	return 0;
+#endif
+}
+
+static uint32_t bench_sweep_next(uint32_t n, uint32_t max)
+{
+#ifdef PLTF_SIM
+	if ((n < max) && ((n * 2) > max))
+		return max;
+	return n * 2;
+#else
+	(void)n;
+	(void)max;
+	return UINT32_MAX;
+#endif
+}
+
+static bool bench_group(const char *name)
+{
+	const char *p = opt.groups;
+	size_t len = strlen(name);
+
+	if (p == NULL)
+		return true;
+
+	while (*p != '\0') {
+		if (!strncmp(p, name, len) && ((p[len] == ',') || (p[len] == '\0')))
+			return true;
+		p += strcspn(p, ",");
+		if (*p == ',')
+			p++;
+	}
+
+	return false;
+}
+
+/* Tags resolved against the tags put in the field */
+static ReturnCode bench_resolved(ReturnCode err, uint32_t n, uint8_t devCnt)
+{
+	if ((err == ERR_NONE) && (n > 0) && (devCnt != n))
+		return ERR_NOTFOUND;
+	return err;
+}
+
+/* Row of a sweep, on the hardware the tags found make the parameter */
+static void bench_sweep_end(uint32_t n, uint8_t devCnt)
+{
+	if (n == 0)
+		op.row.param = devCnt;
+	bench_op_end(&op);
+}
+
+/*
+ ******************************************************************************
+ * LOCAL FUNCTIONS - NFC-V
+ ******************************************************************************
+ */
+/* Select the first tag found, the block commands then go in selected mode */
+static ReturnCode bench_nfcv_select(void)
+{
+	rfalNfcvListenDevice dev;
+	uint8_t devCnt;
+	ReturnCode err;
+
+	rfalNfcvPollerInitialize();
+	rfalFieldOnAndStartGT();
+
+	err = rfalNfcvPollerCollisionResolution(1, &dev, &devCnt);
+	if (err != ERR_NONE)
+		return err;
+	if (devCnt == 0)
+		return ERR_NOTFOUND;
+
+	return rfalNfvPollerSelect(RFAL_NFCV_REQ_FLAG_DEFAULT, dev.InvRes.UID);
+}
+
+/* Encoding station: the first blocks rewritten with another pattern each
+ * run, then verified. The memory is put back afterwards */
+static void bench_nfcv_write_memory(const char *name, uint8_t flags, bool writeMultiple)
+{
+	static uint8_t data[BENCH_NFCV_WRITE_BLOCKS * BENCH_NFCV_BLOCK_LEN];
+	ReturnCode err;
+	uint32_t i, k;
+
+#ifdef PLTF_SIM
+	simNfcv[0].writeMultiple = writeMultiple;
+#else
+	(void)writeMultiple;
+#endif
+
+	bench_op_begin(&op, "nfcv", name, BENCH_NFCV_WRITE_BLOCKS);
+	for (i = 0; i < opt.iterations; i++) {
+		for (k = 0; k < sizeof(data); k++)
+			data[k] = nfcvDump[k] ^ (uint8_t)(i + 1);
+		bench_sample_start(&op);
+		err = rfalNfcvPollerWriteMemory(flags, NULL, 0, BENCH_NFCV_WRITE_BLOCKS, BENCH_NFCV_BLOCK_LEN, data, true);
+		bench_sample_end(&op, err, BENCH_NFCV_WRITE_BLOCKS);
+	}
+	bench_op_end(&op);
+
+	rfalNfcvPollerWriteMemory(RFAL_NFCV_REQ_FLAG_DEFAULT, NULL, 0, BENCH_NFCV_WRITE_BLOCKS, BENCH_NFCV_BLOCK_LEN, nfcvDump, false);
+#ifdef PLTF_SIM
+	simNfcv[0].writeMultiple = true;
+#endif
+}
+
+/* Whole memory of the selected tag, checked against the simulated one */
+static ReturnCode bench_nfcv_dump(bool status, uint16_t *blocks)
+{
+	rfalNfcvSystemInfo info;
+	uint16_t len;
+	ReturnCode err;
+#ifdef PLTF_SIM
+	uint16_t b;
+#endif
+
+	*blocks = 0;
+	err = rfalNfcvPollerDumpMemory(RFAL_NFCV_REQ_FLAG_DEFAULT, NULL, &info, nfcvDump, sizeof(nfcvDump),
+				       status ? nfcvSecStatus : NULL, sizeof(nfcvSecStatus), &len);
+	if (err != ERR_NONE)
+		return err;
+	*blocks = info.numBlocks;
+
+#ifdef PLTF_SIM
+	if ((info.numBlocks != simNfcv[0].blocks) || (info.blockLen != simNfcv[0].blockSize) || (len != (info.numBlocks * info.blockLen)))
+		return ERR_INTERNAL;
+	for (b = 0; b < info.numBlocks; b++) {
+		if (memcmp(&nfcvDump[b * info.blockLen], simNfcv[0].mem[b], info.blockLen)
+		    || (status && (nfcvSecStatus[b] != (simNfcv[0].locked[b] ? 0x01 : 0x00))))
+			return ERR_INTERNAL;
+	}
+#endif
+	return ERR_NONE;
+}
+
+/* Conveyor identification of the tag in the field, UID and first blocks:
+ * inventory then addressed Read Multiple Blocks, or one INVENTORY READ,
+ * optionally the fast one. Checked against the blocks read beforehand */
+static ReturnCode bench_nfcv_identify(bool inventoryRead, bool fast)
+{
+	rfalNfcvInventoryRes invRes;
+	uint8_t uid[RFAL_NFCV_UID_LEN];
+	uint16_t rcvLen;
+	ReturnCode err;
+
+	if (inventoryRead) {
+		err = rfalNfcvPollerInventoryRead(fast, 0, NULL, 0, BENCH_NFCV_BLOCKS - 1, uid, rxBuf, sizeof(rxBuf), &rcvLen);
+	} else {
+		err = rfalNfcvPollerInventory(RFAL_NFCV_NUM_SLOTS_1, 0, NULL, &invRes, NULL);
+		if (err != ERR_NONE)
+			return err;
+		memcpy(uid, invRes.UID, RFAL_NFCV_UID_LEN);
+		err = rfalNfvPollerReadMultipleBlocks(RFAL_NFCV_REQ_FLAG_DEFAULT, uid, 0, BENCH_NFCV_BLOCKS - 1, rxBuf, sizeof(rxBuf), &rcvLen);
+	}
+	if (err != ERR_NONE)
+		return err;
+
+	if ((rcvLen != (1 + sizeof(nfcvData))) || memcmp(&rxBuf[1], nfcvData, sizeof(nfcvData)))
+		return ERR_INTERNAL;
+#ifdef PLTF_SIM
+	if (memcmp(uid, simNfcv[0].uid, RFAL_NFCV_UID_LEN))
+		return ERR_INTERNAL;
+#endif
+	return ERR_NONE;
+}
+
+static void bench_nfcv_queue_done(rfalQueueReq *req, ReturnCode err);
+
+/* Queue the READ SINGLE BLOCK of the next block, a response buffer per slot */
+static ReturnCode bench_nfcv_queue_submit(benchQueueRun *run)
+{
+	rfalQueueReq req;
+	uint8_t b = run->next++;
+
+	memset(&req, 0, sizeof(req));
+	req.type = RFAL_QUEUE_REQ_NFCV;
+	req.cmd.nfcv.flags = RFAL_NFCV_REQ_FLAG_DEFAULT;
+	req.cmd.nfcv.cmd = RFAL_NFCF_CMD_READ_SINGLE_BLOCK;
+	req.cmd.nfcv.param = &b;
+	req.cmd.nfcv.paramLen = 1;
+	req.cmd.nfcv.rxBuf = queueRx[b % RFAL_QUEUE_DEPTH];
+	req.cmd.nfcv.rxBufLen = sizeof(queueRx[0]);
+	req.cmd.nfcv.fwt = BENCH_FWT;
+	req.callback = bench_nfcv_queue_done;
+	req.arg = run;
+
+	return rfalQueueSubmit(&req);
+}
+
+/* Each completion refills the queue */
+static void bench_nfcv_queue_done(rfalQueueReq *req, ReturnCode err)
+{
+	benchQueueRun *run = req->arg;
+
+	if ((err == ERR_NONE) && (req->rcvLen < (1 + BENCH_NFCV_BLOCK_LEN)))
+		err = ERR_PROTO;
+	if (run->err == ERR_NONE)
+		run->err = err;
+	if (run->next < run->blocks)
+		bench_nfcv_queue_submit(run);
+}
+
+static ReturnCode bench_nfcv_read_queued(uint8_t blocks)
+{
+	benchQueueRun run = { blocks, 0, ERR_NONE };
+
+	while ((run.next < blocks) && (rfalQueueGetCount() < RFAL_QUEUE_DEPTH))
+		bench_nfcv_queue_submit(&run);
+	rfalQueueRunBlocking();
+
+	return run.err;
+}
+
+/* The 'v' and 'w' commands of exampleNFC.c, from the RFAL initialisation
+ * to the block access */
+static ReturnCode bench_nfcv_demo(bool write)
+{
+	rfalNfcvListenDevice devList[10];
+	rfalNfcvInventoryRes invRes;
+	uint8_t devCnt;
+	uint16_t rcvLen;
+	ReturnCode err;
+
+	rfalAnalogConfigInitialize();
+	rfalInitialize();
+	err = rfalNfcvPollerInitialize();
+	if (err != ERR_NONE)
+		return err;
+	rfalFieldOnAndStartGT();
+
+	err = rfalNfcvPollerCheckPresence(&invRes);
+	if (err != ERR_NONE)
+		return err;
+	err = rfalNfcvPollerCollisionResolution(10, devList, &devCnt);
+	if (err != ERR_NONE)
+		return err;
+	if (devCnt == 0)
+		return ERR_NOTFOUND;
+	err = rfalNfvPollerSelect(RFAL_NFCV_REQ_FLAG_DEFAULT, devList[0].InvRes.UID);
+	if (err != ERR_NONE)
+		return err;
+
+	err = rfalNfvPollerReadSingleBlock(RFAL_NFCV_REQ_FLAG_DEFAULT, NULL, 0, rxBuf, 32, &rcvLen);
+	if ((err != ERR_NONE) || !write)
+		return err;
+
+	return rfalNfvPollerWriteSingleBlock(RFAL_NFCV_REQ_FLAG_DEFAULT, NULL, 0, &rxBuf[1], BENCH_NFCV_BLOCK_LEN);
+}
+
+static void bench_nfcv(void)
+{
+	static rfalNfcvListenDevice devList[BENCH_TAGS_MAX];
+	static const uint8_t multi[] = { 2, 4, 8, BENCH_NFCV_BLOCKS };
+	rfalNfcvInventoryRes invRes;
+	uint8_t devCnt = 0;
+	uint16_t rcvLen;
+	ReturnCode err;
+	uint32_t i, n;
+	uint8_t b;
+
+	/* Inventory rounds with one tag answering */
+	bench_field(BENCH_TECH_NFCV, 1);
+	rfalNfcvPollerInitialize();
+	rfalFieldOnAndStartGT();
+	bench_op_begin(&op, "nfcv", "inventory", 1);
+	for (i = 0; i < opt.iterations; i++) {
+		bench_sample_start(&op);
+		err = rfalNfcvPollerCheckPresence(&invRes);
+		bench_sample_end(&op, err, 1);
+	}
+	bench_op_end(&op);
+
+	/* Anticollision, the tags stay ready between the runs */
+	for (n = bench_sweep_first(); n <= opt.tagsMax; n = bench_sweep_next(n, opt.tagsMax)) {
+		bench_field(BENCH_TECH_NFCV, n);
+		rfalNfcvPollerInitialize();
+		rfalFieldOnAndStartGT();
+		bench_op_begin(&op, "nfcv", "resolve", n);
+		for (i = 0; i < opt.iterations; i++) {
+			bench_sample_start(&op);
+			err = rfalNfcvPollerCollisionResolution(BENCH_TAGS_MAX, devList, &devCnt);
+			bench_sample_end(&op, bench_resolved(err, n, devCnt), devCnt);
+		}
+		bench_sweep_end(n, devCnt);
+	}
+
+	/* Block access on the selected tag, writes put back what was read */
+	bench_field(BENCH_TECH_NFCV, 1);
+	err = bench_nfcv_select();
+	if (err == ERR_NONE) {
+		for (b = 0; b < BENCH_NFCV_BLOCKS; b++) {
+			if (rfalNfvPollerReadSingleBlock(RFAL_NFCV_REQ_FLAG_DEFAULT, NULL, b, rxBuf, sizeof(rxBuf), &rcvLen) == ERR_NONE)
+				memcpy(&nfcvData[b * BENCH_NFCV_BLOCK_LEN], &rxBuf[1], BENCH_NFCV_BLOCK_LEN);
+		}
+	}
+	if (err != ERR_NONE)
+		fprintf(stderr, "nfcv: no tag selected (%d), block accesses will fail\n", err);
+
+	bench_op_begin(&op, "nfcv", "read_single", 1);
+	for (i = 0; i < opt.iterations; i++) {
+		b = i % BENCH_NFCV_BLOCKS;
+		bench_sample_start(&op);
+		err = rfalNfvPollerReadSingleBlock(RFAL_NFCV_REQ_FLAG_DEFAULT, NULL, b, rxBuf, sizeof(rxBuf), &rcvLen);
+		bench_sample_end(&op, err, 1);
+	}
+	bench_op_end(&op);
+
+	for (b = 0; b < sizeof(multi); b++) {
+		bench_op_begin(&op, "nfcv", "read_multiple", multi[b]);
+		for (i = 0; i < opt.iterations; i++) {
+			bench_sample_start(&op);
+			err = rfalNfvPollerReadMultipleBlocks(RFAL_NFCV_REQ_FLAG_DEFAULT, NULL, 0, multi[b] - 1, rxBuf, sizeof(rxBuf), &rcvLen);
+			bench_sample_end(&op, err, multi[b]);
+		}
+		bench_op_end(&op);
+	}
+
+	/* ICODE custom read, answered at 53kbps */
+	for (b = 0; b < sizeof(multi); b++) {
+		bench_op_begin(&op, "nfcv", "fast_read_multiple", multi[b]);
+		for (i = 0; i < opt.iterations; i++) {
+			bench_sample_start(&op);
+			err = rfalNfcvPollerFastReadMultipleBlocks(RFAL_NFCV_REQ_FLAG_DEFAULT, NULL, 0, multi[b] - 1, rxBuf, sizeof(rxBuf), &rcvLen);
+			if ((err == ERR_NONE) && ((rcvLen != (1 + (multi[b] * BENCH_NFCV_BLOCK_LEN))) || memcmp(&rxBuf[1], nfcvData, rcvLen - 1)))
+				err = ERR_INTERNAL;
+			bench_sample_end(&op, err, multi[b]);
+		}
+		bench_op_end(&op);
+	}
+
+	/* Identification of the tag: inventory and read, then INVENTORY READ */
+	for (b = 0; b < 3; b++) {
+		bench_op_begin(&op, "nfcv", (b == 0) ? "identify" : ((b == 1) ? "identify_inventory_read" : "identify_fast_inventory_read"), BENCH_NFCV_BLOCKS);
+		for (i = 0; i < opt.iterations; i++) {
+			bench_sample_start(&op);
+			err = bench_nfcv_identify(b > 0, b == 2);
+			bench_sample_end(&op, err, BENCH_NFCV_BLOCKS);
+		}
+		bench_op_end(&op);
+	}
+
+	rfalQueueInitialize();
+	bench_op_begin(&op, "nfcv", "read_queued", BENCH_NFCV_BLOCKS);
+	for (i = 0; i < opt.iterations; i++) {
+		bench_sample_start(&op);
+		err = bench_nfcv_read_queued(BENCH_NFCV_BLOCKS);
+		bench_sample_end(&op, err, BENCH_NFCV_BLOCKS);
+	}
+	bench_op_end(&op);
+
+	bench_op_begin(&op, "nfcv", "write_single", 1);
+	for (i = 0; i < opt.iterations; i++) {
+		b = i % BENCH_NFCV_BLOCKS;
+		bench_sample_start(&op);
+		err = rfalNfvPollerWriteSingleBlock(RFAL_NFCV_REQ_FLAG_DEFAULT, NULL, b, &nfcvData[b * BENCH_NFCV_BLOCK_LEN], BENCH_NFCV_BLOCK_LEN);
+		bench_sample_end(&op, err, 1);
+	}
+	bench_op_end(&op);
+
+	for (b = 0; b < sizeof(multi); b++) {
+		bench_op_begin(&op, "nfcv", "write_multiple", multi[b]);
+		for (i = 0; i < opt.iterations; i++) {
+			bench_sample_start(&op);
+			err = rfalNfvPollerWriteMultipleBlocks(RFAL_NFCV_REQ_FLAG_DEFAULT, NULL, 0, multi[b] - 1, nfcvData, BENCH_NFCV_BLOCK_LEN);
+			bench_sample_end(&op, err, multi[b]);
+		}
+		bench_op_end(&op);
+	}
+
+	/* Whole memory, plain and with the security status of a few locked blocks */
+	for (b = 0; b < 2; b++) {
+#ifdef PLTF_SIM
+		if (b == 1) {
+			simNfcv[0].locked[BENCH_NFCV_TAG_BLOCKS - 2] = true;
+			simNfcv[0].locked[BENCH_NFCV_TAG_BLOCKS - 1] = true;
+		}
+#endif
+		bench_op_begin(&op, "nfcv", (b == 0) ? "dump" : "dump_status", BENCH_NFCV_TAG_BLOCKS);
+		for (i = 0; i < opt.iterations; i++) {
+			bench_sample_start(&op);
+			err = bench_nfcv_dump(b == 1, &rcvLen);
+			bench_sample_end(&op, err, rcvLen);
+		}
+		bench_op_end(&op);
+	}
+
+	/* Whole writes from the memory dumped: Write Multiple Blocks, the same
+	 * polling the end of the writes with EOFs, then single block writes */
+	bench_nfcv_write_memory("write_memory", RFAL_NFCV_REQ_FLAG_DEFAULT, true);
+	bench_nfcv_write_memory("write_memory_option", RFAL_NFCV_REQ_FLAG_DEFAULT | RFAL_NFCV_REQ_FLAG_OPTION, true);
+	bench_nfcv_write_memory("write_memory_single", RFAL_NFCV_REQ_FLAG_DEFAULT, false);
+	bench_nfcv_write_memory("write_memory_single_option", RFAL_NFCV_REQ_FLAG_DEFAULT | RFAL_NFCV_REQ_FLAG_OPTION, false);
+
+	/* Demo commands, each run starts from a reset tag */
+	bench_op_begin(&op, "nfcv", "demo_read", 1);
+	for (i = 0; i < opt.iterations; i++) {
+		bench_field(BENCH_TECH_NFCV, 1);
+		bench_sample_start(&op);
+		err = bench_nfcv_demo(false);
+		bench_sample_end(&op, err, 1);
+	}
+	bench_op_end(&op);
+
+	bench_op_begin(&op, "nfcv", "demo_write", 1);
+	for (i = 0; i < opt.iterations; i++) {
+		bench_field(BENCH_TECH_NFCV, 1);
+		bench_sample_start(&op);
+		err = bench_nfcv_demo(true);
+		bench_sample_end(&op, err, 1);
+	}
+	bench_op_end(&op);
+}
+
+/*
+ ******************************************************************************
+ * LOCAL FUNCTIONS - NFC-A
+ ******************************************************************************
+ */
+/* Wake and select the single NFC-A tag in the field */
+static ReturnCode bench_nfca_select(rfalNfcaListenDevice *dev)
+{
+	rfalNfcaSensRes sensRes;
+	rfalNfcaSelRes selRes;
+	uint8_t devCnt;
+	ReturnCode err;
+
+	rfalNfcaPollerInitialize();
+	rfalFieldOnAndStartGT();
+
+	err = rfalNfcaPollerFullCollisionResolution(RFAL_COMPLIANCE_MODE_NFC, 1, dev, &devCnt);
+	if (err != ERR_NONE)
+		return err;
+	if (devCnt == 0)
+		return ERR_NOTFOUND;
+	if (!dev->isSleep)
+		return ERR_NONE;
+
+	err = rfalNfcaPollerCheckPresence(RFAL_14443A_SHORTFRAME_CMD_WUPA, &sensRes);
+	if (err != ERR_NONE)
+		return err;
+	return rfalNfcaPollerSelect(dev->nfcId1, dev->nfcId1Len, &selRes);
+}
+
+/* One APDU through the ISO-DEP layer, driven by the worker */
+static ReturnCode bench_isodep_apdu(const rfalIsoDepDevice *isoDep, uint16_t len)
+{
+	rfalIsoDepApduTxRxParam param;
+	uint16_t rxLen;
+	rfalIrqWaiter w;
+	ReturnCode err;
+
+	/* SELECT by name, the name filling the APDU */
+	apduTx.apdu[0] = 0x00;
+	apduTx.apdu[1] = 0xA4;
+	apduTx.apdu[2] = 0x04;
+	apduTx.apdu[3] = 0x00;
+	apduTx.apdu[4] = (uint8_t)(len - 5);
+	memset(&apduTx.apdu[5], 0xA5, len - 5);
+
+	param.txBuf = &apduTx;
+	param.txBufLen = len;
+	param.rxBuf = &apduRx;
+	param.rxLen = &rxLen;
+	param.tmpBuf = &apduTmp;
+	param.FWT = isoDep->info.FWT;
+	param.dFWT = isoDep->info.dFWT;
+	param.FSx = isoDep->info.FSx;
+	param.ourFSx = RFAL_ISODEP_FSX_KEEP;
+	param.DID = RFAL_ISODEP_NO_DID;
+
+	err = rfalIsoDepStartApduTransceive(param);
+	if (err != ERR_NONE)
+		return err;
+
+	/* Sleep between worker runs until the next IRQ, as the blocking RFAL calls do */
+	do {
+		rfalIrqWaitPrepare(&w);
+		rfalWorker();
+		err = rfalIsoDepGetApduTransceiveStatus();
+		if (err == ERR_BUSY)
+			rfalIrqWaitNext(&w);
+	} while (err == ERR_BUSY);
+
+	return err;
+}
+
+static void bench_nfca(void)
+{
+	static rfalNfcaListenDevice devList[BENCH_TAGS_MAX];
+	static const uint16_t apdus[] = { 16, 64, 250, 1000 };
+	rfalNfcaListenDevice dev;
+	rfalIsoDepDevice isoDep;
+	rfalNfcaSensRes sensRes;
+	uint8_t t2tRead[2] = { 0x30, 0x04 };
+	uint8_t devCnt = 0;
+	uint16_t rcvLen;
+	ReturnCode err;
+	uint32_t i, n;
+
+	bench_field(BENCH_TECH_T2T, 1);
+	rfalNfcaPollerInitialize();
+	rfalFieldOnAndStartGT();
+	bench_op_begin(&op, "nfca", "detect", 1);
+	for (i = 0; i < opt.iterations; i++) {
+		bench_sample_start(&op);
+		err = rfalNfcaPollerTechnologyDetection(RFAL_COMPLIANCE_MODE_NFC, &sensRes);
+		bench_sample_end(&op, err, 1);
+	}
+	bench_op_end(&op);
+
+	/* Full resolution leaves the tags asleep, each run powers them again */
+	for (n = bench_sweep_first(); n <= opt.tagsMax; n = bench_sweep_next(n, opt.tagsMax)) {
+		bench_field(BENCH_TECH_T2T, n);
+		rfalNfcaPollerInitialize();
+		bench_op_begin(&op, "nfca", "resolve", n);
+		for (i = 0; i < opt.iterations; i++) {
+			rfalFieldOff();
+			rfalFieldOnAndStartGT();
+			bench_sample_start(&op);
+			err = rfalNfcaPollerFullCollisionResolution(RFAL_COMPLIANCE_MODE_NFC, BENCH_TAGS_MAX, devList, &devCnt);
+			bench_sample_end(&op, bench_resolved(err, n, devCnt), devCnt);
+		}
+		bench_sweep_end(n, devCnt);
+	}
+
+	/* T2T READ of 16 bytes */
+	bench_field(BENCH_TECH_T2T, 1);
+	err = bench_nfca_select(&dev);
+	if (err != ERR_NONE)
+		fprintf(stderr, "nfca: no T2T selected (%d), reads will fail\n", err);
+	bench_op_begin(&op, "nfca", "t2t_read", 16);
+	for (i = 0; i < opt.iterations; i++) {
+		bench_sample_start(&op);
+		err = rfalTransceiveBlockingTxRx(t2tRead, sizeof(t2tRead), rxBuf, sizeof(rxBuf), &rcvLen, RFAL_TXRX_FLAGS_DEFAULT, BENCH_FWT);
+		bench_sample_end(&op, err, 1);
+	}
+	bench_op_end(&op);
+
+	/* ISO-DEP activation: RATS and PPS, deselected after each run */
+	bench_field(BENCH_TECH_ISODEP, 1);
+	bench_op_begin(&op, "isodep", "activate", 1);
+	for (i = 0; i < opt.iterations; i++) {
+		err = bench_nfca_select(&dev);
+		bench_sample_start(&op);
+		if (err == ERR_NONE)
+			err = rfalIsoDepPollAHandleActivation((rfalIsoDepFSxI)RFAL_ISODEP_FSDI_DEFAULT, RFAL_ISODEP_NO_DID, RFAL_BR_424, &isoDep);
+		bench_sample_end(&op, err, 1);
+		if (err == ERR_NONE)
+			rfalIsoDepDeselect();
+	}
+	bench_op_end(&op);
+
+	err = bench_nfca_select(&dev);
+	if (err == ERR_NONE)
+		err = rfalIsoDepPollAHandleActivation((rfalIsoDepFSxI)RFAL_ISODEP_FSDI_DEFAULT, RFAL_ISODEP_NO_DID, RFAL_BR_424, &isoDep);
+	if (err != ERR_NONE)
+		fprintf(stderr, "isodep: no card activated (%d), APDUs will fail\n", err);
+	for (n = 0; n < (sizeof(apdus) / sizeof(apdus[0])); n++) {
+		bench_op_begin(&op, "isodep", "apdu", apdus[n]);
+		for (i = 0; i < opt.iterations; i++) {
+			bench_sample_start(&op);
+			err = bench_isodep_apdu(&isoDep, apdus[n]);
+			bench_sample_end(&op, err, 1);
+		}
+		bench_op_end(&op);
+	}
+	rfalIsoDepDeselect();
+}
+
+/*
+ ******************************************************************************
+ * LOCAL FUNCTIONS - NFC-F
+ ******************************************************************************
+ */
+static void bench_nfcf(void)
+{
+	static rfalNfcfListenDevice devList[BENCH_TAGS_MAX];
+	/* Check of block 0 of the service 0x0009, the IDm filled in below */
+	uint8_t check[] = { 0x06, 0, 0, 0, 0, 0, 0, 0, 0, 0x01, 0x09, 0x00, 0x01, 0x80, 0x00 };
+	uint8_t devCnt = 0;
+	uint16_t rcvLen;
+	ReturnCode err;
+	uint32_t i, n, max;
+
+	bench_field(BENCH_TECH_NFCF, 1);
+	rfalNfcfPollerInitialize(RFAL_BR_212);
+	rfalFieldOnAndStartGT();
+	bench_op_begin(&op, "nfcf", "detect", 1);
+	for (i = 0; i < opt.iterations; i++) {
+		bench_sample_start(&op);
+		err = rfalNfcfPollerCheckPresence();
+		bench_sample_end(&op, err, 1);
+	}
+	bench_op_end(&op);
+
+	/* One answer per time slot, FeliCa has no anticollision beyond the slots */
+	max = (opt.tagsMax < RFAL_FELICA_POLL_MAX_SLOTS) ? opt.tagsMax : RFAL_FELICA_POLL_MAX_SLOTS;
+	for (n = bench_sweep_first(); n <= max; n = bench_sweep_next(n, max)) {
+		bench_field(BENCH_TECH_NFCF, n);
+		rfalNfcfPollerInitialize(RFAL_BR_212);
+		rfalFieldOnAndStartGT();
+		bench_op_begin(&op, "nfcf", "resolve", n);
+		for (i = 0; i < opt.iterations; i++) {
+			bench_sample_start(&op);
+			err = rfalNfcfPollerCollisionResolution(RFAL_COMPLIANCE_MODE_NFC, BENCH_TAGS_MAX, devList, &devCnt);
+			bench_sample_end(&op, bench_resolved(err, n, devCnt), devCnt);
+		}
+		bench_sweep_end(n, devCnt);
+	}
+
+	bench_field(BENCH_TECH_NFCF, 1);
+	rfalNfcfPollerInitialize(RFAL_BR_212);
+	rfalFieldOnAndStartGT();
+	err = rfalNfcfPollerCollisionResolution(RFAL_COMPLIANCE_MODE_NFC, 1, devList, &devCnt);
+	if ((err != ERR_NONE) || (devCnt == 0))
+		fprintf(stderr, "nfcf: no card found (%d), checks will fail\n", err);
+	memcpy(&check[1], devList[0].sensfRes.NFCID2, RFAL_NFCF_NFCID2_LEN);
+	bench_op_begin(&op, "nfcf", "check", 1);
+	for (i = 0; i < opt.iterations; i++) {
+		bench_sample_start(&op);
+		err = rfalTransceiveBlockingTxRx(check, sizeof(check), rxBuf, sizeof(rxBuf), &rcvLen, RFAL_TXRX_FLAGS_DEFAULT, BENCH_FWT);
+		bench_sample_end(&op, err, 1);
+	}
+	bench_op_end(&op);
+}
+
+/*
+ ******************************************************************************
+ * LOCAL FUNCTIONS - MULTI-TECHNOLOGY POLLER
+ ******************************************************************************
+ */
+/* Technology detection of exampleNFC.c, returns the technologies found */
+static uint32_t bench_poller_detect(void)
+{
+	rfalNfcaSensRes sensRes;
+	rfalNfcbSensbRes sensbRes;
+	rfalNfcvInventoryRes invRes;
+	uint8_t sensbResLen;
+	uint32_t found = 0;
+
+	rfalNfcaPollerInitialize();
+	rfalFieldOnAndStartGT();
+	if (rfalNfcaPollerTechnologyDetection(RFAL_COMPLIANCE_MODE_NFC, &sensRes) == ERR_NONE)
+		found++;
+
+	rfalNfcbPollerInitialize();
+	rfalFieldOnAndStartGT();
+	if (rfalNfcbPollerTechnologyDetection(RFAL_COMPLIANCE_MODE_NFC, &sensbRes, &sensbResLen) == ERR_NONE)
+		found++;
+
+	rfalNfcfPollerInitialize(RFAL_BR_212);
+	rfalFieldOnAndStartGT();
+	if (rfalNfcfPollerCheckPresence() == ERR_NONE)
+		found++;
+
+	rfalNfcvPollerInitialize();
+	rfalFieldOnAndStartGT();
+	if (rfalNfcvPollerCheckPresence(&invRes) == ERR_NONE)
+		found++;
+
+	return found;
+}
+
+/* Detection followed by the collision resolution of exampleNFC.c, field
+ * cycled as the demo does between rounds. Returns the devices found */
+static uint32_t bench_poller_discover(void)
+{
+	static rfalNfcaListenDevice nfcaList[BENCH_TAGS_MAX];
+	static rfalNfcfListenDevice nfcfList[BENCH_TAGS_MAX];
+	static rfalNfcvListenDevice nfcvList[BENCH_TAGS_MAX];
+	uint8_t devCnt;
+	uint32_t total = 0;
+
+	rfalFieldOff();
+	if (bench_poller_detect() == 0)
+		return 0;
+
+	rfalNfcaPollerInitialize();
+	rfalFieldOnAndStartGT();
+	if (rfalNfcaPollerFullCollisionResolution(RFAL_COMPLIANCE_MODE_NFC, BENCH_TAGS_MAX, nfcaList, &devCnt) == ERR_NONE)
+		total += devCnt;
+
+	rfalNfcfPollerInitialize(RFAL_BR_212);
+	rfalFieldOnAndStartGT();
+	if (rfalNfcfPollerCollisionResolution(RFAL_COMPLIANCE_MODE_NFC, BENCH_TAGS_MAX, nfcfList, &devCnt) == ERR_NONE)
+		total += devCnt;
+
+	rfalNfcvPollerInitialize();
+	rfalFieldOnAndStartGT();
+	if (rfalNfcvPollerCollisionResolution(BENCH_TAGS_MAX, nfcvList, &devCnt) == ERR_NONE)
+		total += devCnt;
+
+	return total;
+}
+
+static void bench_poller(void)
+{
+	uint32_t i, found;
+
+	/* One tag of every technology the model has, plus the ISO-DEP card */
+	bench_field(BENCH_TECH_NFCV | BENCH_TECH_T2T | BENCH_TECH_NFCF | BENCH_TECH_ISODEP, 1);
+
+	bench_op_begin(&op, "poller", "tech_detect", 0);
+	for (i = 0; i < opt.iterations; i++) {
+		bench_sample_start(&op);
+		found = bench_poller_detect();
+		bench_sample_end(&op, (found > 0) ? ERR_NONE : ERR_NOTFOUND, found);
+	}
+	bench_op_end(&op);
+
+	bench_op_begin(&op, "poller", "discover", 0);
+	for (i = 0; i < opt.iterations; i++) {
+		bench_sample_start(&op);
+		found = bench_poller_discover();
+		bench_sample_end(&op, (found > 0) ? ERR_NONE : ERR_NOTFOUND, found);
+	}
+	bench_op_end(&op);
+}
+
+/*
+ ******************************************************************************
+ * LOCAL FUNCTIONS - SETUP
+ ******************************************************************************
+ */
+static bool bench_platform_init(void)
+{
+	if (pltf_rt_init(NULL) != ERR_NONE)
+		return false;
+	if (pltf_trace_init() != ERR_NONE)
+		return false;
+	if (gpio_init() != ERR_NONE)
+		return false;
+	if (spi_init() != ERR_NONE)
+		return false;
+	if (interrupt_init() != ERR_NONE)
+		return false;
+
+	rfalAnalogConfigInitialize();
+	return (rfalInitialize() == ERR_NONE);
+}
+
+static void bench_usage(const char *prog)
+{
+	fprintf(stderr, "Usage: %s [options]\n"
+		"  -f, --format csv|json   output format (csv)\n"
+		"  -o, --out FILE          write the results to FILE (stdout)\n"
+		"  -n, --iterations N      runs per operation (%u)\n"
+		"  -t, --tags N            largest tag count of the resolution sweeps (%u)\n"
+		"  -g, --groups LIST       comma separated groups: nfcv,nfca,nfcf,poller (all)\n",
+		prog, BENCH_ITERATIONS, BENCH_TAGS_MAX);
+}
+
+/*
+ ******************************************************************************
+ * MAIN FUNCTION
+ ******************************************************************************
+ */
+int main(int argc, char *argv[])
+{
+	static const struct option longOpts[] = {
+		{ "format", required_argument, NULL, 'f' },
+		{ "out", required_argument, NULL, 'o' },
+		{ "iterations", required_argument, NULL, 'n' },
+		{ "tags", required_argument, NULL, 't' },
+		{ "groups", required_argument, NULL, 'g' },
+		{ "help", no_argument, NULL, 'h' },
+		{ NULL, 0, NULL, 0 }
+	};
+	FILE *out = stdout;
+	int c;
+
+	while ((c = getopt_long(argc, argv, "f:o:n:t:g:h", longOpts, NULL)) != -1) {
+		switch (c) {
+		case 'f':
+			if (bench_format_parse(optarg, &opt.format) != ERR_NONE) {
+				bench_usage(argv[0]);
+				return 1;
+			}
+			break;
+		case 'o':
+			opt.out = optarg;
+			break;
+		case 'n':
+			opt.iterations = strtoul(optarg, NULL, 0);
+			break;
+		case 't':
+			opt.tagsMax = strtoul(optarg, NULL, 0);
+			if ((opt.tagsMax == 0) || (opt.tagsMax > BENCH_TAGS_MAX)) {
+				bench_usage(argv[0]);
+				return 1;
+			}
+			break;
+		case 'g':
+			opt.groups = optarg;
+			break;
+		default:
+			bench_usage(argv[0]);
+			return 1;
+		}
+	}
+
+	if (!bench_platform_init()) {
+		printf("Error: platform initialisation failed\n");
+		return 1;
+	}
+
+	if (bench_group("nfcv"))
+		bench_nfcv();
+	if (bench_group("nfca"))
+		bench_nfca();
+	if (bench_group("nfcf"))
+		bench_nfcf();
+	if (bench_group("poller"))
+		bench_poller();
+	rfalFieldOff();
+
+	if (opt.out != NULL) {
+		out = fopen(opt.out, "w");
+		if (out == NULL) {
+			printf("Error: cannot open %s\n", opt.out);
+			return 1;
+		}
+	}
+	bench_report(out, opt.format, "rfal");
+	if (out != stdout)
+		fclose(out);
+
+	pltf_trace_stop();
+	return 0;
+}
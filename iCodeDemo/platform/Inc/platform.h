@@ -64,6 +64,14 @@
 #include "pltf_timer.h"
 #include "pltf_spi.h"
 #include "pltf_gpio.h"
+#include "pltf_indicator.h"
+#include "pltf_rt.h"
+#include "pltf_reader.h"
+#include "pltf_evloop.h"
+#include "pltf_trace.h"
+#ifdef PLTF_SIM
+#include "pltf_sim.h"
+#endif /* PLTF_SIM */
 
 /*
 ******************************************************************************
@@ -110,6 +118,10 @@
 ******************************************************************************
 */
 #define ST25R391X_COM_SINGLETXRX                                        /*!< Enable single SPI frame transmission */
+#define ST25R391X_COM_SHADOW                                            /*!< Enable register shadow, skips SPI reads of known registers */
+#define ST25R391X_COM_FIFO_DRAIN                                        /*!< Enable FIFO drain by the ISR on end of receive */
+#define PLATFORM_INDICATORS                                             /*!< Enable LED indicators, comment out to compile all LED handling out */
+#define PLATFORM_TRACE                                                  /*!< Enable the SPI/IRQ trace recorder, records once pltf_trace_start() is called */
 
 #define platformProtectST25R391xComm()        pltf_protect_com()
 #define platformUnprotectST25R391xComm()      pltf_unprotect_com()   
@@ -120,6 +132,12 @@
 #define platformProtectST25R391xIrqStatus()   pltf_protect_interrupt_status()   /*!< Acquire the lock for safe access of RFAL interrupt status variable */  
 #define platformUnprotectST25R391xIrqStatus() pltf_unprotect_interrupt_status() /*!< Release the lock aquired for safe accessing of RFAL interrupt status variable */ 
 
+#define platformReaderId()                    pltf_reader_current()     /*!< Reader the calling thread works on, selects the driver state */
+#define PLATFORM_READERS                      PLTF_READER_MAX           /*!< Number of reader contexts                                    */
+
+#define platformIrqSequence()                 pltf_irq_sequence()       /*!< Number of IRQs handled so far, read before checking a wait condition */
+#define platformIrqWait(seq, us)              pltf_irq_wait(seq, us)    /*!< Sleep until an IRQ after seq has been handled or us microseconds elapsed */
+
 #define platformIrqST25R3911SetCallback(cb)          
 #define platformIrqST25R3911PinInitialize()                
 
@@ -129,16 +147,36 @@
 #define platformGpioIsHigh(port, pin)         (gpio_readpin(port, pin) == GPIO_PIN_SET)                                                     /*!< Checks if the given GPIO is High */
 #define platformGpioIsLow(port, pin)          (!platformGpioIsHigh(port, pin))                                                              /*!< Checks if the given GPIO is Low  */
 
+#ifdef PLATFORM_INDICATORS
+#define platformLedsInitialize()              indicator_init()                  /*!< Starts the thread driving the LEDs */
+#define platformLedsFlush()                   indicator_flush()                 /*!< Applies the pending LED state now  */
+#define platformLedOff(port, pin)             indicator_post(pin, false)        /*!< Turns the given LED Off (deferred to the indicator thread) */
+#define platformLedOn(port, pin)              indicator_post(pin, true)         /*!< Turns the given LED On  (deferred to the indicator thread) */
+#else
 #define platformLedsInitialize()                                                /*!< Initializes the pins used as LEDs to outputs*/
-#define platformLedOff(port, pin)             platformGpioClear(port, pin)      /*!< Turns the given LED Off */ /* Support for old board version MB1325-A */
-#define platformLedOn(port, pin)              platformGpioSet(port, pin)        /*!< Turns the given LED On  */ /* Support for old board version MB1325-A */
+#define platformLedsFlush()                                                     /*!< Applies the pending LED state now  */
+#define platformLedOff(port, pin)                                               /*!< Turns the given LED Off */
+#define platformLedOn(port, pin)                                                /*!< Turns the given LED On  */
+#endif /* PLATFORM_INDICATORS */
 
 #define platformTimerCreate(t)                timerCalculateTimer(t)    /*!< Create a timer with the given time (ms)     */
+#define platformTimerCreateUs(t)              timerCalculateTimerUs(t)  /*!< Create a timer with the given time (us)     */
 #define platformTimerIsExpired(timer)         timerIsExpired(timer)     /*!< Checks if the given timer is expired        */
+#define platformTimerNextDeadline(since, d)   timerNextDeadline(since, d) /*!< Earliest timer of the reader created after since */
 #define platformDelay(t)                      timerDelay(t)             /*!< Performs a delay for the given time (ms)    */
+#define platformDelayUs(t)                    timerDelayUs(t)           /*!< Performs a delay for the given time (us)    */
 #define platformGetSysTick()                  platformGetSysTick_linux()/*!< Get System Tick ( 1 tick = 1 ms)            */
+#define platformGetTimeUs()                   timerGetTimeUs()          /*!< Get monotonic time in us                    */
 
+#ifdef PLATFORM_TRACE
+#define platformSpiTxRx(txBuf, rxBuf, len)    pltf_trace_spiTxRx(txBuf, rxBuf, len) /*!< SPI transceive, recorded while tracing */
+#define platformSpiTxRxMulti(segs, n)         pltf_trace_spiTxRxMulti(segs, n)      /*!< SPI transceive of several CS framed segments in one go, recorded while tracing */
+#else
 #define platformSpiTxRx(txBuf, rxBuf, len)    spiTxRx(txBuf, rxBuf, len)/*!< SPI transceive */
+#define platformSpiTxRxMulti(segs, n)         spiTxRxMulti(segs, n)     /*!< SPI transceive of several CS framed segments in one go */
+#endif /* PLATFORM_TRACE */
+#define platformSpiSegment                    spiSegmentTypeDef         /*!< SPI segment type used by platformSpiTxRxMulti           */
+#define PLATFORM_SPI_MAX_SEGMENTS             SPI_MAX_SEGMENTS          /*!< Maximum number of segments per platformSpiTxRxMulti     */
                                               
 #define platformI2CTx(txBuf, len)                                       /*!< I2C Transmit  */
 #define platformI2CRx(txBuf, len)                                       /*!< I2C Receive   */
@@ -164,6 +202,7 @@
 #define RFAL_FEATURE_DYNAMIC_POWER              false                   /*!< Enable/Disable RFAL dynamic power support                                 */
 #define RFAL_FEATURE_ISO_DEP                    true                    /*!< Enable/Disable RFAL support for ISO-DEP (ISO14443-4)                      */
 #define RFAL_FEATURE_NFC_DEP                    true                    /*!< Enable/Disable RFAL support for NFC-DEP (NFCIP1/P2P)                      */
+#define RFAL_FEATURE_QUEUE                      true                    /*!< Enable/Disable RFAL transceive queue with completion callbacks            */
 
 
 #define RFAL_FEATURE_ISO_DEP_IBLOCK_MAX_LEN     256                     /*!< ISO-DEP I-Block max length. Please use values as defined by rfalIsoDepFSx */
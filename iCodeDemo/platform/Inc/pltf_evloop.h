@@ -0,0 +1,131 @@
+
+/******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; COPYRIGHT 2018 STMicroelectronics</center></h2>
+  *
+  * Licensed under ST MYLIBERTY SOFTWARE LICENSE AGREEMENT (the "License");
+  * You may not use this file except in compliance with the License.
+  * You may obtain a copy of the License at:
+  *
+  *        http://www.st.com/myliberty
+  *
+  * Unless required by applicable law or agreed to in writing, software 
+  * distributed under the License is distributed on an "AS IS" BASIS, 
+  * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied,
+  * AND SPECIFICALLY DISCLAIMING THE IMPLIED WARRANTIES OF MERCHANTABILITY,
+  * FITNESS FOR A PARTICULAR PURPOSE, AND NON-INFRINGEMENT.
+  * See the License for the specific language governing permissions and
+  * limitations under the License.
+  *
+******************************************************************************/
+
+/*! \file pltf_evloop.h
+ *
+ *  \brief Event loop serving several readers from one thread
+ *  
+ *  Each registered reader contributes its interrupt line and a timerfd to a
+ *  single epoll set. The timerfd is armed at the earliest deadline of the
+ *  timers the reader's code created (RFAL guard time, FWT, RXE errata
+ *  timer, application timers). The handler of a reader only runs when its
+ *  interrupt fired, one of its deadlines passed or, as a safety net, every
+ *  PLTF_EVLOOP_TICK_MS.
+ *
+ *  Handlers run bound to their reader and must not block: they drive the
+ *  non-blocking RFAL API, e.g. rfalStartTransceive() followed by
+ *  rfalGetTransceiveStatus() on later invocations, or the ISO-DEP and
+ *  NFC-DEP Start/GetStatus pairs, or rfalQueueWorker() for requests
+ *  submitted to the transceive queue (rfal_queue.h). Blocking calls still
+ *  work but hold up the other readers while they wait.
+ *
+ */
+
+#ifndef PLATFORMEVLOOP_H
+#define PLATFORMEVLOOP_H
+
+/*
+ ******************************************************************************
+ * INCLUDES
+ ******************************************************************************
+ */
+#include "st_errno.h"
+#include "pltf_reader.h"
+
+/*
+ ******************************************************************************
+ * GLOBAL DEFINES
+ ******************************************************************************
+ */
+#ifndef PLTF_EVLOOP_TICK_MS
+#define PLTF_EVLOOP_TICK_MS	100	/* Max time a reader handler goes without being run */
+#endif
+
+/*
+ ******************************************************************************
+ * GLOBAL TYPES
+ ******************************************************************************
+ */
+/* Reader handler, runs the reader's RFAL worker and application state machine */
+typedef void (*pltfEvloopHandler)(void *arg);
+
+/*
+ ******************************************************************************
+ * GLOBAL FUNCTION PROTOTYPES
+ ******************************************************************************
+ */
+
+/*! 
+ *****************************************************************************
+ * \brief  Initialize the event loop
+ *  
+ * \return ERR_IO	: epoll instance could not be created
+ * \return ERR_NONE	: No error
+ *****************************************************************************
+ */
+ReturnCode pltf_evloop_init(void);
+
+/*! 
+ *****************************************************************************
+ * \brief  Register a reader with the event loop
+ *  
+ * The SPI and GPIO of the reader must have been set up with spi_init() and
+ * gpio_init() from a thread bound to it; interrupt_init() must not be
+ * called, the loop polls the interrupt line instead of an interrupt thread.
+ * The handler is run once right after the loop starts.
+ * \param[in]	: reader to serve
+ * \param[in]	: handler of the reader
+ * \param[in]	: argument passed to the handler
+ *
+ * \return ERR_PARAM	: Invalid reader or handler, reader already registered
+ * \return ERR_IO	: Interrupt line or timerfd could not be registered
+ * \return ERR_NONE	: No error
+ *****************************************************************************
+ */
+ReturnCode pltf_evloop_add(pltfReader reader, pltfEvloopHandler handler, void *arg);
+
+/*! 
+ *****************************************************************************
+ * \brief  Run the event loop
+ *  
+ * This method serves the registered readers on the calling thread until
+ * pltf_evloop_stop() is called.
+ *
+ * \return ERR_WRONG_STATE	: Event loop not initialized
+ * \return ERR_IO		: epoll or reading a reader timerfd failed
+ * \return ERR_NONE		: Stopped
+ *****************************************************************************
+ */
+ReturnCode pltf_evloop_run(void);
+
+/*! 
+ *****************************************************************************
+ * \brief  Stop the event loop
+ *  
+ * This method makes pltf_evloop_run() return after the current iteration.
+ * It can be called from a handler or from another thread.
+ *
+ *****************************************************************************
+ */
+void pltf_evloop_stop(void);
+
+#endif /* PLATFORMEVLOOP_H */
@@ -30,6 +30,12 @@
  *  It provides the functionality to use a GPIO line to receive interrupts from ST25R3911X
  *  and to set/clear the gpio to glow and off the LEDs. 
  *
+ *  Two backends are available: the GPIO character device (uAPI v2 line requests)
+ *  and the legacy sysfs interface. The character device is preferred when it is
+ *  compiled in (PLTF_GPIO_USE_CDEV) and the chip can be opened; sysfs is used
+ *  as fallback. The backend can be forced at run time with gpio_select_backend()
+ *  or the PLTF_GPIO_BACKEND environment variable ("cdev" or "sysfs").
+ *
  */
 
 #ifndef PLATFORMGPIO_H
@@ -40,6 +46,8 @@
  * INCLUDES
  ******************************************************************************
  */
+#include <stdint.h>
+#include <stdbool.h>
 #include "st_errno.h"
 
 /*
@@ -48,10 +56,33 @@
  ******************************************************************************
  */
 /* GPIO pin no. 22 is used as interrupt line to receive interrupts from ST25R3911X.
+ * This is the line of the default reader, further readers give theirs in
+ * their pltfReaderConfig.
  */ 
 
 #define PLTF_GPIO_INTR_PIN	22
 
+/* Build the GPIO character device backend, comment out to build sysfs only */
+#define PLTF_GPIO_USE_CDEV
+
+#ifndef PLTF_GPIO_CHIP
+#define PLTF_GPIO_CHIP		"/dev/gpiochip0"	/* GPIO chip holding the interrupt and LED lines */
+#endif
+
+#define PLTF_GPIO_MAX_LINES	64			/* Max line offset that can be requested as output */
+
+/* Output lines requested by gpio_init() with the character device backend,
+ * so set/clear never issue a line request on the RF path (tag read and field LEDs) */
+#ifndef PLTF_GPIO_OUT_LINES
+#define PLTF_GPIO_OUT_LINES	{ 27, 17 }
+#endif
+
+/* Time a waiter spins on the IRQ sequence before sleeping, in us.
+ * A short spin avoids the futex wake-up latency on the shortest FDTs */
+#ifndef PLTF_IRQ_SPIN_US
+#define PLTF_IRQ_SPIN_US	0
+#endif
+
 /*
  ******************************************************************************
  * GLOBAL TYPES
@@ -63,6 +94,13 @@ typedef enum {
 	GPIO_PIN_SET
 }GPIO_PinState;
 
+/* GPIO backend enumeration */
+typedef enum {
+	GPIO_BACKEND_AUTO = 0,		/* Character device if available, sysfs otherwise */
+	GPIO_BACKEND_CDEV,		/* GPIO character device, uAPI v2 line requests */
+	GPIO_BACKEND_SYSFS		/* Legacy /sys/class/gpio interface */
+}GPIO_BackendType;
+
 /*
  ******************************************************************************
  * GLOBAL FUNCTION PROTOTYPES
@@ -73,10 +111,14 @@ typedef enum {
  *****************************************************************************
  * \brief  Initialize free GPIO as interrupt pin
  *  
- * This methods initialize GPIO SYSFS interface for interrupt gpio line
+ * This methods initialize the selected GPIO backend for interrupt gpio line
  * to control GPIO pin from user space.
  * This method configures the GPIO line as interrupt pin with rising edge 
  * to receive interrupts from ST25R3911X.
+ * With GPIO_BACKEND_AUTO the character device is tried first and sysfs is
+ * used if the chip cannot be opened or the line cannot be requested.
+ * The interrupt line is the one of the reader bound to the calling thread;
+ * the backend chosen for the first reader is used for all of them.
  *
  * \return ERR_IO	: GPIO is not successfuly configured as interrupt pin 
  * \return ERR_NONE	: No error
@@ -84,6 +126,44 @@ typedef enum {
  */
 ReturnCode gpio_init(void);
 
+/*! 
+ *****************************************************************************
+ * \brief  Select the GPIO backend
+ *  
+ * This method selects the backend used by gpio_init(). It must be called
+ * before gpio_init(); by default GPIO_BACKEND_AUTO is used.
+ * \param[in]	: backend to be used
+ *
+ * \return ERR_WRONG_STATE	: GPIO is already initialized
+ * \return ERR_NOTSUPP		: Character device backend is not compiled in
+ * \return ERR_NONE		: No error
+ *****************************************************************************
+ */
+ReturnCode gpio_select_backend(GPIO_BackendType backend);
+
+/*! 
+ *****************************************************************************
+ * \brief  Get the GPIO backend in use
+ *  
+ * \return GPIO_BACKEND_CDEV or GPIO_BACKEND_SYSFS once gpio_init() succeeded,
+ *         the selected backend otherwise
+ *****************************************************************************
+ */
+GPIO_BackendType gpio_get_backend(void);
+
+/*! 
+ *****************************************************************************
+ * \brief  Get the timestamp of the last interrupt edge
+ *  
+ * With the character device backend the kernel timestamps every edge of the
+ * interrupt line (CLOCK_MONOTONIC). This method returns the timestamp of the
+ * last edge handled by the interrupt thread.
+ *
+ * \return Timestamp in nanoseconds, 0 if not available (sysfs backend)
+ *****************************************************************************
+ */
+uint64_t gpio_get_irq_timestamp(void);
+
 /*! 
  *****************************************************************************
  * \brief  To read GPIO pin state
@@ -106,6 +186,7 @@ GPIO_PinState gpio_readpin(int port, int pin_no);
  * when there is an event (interrupt) on gpio line.
  * It provides the functionality to use a GPIO line to receive interrupts from 
  * ST25R3911XX in user space.
+ * The thread serves the reader bound to the calling thread.
  *
  * \return ERR_IO	: Error in initializing interrupt mechanism 
  * \return ERR_NONE	: No error
@@ -113,6 +194,35 @@ GPIO_PinState gpio_readpin(int port, int pin_no);
  */
 ReturnCode interrupt_init(void);
 
+/*! 
+ *****************************************************************************
+ * \brief  Initialize the interrupt mechanism without interrupt thread
+ *  
+ * This method prepares the interrupt line of the reader bound to the calling
+ * thread to be polled by the application, e.g. from an event loop serving
+ * several readers. When the returned fd signals the returned events the
+ * application calls interrupt_dispatch() bound to the reader. Waits within
+ * blocking RFAL calls poll the line themselves.
+ * \param[out]	: fd of the interrupt line, may be NULL
+ * \param[out]	: poll events signalling an interrupt, may be NULL
+ *
+ * \return ERR_WRONG_STATE	: GPIO of the reader not initialized
+ * \return ERR_NONE		: No error
+ *****************************************************************************
+ */
+ReturnCode interrupt_init_polled(int *fd, short *events);
+
+/*! 
+ *****************************************************************************
+ * \brief  Handle an interrupt of a polled reader
+ *  
+ * This method consumes the pending event of the interrupt line and runs the
+ * ISR of the reader bound to the calling thread.
+ * 
+ *****************************************************************************
+ */
+void interrupt_dispatch(void);
+
 /*! 
  *****************************************************************************
  * \brief  To set GPIO pin 
@@ -159,6 +269,43 @@ void pltf_protect_interrupt_status(void);
  */
 void pltf_unprotect_interrupt_status(void); 
 
+/*! 
+ *****************************************************************************
+ * \brief  Get the IRQ sequence number
+ *  
+ * The interrupt thread increments the sequence number each time it has run
+ * the ISR. A waiter reads it before checking its condition and passes it to
+ * pltf_irq_wait(), so an IRQ handled in between is never missed.
+ *
+ * \return Current IRQ sequence number
+ *****************************************************************************
+ */
+uint32_t pltf_irq_sequence(void);
+
+/*! 
+ *****************************************************************************
+ * \brief  Wait for an IRQ
+ *  
+ * This method sleeps until the IRQ sequence number differs from \a seq or
+ * \a timeout_us elapsed. It first spins for up to the configured spin time.
+ * \param[in]	: IRQ sequence number read before checking the wait condition
+ * \param[in]	: Max time to wait, in us
+ *
+ * \return true	: An IRQ has been handled since \a seq
+ * \return false	: Timeout
+ *****************************************************************************
+ */
+bool pltf_irq_wait(uint32_t seq, uint32_t timeout_us);
+
+/*! 
+ *****************************************************************************
+ * \brief  Set the spin time of IRQ waiters
+ *  
+ * \param[in]	: Time to spin before sleeping in pltf_irq_wait(), in us
+ *****************************************************************************
+ */
+void pltf_irq_set_spin(uint32_t spin_us);
+
 #endif /* PLATFORMGPIO_H */
 
 
@@ -0,0 +1,98 @@
+
+/******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; COPYRIGHT 2018 STMicroelectronics</center></h2>
+  *
+  * Licensed under ST MYLIBERTY SOFTWARE LICENSE AGREEMENT (the "License");
+  * You may not use this file except in compliance with the License.
+  * You may obtain a copy of the License at:
+  *
+  *        http://www.st.com/myliberty
+  *
+  * Unless required by applicable law or agreed to in writing, software 
+  * distributed under the License is distributed on an "AS IS" BASIS, 
+  * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied,
+  * AND SPECIFICALLY DISCLAIMING THE IMPLIED WARRANTIES OF MERCHANTABILITY,
+  * FITNESS FOR A PARTICULAR PURPOSE, AND NON-INFRINGEMENT.
+  * See the License for the specific language governing permissions and
+  * limitations under the License.
+  *
+******************************************************************************/
+
+/*! \file pltf_indicator.h
+ *
+ *  \brief Asynchronous LED indicators
+ *  
+ *  RFAL and the application post the wanted LED state with indicator_post(),
+ *  which only updates a lock-free slot and never touches the GPIO itself.
+ *  A low priority thread applies the posted state every INDICATOR_PERIOD_MS,
+ *  so consecutive changes of the same LED within one period are coalesced
+ *  and GPIO I/O stays off the RF timing path.
+ *
+ */
+
+#ifndef PLATFORMINDICATOR_H
+#define PLATFORMINDICATOR_H
+
+/*
+ ******************************************************************************
+ * INCLUDES
+ ******************************************************************************
+ */
+#include <stdbool.h>
+#include "st_errno.h"
+
+/*
+ ******************************************************************************
+ * GLOBAL DEFINES
+ ******************************************************************************
+ */
+#define INDICATOR_PERIOD_MS	20	/* Update period of the indicator thread, limits the LED update rate */
+#define INDICATOR_MAX_LINES	64	/* LEDs are identified by their GPIO line 0..63 */
+
+/*
+ ******************************************************************************
+ * GLOBAL FUNCTION PROTOTYPES
+ ******************************************************************************
+ */
+
+/*! 
+ *****************************************************************************
+ * \brief  Start the indicator thread
+ *  
+ * This method starts the low priority thread applying the posted LED state.
+ * Calling it again once the thread runs has no effect.
+ *
+ * \return ERR_IO	: Thread could not be created 
+ * \return ERR_NONE	: No error
+ *****************************************************************************
+ */
+ReturnCode indicator_init(void);
+
+/*! 
+ *****************************************************************************
+ * \brief  Post the wanted state of a LED
+ *  
+ * This method records the wanted state and returns immediately; it is
+ * lock-free and safe to be called from the interrupt thread.
+ * \param[in]	: GPIO pin number of the LED
+ * \param[in]	: true to switch the LED on, false to switch it off
+ * 
+ *****************************************************************************
+ */
+void indicator_post(int pin_no, bool on);
+
+/*! 
+ *****************************************************************************
+ * \brief  Apply the posted LED state now
+ *  
+ * This method applies the pending state synchronously, e.g. before the
+ * application exits.
+ * 
+ *****************************************************************************
+ */
+void indicator_flush(void);
+
+#endif /* PLATFORMINDICATOR_H */
+
@@ -0,0 +1,171 @@
+
+/******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; COPYRIGHT 2018 STMicroelectronics</center></h2>
+  *
+  * Licensed under ST MYLIBERTY SOFTWARE LICENSE AGREEMENT (the "License");
+  * You may not use this file except in compliance with the License.
+  * You may obtain a copy of the License at:
+  *
+  *        http://www.st.com/myliberty
+  *
+  * Unless required by applicable law or agreed to in writing, software 
+  * distributed under the License is distributed on an "AS IS" BASIS, 
+  * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied,
+  * AND SPECIFICALLY DISCLAIMING THE IMPLIED WARRANTIES OF MERCHANTABILITY,
+  * FITNESS FOR A PARTICULAR PURPOSE, AND NON-INFRINGEMENT.
+  * See the License for the specific language governing permissions and
+  * limitations under the License.
+  *
+******************************************************************************/
+
+/*! \file pltf_reader.h
+ *
+ *  \brief Reader contexts: several ST25R3911 driven by one process
+ *  
+ *  A reader context holds the SPI device and the interrupt line of one
+ *  ST25R3911 together with the state of the RFAL and ST25R3911 driver
+ *  modules for that chip. Each thread works on one reader at a time, the
+ *  one it is bound to with pltf_reader_bind(); the RFAL API keeps its
+ *  signatures and acts on the reader bound to the calling thread. Threads
+ *  which never bind use PLTF_READER_DEFAULT, so single reader applications
+ *  need no change.
+ *
+ *  The IRQ thread created by interrupt_init() is bound to the reader of the
+ *  thread that created it.
+ *
+ */
+
+#ifndef PLATFORMREADER_H
+#define PLATFORMREADER_H
+
+/*
+ ******************************************************************************
+ * INCLUDES
+ ******************************************************************************
+ */
+#include <stdint.h>
+#include <pthread.h>
+#include "st_errno.h"
+
+/*
+ ******************************************************************************
+ * GLOBAL DEFINES
+ ******************************************************************************
+ */
+#ifndef PLTF_READER_MAX
+#define PLTF_READER_MAX		8		/* Max number of readers driven by one process */
+#endif
+
+#define PLTF_READER_DEFAULT	0		/* Reader of threads which did not bind one */
+
+#ifndef PLTF_READER_SPI_DEVICE
+#define PLTF_READER_SPI_DEVICE	"/dev/spidev0.0"	/* SPI device of the default reader */
+#endif
+
+/* The current reader is read on every access to driver state, use the
+ * cheapest TLS model; the library is linked, not dlopen()ed */
+#define PLTF_READER_TLS		__attribute__((tls_model("initial-exec")))
+
+/*
+ ******************************************************************************
+ * GLOBAL TYPES
+ ******************************************************************************
+ */
+/* Reader handle */
+typedef int pltfReader;
+
+/* Hardware of a reader */
+typedef struct {
+	const char	*spiDevice;	/* SPI device the ST25R3911 is connected to */
+	int		irqPin;		/* GPIO line of the ST25R3911 IRQ output */
+}pltfReaderConfig;
+
+/*
+ ******************************************************************************
+ * GLOBAL VARIABLES
+ ******************************************************************************
+ */
+/* Reader the calling thread works on, use pltf_reader_current() */
+extern __thread pltfReader pltfReaderCurrent PLTF_READER_TLS;
+
+/*
+ ******************************************************************************
+ * GLOBAL FUNCTION PROTOTYPES
+ ******************************************************************************
+ */
+
+/*! 
+ *****************************************************************************
+ * \brief  Open a reader
+ *  
+ * This method allocates the next free reader context, starting with
+ * PLTF_READER_DEFAULT, and assigns it the given hardware. The SPI and GPIO
+ * of the reader are set up by spi_init(), gpio_init() and interrupt_init()
+ * called from a thread bound to it.
+ * \param[in]	: hardware of the reader
+ * \param[out]	: handle of the opened reader
+ *
+ * \return ERR_PARAM	: Invalid configuration
+ * \return ERR_NOMEM	: All PLTF_READER_MAX readers are in use
+ * \return ERR_NONE	: No error
+ *****************************************************************************
+ */
+ReturnCode pltf_reader_open(const pltfReaderConfig *config, pltfReader *reader);
+
+/*! 
+ *****************************************************************************
+ * \brief  Bind the calling thread to a reader
+ *  
+ * This method makes all following RFAL, driver and platform calls of the
+ * calling thread act on the given reader.
+ * \param[in]	: reader to work on
+ *
+ *****************************************************************************
+ */
+void pltf_reader_bind(pltfReader reader);
+
+/*! 
+ *****************************************************************************
+ * \brief  Get the hardware of a reader
+ *  
+ * \param[in]	: reader
+ *
+ * \return the reader configuration, NULL for an invalid handle
+ *****************************************************************************
+ */
+const pltfReaderConfig *pltf_reader_config(pltfReader reader);
+
+/*! 
+ *****************************************************************************
+ * \brief  Run a function on its own thread bound to a reader
+ *  
+ * This method creates a thread, applies the worker settings of the RT
+ * profile to it, binds it to the reader and calls func(arg) on it. 
+ * \param[in]	: reader the thread works on
+ * \param[in]	: function run by the thread, typically initialising the
+ *		  reader and running its RFAL worker loop
+ * \param[in]	: argument passed to func
+ * \param[out]	: created thread, may be NULL
+ *
+ * \return ERR_PARAM	: Invalid reader
+ * \return ERR_IO	: Thread could not be created or configured
+ * \return ERR_NONE	: No error
+ *****************************************************************************
+ */
+ReturnCode pltf_reader_start(pltfReader reader, void *(*func)(void *), void *arg, pthread_t *thread);
+
+/*! 
+ *****************************************************************************
+ * \brief  Get the reader of the calling thread
+ *
+ * \return the reader the calling thread is bound to
+ *****************************************************************************
+ */
+static inline pltfReader pltf_reader_current(void)
+{
+	return pltfReaderCurrent;
+}
+
+#endif /* PLATFORMREADER_H */
@@ -0,0 +1,183 @@
+
+/******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; COPYRIGHT 2018 STMicroelectronics</center></h2>
+  *
+  * Licensed under ST MYLIBERTY SOFTWARE LICENSE AGREEMENT (the "License");
+  * You may not use this file except in compliance with the License.
+  * You may obtain a copy of the License at:
+  *
+  *        http://www.st.com/myliberty
+  *
+  * Unless required by applicable law or agreed to in writing, software 
+  * distributed under the License is distributed on an "AS IS" BASIS, 
+  * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied,
+  * AND SPECIFICALLY DISCLAIMING THE IMPLIED WARRANTIES OF MERCHANTABILITY,
+  * FITNESS FOR A PARTICULAR PURPOSE, AND NON-INFRINGEMENT.
+  * See the License for the specific language governing permissions and
+  * limitations under the License.
+  *
+******************************************************************************/
+
+/*! \file pltf_rt.h
+ *
+ *  \brief Real-time execution profile of the interrupt and worker threads
+ *  
+ *  The profile sets CPU affinity and scheduling of the thread polling the
+ *  interrupt line (IRQ thread) and of the thread running the RFAL worker,
+ *  locks the process memory and pre-faults the thread stacks so that the
+ *  IRQ-to-handler path does not take page faults or migrate between CPUs.
+ *
+ *  Build defaults are given by the PLTF_RT_* defines below and can be
+ *  overridden at run time with environment variables of the same name.
+ *
+ */
+
+#ifndef PLATFORMRT_H
+#define PLATFORMRT_H
+
+/*
+ ******************************************************************************
+ * INCLUDES
+ ******************************************************************************
+ */
+#include <stdbool.h>
+#include <stddef.h>
+#include <pthread.h>
+#include "st_errno.h"
+#include "pltf_reader.h"
+
+/*
+ ******************************************************************************
+ * GLOBAL DEFINES
+ ******************************************************************************
+ */
+#define PLTF_RT_PRIO_MAX	-1		/* Use the max SCHED_FIFO priority */
+#define PLTF_RT_PRIO_NONE	0		/* Keep SCHED_OTHER */
+#define PLTF_RT_CPU_ANY		-1		/* Do not pin the thread */
+
+#ifndef PLTF_RT_IRQ_CPU
+#define PLTF_RT_IRQ_CPU		PLTF_RT_CPU_ANY	/* CPU of the IRQ thread */
+#endif
+#ifndef PLTF_RT_WORKER_CPU
+#define PLTF_RT_WORKER_CPU	PLTF_RT_CPU_ANY	/* CPU of the worker thread */
+#endif
+#ifndef PLTF_RT_IRQ_PRIO
+#define PLTF_RT_IRQ_PRIO	PLTF_RT_PRIO_MAX	/* SCHED_FIFO priority of the IRQ thread */
+#endif
+#ifndef PLTF_RT_WORKER_PRIO
+#define PLTF_RT_WORKER_PRIO	PLTF_RT_PRIO_NONE	/* SCHED_FIFO priority of the worker thread */
+#endif
+#ifndef PLTF_RT_MLOCK
+#define PLTF_RT_MLOCK		1		/* Lock current and future memory */
+#endif
+#ifndef PLTF_RT_STACK_PREFAULT
+#define PLTF_RT_STACK_PREFAULT	(64 * 1024)	/* Bytes of stack touched by each RT thread */
+#endif
+#ifndef PLTF_RT_ISOLATED
+#define PLTF_RT_ISOLATED	0		/* Place unpinned threads on isolated cores */
+#endif
+
+/*
+ ******************************************************************************
+ * GLOBAL TYPES
+ ******************************************************************************
+ */
+/* Threads covered by the profile */
+typedef enum {
+	PLTF_RT_THREAD_IRQ = 0,		/* Thread polling the interrupt line */
+	PLTF_RT_THREAD_WORKER,		/* Thread running rfalWorker() */
+	PLTF_RT_THREAD_NUM
+}pltfRtThread;
+
+/* Real-time profile */
+typedef struct {
+	int	irqCpu;			/* CPU of the IRQ thread, PLTF_RT_CPU_ANY to not pin */
+	int	workerCpu;		/* CPU of the worker thread, PLTF_RT_CPU_ANY to not pin */
+	int	irqPrio;		/* SCHED_FIFO priority, PLTF_RT_PRIO_MAX or PLTF_RT_PRIO_NONE */
+	int	workerPrio;		/* SCHED_FIFO priority, PLTF_RT_PRIO_MAX or PLTF_RT_PRIO_NONE */
+	bool	lockMemory;		/* mlockall(MCL_CURRENT | MCL_FUTURE) */
+	size_t	stackPrefault;		/* Bytes of stack pre-faulted per thread, 0 to skip */
+	bool	isolated;		/* Use cores listed in /sys/devices/system/cpu/isolated */
+	bool	strict;			/* Fail when a setting cannot be applied */
+}pltfRtProfile;
+
+/*
+ ******************************************************************************
+ * GLOBAL FUNCTION PROTOTYPES
+ ******************************************************************************
+ */
+
+/*! 
+ *****************************************************************************
+ * \brief  Get the default profile
+ *  
+ * This method fills the profile with the build defaults, overridden by the
+ * PLTF_RT_* environment variables when set.
+ * \param[out]	: profile to fill
+ *
+ *****************************************************************************
+ */
+void pltf_rt_profile_default(pltfRtProfile *profile);
+
+/*! 
+ *****************************************************************************
+ * \brief  Apply the real-time profile
+ *  
+ * This method stores the profile used for the IRQ thread created later by
+ * interrupt_init(), locks the memory and applies the worker settings to the
+ * calling thread. It should be called first, from the thread that will run
+ * the RFAL worker.
+ * \param[in]	: profile to apply, NULL for the default one
+ *
+ * \return ERR_IO	: A setting could not be applied and the profile is strict
+ * \return ERR_NONE	: No error
+ *****************************************************************************
+ */
+ReturnCode pltf_rt_init(const pltfRtProfile *profile);
+
+/*! 
+ *****************************************************************************
+ * \brief  Apply the profile to a thread
+ *  
+ * This method sets the CPU affinity and scheduling of the given thread
+ * according to its role.
+ * \param[in]	: thread to configure
+ * \param[in]	: reader the thread works on
+ * \param[in]	: role of the thread
+ *
+ * \return ERR_IO	: A setting could not be applied and the profile is strict
+ * \return ERR_NONE	: No error
+ *****************************************************************************
+ */
+ReturnCode pltf_rt_setup_thread(pthread_t thread, pltfReader reader, pltfRtThread role);
+
+/*! 
+ *****************************************************************************
+ * \brief  Pre-fault the stack of the calling thread
+ *  
+ * This method touches the configured amount of stack so that later use of
+ * it does not page fault. It must be called by the thread itself, once bound
+ * to its reader. The amount is capped to the stack the thread has left, less
+ * a reserve.
+ * \param[in]	: role of the calling thread
+ *
+ *****************************************************************************
+ */
+void pltf_rt_prefault_stack(pltfRtThread role);
+
+/*! 
+ *****************************************************************************
+ * \brief  Report the achieved configuration
+ *  
+ * This method prints, for each thread of each reader, the scheduling policy, priority and
+ * CPUs actually in effect together with memory locking and any setting
+ * that could not be applied.
+ *
+ *****************************************************************************
+ */
+void pltf_rt_report(void);
+
+#endif /* PLATFORMRT_H */
+
@@ -0,0 +1,326 @@
+
+/******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; COPYRIGHT 2018 STMicroelectronics</center></h2>
+  *
+  * Licensed under ST MYLIBERTY SOFTWARE LICENSE AGREEMENT (the "License");
+  * You may not use this file except in compliance with the License.
+  * You may obtain a copy of the License at:
+  *
+  *        http://www.st.com/myliberty
+  *
+  * Unless required by applicable law or agreed to in writing, software 
+  * distributed under the License is distributed on an "AS IS" BASIS, 
+  * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied,
+  * AND SPECIFICALLY DISCLAIMING THE IMPLIED WARRANTIES OF MERCHANTABILITY,
+  * FITNESS FOR A PARTICULAR PURPOSE, AND NON-INFRINGEMENT.
+  * See the License for the specific language governing permissions and
+  * limitations under the License.
+  *
+******************************************************************************/
+
+/*! \file pltf_sim.h
+ *
+ *  \brief Simulated ST25R3911 behind the platform layer
+ *  
+ *  Built instead of pltf_spi.c and pltf_gpio.c when configured with
+ *  -DPLTF_SIM=ON. The SPI frames sent by the driver are decoded by a model
+ *  of the ST25R3911: register file, FIFO with water levels, direct
+ *  commands, IRQ registers and line, oscillator, NRT/GPT/MRT timers and the
+ *  framing of ISO14443A/B, FeliCa and the NFC-V stream mode. Frames sent on
+ *  air are handed to the virtual tags attached to the reader, their answers
+ *  are fed back to the receiver with the FDT they asked for.
+ *  
+ *  Each reader runs on its own virtual clock. Reading the time, waiting for
+ *  an IRQ or delaying moves the clock on, an SPI transfer costs its bus
+ *  time. There is no interrupt thread: the ISR runs on the calling thread
+ *  as soon as the IRQ line rises and the communication is not protected.
+ *  Runs are therefore deterministic and only take the CPU time of the code
+ *  under test.
+ *  
+ *  Readers set up with interrupt_init_polled() follow the real time
+ *  instead: their interrupt fd signals whenever the simulated IRQ line
+ *  is high, so that an event loop can be run against the model.
+ *  
+ *  Tags are attached with pltf_sim_tag_attach() or listed in the
+ *  PLTF_SIM_TAGS environment variable, e.g. "nfcv=2,t2t=1,isodep=1,felica=1",
+ *  which spi_init() reads for every reader.
+ *  
+ *  A reader can replay a trace recorded by pltf_trace.c instead of running
+ *  the model: pltf_sim_replay_start(), or PLTF_SIM_REPLAY naming the file.
+ *  The SPI frames of the driver are checked against the recorded ones and
+ *  answered with the recorded bytes, the ISR runs where it did, the clock
+ *  follows the recorded time.
+ *
+ */
+
+#ifndef PLATFORMSIM_H
+#define PLATFORMSIM_H
+
+/*
+ ******************************************************************************
+ * INCLUDES
+ ******************************************************************************
+ */
+#include <stdint.h>
+#include <stdbool.h>
+#include "st_errno.h"
+
+/*
+ ******************************************************************************
+ * GLOBAL DEFINES
+ ******************************************************************************
+ */
+#define PLTF_SIM_TAGS_ENV	"PLTF_SIM_TAGS"	/* Environment variable listing the tags of each reader */
+#define PLTF_SIM_REPLAY_ENV	"PLTF_SIM_REPLAY"	/* Environment variable naming a trace to replay */
+
+#define PLTF_SIM_FRAME_MAX	512		/* Max payload of a frame on air, bytes */
+
+/* Bus cost of one spidev ioctl and of the gap between CS framed segments, in ns.
+ * Rough figures of a Raspberry Pi; the bytes are clocked at SPI_MAX_FREQ on top */
+#ifndef PLTF_SIM_SPI_CALL_NS
+#define PLTF_SIM_SPI_CALL_NS	8000
+#endif
+#ifndef PLTF_SIM_SPI_GAP_NS
+#define PLTF_SIM_SPI_GAP_NS	500
+#endif
+
+/* Time a read of the clock takes, in ns, so that polling loops progress */
+#ifndef PLTF_SIM_POLL_NS
+#define PLTF_SIM_POLL_NS	1000
+#endif
+
+#define PLTF_SIM_NFCV_BLOCKS_MAX	256	/* Max number of blocks of a NFC-V tag */
+#define PLTF_SIM_NFCV_BLOCK_MAX		8	/* Max block size of a NFC-V tag, bytes */
+#define PLTF_SIM_T2T_PAGES		45	/* Pages of the T2T, NTAG213 layout */
+#define PLTF_SIM_FELICA_BLOCKS		16	/* Blocks of the FeliCa tag */
+
+/*
+ ******************************************************************************
+ * GLOBAL TYPES
+ ******************************************************************************
+ */
+/* Technology a tag listens to */
+typedef enum {
+	PLTF_SIM_TECH_NFCA = 0,		/* ISO14443A, 106 kbps */
+	PLTF_SIM_TECH_NFCB,		/* ISO14443B, 106 kbps */
+	PLTF_SIM_TECH_NFCF,		/* FeliCa, 212/424 kbps */
+	PLTF_SIM_TECH_NFCV		/* ISO15693 */
+}pltfSimTech;
+
+/* Frame on air, bits are sent LSB first */
+typedef struct {
+	uint8_t		data[PLTF_SIM_FRAME_MAX];
+	uint16_t	len;		/* Number of complete bytes */
+	uint8_t		bits;		/* Bits of a last incomplete byte, 0 if none */
+	bool		crc;		/* Request: a valid CRC came along. Response: have the CRC appended */
+	uint32_t	fdt;		/* Response: delay from the end of the request, 1/fc */
+	bool		fast;		/* NFC-V response: double data rate (ICODE fast commands) */
+}pltfSimFrame;
+
+typedef struct pltfSimTag pltfSimTag;
+
+/* Virtual tag. CRC, FeliCa LEN and NFC-V coding are handled by the model,
+ * requests and responses only hold the payload */
+struct pltfSimTag {
+	pltfSimTech	tech;
+	void		(*reset)(pltfSimTag *tag);	/* Field switched on: power-on state */
+	bool		(*receive)(pltfSimTag *tag, const pltfSimFrame *req, pltfSimFrame *res);	/* true to answer with res */
+	pltfSimTag	*next;				/* Tags of the same reader, managed by the model */
+};
+
+/* Counters of one reader */
+typedef struct {
+	uint32_t	spiCalls;	/* spiTxRx() and spiTxRxMulti() calls */
+	uint32_t	spiFrames;	/* CS framed SPI frames */
+	uint32_t	spiBytes;	/* Bytes clocked on the bus */
+	uint32_t	irqs;		/* ISR runs */
+	uint32_t	txFrames;	/* Frames sent on air */
+	uint32_t	rxFrames;	/* Frames received from the tags */
+}pltfSimStats;
+
+/* Outcome of a replay */
+typedef struct {
+	uint32_t	records;	/* Records of the reader in the trace */
+	uint32_t	replayed;	/* Records consumed so far */
+	uint32_t	spiChecked;	/* SPI segments compared */
+	uint32_t	mismatches;	/* Segments or ISR steps that differ from the trace */
+	uint32_t	firstMismatch;	/* Index in the trace of the first one, UINT32_MAX if none */
+	uint32_t	overrun;	/* Accesses past the end of the trace */
+	uint32_t	lost;		/* Records overwritten in the ring before the oldest one */
+}pltfSimReplayResult;
+
+/* ISO15693 / ICODE SLIX tag */
+typedef struct {
+	pltfSimTag	tag;
+	uint8_t		uid[8];		/* As sent on air, LSB first: uid[7] is 0xE0 */
+	uint16_t	blocks;		/* Number of blocks */
+	uint8_t		blockSize;	/* Block size, bytes */
+	uint8_t		mem[PLTF_SIM_NFCV_BLOCKS_MAX][PLTF_SIM_NFCV_BLOCK_MAX];
+	bool		locked[PLTF_SIM_NFCV_BLOCKS_MAX];
+	uint8_t		dsfid;
+	uint8_t		afi;
+	uint8_t		icRef;
+	uint32_t	writeFdt;	/* Answer delay of write and lock commands, 1/fc, programming one block */
+	bool		writeMultiple;	/* WRITE MULTIPLE BLOCKS supported, the ICODE SLIX does not */
+	uint8_t		state;		/* Power off, ready, quiet, selected */
+	int8_t		slot;		/* 16 slot inventory: own slot, -1 if not taking part */
+	int8_t		slotNow;	/* 16 slot inventory: current slot */
+	bool		eofPending;	/* Option flag set on a write: answer after the next EOF */
+	uint64_t	busyUntil;	/* Option flag set on a write: end of programming (ns), earlier EOFs are not answered */
+	pltfSimFrame	pending;	/* Answer held for the EOF */
+}pltfSimNfcv;
+
+/* NFC-A tag, shared by the T2T and the ISO-DEP tag */
+typedef struct {
+	uint8_t		uid[10];
+	uint8_t		uidLen;		/* 4, 7 or 10 */
+	uint8_t		atqa[2];
+	uint8_t		sak;		/* SAK of the last cascade level */
+	uint8_t		state;		/* Idle, ready, active, halt */
+	uint8_t		level;		/* Cascade level being selected */
+}pltfSimNfca;
+
+/* NFC Forum Type 2 tag, NTAG213 layout */
+typedef struct {
+	pltfSimTag	tag;
+	pltfSimNfca	nfca;
+	uint8_t		mem[PLTF_SIM_T2T_PAGES][4];
+}pltfSimT2t;
+
+/* ISO14443-4 tag, handles RATS/PPS, block chaining and DESELECT */
+typedef struct pltfSimIsoDep pltfSimIsoDep;
+struct pltfSimIsoDep {
+	pltfSimTag	tag;
+	pltfSimNfca	nfca;
+	bool		active;		/* RATS received */
+	uint16_t	fsd;		/* Frame size of the reader, from RATS */
+	uint16_t	cmdLen;		/* Chained command received so far */
+	uint16_t	rspLen;		/* Response to be sent */
+	uint16_t	rspPos;		/* Part of the response already sent */
+	uint8_t		cmd[PLTF_SIM_FRAME_MAX];
+	uint8_t		rsp[PLTF_SIM_FRAME_MAX];
+	pltfSimFrame	last;		/* Last block sent, for retransmission */
+	/* Handles one APDU, returns the response length. Echoes the APDU followed by 90 00 if NULL */
+	uint16_t	(*apdu)(pltfSimIsoDep *tag, const uint8_t *cmd, uint16_t cmdLen, uint8_t *rsp, uint16_t rspMax);
+};
+
+/* FeliCa tag */
+typedef struct {
+	pltfSimTag	tag;
+	uint8_t		idm[8];
+	uint8_t		pmm[8];
+	uint16_t	sysCode;
+	uint8_t		mem[PLTF_SIM_FELICA_BLOCKS][16];
+}pltfSimFelica;
+
+/*
+ ******************************************************************************
+ * GLOBAL FUNCTION PROTOTYPES
+ ******************************************************************************
+ */
+
+/*! 
+ *****************************************************************************
+ * \brief  Attach a tag to the reader
+ * The tag is put in the field of the reader bound to the calling thread.
+ * It is powered, and reset, the next time the field is switched on.
+ * \param[in]	: tag, initialized by one of the pltf_sim_*_init() or by the caller
+ * \return ERR_PARAM	: invalid tag or already attached
+ * \return ERR_NONE	: No error
+ *****************************************************************************
+ */
+ReturnCode pltf_sim_tag_attach(pltfSimTag *tag);
+
+/*! 
+ *****************************************************************************
+ * \brief  Detach a tag from the reader bound to the calling thread
+ * \param[in]	: tag
+ *****************************************************************************
+ */
+void pltf_sim_tag_detach(pltfSimTag *tag);
+
+/*! 
+ *****************************************************************************
+ * \brief  Attach built-in tags
+ * Allocates and attaches the tags listed in \a spec to the reader bound to
+ * the calling thread. The spec is a comma separated list of type=count with
+ * the types nfcv, t2t, isodep and felica. UIDs are derived from the reader
+ * and tag index, all tags of a type answer in different NFC-V slots.
+ * \param[in]	: tag list, e.g. "nfcv=2,t2t=1"
+ * \return ERR_PARAM	: malformed list
+ * \return ERR_NOMEM	: allocation failed
+ * \return ERR_NONE	: No error
+ *****************************************************************************
+ */
+ReturnCode pltf_sim_tags_add(const char *spec);
+
+/*! 
+ *****************************************************************************
+ * \brief  Initialize the built-in tags
+ * The memory is filled with a pattern, NFC Forum tags get an empty NDEF
+ * (T2T capability container, NFC-V CC in block 0).
+ *****************************************************************************
+ */
+void pltf_sim_nfcv_init(pltfSimNfcv *tag, const uint8_t uid[8], uint16_t blocks, uint8_t blockSize);
+void pltf_sim_t2t_init(pltfSimT2t *tag, const uint8_t uid[7]);
+void pltf_sim_isodep_init(pltfSimIsoDep *tag, const uint8_t uid[4]);
+void pltf_sim_felica_init(pltfSimFelica *tag, const uint8_t idm[8]);
+
+/*! 
+ *****************************************************************************
+ * \brief  Virtual time of the reader bound to the calling thread
+ * \return time in ns, does not move the clock on
+ *****************************************************************************
+ */
+uint64_t pltf_sim_time_ns(void);
+
+/*! 
+ *****************************************************************************
+ * \brief  Get and reset the counters of the reader bound to the calling thread
+ *****************************************************************************
+ */
+void pltf_sim_get_stats(pltfSimStats *stats);
+void pltf_sim_reset_stats(void);
+
+/*! 
+ *****************************************************************************
+ * \brief  Clock hooks of pltf_timer.c
+ * pltf_sim_clock_ns() returns the time of the reader after moving it on by
+ * PLTF_SIM_POLL_NS, pltf_sim_delay_us() moves it on by the given time. Both
+ * run the ISR on IRQs raised meanwhile.
+ *****************************************************************************
+ */
+uint64_t pltf_sim_clock_ns(void);
+void pltf_sim_delay_us(uint32_t us);
+
+/*! 
+ *****************************************************************************
+ * \brief  Replay a trace on the reader bound to the calling thread
+ * The records of the trace made for the same reader id are replayed in
+ * place of the model, the tags of the reader are not used meanwhile.
+ * \param[in]	: path of a trace recorded with pltf_trace_start()
+ * \return ERR_WRONG_STATE	: a replay is running already
+ * \return ERR_NOTFOUND	: no record of this reader in the trace
+ * \return ERR_NONE	: No error, see pltf_trace_load() for the others
+ *****************************************************************************
+ */
+ReturnCode pltf_sim_replay_start(const char *path);
+
+/*! 
+ *****************************************************************************
+ * \brief  Stop the replay, the model takes over again
+ *****************************************************************************
+ */
+void pltf_sim_replay_stop(void);
+
+/*! 
+ *****************************************************************************
+ * \brief  Outcome of the replay of the reader bound to the calling thread
+ * \return true if the driver did the same as recorded, all records consumed
+ *****************************************************************************
+ */
+bool pltf_sim_replay_result(pltfSimReplayResult *res);
+
+#endif /* PLATFORMSIM_H */
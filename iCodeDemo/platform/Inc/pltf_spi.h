@@ -38,6 +38,7 @@
  ******************************************************************************
  */
 #include <stdint.h>
+#include <stdbool.h>
 #include "st_errno.h"
 
 /*
@@ -54,6 +55,19 @@ typedef enum
 	HAL_TIMEOUT	= 0x03
 } HAL_statusTypeDef;
 
+/* One segment of a batched SPI message, each segment is framed by its own CS assertion
+ * unless csHold is set, in which case the following segment continues the same frame */
+typedef struct
+{
+	const uint8_t	*txData;	/* Data to be sent, NULL to clock out zeros	*/
+	uint8_t		*rxData;	/* Buffer for received data, NULL to discard	*/
+	uint16_t	length;		/* Number of bytes in this segment		*/
+	bool		csHold;		/* Keep CS asserted into the next segment	*/
+} spiSegmentTypeDef;
+
+/* Maximum number of segments accepted by spiTxRxMulti() */
+#define SPI_MAX_SEGMENTS	32
+
 /*
  ******************************************************************************
  * GLOBAL FUNCTIONS
@@ -87,6 +101,26 @@ ReturnCode spi_init(void);
 /* function for full duplex SPI communication */
 HAL_statusTypeDef spiTxRx(const uint8_t *txData, uint8_t *rxData, uint8_t length);
 
+/*! 
+ *****************************************************************************
+ * \brief  Batched SPI transfer
+ *  
+ * Sends several segments to ST25R3911XX with a single SPI_IOC_MESSAGE ioctl.
+ * Chip select is released between consecutive segments so that each segment
+ * is seen by the chip as an individual SPI frame (register access, FIFO
+ * access or direct command). Segments with csHold set are continued by the
+ * next segment, which allows the command byte and the payload to live in
+ * different buffers (scatter-gather).
+ *
+ * \param[in]	segs	: segments to be transferred, in order
+ * \param[in]	count	: number of segments (max SPI_MAX_SEGMENTS)
+ *
+ * \return HAL_ERROR	: SPI not initialized, invalid parameter or transfer failed
+ * \return HAL_OK	: No error
+ *****************************************************************************
+ */
+HAL_statusTypeDef spiTxRxMulti(const spiSegmentTypeDef *segs, uint8_t count);
+
 /*! 
  *****************************************************************************
  * \brief  To protect SPI communication
@@ -25,6 +25,8 @@
  *   
  *   This module makes use of a System Tick in millisconds and provides
  *   an abstraction for SW timers
+ *   Timers are kept in microseconds of CLOCK_MONOTONIC, so they are not
+ *   affected by wall clock steps and can be created with us resolution.
  *
  */
  
@@ -51,7 +53,27 @@
 * GLOBAL DEFINES
 ******************************************************************************
 */
+/* Final part of a delay that is busy-waited instead of slept, in us.
+ * Trades CPU for wake-up jitter on short delays; 0 sleeps for the whole delay */
+#ifndef PLTF_TIMER_DELAY_SPIN_US
+#define PLTF_TIMER_DELAY_SPIN_US     0
+#endif
+
+/* Max number of pending deadlines followed per reader, see timerNextDeadline() */
+#ifndef PLTF_TIMER_DEADLINES
+#define PLTF_TIMER_DEADLINES         16
+#endif
+
 uint32_t platformGetSysTick_linux();
+
+ /*! 
+ *****************************************************************************
+ * \brief  Get the monotonic time in microseconds
+ *  
+ * \return u32 : CLOCK_MONOTONIC time in us, wrapping every ~71 minutes
+ *****************************************************************************
+ */
+uint32_t timerGetTimeUs( void );
  
  /*! 
  *****************************************************************************
@@ -71,6 +93,20 @@ uint32_t platformGetSysTick_linux();
  */
 uint32_t timerCalculateTimer( uint16_t time );
 
+ /*! 
+ *****************************************************************************
+ * \brief  Calculate Timer in microseconds
+ *  
+ * Same as timerCalculateTimer() with the time given in microseconds.
+ * Timers must be shorter than ~35 minutes.
+ *
+ * \param[in]  time : time/duration in Microseconds for the timer
+ *
+ * \return u32 : The new timer calculated based on the given time 
+ *****************************************************************************
+ */
+uint32_t timerCalculateTimerUs( uint32_t time );
+
 /*! 
  *****************************************************************************
  * \brief  Checks if a Timer is Expired
@@ -101,4 +137,51 @@ bool timerIsExpired( uint32_t timer );
  */
 void timerDelay( uint16_t time );
 
+ /*! 
+ *****************************************************************************
+ * \brief  Performs a Delay in microseconds
+ *  
+ * This method sleeps for the given amount of time in Microseconds, the last
+ * PLTF_TIMER_DELAY_SPIN_US are busy-waited
+ * 
+ * \param[in]  time : time/duration in Microseconds of the delay
+ *
+ *****************************************************************************
+ */
+void timerDelayUs( uint32_t time );
+
+ /*! 
+ *****************************************************************************
+ * \brief  Follow the deadlines of the current reader
+ *  
+ * Every timer created by a thread bound to the reader is recorded, by
+ * default, so that an event loop or a blocking IRQ wait can wake up when the
+ * earliest one expires instead of polling timerIsExpired().
+ * Also drops the deadlines recorded so far.
+ * 
+ * \param[in]  enable : true to record the deadlines, false to stop
+ *
+ *****************************************************************************
+ */
+void timerTrackDeadlines( bool enable );
+
+ /*! 
+ *****************************************************************************
+ * \brief  Get the next deadline of the current reader
+ *  
+ * Deadlines reached at or before \a since are dropped: the code that created
+ * them has run afterwards and seen them expired. The earliest remaining one
+ * is returned, it may already be in the past.
+ * If more than PLTF_TIMER_DEADLINES are pending the latest ones are lost,
+ * event loops shall also wake up periodically.
+ * 
+ * \param[in]   since    : time (us) the code checking the timers last started
+ * \param[out]  deadline : earliest pending deadline
+ *
+ * \return true  : \a deadline is valid
+ * \return false : no pending deadline
+ *****************************************************************************
+ */
+bool timerNextDeadline( uint32_t since, uint32_t *deadline );
+
 #endif /* PLATFORM_TIMER */
@@ -0,0 +1,201 @@
+
+/******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; COPYRIGHT 2018 STMicroelectronics</center></h2>
+  *
+  * Licensed under ST MYLIBERTY SOFTWARE LICENSE AGREEMENT (the "License");
+  * You may not use this file except in compliance with the License.
+  * You may obtain a copy of the License at:
+  *
+  *        http://www.st.com/myliberty
+  *
+  * Unless required by applicable law or agreed to in writing, software 
+  * distributed under the License is distributed on an "AS IS" BASIS, 
+  * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied,
+  * AND SPECIFICALLY DISCLAIMING THE IMPLIED WARRANTIES OF MERCHANTABILITY,
+  * FITNESS FOR A PARTICULAR PURPOSE, AND NON-INFRINGEMENT.
+  * See the License for the specific language governing permissions and
+  * limitations under the License.
+  *
+******************************************************************************/
+
+/*! \file pltf_trace.h
+ *
+ *  \brief SPI and IRQ trace recorder
+ *  
+ *  Records every SPI segment exchanged with the ST25R3911 (bytes sent and
+ *  received, CS framing, time), every run of the ISR and the levels of
+ *  the interrupt line the ISR reads. Records go into a ring buffer memory
+ *  mapped to a file, so that a trace survives a crash of the process and
+ *  a long session keeps its most recent part.
+ *  
+ *  Records made by the ISR carry a flag: the ISR and the worker run on
+ *  different threads and only the order within each of them is
+ *  meaningful. The simulated backend replays such a trace in place of the
+ *  chip model, see pltf_sim_replay_start().
+ *  
+ *  Recording is compiled in with PLATFORM_TRACE in platform.h and started
+ *  with pltf_trace_start(), or by pltf_trace_init() when the environment
+ *  variable PLTF_TRACE names the file.
+ *
+ */
+
+#ifndef PLATFORMTRACE_H
+#define PLATFORMTRACE_H
+
+/*
+ ******************************************************************************
+ * INCLUDES
+ ******************************************************************************
+ */
+#include <stdint.h>
+#include <stdbool.h>
+#include "st_errno.h"
+#include "pltf_spi.h"
+
+/*
+ ******************************************************************************
+ * GLOBAL DEFINES
+ ******************************************************************************
+ */
+#define PLTF_TRACE_ENV		"PLTF_TRACE"		/* File to record into */
+#define PLTF_TRACE_SIZE_ENV	"PLTF_TRACE_SIZE"	/* Ring size in bytes, PLTF_TRACE_SIZE if unset */
+
+#ifndef PLTF_TRACE_SIZE
+#define PLTF_TRACE_SIZE		(16 * 1024 * 1024)	/* Default ring size, bytes */
+#endif
+#define PLTF_TRACE_SIZE_MIN	(64 * 1024)		/* Smallest ring accepted */
+
+#define PLTF_TRACE_MAGIC	"ST3911TR"
+#define PLTF_TRACE_VERSION	1
+
+/* Record types */
+#define PLTF_TRACE_PAD		0	/* Rest of the ring unused, continue at its start */
+#define PLTF_TRACE_SPI		1	/* SPI segment: tx bytes unless TX_NONE, then rx bytes unless RX_NONE */
+#define PLTF_TRACE_IRQ		2	/* ISR run starts */
+#define PLTF_TRACE_LINE		3	/* Interrupt line read by the ISR, len is the level */
+
+/* Record flags */
+#define PLTF_TRACE_FLAG_READER	0x07	/* Reader the record belongs to */
+#define PLTF_TRACE_FLAG_TRUNC	0x08	/* SPI: len covers only the first bytes of a longer segment */
+#define PLTF_TRACE_FLAG_ISR	0x10	/* Made by the ISR */
+#define PLTF_TRACE_FLAG_TX_NONE	0x20	/* SPI: zeros sent, no tx bytes stored */
+#define PLTF_TRACE_FLAG_RX_NONE	0x40	/* SPI: received bytes discarded, none stored */
+#define PLTF_TRACE_FLAG_HOLD	0x80	/* SPI: CS held, the next segment continues the frame */
+
+#define PLTF_TRACE_REC_HDR	12	/* Size of the record header in the file */
+
+/*
+ ******************************************************************************
+ * GLOBAL TYPES
+ ******************************************************************************
+ */
+/* File header, the ring follows. Offsets are relative to the ring */
+typedef struct {
+	char		magic[8];
+	uint16_t	version;
+	uint16_t	hdrSize;	/* sizeof(pltfTraceHdr) */
+	uint32_t	size;		/* Ring size, bytes */
+	uint32_t	head;		/* Where the next record goes */
+	uint32_t	tail;		/* Oldest record */
+	uint32_t	wrapped;	/* Records were overwritten, tail is valid */
+	uint32_t	records;	/* Records written */
+	uint32_t	lost;		/* Records overwritten */
+	uint32_t	reserved;
+	uint64_t	start;		/* Clock when recording started, ns */
+}pltfTraceHdr;
+
+/* Record as stored, packed in the file: type, flags, len (LE 16 bit), t (LE 64 bit) */
+typedef struct {
+	uint8_t		type;
+	uint8_t		flags;
+	uint16_t	len;		/* SPI: segment length, LINE: level */
+	uint64_t	t;		/* ns since the start of the recording */
+	const uint8_t	*tx;		/* SPI: bytes sent, NULL for zeros */
+	const uint8_t	*rx;		/* SPI: bytes received, NULL if discarded */
+}pltfTraceRec;
+
+/* Trace loaded for reading */
+typedef struct {
+	void		*map;
+	uint32_t	mapSize;
+	uint32_t	lost;		/* Records lost to a wrap before the first one */
+	uint32_t	count;
+	pltfTraceRec	*recs;		/* Records in the order they were made */
+}pltfTraceLog;
+
+/*
+ ******************************************************************************
+ * GLOBAL FUNCTION PROTOTYPES
+ ******************************************************************************
+ */
+
+/*! 
+ *****************************************************************************
+ * \brief  Start recording if PLTF_TRACE is set
+ *  
+ * \return ERR_IO	: file could not be set up
+ * \return ERR_NONE	: recording, or nothing asked for
+ *****************************************************************************
+ */
+ReturnCode pltf_trace_init(void);
+
+/*! 
+ *****************************************************************************
+ * \brief  Start recording into a file
+ *  
+ * The file is created or truncated and sized to hold the ring. Recording
+ * is process wide, records carry the reader they belong to.
+ * \param[in]	: path of the file
+ * \param[in]	: ring size in bytes, at least PLTF_TRACE_SIZE_MIN
+ *
+ * \return ERR_WRONG_STATE	: already recording
+ * \return ERR_PARAM		: ring size too small
+ * \return ERR_IO		: file could not be created or mapped
+ * \return ERR_NONE		: No error
+ *****************************************************************************
+ */
+ReturnCode pltf_trace_start(const char *path, uint32_t size);
+
+/*! 
+ *****************************************************************************
+ * \brief  Stop recording, flush and close the file
+ *****************************************************************************
+ */
+void pltf_trace_stop(void);
+
+/*! 
+ *****************************************************************************
+ * \brief  Recording hooks
+ *  
+ * pltf_trace_spiTxRx() and pltf_trace_spiTxRxMulti() stand in for the SPI
+ * functions when PLATFORM_TRACE is defined. The GPIO backends bracket the
+ * ISR with pltf_trace_isr_begin() and pltf_trace_isr_end() and report the
+ * levels the ISR reads with pltf_trace_line().
+ *****************************************************************************
+ */
+HAL_statusTypeDef pltf_trace_spiTxRx(const uint8_t *txData, uint8_t *rxData, uint8_t length);
+HAL_statusTypeDef pltf_trace_spiTxRxMulti(const spiSegmentTypeDef *segs, uint8_t count);
+void pltf_trace_isr_begin(void);
+void pltf_trace_isr_end(void);
+void pltf_trace_line(bool high);
+
+/*! 
+ *****************************************************************************
+ * \brief  Load a trace for reading
+ *  
+ * Maps the file and indexes its records, oldest first.
+ * \param[in]	: path of the file
+ * \param[out]	: loaded trace, release with pltf_trace_unload()
+ *
+ * \return ERR_IO	: file could not be read
+ * \return ERR_PROTO	: not a trace or corrupted
+ * \return ERR_NOMEM	: allocation failed
+ * \return ERR_NONE	: No error
+ *****************************************************************************
+ */
+ReturnCode pltf_trace_load(const char *path, pltfTraceLog *log);
+void pltf_trace_unload(pltfTraceLog *log);
+
+#endif /* PLATFORMTRACE_H */
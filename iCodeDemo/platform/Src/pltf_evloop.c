@@ -0,0 +1,300 @@
+
+/******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; COPYRIGHT 2018 STMicroelectronics</center></h2>
+  *
+  * Licensed under ST MYLIBERTY SOFTWARE LICENSE AGREEMENT (the "License");
+  * You may not use this file except in compliance with the License.
+  * You may obtain a copy of the License at:
+  *
+  *        http://www.st.com/myliberty
+  *
+  * Unless required by applicable law or agreed to in writing, software 
+  * distributed under the License is distributed on an "AS IS" BASIS, 
+  * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied,
+  * AND SPECIFICALLY DISCLAIMING THE IMPLIED WARRANTIES OF MERCHANTABILITY,
+  * FITNESS FOR A PARTICULAR PURPOSE, AND NON-INFRINGEMENT.
+  * See the License for the specific language governing permissions and
+  * limitations under the License.
+  *
+******************************************************************************/
+
+/*! \file pltf_evloop.c
+ *
+ *  \brief Implementation of the event loop.
+ *  
+ */
+
+/*
+ ******************************************************************************
+ * INCLUDES
+ ******************************************************************************
+ */
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#include "pltf_evloop.h"
+#include "pltf_gpio.h"
+#include "pltf_timer.h"
+
+/*
+ ******************************************************************************
+ * DEFINES
+ ******************************************************************************
+ */
+/* epoll data of an event: reader in the upper bits, source in bit 0 */
+#define EVLOOP_SRC_IRQ		0
+#define EVLOOP_SRC_TIMER	1
+#define EVLOOP_DATA(reader, src)	(((uint32_t)(reader) << 1) | (src))
+
+#define EVLOOP_MAX_EVENTS	(2 * PLTF_READER_MAX)
+
+/*
+ ******************************************************************************
+ * LOCAL DATA TYPES
+ ******************************************************************************
+ */
+/* Reader registered with the loop */
+typedef struct {
+	bool			used;
+	int			fdTimer;	/* timerfd armed at the next deadline */
+	pltfEvloopHandler	handler;
+	void			*arg;
+	uint32_t		lastRun;	/* Start of the last handler run (us) */
+}evloopReader;
+
+/*
+ ******************************************************************************
+ * STATIC VARIABLES
+ ******************************************************************************
+ */
+static int epfd = -1;
+static volatile bool running = false;
+static evloopReader evReader[PLTF_READER_MAX];
+
+/*
+ ******************************************************************************
+ * LOCAL FUNCTIONS
+ ******************************************************************************
+ */
+static void evloop_arm(evloopReader *ev, uint32_t deadline)
+{
+	struct itimerspec its;
+	int32_t us;
+
+	memset(&its, 0, sizeof(its));
+
+	/* Relative to now; a deadline already passed fires right away */
+	us = (int32_t)(deadline - timerGetTimeUs());
+	if (us > 0) {
+		its.it_value.tv_sec = us / 1000000;
+		its.it_value.tv_nsec = (us % 1000000) * 1000;
+	} else {
+		its.it_value.tv_nsec = 1;
+	}
+
+	timerfd_settime(ev->fdTimer, 0, &its, NULL);
+}
+
+static void evloop_disarm(evloopReader *ev)
+{
+	struct itimerspec its;
+
+	memset(&its, 0, sizeof(its));
+	timerfd_settime(ev->fdTimer, 0, &its, NULL);
+}
+
+/* Consume the expirations of the timer of a reader.
+ * ERR_BUSY when the timer has nothing to report, e.g. re-armed since epoll saw it */
+static ReturnCode evloop_ack(evloopReader *ev)
+{
+	uint64_t expirations;
+	ssize_t len;
+
+	do {
+		len = read(ev->fdTimer, &expirations, sizeof(expirations));
+	} while ((len < 0) && (errno == EINTR));
+
+	if ((len < 0) && (errno == EAGAIN))
+		return ERR_BUSY;
+	if (len < 0) {
+		printf("Error: reading timerfd (%s)\n", strerror(errno));
+		return ERR_IO;
+	}
+	if (len != (ssize_t)sizeof(expirations)) {
+		printf("Error: short read of timerfd (%zd bytes)\n", len);
+		return ERR_IO;
+	}
+
+	return ERR_NONE;
+}
+
+/* Run the handler of the bound reader and re-arm its timer */
+static void evloop_service(evloopReader *ev)
+{
+	uint32_t deadline;
+
+	ev->lastRun = timerGetTimeUs();
+	ev->handler(ev->arg);
+
+	if (timerNextDeadline(ev->lastRun, &deadline))
+		evloop_arm(ev, deadline);
+	else
+		evloop_disarm(ev);
+}
+
+/*
+ ******************************************************************************
+ * GLOBAL FUNCTIONS
+ ******************************************************************************
+ */
+ReturnCode pltf_evloop_init(void)
+{
+	if (epfd >= 0)
+		return ERR_NONE;
+
+	epfd = epoll_create1(EPOLL_CLOEXEC);
+	if (epfd < 0) {
+		printf("Error: creating epoll instance (%s)\n", strerror(errno));
+		return ERR_IO;
+	}
+
+	return ERR_NONE;
+}
+
+ReturnCode pltf_evloop_add(pltfReader reader, pltfEvloopHandler handler, void *arg)
+{
+	struct epoll_event event;
+	evloopReader *ev;
+	pltfReader prev;
+	ReturnCode err = ERR_IO;
+	int fdIrq;
+	short irqEvents;
+
+	if ((epfd < 0) || (pltf_reader_config(reader) == NULL) || (handler == NULL) || evReader[reader].used)
+		return ERR_PARAM;
+
+	ev = &evReader[reader];
+	ev->fdTimer = -1;
+
+	/* Interrupt line and deadlines are those of the reader */
+	prev = pltf_reader_current();
+	pltf_reader_bind(reader);
+
+	if (interrupt_init_polled(&fdIrq, &irqEvents) != ERR_NONE)
+		goto error;
+
+	ev->fdTimer = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+	if (ev->fdTimer < 0) {
+		printf("Error: creating timerfd of reader %d (%s)\n", reader, strerror(errno));
+		goto error;
+	}
+
+	memset(&event, 0, sizeof(event));
+	event.events = (irqEvents == POLLIN) ? EPOLLIN : EPOLLPRI;
+	event.data.u32 = EVLOOP_DATA(reader, EVLOOP_SRC_IRQ);
+	if (epoll_ctl(epfd, EPOLL_CTL_ADD, fdIrq, &event) < 0) {
+		printf("Error: adding interrupt line of reader %d (%s)\n", reader, strerror(errno));
+		goto error;
+	}
+
+	event.events = EPOLLIN;
+	event.data.u32 = EVLOOP_DATA(reader, EVLOOP_SRC_TIMER);
+	if (epoll_ctl(epfd, EPOLL_CTL_ADD, ev->fdTimer, &event) < 0) {
+		printf("Error: adding timer of reader %d (%s)\n", reader, strerror(errno));
+		epoll_ctl(epfd, EPOLL_CTL_DEL, fdIrq, NULL);
+		goto error;
+	}
+
+	timerTrackDeadlines(true);
+
+	ev->handler = handler;
+	ev->arg = arg;
+	ev->used = true;
+
+	/* First run as soon as the loop starts */
+	evloop_arm(ev, timerGetTimeUs());
+	err = ERR_NONE;
+
+error:
+	if ((err != ERR_NONE) && (ev->fdTimer >= 0)) {
+		close(ev->fdTimer);
+		ev->fdTimer = -1;
+	}
+	pltf_reader_bind(prev);
+	return err;
+}
+
+ReturnCode pltf_evloop_run(void)
+{
+	struct epoll_event events[EVLOOP_MAX_EVENTS];
+	uint32_t pending;
+	uint32_t now;
+	ReturnCode err;
+	pltfReader prev;
+	pltfReader r;
+	int n;
+	int i;
+
+	if (epfd < 0)
+		return ERR_WRONG_STATE;
+
+	prev = pltf_reader_current();
+	running = true;
+
+	while (running)
+	{
+		n = epoll_wait(epfd, events, EVLOOP_MAX_EVENTS, PLTF_EVLOOP_TICK_MS);
+		if (n < 0) {
+			if (errno == EINTR)
+				continue;
+			printf("Error: waiting for reader events (%s)\n", strerror(errno));
+			pltf_reader_bind(prev);
+			return ERR_IO;
+		}
+
+		/* Interrupts are handled first, handlers then see the new status */
+		pending = 0;
+		for (i = 0; i < n; i++) {
+			r = (pltfReader)(events[i].data.u32 >> 1);
+			pltf_reader_bind(r);
+			if ((events[i].data.u32 & 1) == EVLOOP_SRC_IRQ) {
+				interrupt_dispatch();
+			} else {
+				err = evloop_ack(&evReader[r]);
+				if (err == ERR_BUSY)
+					continue;
+				if (err != ERR_NONE) {
+					pltf_reader_bind(prev);
+					return err;
+				}
+			}
+			pending |= (1U << r);
+		}
+
+		now = timerGetTimeUs();
+		for (r = 0; r < PLTF_READER_MAX; r++) {
+			if (!evReader[r].used)
+				continue;
+			if (!(pending & (1U << r)) && ((now - evReader[r].lastRun) < (PLTF_EVLOOP_TICK_MS * 1000)))
+				continue;
+			pltf_reader_bind(r);
+			evloop_service(&evReader[r]);
+		}
+	}
+
+	pltf_reader_bind(prev);
+	return ERR_NONE;
+}
+
+void pltf_evloop_stop(void)
+{
+	running = false;
+}
@@ -33,7 +33,9 @@
  * INCLUDES
  ******************************************************************************
  */
+#define _GNU_SOURCE		/* ppoll */
 #include <stdio.h>
+#include <stdlib.h>
 #include <poll.h>
 #include <pthread.h>
 #include <sched.h>
@@ -42,8 +44,21 @@
 #include <sys/stat.h>
 #include <string.h>
 #include <errno.h>
+#include <limits.h>
+#include <time.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
 #include "pltf_gpio.h"
+#include "pltf_reader.h"
+#include "pltf_rt.h"
 #include "st25r3911_interrupt.h"
+#ifdef PLTF_GPIO_USE_CDEV
+#include <sys/ioctl.h>
+#include <linux/gpio.h>
+#ifndef GPIO_V2_LINES_MAX
+#undef PLTF_GPIO_USE_CDEV	/* Kernel headers predate uAPI v2, sysfs only */
+#endif
+#endif /* PLTF_GPIO_USE_CDEV */
 
 /*
  ******************************************************************************
@@ -53,21 +68,285 @@
 /* Max size of file path to access */ 
 #define SIZE	60
 
+/* Consumer label shown by the kernel for the requested lines */
+#define PLTF_GPIO_CONSUMER	"st25r3911"
+
+/* Max number of edge events read from the kernel in one go */
+#define PLTF_GPIO_EVENT_BURST	16
+
+/*
+ ******************************************************************************
+ * LOCAL DATA TYPES
+ ******************************************************************************
+ */
+/* Interrupt line of one reader */
+typedef struct {
+	int isInit;
+	int polled;			/* Polled by the application, no interrupt thread */
+	int fd_readGPIO;		/* sysfs value file */
+	int fd_irqLine;			/* Character device line request */
+	uint32_t irqSeq;
+	uint32_t irqWaiters;
+	volatile uint64_t irqTimestamp;
+} gpioIntrLine;
+
 /*
  ******************************************************************************
  * STATIC VARIABLES
  ******************************************************************************
  */
 static int isGPIOInit	= 0;
-static int fd_readGPIO	= 0;
 static pthread_mutex_t lock;
+static GPIO_BackendType gpioBackend = GPIO_BACKEND_AUTO;
+static uint32_t irqSpinUs	= PLTF_IRQ_SPIN_US;
+static gpioIntrLine gpioIntr[PLTF_READER_MAX];
+
+#ifdef PLTF_GPIO_USE_CDEV
+static int fd_chip	= -1;
+static int fd_outLine[PLTF_GPIO_MAX_LINES];
+static const int outLines[] = PLTF_GPIO_OUT_LINES;
+#endif /* PLTF_GPIO_USE_CDEV */
+
+/* Interrupt line of the reader the calling thread is bound to */
+#define intr	(gpioIntr[pltf_reader_current()])
+
+/*
+ ******************************************************************************
+ * LOCAL FUNCTIONS - IRQ WAITERS
+ ******************************************************************************
+ */
+static void gpio_irq_signal(void)
+{
+	/* Seq_cst pairs with the waiter: either it sees the new sequence in
+	 * FUTEX_WAIT or we see it registered and wake it */
+	__atomic_add_fetch(&intr.irqSeq, 1, __ATOMIC_SEQ_CST);
+	if (__atomic_load_n(&intr.irqWaiters, __ATOMIC_SEQ_CST))
+		syscall(SYS_futex, &intr.irqSeq, FUTEX_WAKE_PRIVATE, INT_MAX, NULL, NULL, 0);
+}
+
+static int gpio_irq_fd(void)
+{
+#ifdef PLTF_GPIO_USE_CDEV
+	if (gpioBackend == GPIO_BACKEND_CDEV)
+		return intr.fd_irqLine;
+#endif /* PLTF_GPIO_USE_CDEV */
+	return intr.fd_readGPIO;
+}
+
+static short gpio_irq_events(void)
+{
+	return ((gpioBackend == GPIO_BACKEND_CDEV) ? POLLIN : POLLPRI);
+}
+
+/* Consume the pending event of the interrupt line and run the ISR */
+static void gpio_irq_handle(void)
+{
+#ifdef PLTF_GPIO_USE_CDEV
+	struct gpio_v2_line_event events[PLTF_GPIO_EVENT_BURST];
+	ssize_t len;
+#endif /* PLTF_GPIO_USE_CDEV */
+	int c = 0;
+
+#ifdef PLTF_GPIO_USE_CDEV
+	if (gpioBackend == GPIO_BACKEND_CDEV) {
+		/* Drain all queued edges, the ISR reads IRQ registers until the line is low */
+		len = read(intr.fd_irqLine, events, sizeof(events));
+		if (len >= (ssize_t)sizeof(struct gpio_v2_line_event))
+			intr.irqTimestamp = events[(len / sizeof(struct gpio_v2_line_event)) - 1].timestamp_ns;
+	} else
+#endif /* PLTF_GPIO_USE_CDEV */
+	{
+		lseek(intr.fd_readGPIO, 0, SEEK_SET);
+		read(intr.fd_readGPIO, &c, 1);
+	}
+
+	/* Call RFAL Isr */
+#ifdef PLATFORM_TRACE
+	pltf_trace_isr_begin();
+#endif /* PLATFORM_TRACE */
+	st25r3911Isr();
+#ifdef PLATFORM_TRACE
+	pltf_trace_isr_end();
+#endif /* PLATFORM_TRACE */
+	gpio_irq_signal();
+}
+
+/* Wait for the interrupt line of a polled reader and handle it in place */
+static bool gpio_irq_poll(uint32_t seq, uint32_t timeout_us)
+{
+	struct pollfd poll_fd;
+	struct timespec ts;
+	int ret;
+
+	poll_fd.fd = gpio_irq_fd();
+	poll_fd.events = gpio_irq_events();
+
+	/* poll() would round the timeout up to the next ms */
+	ts.tv_sec = timeout_us / 1000000;
+	ts.tv_nsec = (long)(timeout_us % 1000000) * 1000;
+	ret = ppoll(&poll_fd, 1, &ts, NULL);
+	if ((ret > 0) && (poll_fd.revents & (poll_fd.events | POLLERR)))
+		gpio_irq_handle();
+
+	return (pltf_irq_sequence() != seq);
+}
+
+static uint64_t gpio_irq_now_us(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ((uint64_t)ts.tv_sec * 1000000) + (ts.tv_nsec / 1000);
+}
+
+/*
+ ******************************************************************************
+ * LOCAL FUNCTIONS - GPIO CHARACTER DEVICE
+ ******************************************************************************
+ */
+#ifdef PLTF_GPIO_USE_CDEV
+/* Request a line as output already driven to the given level */
+static void gpio_cdev_request_out(int pin_no, int value)
+{
+	struct gpio_v2_line_request req;
+
+	if ((pin_no < 0) || (pin_no >= PLTF_GPIO_MAX_LINES)) {
+		printf("Error: gpio line %d out of range\n", pin_no);
+		return;
+	}
+
+	memset(&req, 0, sizeof(req));
+	req.offsets[0] = pin_no;
+	req.num_lines = 1;
+	strncpy(req.consumer, PLTF_GPIO_CONSUMER, sizeof(req.consumer) - 1);
+	req.config.flags = GPIO_V2_LINE_FLAG_OUTPUT;
+	req.config.num_attrs = 1;
+	req.config.attrs[0].attr.id = GPIO_V2_LINE_ATTR_ID_OUTPUT_VALUES;
+	req.config.attrs[0].attr.values = (uint64_t)value;
+	req.config.attrs[0].mask = 1;
+
+	if (ioctl(fd_chip, GPIO_V2_GET_LINE_IOCTL, &req) < 0) {
+		printf("Error: requesting gpio line %d as output (%s)\n", pin_no, strerror(errno));
+		return;
+	}
+	fd_outLine[pin_no] = req.fd;
+}
+
+static ReturnCode gpio_cdev_init(int pin)
+{
+	struct gpio_v2_line_request req;
+	int i;
+
+	/* The chip is shared by all readers, open it with the first one */
+	if (fd_chip < 0) {
+		for (i = 0; i < PLTF_GPIO_MAX_LINES; i++)
+			fd_outLine[i] = -1;
+
+		fd_chip = open(PLTF_GPIO_CHIP, O_RDWR | O_CLOEXEC);
+		if (fd_chip < 0) {
+			printf("Error: opening %s\n", PLTF_GPIO_CHIP);
+			return ERR_IO;
+		}
+
+		/* Request the output lines now, set/clear then only write the value */
+		for (i = 0; i < (int)(sizeof(outLines) / sizeof(outLines[0])); i++) {
+			if (outLines[i] != pin)
+				gpio_cdev_request_out(outLines[i], 0);
+		}
+	}
+
+	/* Request the interrupt line as input with rising edge detection.
+	 * Edges are queued by the kernel with a CLOCK_MONOTONIC timestamp */
+	memset(&req, 0, sizeof(req));
+	req.offsets[0] = pin;
+	req.num_lines = 1;
+	strncpy(req.consumer, PLTF_GPIO_CONSUMER, sizeof(req.consumer) - 1);
+	req.config.flags = GPIO_V2_LINE_FLAG_INPUT | GPIO_V2_LINE_FLAG_EDGE_RISING;
+	req.event_buffer_size = PLTF_GPIO_EVENT_BURST;
+
+	if (ioctl(fd_chip, GPIO_V2_GET_LINE_IOCTL, &req) < 0) {
+		printf("Error: requesting interrupt line %d (%s)\n", pin, strerror(errno));
+		if (!isGPIOInit) {
+			/* Release the output lines too, sysfs may take over */
+			for (i = 0; i < PLTF_GPIO_MAX_LINES; i++) {
+				if (fd_outLine[i] >= 0)
+					close(fd_outLine[i]);
+				fd_outLine[i] = -1;
+			}
+			close(fd_chip);
+			fd_chip = -1;
+		}
+		return ERR_IO;
+	}
+	intr.fd_irqLine = req.fd;
+
+	return ERR_NONE;
+}
+
+static int gpio_cdev_get(int fd)
+{
+	struct gpio_v2_line_values values;
+
+	values.bits = 0;
+	values.mask = 1;
+	if (ioctl(fd, GPIO_V2_LINE_GET_VALUES_IOCTL, &values) < 0)
+		return -1;
+
+	return (int)(values.bits & 1);
+}
+
+static void gpio_cdev_put(int pin_no, int value)
+{
+	struct gpio_v2_line_values values;
+
+	if ((pin_no < 0) || (pin_no >= PLTF_GPIO_MAX_LINES)) {
+		printf("Error: gpio line %d out of range\n", pin_no);
+		return;
+	}
+
+	/* Lines of PLTF_GPIO_OUT_LINES are requested by gpio_init(), others on first use */
+	if (fd_outLine[pin_no] < 0) {
+		gpio_cdev_request_out(pin_no, value);
+		return;
+	}
+
+	values.bits = (uint64_t)value;
+	values.mask = 1;
+	if (ioctl(fd_outLine[pin_no], GPIO_V2_LINE_SET_VALUES_IOCTL, &values) < 0)
+		printf("Error: setting gpio line %d value\n", pin_no);
+}
+
+static void* gpio_cdev_irq_loop(void)
+{
+	struct pollfd poll_fd;
+	int ret;
+
+	poll_fd.fd = intr.fd_irqLine;
+	poll_fd.events = POLLIN;
+
+	while(true)
+	{
+		ret = poll(&poll_fd, 1, -1);
+		if (ret < 0 && errno == EINTR)
+			continue;
+		if (ret < 1) {
+			printf("Error: in polling for interrupt line\n");
+			return NULL;
+		}
+		if (poll_fd.revents & POLLIN)
+			gpio_irq_handle();
+	}
+
+	return NULL;
+}
+#endif /* PLTF_GPIO_USE_CDEV */
 
 /*
  ******************************************************************************
  * GLOBAL AND HELPER FUNCTIONS
  ******************************************************************************
  */
-ReturnCode gpio_init(void)
+static ReturnCode gpio_sysfs_init(int pin)
 {
 	int fd_exportGPIO = 0;
 	int fd_dirGPIO = 0;
@@ -81,14 +360,14 @@ ReturnCode gpio_init(void)
 	/* Export the control of interrupt GPIO to user space */
 
 	/* if already exported, first unexport it */
-	sprintf(buf, "/sys/class/gpio/gpio%d", PLTF_GPIO_INTR_PIN);
+	sprintf(buf, "/sys/class/gpio/gpio%d", pin);
 	if (!stat (buf, &sts)) {
 		fd_unexport = open("/sys/class/gpio/unexport", O_WRONLY);
 		if (fd_unexport < 0) {
 			printf("Error: opening gpio export file in gpio_init\n");
 			goto error;
 		}
-		sprintf(buf_tmp, "%d", PLTF_GPIO_INTR_PIN);
+		sprintf(buf_tmp, "%d", pin);
         	ret = write(fd_unexport, buf_tmp, strlen(buf_tmp));
 		if (ret <= 0) {
 			printf("Error: writing to gpio export file in gpio_init\n");
@@ -102,7 +381,7 @@ ReturnCode gpio_init(void)
 		goto error;
 	}
 
-	sprintf(buf, "%d", PLTF_GPIO_INTR_PIN);
+	sprintf(buf, "%d", pin);
 	ret = write(fd_exportGPIO, buf, strlen(buf)); 
 	if(ret < 0) {
 		printf("Error: writing interrupt pin to gpio export file\n");
@@ -110,7 +389,7 @@ ReturnCode gpio_init(void)
 	}
 	 
 	/* set the direction of interrupt pin */
-	sprintf(buf, "/sys/class/gpio/gpio%d/direction", PLTF_GPIO_INTR_PIN);
+	sprintf(buf, "/sys/class/gpio/gpio%d/direction", pin);
 	fd_dirGPIO = open(buf, O_WRONLY);
 	if (fd_dirGPIO < 0) {
 		printf("Error: opening gpio direction file for interrupt pin\n");
@@ -123,14 +402,14 @@ ReturnCode gpio_init(void)
 		goto error;
 	}
 
-	sprintf(buf, "/sys/class/gpio/gpio%d/value", PLTF_GPIO_INTR_PIN);
-	fd_readGPIO = open(buf, O_RDWR);
-	if (fd_readGPIO < 1) {
+	sprintf(buf, "/sys/class/gpio/gpio%d/value", pin);
+	intr.fd_readGPIO = open(buf, O_RDWR);
+	if (intr.fd_readGPIO < 1) {
 		printf("Error: opening gpio value file for interrupt pin\n");
 		goto error;
 	}
 
-	sprintf(buf, "/sys/class/gpio/gpio%d/edge", PLTF_GPIO_INTR_PIN);
+	sprintf(buf, "/sys/class/gpio/gpio%d/edge", pin);
 	fd_edgeGPIO = open(buf, O_WRONLY);
 	if (fd_edgeGPIO < 1) {
 		printf("Error: opening edge file to configure interrupt pin\n");
@@ -139,19 +418,13 @@ ReturnCode gpio_init(void)
 
     //MB this appears to be wrong - fixed to 7, trying eith parameter instead.
 	ret = write(fd_edgeGPIO, "rising", 7);
-	//ret = write(fd_edgeGPIO, "rising", PLTF_GPIO_INTR_PIN);
+	//ret = write(fd_edgeGPIO, "rising", pin);
 	if (ret <= 0) {
 		printf("Error: writing gpio edge setting for interrupt pin\n");
 		goto error;
 	}	
-	ret = pthread_mutex_init(&lock, NULL);
-	if (ret != 0)
-	{
-		printf("Error: mutex init to protect interrupt status is failed\n");
-		goto error;
-	}
 
-	isGPIOInit = 1;
+	intr.isInit = 1;
 
 error: 
 	if (fd_exportGPIO > 0)
@@ -162,13 +435,93 @@ error:
 		close(fd_edgeGPIO);
 	if (fd_unexport > 0)
 		close(fd_unexport);
-	if(isGPIOInit)
+	if(intr.isInit)
 		return ERR_NONE;
 	else
 		return ERR_IO;
 
 }
 
+ReturnCode gpio_init(void)
+{
+	GPIO_BackendType backend = gpioBackend;
+	const char *env;
+	ReturnCode err = ERR_IO;
+	int pin = pltf_reader_config(pltf_reader_current())->irqPin;
+
+	if (intr.isInit)
+		return ERR_NONE;
+
+	if (!isGPIOInit && (pthread_mutex_init(&lock, NULL) != 0)) {
+		printf("Error: mutex init to protect interrupt status is failed\n");
+		return ERR_IO;
+	}
+
+	/* Environment overrides the automatic selection only */
+	env = getenv("PLTF_GPIO_BACKEND");
+	if ((backend == GPIO_BACKEND_AUTO) && (env != NULL)) {
+		if (!strcmp(env, "sysfs"))
+			backend = GPIO_BACKEND_SYSFS;
+		else if (!strcmp(env, "cdev"))
+			backend = GPIO_BACKEND_CDEV;
+	}
+
+#ifdef PLTF_GPIO_USE_CDEV
+	if (backend != GPIO_BACKEND_SYSFS) {
+		err = gpio_cdev_init(pin);
+		if (err == ERR_NONE) {
+			gpioBackend = GPIO_BACKEND_CDEV;
+			isGPIOInit = 1;
+			intr.isInit = 1;
+			return ERR_NONE;
+		}
+		if (backend == GPIO_BACKEND_CDEV)
+			return err;
+		printf("Warning: GPIO character device not available, falling back to sysfs\n");
+	}
+#else
+	if (backend == GPIO_BACKEND_CDEV) {
+		printf("Error: GPIO character device backend not compiled in\n");
+		return ERR_NOTSUPP;
+	}
+#endif /* PLTF_GPIO_USE_CDEV */
+
+	err = gpio_sysfs_init(pin);
+	if (err == ERR_NONE) {
+		gpioBackend = GPIO_BACKEND_SYSFS;
+		isGPIOInit = 1;
+	}
+
+	return err;
+}
+
+ReturnCode gpio_select_backend(GPIO_BackendType backend)
+{
+	if (isGPIOInit)
+		return ERR_WRONG_STATE;
+
+#ifndef PLTF_GPIO_USE_CDEV
+	if (backend == GPIO_BACKEND_CDEV)
+		return ERR_NOTSUPP;
+#endif /* PLTF_GPIO_USE_CDEV */
+
+	gpioBackend = backend;
+	return ERR_NONE;
+}
+
+GPIO_BackendType gpio_get_backend(void)
+{
+	return gpioBackend;
+}
+
+uint64_t gpio_get_irq_timestamp(void)
+{
+#ifdef PLTF_GPIO_USE_CDEV
+	return intr.irqTimestamp;
+#else
+	return 0;
+#endif /* PLTF_GPIO_USE_CDEV */
+}
 
 GPIO_PinState gpio_readpin(int port, int pin_no) 
 {
@@ -182,35 +535,69 @@ GPIO_PinState gpio_readpin(int port, int pin_no)
 		return ERR_WRONG_STATE;
 	}
 
-	lseek(fd_readGPIO, 0, SEEK_SET);
-	ret = read(fd_readGPIO, &value, 1);
+#ifdef PLTF_GPIO_USE_CDEV
+	if (gpioBackend == GPIO_BACKEND_CDEV) {
+		/* Output lines read back their own value, anything else the interrupt line */
+		if ((pin_no >= 0) && (pin_no < PLTF_GPIO_MAX_LINES) && (fd_outLine[pin_no] >= 0))
+			ret = gpio_cdev_get(fd_outLine[pin_no]);
+		else
+			ret = gpio_cdev_get(intr.fd_irqLine);
+		if (ret < 0) {
+			printf("Error: while reading GPIO pin state\n");
+			return ERR_IO;
+		}
+		state = (ret ? GPIO_PIN_SET : GPIO_PIN_RESET);
+#ifdef PLATFORM_TRACE
+		pltf_trace_line(state == GPIO_PIN_SET);
+#endif /* PLATFORM_TRACE */
+		return state;
+	}
+#endif /* PLTF_GPIO_USE_CDEV */
+
+	lseek(intr.fd_readGPIO, 0, SEEK_SET);
+	ret = read(intr.fd_readGPIO, &value, 1);
 	if (ret < 0) {
 		printf("Error: while reading GPIO pin state\n");
 		return ERR_IO;
 	}
 
 	if (value == '0') {
-		return GPIO_PIN_RESET;
+		state = GPIO_PIN_RESET;
 	} else {
-		return GPIO_PIN_SET;
+		state = GPIO_PIN_SET;
 	}
+#ifdef PLATFORM_TRACE
+	pltf_trace_line(state == GPIO_PIN_SET);
+#endif /* PLATFORM_TRACE */
+
+	return state;
 }
 
-void* pthread_func()
+void* pthread_func(void *arg)
 {
 	int ret = 0;
-	int c = 0; 
-	uint16_t event;
 	struct pollfd poll_fd;
-	poll_fd.fd = fd_readGPIO; 
+
+	/* Serve the reader of the thread which called interrupt_init() */
+	pltf_reader_bind((pltfReader)(intptr_t)arg);
+
+	poll_fd.fd = intr.fd_readGPIO; 
 	poll_fd.events = POLLPRI;
 
 	/* First check if GPIOInit is done or not */
-	if (!isGPIOInit) {
+	if (!intr.isInit) {
 		printf("GPIO is not initialized\n");
 		return NULL;
 	}
 
+	/* Touch the stack now rather than on the first interrupts */
+	pltf_rt_prefault_stack(PLTF_RT_THREAD_IRQ);
+
+#ifdef PLTF_GPIO_USE_CDEV
+	if (gpioBackend == GPIO_BACKEND_CDEV)
+		return gpio_cdev_irq_loop();
+#endif /* PLTF_GPIO_USE_CDEV */
+
 	/* poll interrupt line forever */
 	while(true) 
 	{ 	
@@ -220,12 +607,7 @@ void* pthread_func()
 			return NULL; 
 		}
 		if (poll_fd.revents & (POLLPRI|POLLERR))
-		{
-			lseek(poll_fd.fd, 0, SEEK_SET);
-			read(poll_fd.fd, &c, 1);
-			/* Call RFAL Isr */
-			st25r3911Isr();
-		}	
+			gpio_irq_handle();
 	}
 
 	return NULL;
@@ -234,28 +616,46 @@ void* pthread_func()
 ReturnCode interrupt_init(void)
 {
 	pthread_t intr_thread;
-	struct sched_param params;
 	int ret;
 
 	/* create a pthread to poll for interrupt */
-	ret = pthread_create(&intr_thread, NULL, pthread_func, NULL);
+	ret = pthread_create(&intr_thread, NULL, pthread_func, (void *)(intptr_t)pltf_reader_current());
 	if (ret) {
 		printf("Error: poll thread creation %d\n", ret);
 		return ERR_IO;
 	}
 	
-	/* Assign highest priority to polling thread */
-	params.sched_priority = sched_get_priority_max(SCHED_FIFO);
-	ret = pthread_setschedparam(intr_thread, SCHED_FIFO, &params);
-	if (ret) {
-		printf("Error: assigning high priority to polling thread\n");
+	/* Apply affinity and priority of the RT profile to polling thread */
+	if (pltf_rt_setup_thread(intr_thread, pltf_reader_current(), PLTF_RT_THREAD_IRQ) != ERR_NONE) {
+		printf("Error: applying RT profile to polling thread\n");
 		return ERR_IO;
-	}	
+	}
 
 	return ERR_NONE;
 }
 
-void gpio_set(int port, int pin_no) 
+ReturnCode interrupt_init_polled(int *fd, short *events)
+{
+	if (!intr.isInit) {
+		printf("GPIO is not initialized\n");
+		return ERR_WRONG_STATE;
+	}
+
+	intr.polled = 1;
+	if (fd != NULL)
+		*fd = gpio_irq_fd();
+	if (events != NULL)
+		*events = gpio_irq_events();
+
+	return ERR_NONE;
+}
+
+void interrupt_dispatch(void)
+{
+	gpio_irq_handle();
+}
+
+static void gpio_sysfs_set(int pin_no) 
 {
 	char buf[SIZE];
 	char buf_tmp[SIZE];
@@ -328,7 +728,7 @@ error:
 		close(fd_value);
 }
 
-void gpio_clear(int port, int pin_no) 
+static void gpio_sysfs_clear(int pin_no) 
 {
 	char buf[SIZE];
 	char buf_tmp[SIZE];
@@ -402,6 +802,28 @@ error:
 		close(fd_value);
 }
 
+void gpio_set(int port, int pin_no) 
+{
+#ifdef PLTF_GPIO_USE_CDEV
+	if (gpioBackend == GPIO_BACKEND_CDEV) {
+		gpio_cdev_put(pin_no, 1);
+		return;
+	}
+#endif /* PLTF_GPIO_USE_CDEV */
+	gpio_sysfs_set(pin_no);
+}
+
+void gpio_clear(int port, int pin_no) 
+{
+#ifdef PLTF_GPIO_USE_CDEV
+	if (gpioBackend == GPIO_BACKEND_CDEV) {
+		gpio_cdev_put(pin_no, 0);
+		return;
+	}
+#endif /* PLTF_GPIO_USE_CDEV */
+	gpio_sysfs_clear(pin_no);
+}
+
 void pltf_protect_interrupt_status(void)
 {
 	pthread_mutex_lock(&lock);
@@ -411,3 +833,53 @@ void pltf_unprotect_interrupt_status(void)
 {
 	pthread_mutex_unlock(&lock);
 }
+
+uint32_t pltf_irq_sequence(void)
+{
+	return __atomic_load_n(&intr.irqSeq, __ATOMIC_ACQUIRE);
+}
+
+bool pltf_irq_wait(uint32_t seq, uint32_t timeout_us)
+{
+	struct timespec ts;
+	uint64_t start;
+	uint64_t spun;
+	uint32_t spin = __atomic_load_n(&irqSpinUs, __ATOMIC_RELAXED);
+
+	if (pltf_irq_sequence() != seq)
+		return true;
+
+	/* Nobody else handles the line of a polled reader, wait on it directly */
+	if (intr.polled)
+		return gpio_irq_poll(seq, timeout_us);
+
+	/* Optionally spin first, an IRQ within the spin time is seen without a syscall */
+	if (spin) {
+		if (spin > timeout_us)
+			spin = timeout_us;
+		start = gpio_irq_now_us();
+		do {
+			if (pltf_irq_sequence() != seq)
+				return true;
+			spun = gpio_irq_now_us() - start;
+		} while (spun < spin);
+		timeout_us -= (uint32_t)spun;
+	}
+
+	if (timeout_us == 0)
+		return (pltf_irq_sequence() != seq);
+
+	ts.tv_sec  = timeout_us / 1000000;
+	ts.tv_nsec = (timeout_us % 1000000) * 1000;
+
+	__atomic_add_fetch(&intr.irqWaiters, 1, __ATOMIC_SEQ_CST);
+	syscall(SYS_futex, &intr.irqSeq, FUTEX_WAIT_PRIVATE, seq, &ts, NULL, 0);
+	__atomic_sub_fetch(&intr.irqWaiters, 1, __ATOMIC_SEQ_CST);
+
+	return (pltf_irq_sequence() != seq);
+}
+
+void pltf_irq_set_spin(uint32_t spin_us)
+{
+	__atomic_store_n(&irqSpinUs, spin_us, __ATOMIC_RELAXED);
+}
@@ -0,0 +1,163 @@
+
+/******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; COPYRIGHT 2018 STMicroelectronics</center></h2>
+  *
+  * Licensed under ST MYLIBERTY SOFTWARE LICENSE AGREEMENT (the "License");
+  * You may not use this file except in compliance with the License.
+  * You may obtain a copy of the License at:
+  *
+  *        http://www.st.com/myliberty
+  *
+  * Unless required by applicable law or agreed to in writing, software 
+  * distributed under the License is distributed on an "AS IS" BASIS, 
+  * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied,
+  * AND SPECIFICALLY DISCLAIMING THE IMPLIED WARRANTIES OF MERCHANTABILITY,
+  * FITNESS FOR A PARTICULAR PURPOSE, AND NON-INFRINGEMENT.
+  * See the License for the specific language governing permissions and
+  * limitations under the License.
+  *
+******************************************************************************/
+
+/*! \file pltf_indicator.c
+ *
+ *  \brief Implementation of the asynchronous LED indicators.
+ *  
+ *  The wanted state of all LEDs is kept as a bit mask updated with atomic
+ *  operations. The indicator thread compares it with the state last
+ *  written to the GPIOs and only drives the lines which differ.
+ *
+ */
+
+/*
+ ******************************************************************************
+ * INCLUDES
+ ******************************************************************************
+ */
+#include <stdio.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#include "pltf_indicator.h"
+#include "pltf_gpio.h"
+
+/*
+ ******************************************************************************
+ * STATIC VARIABLES
+ ******************************************************************************
+ */
+static uint64_t ledWanted	= 0;	/* bit n: posted state of line n            */
+static uint64_t ledPosted	= 0;	/* bit n: line n has been posted at least once */
+static uint64_t ledApplied	= 0;	/* bit n: state last written to line n       */
+static uint64_t ledAppliedValid	= 0;	/* bit n: line n has been written            */
+static int isIndicatorInit	= 0;
+static pthread_mutex_t applyLock = PTHREAD_MUTEX_INITIALIZER;
+
+/*
+ ******************************************************************************
+ * GLOBAL AND HELPER FUNCTIONS
+ ******************************************************************************
+ */
+static void indicator_apply(void)
+{
+	uint64_t posted;
+	uint64_t wanted;
+	uint64_t changed;
+	int pin_no;
+
+	pthread_mutex_lock(&applyLock);
+
+	/* Posted is set after wanted, so a line seen as posted has its state in wanted */
+	posted = __atomic_load_n(&ledPosted, __ATOMIC_ACQUIRE);
+	wanted = __atomic_load_n(&ledWanted, __ATOMIC_ACQUIRE);
+	changed = posted & ((wanted ^ ledApplied) | ~ledAppliedValid);
+
+	while (changed) {
+		pin_no = __builtin_ctzll(changed);
+		changed &= (changed - 1);
+
+		if ((wanted >> pin_no) & 1)
+			gpio_set(0, pin_no);
+		else
+			gpio_clear(0, pin_no);
+	}
+
+	ledApplied = wanted;
+	ledAppliedValid |= posted;
+
+	pthread_mutex_unlock(&applyLock);
+}
+
+static void* indicator_thread(void *arg)
+{
+	struct timespec next;
+
+	(void)arg;
+	clock_gettime(CLOCK_MONOTONIC, &next);
+
+	while (true)
+	{
+		next.tv_nsec += (INDICATOR_PERIOD_MS * 1000000L);
+		if (next.tv_nsec >= 1000000000L) {
+			next.tv_nsec -= 1000000000L;
+			next.tv_sec++;
+		}
+		clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+
+		indicator_apply();
+	}
+
+	return NULL;
+}
+
+ReturnCode indicator_init(void)
+{
+	pthread_t ind_thread;
+	pthread_attr_t attr;
+	struct sched_param params;
+	int ret;
+
+	if (isIndicatorInit)
+		return ERR_NONE;
+
+	/* Run as a normal time-shared thread, never competing with the IRQ thread */
+	pthread_attr_init(&attr);
+	pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+	pthread_attr_setschedpolicy(&attr, SCHED_OTHER);
+	params.sched_priority = 0;
+	pthread_attr_setschedparam(&attr, &params);
+	pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+
+	ret = pthread_create(&ind_thread, &attr, indicator_thread, NULL);
+	pthread_attr_destroy(&attr);
+	if (ret) {
+		printf("Error: indicator thread creation %d\n", ret);
+		return ERR_IO;
+	}
+
+	isIndicatorInit = 1;
+	return ERR_NONE;
+}
+
+void indicator_post(int pin_no, bool on)
+{
+	uint64_t bit;
+
+	if ((pin_no < 0) || (pin_no >= INDICATOR_MAX_LINES))
+		return;
+
+	bit = ((uint64_t)1 << pin_no);
+	if (on)
+		__atomic_fetch_or(&ledWanted, bit, __ATOMIC_RELEASE);
+	else
+		__atomic_fetch_and(&ledWanted, ~bit, __ATOMIC_RELEASE);
+
+	__atomic_fetch_or(&ledPosted, bit, __ATOMIC_RELEASE);
+}
+
+void indicator_flush(void)
+{
+	indicator_apply();
+}
@@ -0,0 +1,160 @@
+
+/******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; COPYRIGHT 2018 STMicroelectronics</center></h2>
+  *
+  * Licensed under ST MYLIBERTY SOFTWARE LICENSE AGREEMENT (the "License");
+  * You may not use this file except in compliance with the License.
+  * You may obtain a copy of the License at:
+  *
+  *        http://www.st.com/myliberty
+  *
+  * Unless required by applicable law or agreed to in writing, software 
+  * distributed under the License is distributed on an "AS IS" BASIS, 
+  * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied,
+  * AND SPECIFICALLY DISCLAIMING THE IMPLIED WARRANTIES OF MERCHANTABILITY,
+  * FITNESS FOR A PARTICULAR PURPOSE, AND NON-INFRINGEMENT.
+  * See the License for the specific language governing permissions and
+  * limitations under the License.
+  *
+******************************************************************************/
+
+/*! \file pltf_reader.c
+ *
+ *  \brief Implementation of the reader contexts.
+ *  
+ */
+
+/*
+ ******************************************************************************
+ * INCLUDES
+ ******************************************************************************
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include "pltf_reader.h"
+#include "pltf_gpio.h"
+#include "pltf_rt.h"
+
+/*
+ ******************************************************************************
+ * LOCAL DATA TYPES
+ ******************************************************************************
+ */
+/* Start-up data of a reader thread */
+typedef struct {
+	pltfReader	reader;		/* Reader the thread is bound to */
+	void		*(*func)(void *);	/* Function run by the thread */
+	void		*arg;		/* Argument of func */
+}pltfReaderStart;
+
+/*
+ ******************************************************************************
+ * STATIC VARIABLES
+ ******************************************************************************
+ */
+static pltfReaderConfig readerConfig[PLTF_READER_MAX] = {
+	[PLTF_READER_DEFAULT] = { PLTF_READER_SPI_DEVICE, PLTF_GPIO_INTR_PIN }
+};
+static int readerCount = 0;
+static pthread_mutex_t readerLock = PTHREAD_MUTEX_INITIALIZER;
+
+/*
+ ******************************************************************************
+ * GLOBAL VARIABLES
+ ******************************************************************************
+ */
+__thread pltfReader pltfReaderCurrent PLTF_READER_TLS = PLTF_READER_DEFAULT;
+
+/*
+ ******************************************************************************
+ * LOCAL FUNCTIONS
+ ******************************************************************************
+ */
+static void *reader_thread(void *arg)
+{
+	pltfReaderStart start = *(pltfReaderStart *)arg;
+
+	free(arg);
+
+	pltf_reader_bind(start.reader);
+	pltf_rt_prefault_stack(PLTF_RT_THREAD_WORKER);
+
+	return start.func(start.arg);
+}
+
+/*
+ ******************************************************************************
+ * GLOBAL FUNCTIONS
+ ******************************************************************************
+ */
+ReturnCode pltf_reader_open(const pltfReaderConfig *config, pltfReader *reader)
+{
+	if ((config == NULL) || (config->spiDevice == NULL) || (config->irqPin < 0) || (reader == NULL))
+		return ERR_PARAM;
+
+	pthread_mutex_lock(&readerLock);
+	if (readerCount >= PLTF_READER_MAX) {
+		pthread_mutex_unlock(&readerLock);
+		printf("Error: no free reader context, max %d\n", PLTF_READER_MAX);
+		return ERR_NOMEM;
+	}
+	*reader = readerCount++;
+	readerConfig[*reader] = *config;
+	pthread_mutex_unlock(&readerLock);
+
+	return ERR_NONE;
+}
+
+void pltf_reader_bind(pltfReader reader)
+{
+	if ((reader < 0) || (reader >= PLTF_READER_MAX)) {
+		printf("Error: invalid reader %d\n", reader);
+		return;
+	}
+	pltfReaderCurrent = reader;
+}
+
+const pltfReaderConfig *pltf_reader_config(pltfReader reader)
+{
+	if ((reader < 0) || (reader >= PLTF_READER_MAX))
+		return NULL;
+
+	return &readerConfig[reader];
+}
+
+ReturnCode pltf_reader_start(pltfReader reader, void *(*func)(void *), void *arg, pthread_t *thread)
+{
+	pltfReaderStart *start;
+	pthread_t tid;
+	int ret;
+
+	if ((reader < 0) || (reader >= PLTF_READER_MAX) || (func == NULL))
+		return ERR_PARAM;
+
+	start = malloc(sizeof(pltfReaderStart));
+	if (start == NULL)
+		return ERR_NOMEM;
+	start->reader = reader;
+	start->func = func;
+	start->arg = arg;
+
+	ret = pthread_create(&tid, NULL, reader_thread, start);
+	if (ret) {
+		printf("Error: reader %d thread creation %d\n", reader, ret);
+		free(start);
+		return ERR_IO;
+	}
+
+	if (pltf_rt_setup_thread(tid, reader, PLTF_RT_THREAD_WORKER) != ERR_NONE) {
+		printf("Error: applying RT profile to reader %d thread\n", reader);
+		return ERR_IO;
+	}
+
+	if (thread != NULL)
+		*thread = tid;
+
+	return ERR_NONE;
+}
@@ -0,0 +1,337 @@
+
+/******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; COPYRIGHT 2018 STMicroelectronics</center></h2>
+  *
+  * Licensed under ST MYLIBERTY SOFTWARE LICENSE AGREEMENT (the "License");
+  * You may not use this file except in compliance with the License.
+  * You may obtain a copy of the License at:
+  *
+  *        http://www.st.com/myliberty
+  *
+  * Unless required by applicable law or agreed to in writing, software 
+  * distributed under the License is distributed on an "AS IS" BASIS, 
+  * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied,
+  * AND SPECIFICALLY DISCLAIMING THE IMPLIED WARRANTIES OF MERCHANTABILITY,
+  * FITNESS FOR A PARTICULAR PURPOSE, AND NON-INFRINGEMENT.
+  * See the License for the specific language governing permissions and
+  * limitations under the License.
+  *
+******************************************************************************/
+
+/*! \file pltf_rt.c
+ *
+ *  \brief Implementation of the real-time execution profile.
+ *  
+ */
+
+/*
+ ******************************************************************************
+ * INCLUDES
+ ******************************************************************************
+ */
+#define _GNU_SOURCE		/* pthread affinity */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include "pltf_rt.h"
+
+/*
+ ******************************************************************************
+ * DEFINES
+ ******************************************************************************
+ */
+/* File listing the CPUs isolated from the scheduler (isolcpus=) */
+#define PLTF_RT_ISOLATED_FILE	"/sys/devices/system/cpu/isolated"
+
+/* Stack kept out of the prefault, for the frames of the prefault itself and a guard */
+#define PLTF_RT_STACK_RESERVE	(16 * 1024)
+
+/*
+ ******************************************************************************
+ * LOCAL DATA TYPES
+ ******************************************************************************
+ */
+/* Settings applied to a thread and their outcome */
+typedef struct {
+	bool	configured;		/* Profile has been applied to the thread */
+	pthread_t thread;		/* Configured thread */
+	int	cpu;			/* Requested CPU, PLTF_RT_CPU_ANY if none */
+	int	prio;			/* Requested SCHED_FIFO priority, 0 if none */
+	int	affinityErr;		/* errno of pthread_setaffinity_np, 0 if ok */
+	int	schedErr;		/* errno of pthread_setschedparam, 0 if ok */
+	size_t	prefaulted;		/* Bytes of stack pre-faulted */
+}pltfRtThreadState;
+
+/*
+ ******************************************************************************
+ * STATIC VARIABLES
+ ******************************************************************************
+ */
+static pltfRtProfile rtProfile;
+static bool rtProfileSet = false;
+static int rtMlockErr = -1;		/* -1 not requested, 0 locked, errno otherwise */
+static pltfRtThreadState rtThread[PLTF_READER_MAX][PLTF_RT_THREAD_NUM];	/* Per reader and role */
+static const char *rtThreadName[PLTF_RT_THREAD_NUM] = { "irq", "worker" };
+
+/*
+ ******************************************************************************
+ * LOCAL FUNCTIONS
+ ******************************************************************************
+ */
+static int pltf_rt_env_int(const char *name, int def)
+{
+	const char *env = getenv(name);
+
+	if (env == NULL || *env == '\0')
+		return def;
+
+	return (int)strtol(env, NULL, 0);
+}
+
+static int pltf_rt_isolated_cpus(int *cpus, int max)
+{
+	char buf[128];
+	char *p;
+	char *end;
+	long first;
+	long last;
+	int n = 0;
+	FILE *f;
+
+	f = fopen(PLTF_RT_ISOLATED_FILE, "r");
+	if (f == NULL)
+		return 0;
+	if (fgets(buf, sizeof(buf), f) == NULL)
+		buf[0] = '\0';
+	fclose(f);
+
+	/* List format: "2-3,5" */
+	p = buf;
+	while ((*p >= '0') && (*p <= '9') && (n < max)) {
+		first = strtol(p, &end, 10);
+		last = first;
+		if (*end == '-')
+			last = strtol(end + 1, &end, 10);
+		for (; (first <= last) && (n < max); first++)
+			cpus[n++] = (int)first;
+		p = (*end == ',') ? (end + 1) : end;
+	}
+
+	return n;
+}
+
+static int pltf_rt_resolve_prio(int prio)
+{
+	int max = sched_get_priority_max(SCHED_FIFO);
+	int min = sched_get_priority_min(SCHED_FIFO);
+
+	if (prio == PLTF_RT_PRIO_MAX)
+		return max;
+	if (prio < min)
+		return PLTF_RT_PRIO_NONE;
+	return (prio > max) ? max : prio;
+}
+
+/* Bytes of stack left below the caller, 0 if unknown */
+static size_t pltf_rt_stack_left(void)
+{
+	pthread_attr_t attr;
+	void *addr;
+	size_t size;
+	uint8_t here;
+	size_t left = 0;
+
+	if (pthread_getattr_np(pthread_self(), &attr) != 0)
+		return 0;
+	/* addr is the lowest address, the stack grows down towards it */
+	if ((pthread_attr_getstack(&attr, &addr, &size) == 0) &&
+	    ((uintptr_t)&here > (uintptr_t)addr) && ((uintptr_t)&here - (uintptr_t)addr <= size))
+		left = (uintptr_t)&here - (uintptr_t)addr;
+	pthread_attr_destroy(&attr);
+
+	return left;
+}
+
+static void __attribute__((noinline)) pltf_rt_touch_stack(size_t size)
+{
+	uint8_t stack[size];
+
+	/* The barrier makes the buffer escape, so the stores are kept */
+	memset(stack, 0, size);
+	__asm__ __volatile__("" : : "r"(stack) : "memory");
+}
+
+/*
+ ******************************************************************************
+ * GLOBAL FUNCTIONS
+ ******************************************************************************
+ */
+void pltf_rt_profile_default(pltfRtProfile *profile)
+{
+	profile->irqCpu		= pltf_rt_env_int("PLTF_RT_IRQ_CPU", PLTF_RT_IRQ_CPU);
+	profile->workerCpu	= pltf_rt_env_int("PLTF_RT_WORKER_CPU", PLTF_RT_WORKER_CPU);
+	profile->irqPrio	= pltf_rt_env_int("PLTF_RT_IRQ_PRIO", PLTF_RT_IRQ_PRIO);
+	profile->workerPrio	= pltf_rt_env_int("PLTF_RT_WORKER_PRIO", PLTF_RT_WORKER_PRIO);
+	profile->lockMemory	= pltf_rt_env_int("PLTF_RT_MLOCK", PLTF_RT_MLOCK) != 0;
+	profile->stackPrefault	= (size_t)pltf_rt_env_int("PLTF_RT_STACK_PREFAULT", PLTF_RT_STACK_PREFAULT);
+	profile->isolated	= pltf_rt_env_int("PLTF_RT_ISOLATED", PLTF_RT_ISOLATED) != 0;
+	profile->strict		= false;
+}
+
+ReturnCode pltf_rt_init(const pltfRtProfile *profile)
+{
+	int cpus[2];
+	int n;
+	ReturnCode err = ERR_NONE;
+
+	if (profile != NULL)
+		rtProfile = *profile;
+	else
+		pltf_rt_profile_default(&rtProfile);
+	rtProfileSet = true;
+
+	/* Isolated-core mode: unpinned threads go to the isolated cores,
+	 * the IRQ thread first, the worker on the next one if there is one */
+	if (rtProfile.isolated) {
+		n = pltf_rt_isolated_cpus(cpus, 2);
+		if (n == 0) {
+			printf("Warning: no isolated CPU found in %s\n", PLTF_RT_ISOLATED_FILE);
+			if (rtProfile.strict)
+				err = ERR_IO;
+		} else {
+			if (rtProfile.irqCpu == PLTF_RT_CPU_ANY)
+				rtProfile.irqCpu = cpus[0];
+			if (rtProfile.workerCpu == PLTF_RT_CPU_ANY)
+				rtProfile.workerCpu = cpus[n - 1];
+		}
+	}
+
+	if (rtProfile.lockMemory) {
+		rtMlockErr = (mlockall(MCL_CURRENT | MCL_FUTURE) == 0) ? 0 : errno;
+		if (rtMlockErr && rtProfile.strict)
+			err = ERR_IO;
+	}
+
+	if (pltf_rt_setup_thread(pthread_self(), pltf_reader_current(), PLTF_RT_THREAD_WORKER) != ERR_NONE)
+		err = ERR_IO;
+	pltf_rt_prefault_stack(PLTF_RT_THREAD_WORKER);
+
+	return err;
+}
+
+ReturnCode pltf_rt_setup_thread(pthread_t thread, pltfReader reader, pltfRtThread role)
+{
+	pltfRtThreadState *st;
+	struct sched_param params;
+	cpu_set_t set;
+
+	if ((reader < 0) || (reader >= PLTF_READER_MAX) || (role >= PLTF_RT_THREAD_NUM))
+		return ERR_PARAM;
+
+	if (!rtProfileSet) {
+		pltf_rt_profile_default(&rtProfile);
+		rtProfileSet = true;
+	}
+
+	/* The thread may already have pre-faulted its stack, keep that */
+	st = &rtThread[reader][role];
+	st->affinityErr	= 0;
+	st->schedErr	= 0;
+	st->configured	= true;
+	st->thread	= thread;
+	st->cpu		= (role == PLTF_RT_THREAD_IRQ) ? rtProfile.irqCpu : rtProfile.workerCpu;
+	st->prio	= pltf_rt_resolve_prio((role == PLTF_RT_THREAD_IRQ) ? rtProfile.irqPrio : rtProfile.workerPrio);
+
+	if (st->cpu != PLTF_RT_CPU_ANY) {
+		CPU_ZERO(&set);
+		CPU_SET(st->cpu, &set);
+		st->affinityErr = pthread_setaffinity_np(thread, sizeof(set), &set);
+	}
+
+	if (st->prio != PLTF_RT_PRIO_NONE) {
+		params.sched_priority = st->prio;
+		st->schedErr = pthread_setschedparam(thread, SCHED_FIFO, &params);
+	}
+
+	if (st->affinityErr || st->schedErr) {
+		printf("Warning: RT profile of reader %d %s thread not fully applied (affinity: %s, sched: %s)\n",
+			reader, rtThreadName[role], strerror(st->affinityErr), strerror(st->schedErr));
+		if (rtProfile.strict)
+			return ERR_IO;
+	}
+
+	return ERR_NONE;
+}
+
+void pltf_rt_prefault_stack(pltfRtThread role)
+{
+	size_t size = rtProfileSet ? rtProfile.stackPrefault : PLTF_RT_STACK_PREFAULT;
+	size_t left;
+
+	if ((role >= PLTF_RT_THREAD_NUM) || (size == 0))
+		return;
+
+	/* The size comes from the environment: never run past the thread stack */
+	left = pltf_rt_stack_left();
+	left = (left > PLTF_RT_STACK_RESERVE) ? (left - PLTF_RT_STACK_RESERVE) : 0;
+	if (size > left) {
+		printf("Warning: %s stack prefault of %zu bytes capped to %zu\n",
+			rtThreadName[role], size, left);
+		size = left;
+		if (size == 0)
+			return;
+	}
+
+	pltf_rt_touch_stack(size);
+	rtThread[pltf_reader_current()][role].prefaulted = size;
+}
+
+void pltf_rt_report(void)
+{
+	struct sched_param params;
+	cpu_set_t set;
+	int policy;
+	int reader;
+	int role;
+	int cpu;
+
+	printf("RT profile:\n");
+	printf("  memory lock : %s\n", (rtMlockErr < 0) ? "off" :
+		((rtMlockErr == 0) ? "locked" : strerror(rtMlockErr)));
+
+	for (reader = 0; reader < PLTF_READER_MAX; reader++)
+	for (role = 0; role < PLTF_RT_THREAD_NUM; role++) {
+		pltfRtThreadState *st = &rtThread[reader][role];
+
+		/* Readers other than the default one are listed once in use */
+		if (!st->configured) {
+			if (reader == PLTF_READER_DEFAULT)
+				printf("  reader %d %-6s thread: not configured\n", reader, rtThreadName[role]);
+			continue;
+		}
+
+		/* Report what the kernel actually applied, not what was requested */
+		printf("  reader %d %-6s thread:", reader, rtThreadName[role]);
+		if (pthread_getschedparam(st->thread, &policy, &params) == 0)
+			printf(" %s prio %d", (policy == SCHED_FIFO) ? "SCHED_FIFO" :
+				((policy == SCHED_RR) ? "SCHED_RR" : "SCHED_OTHER"), params.sched_priority);
+		if (pthread_getaffinity_np(st->thread, sizeof(set), &set) == 0) {
+			printf(", cpus");
+			for (cpu = 0; cpu < CPU_SETSIZE; cpu++)
+				if (CPU_ISSET(cpu, &set))
+					printf(" %d", cpu);
+		}
+		printf(", stack prefault %u bytes", (unsigned)st->prefaulted);
+		if (st->affinityErr)
+			printf(", affinity %d failed: %s", st->cpu, strerror(st->affinityErr));
+		if (st->schedErr)
+			printf(", SCHED_FIFO %d failed: %s", st->prio, strerror(st->schedErr));
+		printf("\n");
+	}
+}
@@ -39,6 +39,7 @@
 #include <sys/ioctl.h>
 #include <pthread.h>
 #include "pltf_spi.h"
+#include "pltf_reader.h"
 #include "st_errno.h"
 
 /*
@@ -51,17 +52,29 @@
 #define SPI_MAX_FREQ		6000000
 #define ARRAY_SIZE(a)		(sizeof(a) / sizeof(a[0]))
 
+/*
+ ******************************************************************************
+ * LOCAL DATA TYPES
+ ******************************************************************************
+ */
+/* SPI port of one reader */
+typedef struct {
+	int fd;
+	int isSPIInit;
+	/* Lock to serialize SPI communication */
+	pthread_mutex_t lockCom;
+} spiPort;
+
 /*
  ******************************************************************************
  * STATIC VARIABLES
  ******************************************************************************
  */
-/* ST25R3911XX is connected with Linux host's SPI port /dev/spidev0.0 */
-static const char *device = "/dev/spidev0.0";
-static int fd = 0;
-static int isSPIInit = 0;
-/* Lock to serialize SPI communication */
-static pthread_mutex_t lockCom;
+/* Each ST25R3911XX is connected with its own SPI device of the Linux host,
+ * /dev/spidev0.0 for the default reader, see pltf_reader_config() */
+static spiPort spiPorts[PLTF_READER_MAX];
+
+#define spi	(spiPorts[pltf_reader_current()])
 
 /*
  ******************************************************************************
@@ -74,36 +87,40 @@ ReturnCode spi_init(void)
 	uint32_t mode = SPI_MODE_CONFIG;
 	uint8_t bitsperword = SPI_BITS_PER_WORD; 
 	uint32_t speed = SPI_MAX_FREQ; 
+	const char *device = pltf_reader_config(pltf_reader_current())->spiDevice;
+
+	if (spi.isSPIInit)
+		return ERR_NONE;
 
-	fd = open(device, O_RDWR);
-	if (fd < 0) {
-		printf("Error: spi device open = %d\n", fd);
-		ret = fd;
+	spi.fd = open(device, O_RDWR);
+	if (spi.fd < 0) {
+		printf("Error: spi device %s open = %d\n", device, spi.fd);
+		ret = spi.fd;
 		goto error;
 	}
 	
 	/* set spi mode */
-	ret = ioctl(fd, SPI_IOC_WR_MODE32, &mode);
+	ret = ioctl(spi.fd, SPI_IOC_WR_MODE32, &mode);
 	if (ret < 0) {
 		printf("Error: SPI mode setting\n");
 		goto error;
 	}
 
 	/* set spi bits per word */
-	ret = ioctl(fd, SPI_IOC_WR_BITS_PER_WORD, &bitsperword);
+	ret = ioctl(spi.fd, SPI_IOC_WR_BITS_PER_WORD, &bitsperword);
  	if (ret < 0) {
 		printf("Error: setting spi bitsperword\n");
 		goto error;
 	}
 
 	/* set spi frequency */
-	ret = ioctl(fd, SPI_IOC_WR_MAX_SPEED_HZ, &speed);
+	ret = ioctl(spi.fd, SPI_IOC_WR_MAX_SPEED_HZ, &speed);
 	if (ret < 0) {
 		printf("Error: setting SPI frequency\n");
 		goto error;
  	}
 
-	ret = pthread_mutex_init(&lockCom, NULL);
+	ret = pthread_mutex_init(&spi.lockCom, NULL);
 	if (ret != 0)
 	{
 		printf("Error: mutex init to protect SPI communication is failed\n");
@@ -111,7 +128,7 @@ ReturnCode spi_init(void)
 	}
 
 	
-	isSPIInit = 1;
+	spi.isSPIInit = 1;
 	return ERR_NONE;
 
 error:
@@ -126,7 +143,7 @@ HAL_statusTypeDef spiTxRx(const uint8_t *txData, uint8_t *rxData, uint8_t length
 	int i;
 
 	/* check if SPI init is done */
-	if (!isSPIInit) {
+	if (!spi.isSPIInit) {
 		printf(" error: spi is used for communication before its initialization\n");
 		return	HAL_ERROR;
 	}
@@ -149,7 +166,7 @@ HAL_statusTypeDef spiTxRx(const uint8_t *txData, uint8_t *rxData, uint8_t length
 	transfer.delay_usecs 	= 0;
 	transfer.cs_change	= 0;
 	
-	ret = ioctl(fd, SPI_IOC_MESSAGE(1), &transfer);
+	ret = ioctl(spi.fd, SPI_IOC_MESSAGE(1), &transfer);
 	if (ret < 0) {
 		printf("Error: SPI error in data transfer=%d\n",ret);
 		/* Unlock the mutex before returning from error case */
@@ -163,13 +180,54 @@ HAL_statusTypeDef spiTxRx(const uint8_t *txData, uint8_t *rxData, uint8_t length
 	return HAL_OK;
 }
 
+HAL_statusTypeDef spiTxRxMulti(const spiSegmentTypeDef *segs, uint8_t count)
+{
+	struct spi_ioc_transfer transfer[SPI_MAX_SEGMENTS];
+	int ret = 0;
+	int i;
+
+	/* check if SPI init is done */
+	if (!spi.isSPIInit) {
+		printf(" error: spi is used for communication before its initialization\n");
+		return	HAL_ERROR;
+	}
+
+	if ((segs == NULL) || (count == 0) || (count > SPI_MAX_SEGMENTS)) {
+		printf("Error: invalid SPI segment count=%d\n", count);
+		return HAL_ERROR;
+	}
+
+	memset(transfer, 0, (count * sizeof(struct spi_ioc_transfer)));
+
+	for (i = 0; i < count; i++) {
+		if (segs[i].txData)
+			transfer[i].tx_buf = (unsigned long) segs[i].txData;
+		if (segs[i].rxData)
+			transfer[i].rx_buf = (unsigned long) segs[i].rxData;
+		transfer[i].len			= (unsigned int) segs[i].length;
+		transfer[i].speed_hz		= SPI_MAX_FREQ;
+		transfer[i].bits_per_word	= SPI_BITS_PER_WORD;
+		transfer[i].delay_usecs		= 0;
+		/* Release CS between segments unless the frame continues, keep the last one as a regular transfer */
+		transfer[i].cs_change		= (((i + 1) < count) && !segs[i].csHold) ? 1 : 0;
+	}
+
+	ret = ioctl(spi.fd, SPI_IOC_MESSAGE(count), transfer);
+	if (ret < 0) {
+		printf("Error: SPI error in batched data transfer=%d\n",ret);
+		return HAL_ERROR;
+	}
+
+	return HAL_OK;
+}
+
 void pltf_protect_com(void)
 {
-	pthread_mutex_lock(&lockCom);
+	pthread_mutex_lock(&spi.lockCom);
 }
 
 void pltf_unprotect_com(void)
 {
-	pthread_mutex_unlock(&lockCom);
+	pthread_mutex_unlock(&spi.lockCom);
 }
 
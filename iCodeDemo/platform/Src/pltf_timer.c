@@ -37,6 +37,7 @@
 ******************************************************************************
 */
 #include <time.h>
+#include <errno.h>
 #include "pltf_timer.h"
 #include "platform.h"
 
@@ -46,6 +47,28 @@
 ******************************************************************************
 */
 
+/*
+******************************************************************************
+* LOCAL DATA TYPES
+******************************************************************************
+*/
+
+/*! Pending deadlines of one reader */
+typedef struct
+{
+  bool     ignored;                         /*!< Deadlines are not recorded       */
+  uint8_t  count;                           /*!< Number of recorded deadlines     */
+  uint32_t deadline[PLTF_TIMER_DEADLINES];  /*!< Recorded deadlines (us)          */
+} timerDeadlines;
+
+/*
+******************************************************************************
+* LOCAL VARIABLES
+******************************************************************************
+*/
+
+static timerDeadlines timerTrack[PLTF_READER_MAX];   /*!< Deadlines per reader */
+
 /*
 ******************************************************************************
 * GLOBAL AND HELPER FUNCTIONS
@@ -62,17 +85,73 @@ uint32_t ts2milisec(struct timespec* ts) {
 /****************************************************************************/
 
 uint32_t platformGetSysTick_linux() {
+#ifdef PLTF_SIM
+	return (uint32_t)(pltf_sim_clock_ns() / 1000000);
+#else
 	struct timespec cur_ts;
-	clock_gettime(CLOCK_REALTIME, &cur_ts);
+	clock_gettime(CLOCK_MONOTONIC, &cur_ts);
 	return ts2milisec(&cur_ts); 
+#endif /* PLTF_SIM */
+}
+
+
+/*******************************************************************************/
+uint32_t timerGetTimeUs( void )
+{
+#ifdef PLTF_SIM
+  /* Virtual clock of the simulated reader */
+  return (uint32_t)(pltf_sim_clock_ns() / 1000);
+#else
+  struct timespec cur_ts;
+  
+  clock_gettime(CLOCK_MONOTONIC, &cur_ts);
+  return (uint32_t)((cur_ts.tv_sec * (uint64_t)1000000) + (cur_ts.tv_nsec / 1000));
+#endif /* PLTF_SIM */
 }
 
 
 /*******************************************************************************/
 uint32_t timerCalculateTimer( uint16_t time )
 {
- 
-  return (platformGetSysTick() + time);
+  return timerCalculateTimerUs( (uint32_t)time * 1000 );
+}
+
+
+/*******************************************************************************/
+uint32_t timerCalculateTimerUs( uint32_t time )
+{
+  timerDeadlines *track = &timerTrack[pltf_reader_current()];
+  uint32_t t;
+  uint8_t  i;
+  uint8_t  last;
+  
+  t = (timerGetTimeUs() + time);
+  
+  if( !track->ignored )
+  {
+    if( track->count < PLTF_TIMER_DEADLINES )
+    {
+      track->deadline[track->count++] = t;
+    }
+    else
+    {
+      /* Full: keep the earliest ones */
+      last = 0;
+      for( i = 1; i < track->count; i++ )
+      {
+        if( (int32_t)(track->deadline[i] - track->deadline[last]) > 0 )
+        {
+          last = i;
+        }
+      }
+      if( (int32_t)(t - track->deadline[last]) < 0 )
+      {
+        track->deadline[last] = t;
+      }
+    }
+  }
+  
+  return t;
 }
 
 
@@ -82,7 +161,7 @@ bool timerIsExpired( uint32_t timer )
   uint32_t uDiff;
   int32_t sDiff;
   
-  uDiff = (timer - platformGetSysTick());   /* Calculate the diff between the timers */
+  uDiff = (timer - timerGetTimeUs());       /* Calculate the diff between the timers */
   sDiff = uDiff;                            /* Convert the diff to a signed var      */
   
   /* Check if the given timer has expired already */
@@ -98,10 +177,77 @@ bool timerIsExpired( uint32_t timer )
 /*******************************************************************************/
 void timerDelay( uint16_t tOut )
 {
+  timerDelayUs( (uint32_t)tOut * 1000 );
+}
+
+
+/*******************************************************************************/
+void timerDelayUs( uint32_t tOut )
+{
+#ifdef PLTF_SIM
+  /* Virtual clock: moved on by the delay, IRQs raised meanwhile are serviced */
+  timerCalculateTimerUs( tOut );
+  pltf_sim_delay_us( tOut );
+#else
+  struct timespec ts;
   uint32_t t;
+  uint64_t ns;
+  
+  t = timerCalculateTimerUs( tOut );
+  
+  /* Sleep until the absolute deadline minus the spin part, immune to EINTR drift */
+  if( tOut > PLTF_TIMER_DELAY_SPIN_US )
+  {
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    ns  = (uint64_t)ts.tv_nsec + ((uint64_t)(tOut - PLTF_TIMER_DELAY_SPIN_US) * 1000);
+    ts.tv_sec  += (time_t)(ns / 1000000000);
+    ts.tv_nsec  = (long)(ns % 1000000000);
+    
+    while( clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR );
+  }
   
-  /* Calculate the timer and wait blocking until is running */
-  t = timerCalculateTimer( tOut );
+  /* Busy-wait the remaining part */
   while( timerIsRunning(t) );
+#endif /* PLTF_SIM */
+}
+
+
+/*******************************************************************************/
+void timerTrackDeadlines( bool enable )
+{
+  timerDeadlines *track = &timerTrack[pltf_reader_current()];
+  
+  track->ignored = !enable;
+  track->count   = 0;
 }
 
+
+/*******************************************************************************/
+bool timerNextDeadline( uint32_t since, uint32_t *deadline )
+{
+  timerDeadlines *track = &timerTrack[pltf_reader_current()];
+  uint8_t  i;
+  uint8_t  n;
+  bool     found;
+  
+  found = false;
+  n     = 0;
+  for( i = 0; i < track->count; i++ )
+  {
+    /* Reached before the last run of the timer owner: handled */
+    if( (int32_t)(track->deadline[i] - since) <= 0 )
+    {
+      continue;
+    }
+    
+    track->deadline[n++] = track->deadline[i];
+    if( !found || ((int32_t)(track->deadline[i] - *deadline) < 0) )
+    {
+      *deadline = track->deadline[i];
+      found     = true;
+    }
+  }
+  track->count = n;
+  
+  return found;
+}
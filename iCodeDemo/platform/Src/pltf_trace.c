@@ -0,0 +1,539 @@
+
+/******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; COPYRIGHT 2018 STMicroelectronics</center></h2>
+  *
+  * Licensed under ST MYLIBERTY SOFTWARE LICENSE AGREEMENT (the "License");
+  * You may not use this file except in compliance with the License.
+  * You may obtain a copy of the License at:
+  *
+  *        http://www.st.com/myliberty
+  *
+  * Unless required by applicable law or agreed to in writing, software 
+  * distributed under the License is distributed on an "AS IS" BASIS, 
+  * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied,
+  * AND SPECIFICALLY DISCLAIMING THE IMPLIED WARRANTIES OF MERCHANTABILITY,
+  * FITNESS FOR A PARTICULAR PURPOSE, AND NON-INFRINGEMENT.
+  * See the License for the specific language governing permissions and
+  * limitations under the License.
+  *
+******************************************************************************/
+
+/*! \file pltf_trace.c
+ *
+ *  \brief Implementation of the SPI and IRQ trace recorder.
+ *  
+ *  The ring is written in place through a shared mapping: the kernel keeps
+ *  the pages of the file, a crash of the process loses at most the record
+ *  being written. Records never wrap, the end of the ring left over is
+ *  padding. Once the ring is full the oldest records are dropped to make
+ *  room, the header keeps track of the oldest one left.
+ *  
+ */
+
+/*
+ ******************************************************************************
+ * INCLUDES
+ ******************************************************************************
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "pltf_trace.h"
+#include "pltf_reader.h"
+#ifdef PLTF_SIM
+#include "pltf_sim.h"
+#endif /* PLTF_SIM */
+
+/*
+ ******************************************************************************
+ * DEFINES
+ ******************************************************************************
+ */
+/* Bytes sent, kept aside before an in place transfer overwrites them */
+#define TRACE_STAGE_MAX		1024
+
+/* Largest record accepted, relative to the ring size */
+#define trace_rec_max(size)	((size) / 4)
+
+#if (PLTF_READER_MAX > (PLTF_TRACE_FLAG_READER + 1))
+#error "PLTF_READER_MAX exceeds the readers a trace record can tell apart"
+#endif
+
+/*
+ ******************************************************************************
+ * LOCAL DATA TYPES
+ ******************************************************************************
+ */
+/* File being recorded into */
+typedef struct {
+	pthread_mutex_t	lock;		/* Serializes the writers, priority inheriting */
+	bool		on;		/* Recording, read without the lock */
+	int		fd;
+	uint8_t		*map;
+	size_t		mapSize;
+	pltfTraceHdr	*hdr;
+	uint8_t		*ring;
+}traceFile;
+
+/*
+ ******************************************************************************
+ * STATIC VARIABLES
+ ******************************************************************************
+ */
+static traceFile trace = { .on = false, .fd = -1 };
+static pthread_once_t traceLockOnce = PTHREAD_ONCE_INIT;
+
+/* The calling thread is running the ISR */
+static __thread bool traceIsr;
+
+/*
+ ******************************************************************************
+ * LOCAL FUNCTIONS
+ ******************************************************************************
+ */
+static uint64_t trace_now(void)
+{
+#ifdef PLTF_SIM
+	return pltf_sim_time_ns();
+#else
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ((uint64_t)ts.tv_sec * 1000000000ULL) + (uint64_t)ts.tv_nsec;
+#endif /* PLTF_SIM */
+}
+
+/* The ISR records from the RT interrupt thread: a lower priority writer
+ * holding the lock is boosted rather than preempted by a third thread */
+static void trace_lock_init(void)
+{
+	pthread_mutexattr_t attr;
+
+	pthread_mutexattr_init(&attr);
+	pthread_mutexattr_setprotocol(&attr, PTHREAD_PRIO_INHERIT);
+	pthread_mutex_init(&trace.lock, &attr);
+	pthread_mutexattr_destroy(&attr);
+}
+
+static void trace_lock(void)
+{
+	pthread_once(&traceLockOnce, trace_lock_init);
+	pthread_mutex_lock(&trace.lock);
+}
+
+static bool trace_on(void)
+{
+	return __atomic_load_n(&trace.on, __ATOMIC_RELAXED);
+}
+
+/* Size of the record at p, 0 if it is no valid record */
+static uint32_t trace_rec_size(const uint8_t *p)
+{
+	uint16_t len = (uint16_t)(p[2] | (p[3] << 8));
+	uint32_t size = PLTF_TRACE_REC_HDR;
+
+	switch (p[0]) {
+	case PLTF_TRACE_SPI:
+		if (!(p[1] & PLTF_TRACE_FLAG_TX_NONE))
+			size += len;
+		if (!(p[1] & PLTF_TRACE_FLAG_RX_NONE))
+			size += len;
+		return size;
+	case PLTF_TRACE_IRQ:
+	case PLTF_TRACE_LINE:
+		return size;
+	default:
+		return 0;
+	}
+}
+
+/* Drop the oldest record */
+static void trace_evict(void)
+{
+	pltfTraceHdr *h = trace.hdr;
+
+	h->tail += trace_rec_size(&trace.ring[h->tail]);
+	h->lost++;
+	if (((h->tail + PLTF_TRACE_REC_HDR) > h->size) || (trace.ring[h->tail] == PLTF_TRACE_PAD))
+		h->tail = 0;
+}
+
+/* Make room for need bytes at the head */
+static void trace_reserve(uint32_t need)
+{
+	pltfTraceHdr *h = trace.hdr;
+
+	if ((h->head + need) > h->size) {
+		if (h->head < h->size)
+			trace.ring[h->head] = PLTF_TRACE_PAD;
+		h->head = 0;
+		h->wrapped = 1;
+	}
+
+	/* Once wrapped, the oldest records are the ones right after the head */
+	while (h->wrapped && (h->tail >= h->head) && (h->tail < (h->head + need)))
+		trace_evict();
+}
+
+static void trace_put16(uint8_t *p, uint16_t v)
+{
+	p[0] = (uint8_t)v;
+	p[1] = (uint8_t)(v >> 8);
+}
+
+static void trace_put64(uint8_t *p, uint64_t v)
+{
+	int i;
+
+	for (i = 0; i < 8; i++)
+		p[i] = (uint8_t)(v >> (8 * i));
+}
+
+static uint64_t trace_get64(const uint8_t *p)
+{
+	uint64_t v = 0;
+	int i;
+
+	for (i = 7; i >= 0; i--)
+		v = (v << 8) | p[i];
+	return v;
+}
+
+static void trace_put(uint8_t type, uint8_t flags, uint16_t len, uint64_t t, const uint8_t *tx, const uint8_t *rx)
+{
+	uint32_t need;
+	uint8_t *p;
+
+	flags |= (uint8_t)(pltf_reader_current() & PLTF_TRACE_FLAG_READER);
+	if (traceIsr)
+		flags |= PLTF_TRACE_FLAG_ISR;
+	if (type == PLTF_TRACE_SPI) {
+		if (tx == NULL)
+			flags |= PLTF_TRACE_FLAG_TX_NONE;
+		if (rx == NULL)
+			flags |= PLTF_TRACE_FLAG_RX_NONE;
+	}
+
+	trace_lock();
+	if (trace.hdr == NULL)
+		goto unlock;
+
+	need = PLTF_TRACE_REC_HDR + ((tx != NULL) ? len : 0) + ((rx != NULL) ? len : 0);
+	if (need > trace_rec_max(trace.hdr->size)) {
+		trace.hdr->lost++;
+		goto unlock;
+	}
+	trace_reserve(need);
+
+	p = &trace.ring[trace.hdr->head];
+	p[0] = type;
+	p[1] = flags;
+	trace_put16(&p[2], len);
+	trace_put64(&p[4], t);
+	p += PLTF_TRACE_REC_HDR;
+	if (tx != NULL) {
+		memcpy(p, tx, len);
+		p += len;
+	}
+	if (rx != NULL)
+		memcpy(p, rx, len);
+
+	/* Published once complete */
+	trace.hdr->head += need;
+	trace.hdr->records++;
+
+unlock:
+	pthread_mutex_unlock(&trace.lock);
+}
+
+/* Bytes sent that the transfer overwrites with the ones received */
+static bool trace_in_place(const uint8_t *tx, const uint8_t *rx, uint16_t len)
+{
+	return ((tx != NULL) && (rx != NULL) && (rx < (tx + len)) && (tx < (rx + len)));
+}
+
+/*
+ ******************************************************************************
+ * GLOBAL FUNCTIONS - RECORDING
+ ******************************************************************************
+ */
+ReturnCode pltf_trace_init(void)
+{
+	const char *path = getenv(PLTF_TRACE_ENV);
+	const char *size = getenv(PLTF_TRACE_SIZE_ENV);
+
+	if ((path == NULL) || (*path == '\0'))
+		return ERR_NONE;
+
+	return pltf_trace_start(path, ((size != NULL) && (*size != '\0')) ? (uint32_t)strtoul(size, NULL, 0) : PLTF_TRACE_SIZE);
+}
+
+ReturnCode pltf_trace_start(const char *path, uint32_t size)
+{
+	ReturnCode err = ERR_IO;
+	pltfTraceHdr *h;
+
+	if (size < PLTF_TRACE_SIZE_MIN)
+		return ERR_PARAM;
+
+	trace_lock();
+	if (trace.hdr != NULL) {
+		err = ERR_WRONG_STATE;
+		goto unlock;
+	}
+
+	trace.fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+	if (trace.fd < 0) {
+		printf("Error: trace file %s open\n", path);
+		goto unlock;
+	}
+
+	trace.mapSize = sizeof(pltfTraceHdr) + size;
+	if (ftruncate(trace.fd, (off_t)trace.mapSize) < 0) {
+		printf("Error: sizing trace file %s\n", path);
+		goto error;
+	}
+
+	trace.map = mmap(NULL, trace.mapSize, PROT_READ | PROT_WRITE, MAP_SHARED, trace.fd, 0);
+	if (trace.map == MAP_FAILED) {
+		printf("Error: mapping trace file %s\n", path);
+		trace.map = NULL;
+		goto error;
+	}
+
+	h = (pltfTraceHdr *)trace.map;
+	memcpy(h->magic, PLTF_TRACE_MAGIC, sizeof(h->magic));
+	h->version = PLTF_TRACE_VERSION;
+	h->hdrSize = sizeof(pltfTraceHdr);
+	h->size = size;
+	h->start = trace_now();
+	trace.ring = trace.map + sizeof(pltfTraceHdr);
+	trace.hdr = h;
+	__atomic_store_n(&trace.on, true, __ATOMIC_RELEASE);
+
+	pthread_mutex_unlock(&trace.lock);
+	return ERR_NONE;
+
+error:
+	close(trace.fd);
+	trace.fd = -1;
+unlock:
+	pthread_mutex_unlock(&trace.lock);
+	return err;
+}
+
+void pltf_trace_stop(void)
+{
+	trace_lock();
+	__atomic_store_n(&trace.on, false, __ATOMIC_RELEASE);
+	if (trace.hdr != NULL) {
+		msync(trace.map, trace.mapSize, MS_SYNC);
+		munmap(trace.map, trace.mapSize);
+		close(trace.fd);
+		trace.map = NULL;
+		trace.ring = NULL;
+		trace.hdr = NULL;
+		trace.fd = -1;
+	}
+	pthread_mutex_unlock(&trace.lock);
+}
+
+HAL_statusTypeDef pltf_trace_spiTxRx(const uint8_t *txData, uint8_t *rxData, uint8_t length)
+{
+	uint8_t stage[UINT8_MAX];
+	const uint8_t *tx = txData;
+	HAL_statusTypeDef ret;
+	uint64_t t;
+
+	if (!trace_on())
+		return spiTxRx(txData, rxData, length);
+
+	if (trace_in_place(txData, rxData, length)) {
+		memcpy(stage, txData, length);
+		tx = stage;
+	}
+
+	t = trace_now();
+	ret = spiTxRx(txData, rxData, length);
+	trace_put(PLTF_TRACE_SPI, 0, length, t, tx, rxData);
+
+	return ret;
+}
+
+HAL_statusTypeDef pltf_trace_spiTxRxMulti(const spiSegmentTypeDef *segs, uint8_t count)
+{
+	uint8_t stage[TRACE_STAGE_MAX];
+	const uint8_t *tx[SPI_MAX_SEGMENTS];
+	uint16_t len[SPI_MAX_SEGMENTS];
+	uint8_t flags[SPI_MAX_SEGMENTS];
+	uint16_t used = 0;
+	HAL_statusTypeDef ret;
+	uint64_t t;
+	uint8_t i;
+
+	if (!trace_on() || (count > SPI_MAX_SEGMENTS))
+		return spiTxRxMulti(segs, count);
+
+	for (i = 0; i < count; i++) {
+		tx[i] = segs[i].txData;
+		len[i] = segs[i].length;
+		flags[i] = (segs[i].csHold ? PLTF_TRACE_FLAG_HOLD : 0);
+		if (trace_in_place(segs[i].txData, segs[i].rxData, segs[i].length)) {
+			/* Bytes sent past the stage are lost, record only the staged part */
+			if ((used + len[i]) > sizeof(stage)) {
+				len[i] = (uint16_t)(sizeof(stage) - used);
+				flags[i] |= PLTF_TRACE_FLAG_TRUNC;
+			}
+			memcpy(&stage[used], segs[i].txData, len[i]);
+			tx[i] = &stage[used];
+			used += len[i];
+		}
+	}
+
+	t = trace_now();
+	ret = spiTxRxMulti(segs, count);
+	for (i = 0; i < count; i++)
+		trace_put(PLTF_TRACE_SPI, flags[i], len[i], t, tx[i], segs[i].rxData);
+
+	return ret;
+}
+
+void pltf_trace_isr_begin(void)
+{
+	traceIsr = true;
+	if (trace_on())
+		trace_put(PLTF_TRACE_IRQ, 0, 0, trace_now(), NULL, NULL);
+}
+
+void pltf_trace_isr_end(void)
+{
+	traceIsr = false;
+}
+
+void pltf_trace_line(bool high)
+{
+	/* Only the reads of the ISR decide anything */
+	if (traceIsr && trace_on())
+		trace_put(PLTF_TRACE_LINE, 0, (high ? 1 : 0), trace_now(), NULL, NULL);
+}
+
+/*
+ ******************************************************************************
+ * GLOBAL FUNCTIONS - READING
+ ******************************************************************************
+ */
+ReturnCode pltf_trace_load(const char *path, pltfTraceLog *log)
+{
+	const pltfTraceHdr *h;
+	const uint8_t *ring;
+	const uint8_t *p;
+	struct stat st;
+	uint32_t pos, end, size, n;
+	bool second;
+	int fd;
+
+	memset(log, 0, sizeof(*log));
+
+	fd = open(path, O_RDONLY);
+	if (fd < 0) {
+		printf("Error: trace file %s open\n", path);
+		return ERR_IO;
+	}
+	if ((fstat(fd, &st) < 0) || (st.st_size < (off_t)sizeof(pltfTraceHdr))) {
+		close(fd);
+		return ERR_PROTO;
+	}
+
+	log->mapSize = (uint32_t)st.st_size;
+	log->map = mmap(NULL, log->mapSize, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (log->map == MAP_FAILED) {
+		printf("Error: mapping trace file %s\n", path);
+		log->map = NULL;
+		return ERR_IO;
+	}
+
+	h = (const pltfTraceHdr *)log->map;
+	ring = (const uint8_t *)log->map + sizeof(pltfTraceHdr);
+	if ((memcmp(h->magic, PLTF_TRACE_MAGIC, sizeof(h->magic)) != 0) || (h->version != PLTF_TRACE_VERSION) ||
+	    (h->hdrSize != sizeof(pltfTraceHdr)) || (h->size != (log->mapSize - sizeof(pltfTraceHdr))) ||
+	    (h->head > h->size) || (h->tail > h->size))
+		goto corrupt;
+
+	/* Two passes: count, then index */
+	for (n = 0; n < 2; n++) {
+		/* Oldest part up to the padding, the newest from the start of the ring */
+		second = (!h->wrapped || (h->tail < h->head));
+		pos = (h->wrapped ? h->tail : 0);
+		end = (second ? h->head : h->size);
+		log->count = 0;
+
+		while (true) {
+			if (((pos + PLTF_TRACE_REC_HDR) > end) || (ring[pos] == PLTF_TRACE_PAD)) {
+				if (second)
+					break;
+				second = true;
+				pos = 0;
+				end = h->head;
+				continue;
+			}
+
+			p = &ring[pos];
+			size = trace_rec_size(p);
+			if ((size == 0) || ((pos + size) > end))
+				goto corrupt;
+
+			if (log->recs != NULL) {
+				pltfTraceRec *r = &log->recs[log->count];
+
+				r->type = p[0];
+				r->flags = p[1];
+				r->len = (uint16_t)(p[2] | (p[3] << 8));
+				r->t = trace_get64(&p[4]);
+				r->tx = NULL;
+				r->rx = NULL;
+				if (r->type == PLTF_TRACE_SPI) {
+					if (!(r->flags & PLTF_TRACE_FLAG_TX_NONE))
+						r->tx = &p[PLTF_TRACE_REC_HDR];
+					if (!(r->flags & PLTF_TRACE_FLAG_RX_NONE))
+						r->rx = &p[PLTF_TRACE_REC_HDR + ((r->tx != NULL) ? r->len : 0)];
+				}
+			}
+			log->count++;
+			pos += size;
+		}
+
+		if ((n == 0) && (log->count > 0)) {
+			log->recs = malloc(log->count * sizeof(pltfTraceRec));
+			if (log->recs == NULL) {
+				pltf_trace_unload(log);
+				return ERR_NOMEM;
+			}
+		}
+	}
+
+	log->lost = h->lost;
+	return ERR_NONE;
+
+corrupt:
+	printf("Error: %s is no valid trace\n", path);
+	pltf_trace_unload(log);
+	return ERR_PROTO;
+}
+
+void pltf_trace_unload(pltfTraceLog *log)
+{
+	free(log->recs);
+	if (log->map != NULL)
+		munmap(log->map, log->mapSize);
+	memset(log, 0, sizeof(*log));
+}
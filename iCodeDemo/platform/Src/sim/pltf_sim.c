@@ -0,0 +1,1368 @@
+
+/******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; COPYRIGHT 2018 STMicroelectronics</center></h2>
+  *
+  * Licensed under ST MYLIBERTY SOFTWARE LICENSE AGREEMENT (the "License");
+  * You may not use this file except in compliance with the License.
+  * You may obtain a copy of the License at:
+  *
+  *        http://www.st.com/myliberty
+  *
+  * Unless required by applicable law or agreed to in writing, software 
+  * distributed under the License is distributed on an "AS IS" BASIS, 
+  * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied,
+  * AND SPECIFICALLY DISCLAIMING THE IMPLIED WARRANTIES OF MERCHANTABILITY,
+  * FITNESS FOR A PARTICULAR PURPOSE, AND NON-INFRINGEMENT.
+  * See the License for the specific language governing permissions and
+  * limitations under the License.
+  *
+******************************************************************************/
+/*! \file pltf_sim.c
+ *
+ *  \brief Model of the ST25R3911 and its virtual clock.
+ *  
+ */
+
+/*
+ ******************************************************************************
+ * INCLUDES
+ ******************************************************************************
+ */
+#define _GNU_SOURCE		/* recursive mutex initialiser */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <string.h>
+#include <time.h>
+#include <sys/timerfd.h>
+#include "pltf_sim_int.h"
+#include "st25r3911.h"
+#include "st25r3911_com.h"
+#include "st25r3911_interrupt.h"
+
+/*
+ ******************************************************************************
+ * DEFINES
+ ******************************************************************************
+ */
+#define SIM_EPOCH_NS		1000000000ULL	/* Virtual clock at start-up */
+
+#define SIM_OSC_NS		300000		/* Oscillator start-up */
+#define SIM_DCT_NS		100000		/* Measurement, calibration and adjustment commands */
+#define SIM_CA_NS		100000		/* RF collision avoidance until the field is on */
+
+#define SIM_VDD_AD		0x8D		/* MEASURE_VDD: 3.3 V */
+#define SIM_MEASURE_AD		0x80		/* Other A/D measurements, mid scale */
+#define SIM_REG_NIBBLE		0xA		/* ADJUST_REGULATORS: 2.9 V at 3.3 V supply */
+
+/* SPI operation modes, as in st25r3911_com.c */
+#define SIM_SPI_MODE_MASK	0xC0
+#define SIM_SPI_WRITE		0x00
+#define SIM_SPI_READ		0x40
+#define SIM_SPI_FIFO		0x80
+#define SIM_SPI_FIFO_READ	0xBF
+#define SIM_SPI_CMD		0xC0
+
+/* Registers the host cannot write */
+#define SIM_REG_BIT(r)		((uint64_t)1 << (r))
+#define SIM_REG_RO		( SIM_REG_BIT(ST25R3911_REG_IRQ_MAIN)                   | \
+				  SIM_REG_BIT(ST25R3911_REG_IRQ_TIMER_NFC)              | \
+				  SIM_REG_BIT(ST25R3911_REG_IRQ_ERROR_WUP)              | \
+				  SIM_REG_BIT(ST25R3911_REG_FIFO_RX_STATUS1)            | \
+				  SIM_REG_BIT(ST25R3911_REG_FIFO_RX_STATUS2)            | \
+				  SIM_REG_BIT(ST25R3911_REG_COLLISION_STATUS)           | \
+				  SIM_REG_BIT(ST25R3911_REG_NFCIP1_BIT_RATE)            | \
+				  SIM_REG_BIT(ST25R3911_REG_AD_RESULT)                  | \
+				  SIM_REG_BIT(ST25R3911_REG_ANT_CAL_RESULT)             | \
+				  SIM_REG_BIT(ST25R3911_REG_AM_MOD_DEPTH_RESULT)        | \
+				  SIM_REG_BIT(ST25R3911_REG_REGULATOR_RESULT)           | \
+				  SIM_REG_BIT(ST25R3911_REG_RSSI_RESULT)                | \
+				  SIM_REG_BIT(ST25R3911_REG_GAIN_RED_STATE)             | \
+				  SIM_REG_BIT(ST25R3911_REG_CAP_SENSOR_RESULT)          | \
+				  SIM_REG_BIT(ST25R3911_REG_AUX_DISPLAY)                | \
+				  SIM_REG_BIT(ST25R3911_REG_AMPLITUDE_MEASURE_AA_RESULT)| \
+				  SIM_REG_BIT(ST25R3911_REG_AMPLITUDE_MEASURE_RESULT)   | \
+				  SIM_REG_BIT(ST25R3911_REG_PHASE_MEASURE_AA_RESULT)    | \
+				  SIM_REG_BIT(ST25R3911_REG_PHASE_MEASURE_RESULT)       | \
+				  SIM_REG_BIT(ST25R3911_REG_CAPACITANCE_MEASURE_AA_RESULT) | \
+				  SIM_REG_BIT(ST25R3911_REG_CAPACITANCE_MEASURE_RESULT) | \
+				  SIM_REG_BIT(ST25R3911_REG_IC_IDENTITY) )
+
+#define SIM_IRQ_ERR		(ST25R3911_IRQ_MASK_CRC | ST25R3911_IRQ_MASK_PAR | ST25R3911_IRQ_MASK_ERR1 | ST25R3911_IRQ_MASK_ERR2 | ST25R3911_IRQ_MASK_COL)
+
+/* NFC-V stream codes */
+#define SIM_NFCV_SOF_1OF4	0x21
+#define SIM_NFCV_SOF_1OF256	0x81
+#define SIM_NFCV_EOF		0x04
+
+#define sim_reg(c, r)		((c)->reg[(r)])
+#define sim_om(c)		(sim_reg(c, ST25R3911_REG_MODE) & ST25R3911_REG_MODE_mask_om)
+#define sim_is_stream(c)	((sim_om(c) == ST25R3911_REG_MODE_om_subcarrier_stream) || (sim_om(c) == ST25R3911_REG_MODE_om_bpsk_stream))
+#define sim_running(c, t)	(((t) != 0) && ((t) > (c)->now))
+
+/*
+ ******************************************************************************
+ * STATIC VARIABLES
+ ******************************************************************************
+ */
+static simChip simChips[PLTF_READER_MAX] = {
+	[0 ... PLTF_READER_MAX - 1] = {
+		.lock	= PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP,
+		.fdIrq	= -1,
+		.now	= SIM_EPOCH_NS,
+		.reg	= { [ST25R3911_REG_MODE] = ST25R3911_REG_MODE_om_iso14443a },
+	}
+};
+
+/*
+ ******************************************************************************
+ * LOCAL FUNCTIONS - IRQ
+ ******************************************************************************
+ */
+static uint32_t sim_irq_mask(simChip *c)
+{
+	return (uint32_t)sim_reg(c, ST25R3911_REG_IRQ_MASK_MAIN)
+		| ((uint32_t)sim_reg(c, ST25R3911_REG_IRQ_MASK_TIMER_NFC) << 8)
+		| ((uint32_t)sim_reg(c, ST25R3911_REG_IRQ_MASK_ERROR_WUP) << 16);
+}
+
+static void sim_irq_update(simChip *c)
+{
+	bool high = ((c->irq & ~sim_irq_mask(c)) != 0);
+
+	if (high && !c->lineHigh)
+		c->irqStamp = c->now;
+	c->lineHigh = high;
+}
+
+/* Masked sources are not latched */
+static void sim_irq_raise(simChip *c, uint32_t irq)
+{
+	c->irq |= (irq & ~sim_irq_mask(c));
+	sim_irq_update(c);
+}
+
+/*
+ ******************************************************************************
+ * LOCAL FUNCTIONS - CODECS
+ ******************************************************************************
+ */
+static void sim_bits_put(uint8_t *dst, uint32_t pos, const uint8_t *src, uint32_t nbits)
+{
+	uint32_t i;
+
+	for (i = 0; i < nbits; i++, pos++) {
+		if (src[i / 8] & (1 << (i % 8)))
+			dst[pos / 8] |= (1 << (pos % 8));
+	}
+}
+
+/* VCD frame from the stream bytes sent, checks and strips the CRC */
+static bool sim_nfcv_vcd_decode(const uint8_t *s, uint16_t n, pltfSimFrame *f)
+{
+	uint16_t i, crc;
+	uint8_t k, b, v;
+
+	f->len = 0;
+	f->bits = 0;
+	f->crc = false;
+
+	/* EOF alone, next slot of an inventory or the answer to a write */
+	if ((n == 1) && (s[0] == SIM_NFCV_EOF))
+		return true;
+
+	if ((n < 2) || (s[n - 1] != SIM_NFCV_EOF))
+		return false;
+
+	if (s[0] == SIM_NFCV_SOF_1OF4) {
+		if ((n - 2) % 4)
+			return false;
+		for (i = 1; i < (n - 1); i += 4) {
+			b = 0;
+			for (k = 0; k < 4; k++) {
+				switch (s[i + k]) {
+				case 0x02: v = 0; break;
+				case 0x08: v = 1; break;
+				case 0x20: v = 2; break;
+				case 0x80: v = 3; break;
+				default: return false;
+				}
+				b |= (v << (2 * k));
+			}
+			if (f->len >= PLTF_SIM_FRAME_MAX)
+				return false;
+			f->data[f->len++] = b;
+		}
+	} else if (s[0] == SIM_NFCV_SOF_1OF256) {
+		if ((n - 2) % 64)
+			return false;
+		for (i = 1; i < (n - 1); i += 64) {
+			b = 0;
+			v = 0;
+			for (k = 0; k < 64; k++) {
+				if (s[i + k] == 0)
+					continue;
+				switch (s[i + k]) {
+				case 0x02: b = k * 4 + 0; break;
+				case 0x08: b = k * 4 + 1; break;
+				case 0x20: b = k * 4 + 2; break;
+				case 0x80: b = k * 4 + 3; break;
+				default: return false;
+				}
+				v++;
+			}
+			if ((v != 1) || (f->len >= PLTF_SIM_FRAME_MAX))
+				return false;
+			f->data[f->len++] = b;
+		}
+	} else {
+		return false;
+	}
+
+	if (f->len >= 3) {
+		crc = sim_crc_b(f->data, f->len - 2);
+		if ((f->data[f->len - 2] == (crc & 0xFF)) && (f->data[f->len - 1] == (crc >> 8))) {
+			f->crc = true;
+			f->len -= 2;
+		}
+	}
+	return true;
+}
+
+/* VICC frame into stream bits: SOF, Manchester coded data, EOF. Returns the FIFO bytes */
+static uint16_t sim_nfcv_vicc_encode(const uint8_t *d, uint16_t n, uint8_t *s)
+{
+	static const uint8_t sof[] = { 1, 1, 1, 0, 1 };
+	static const uint8_t eof[] = { 1, 0, 1, 1, 1 };
+	uint32_t pos = 0;
+	uint16_t i;
+	uint8_t k;
+
+	memset(s, 0, (2 * n) + 3);
+
+	for (k = 0; k < sizeof(sof); k++, pos++)
+		s[pos / 8] |= (sof[k] << (pos % 8));
+
+	for (i = 0; i < n; i++) {
+		for (k = 0; k < 8; k++) {
+			/* Logic 0 is (1,0), logic 1 is (0,1) */
+			pos += ((d[i] >> k) & 1);
+			s[pos / 8] |= (1 << (pos % 8));
+			pos += 2 - ((d[i] >> k) & 1);
+		}
+	}
+
+	for (k = 0; k < sizeof(eof); k++, pos++)
+		s[pos / 8] |= (eof[k] << (pos % 8));
+
+	return (uint16_t)((pos + 7) / 8);
+}
+
+/*
+ ******************************************************************************
+ * LOCAL FUNCTIONS - AIR INTERFACE
+ ******************************************************************************
+ */
+static int sim_tech(simChip *c)
+{
+	switch (sim_om(c)) {
+	case ST25R3911_REG_MODE_om_iso14443a:
+		return PLTF_SIM_TECH_NFCA;
+	case ST25R3911_REG_MODE_om_iso14443b:
+		return PLTF_SIM_TECH_NFCB;
+	case ST25R3911_REG_MODE_om_felica:
+		return PLTF_SIM_TECH_NFCF;
+	case ST25R3911_REG_MODE_om_subcarrier_stream:
+	case ST25R3911_REG_MODE_om_bpsk_stream:
+		return PLTF_SIM_TECH_NFCV;
+	default:
+		return -1;
+	}
+}
+
+/* Air time of one FIFO byte and of the framing (SOF, EOF, sync) */
+static void sim_air_timing(simChip *c, bool tx, uint64_t *byteNs, uint64_t *overNs)
+{
+	uint8_t rate = tx ? (sim_reg(c, ST25R3911_REG_BIT_RATE) >> ST25R3911_REG_BIT_RATE_shift_txrate)
+			  : (sim_reg(c, ST25R3911_REG_BIT_RATE) & ST25R3911_REG_BIT_RATE_mask_rxrate);
+	uint8_t stream = sim_reg(c, ST25R3911_REG_STREAM_MODE);
+	uint32_t bitFc = 128 >> (rate & 7);
+	uint32_t byteFc, overFc;
+
+	switch (sim_om(c)) {
+	case ST25R3911_REG_MODE_om_subcarrier_stream:
+	case ST25R3911_REG_MODE_om_bpsk_stream:
+		if (tx)
+			bitFc = 128 >> (stream & ST25R3911_REG_STREAM_MODE_mask_stx);
+		else
+			bitFc = (1 << ((stream & ST25R3911_REG_STREAM_MODE_mask_scp) >> ST25R3911_REG_STREAM_MODE_shift_scp))
+				* (64 >> ((stream & ST25R3911_REG_STREAM_MODE_mask_scf) >> ST25R3911_REG_STREAM_MODE_shift_scf));
+		byteFc = 8 * bitFc;
+		overFc = 0;
+		break;
+	case ST25R3911_REG_MODE_om_iso14443b:
+		byteFc = 10 * bitFc;
+		overFc = (tx ? 23 : 31) * bitFc;
+		break;
+	case ST25R3911_REG_MODE_om_felica:
+		byteFc = 8 * bitFc;
+		overFc = 64 * bitFc;
+		break;
+	default:
+		byteFc = 9 * bitFc;
+		overFc = 2 * bitFc;
+		break;
+	}
+
+	*byteNs = sim_fc2ns(byteFc);
+	*overNs = sim_fc2ns(overFc);
+}
+
+/* Response of one tag in the FIFO layout, returns its number of bits */
+static uint32_t sim_rx_bits(simChip *c, const pltfSimFrame *res, uint8_t align, uint8_t *out)
+{
+	uint8_t tmp[PLTF_SIM_FRAME_MAX + 3];
+	uint16_t crc, n;
+	uint32_t bits;
+
+	memset(out, 0, SIM_RX_MAX);
+
+	switch (sim_tech(c)) {
+	case PLTF_SIM_TECH_NFCV:
+		n = res->len;
+		memcpy(tmp, res->data, n);
+		if (res->crc) {
+			crc = sim_crc_b(tmp, n);
+			tmp[n++] = (uint8_t)(crc & 0xFF);
+			tmp[n++] = (uint8_t)(crc >> 8);
+		}
+		return (uint32_t)sim_nfcv_vicc_encode(tmp, n, out) * 8;
+
+	case PLTF_SIM_TECH_NFCF:
+		/* LEN counts itself, the CRC covers LEN and payload, MSB first */
+		tmp[0] = (uint8_t)(res->len + 1);
+		memcpy(&tmp[1], res->data, res->len);
+		n = res->len + 1;
+		crc = sim_crc_f(tmp, n);
+		tmp[n++] = (uint8_t)(crc >> 8);
+		tmp[n++] = (uint8_t)(crc & 0xFF);
+		memcpy(out, tmp, n);
+		return (uint32_t)n * 8;
+
+	default:
+		bits = ((uint32_t)res->len * 8) + res->bits;
+		sim_bits_put(out, align, res->data, bits);
+		if (res->crc && (res->bits == 0)) {
+			crc = (sim_tech(c) == PLTF_SIM_TECH_NFCB) ? sim_crc_b(res->data, res->len) : sim_crc_a(res->data, res->len);
+			tmp[0] = (uint8_t)(crc & 0xFF);
+			tmp[1] = (uint8_t)(crc >> 8);
+			sim_bits_put(out, align + bits, tmp, 16);
+			bits += 16;
+		}
+		return align + bits;
+	}
+}
+
+/* Merge the answers overlapping on air into one reception */
+static void sim_rx_build(simChip *c, const pltfSimFrame **res, uint8_t n, uint64_t start)
+{
+	uint8_t (*bufs)[SIM_RX_MAX] = c->airBits;
+	uint32_t bits[SIM_AIR_MAX];
+	uint32_t total = 0, q, i;
+	uint8_t align = 0, txFull;
+	uint16_t crc, len;
+	simRx *rx;
+	uint8_t k;
+
+	if (c->rxCount >= SIM_RX_QUEUE)
+		return;
+
+	/* Anticollision: the answer continues the incomplete byte sent. Short
+	 * frames (REQA, WUPA) are answered byte aligned */
+	txFull = (uint8_t)(c->txTotal - ((c->txBits != 0) ? 1 : 0));
+	if ((sim_tech(c) == PLTF_SIM_TECH_NFCA) && (c->txTotal > 1))
+		align = c->txBits;
+
+	for (k = 0; k < n; k++) {
+		bits[k] = sim_rx_bits(c, res[k], align, bufs[k]);
+		if (bits[k] > total)
+			total = bits[k];
+	}
+
+	rx = &c->rxq[c->rxCount++];
+	memset(rx, 0, offsetof(simRx, data));
+	memset(rx->data, 0, sizeof(rx->data));
+	rx->start = start;
+	sim_air_timing(c, false, &rx->byteNs, &rx->sofNs);
+
+	for (k = 0; k < n; k++) {
+		for (i = 0; i < ((bits[k] + 7) / 8); i++)
+			rx->data[i] |= bufs[k][i];
+	}
+
+	/* NFC-A detects the first bit where the tags disagree */
+	if ((n > 1) && (sim_tech(c) == PLTF_SIM_TECH_NFCA)) {
+		for (q = align; q < total; q++) {
+			for (k = 1; k < n; k++) {
+				if ((q >= bits[k]) || (q >= bits[0]) || (sim_bit(bufs[k], q) != sim_bit(bufs[0], q)))
+					break;
+			}
+			if (k < n)
+				break;
+		}
+		if (q < total) {
+			rx->irqErr |= ST25R3911_IRQ_MASK_COL;
+			rx->colStatus = (uint8_t)((((txFull + (q / 8)) & 0x0F) << ST25R3911_REG_COLLISION_STATUS_shift_c_byte)
+					| ((q % 8) << ST25R3911_REG_COLLISION_STATUS_shift_c_bit));
+
+			/* With anticollision the reception stops at the collision */
+			if (sim_reg(c, ST25R3911_REG_ISO14443A_NFC) & ST25R3911_REG_ISO14443A_NFC_antcl) {
+				total = q;
+				if (q % 8)
+					rx->data[q / 8] &= (uint8_t)((1 << (q % 8)) - 1);
+				memset(&rx->data[(q + 7) / 8], 0, sizeof(rx->data) - ((q + 7) / 8));
+			}
+		}
+	} else if ((n > 1) && !sim_is_stream(c)) {
+		/* In stream mode the host decoder finds the collision in the merged subcarrier */
+		rx->irqErr |= ST25R3911_IRQ_MASK_CRC;
+	}
+
+	len = (uint16_t)((total + 7) / 8);
+	rx->lb = (uint8_t)(total % 8);
+
+	/* Receiver CRC check, the stream mode leaves it to the host */
+	if (!sim_is_stream(c) && !(sim_reg(c, ST25R3911_REG_AUX) & ST25R3911_REG_AUX_no_crc_rx)) {
+		if ((len < 3) || (rx->lb != 0)) {
+			rx->irqErr |= ST25R3911_IRQ_MASK_CRC;
+		} else if (sim_tech(c) == PLTF_SIM_TECH_NFCF) {
+			crc = sim_crc_f(rx->data, len - 2);
+			if ((rx->data[len - 2] != (crc >> 8)) || (rx->data[len - 1] != (crc & 0xFF)))
+				rx->irqErr |= ST25R3911_IRQ_MASK_CRC;
+		} else {
+			crc = (sim_tech(c) == PLTF_SIM_TECH_NFCB) ? sim_crc_b(rx->data, len - 2) : sim_crc_a(rx->data, len - 2);
+			if ((rx->data[len - 2] != (crc & 0xFF)) || (rx->data[len - 1] != (crc >> 8)))
+				rx->irqErr |= ST25R3911_IRQ_MASK_CRC;
+		}
+
+		if ((len >= 2) && (rx->lb == 0) && !(sim_reg(c, ST25R3911_REG_AUX) & ST25R3911_REG_AUX_crc_2_fifo))
+			len -= 2;
+	}
+	rx->len = len;
+}
+
+static int sim_rx_cmp(const void *a, const void *b)
+{
+	const pltfSimFrame *fa = *(const pltfSimFrame * const *)a;
+	const pltfSimFrame *fb = *(const pltfSimFrame * const *)b;
+
+	return (fa->fdt > fb->fdt) - (fa->fdt < fb->fdt);
+}
+
+/* Air time of an answer, framing included */
+static uint64_t sim_rx_air_ns(simChip *c, const pltfSimFrame *res, uint64_t byteNs, uint64_t overNs)
+{
+	uint32_t bytes = res->len + (res->bits ? 1 : 0) + (res->crc ? 2 : 0);
+
+	if (sim_tech(c) == PLTF_SIM_TECH_NFCV)
+		bytes = (2 * bytes) + 2;
+	else if (sim_tech(c) == PLTF_SIM_TECH_NFCF)
+		bytes = res->len + 3;
+
+	return overNs + (bytes * byteNs);
+}
+
+/* Hand the frame just sent to the tags, queue their answers */
+static void sim_air(simChip *c)
+{
+	const pltfSimFrame *res[SIM_AIR_MAX];
+	pltfSimFrame req;
+	pltfSimFrame *r;
+	pltfSimTag *t;
+	uint64_t byteNs, overNs, start, end, s;
+	uint32_t bitFc;
+	uint16_t len;
+	uint8_t stream = sim_reg(c, ST25R3911_REG_STREAM_MODE);
+	uint8_t n = 0, i, g;
+	int tech = sim_tech(c);
+
+	if ((tech < 0) || !c->field)
+		return;
+
+	memset(&req, 0, sizeof(req));
+	if (tech == PLTF_SIM_TECH_NFCV) {
+		if (!sim_nfcv_vcd_decode(c->txBuf, c->txTotal, &req))
+			return;
+	} else {
+		len = c->txTotal - ((c->txBits != 0) ? 1 : 0);
+		if (len > PLTF_SIM_FRAME_MAX)
+			return;
+		memcpy(req.data, c->txBuf, c->txTotal);
+		if (c->txBits)
+			req.data[len] &= (uint8_t)((1 << c->txBits) - 1);
+		req.len = len;
+		req.bits = c->txBits;
+		req.crc = c->txCrc;
+	}
+
+	/* Subcarrier pulses the receiver is set up for, NFC-V answers at another rate are lost */
+	bitFc = (1 << ((stream & ST25R3911_REG_STREAM_MODE_mask_scp) >> ST25R3911_REG_STREAM_MODE_shift_scp))
+		* (64 >> ((stream & ST25R3911_REG_STREAM_MODE_mask_scf) >> ST25R3911_REG_STREAM_MODE_shift_scf));
+
+	for (t = c->tags; (t != NULL) && (n < SIM_AIR_MAX); t = t->next) {
+		if ((int)t->tech != tech)
+			continue;
+
+		r = &c->air[n];
+		r->len = 0;
+		r->bits = 0;
+		r->crc = true;
+		r->fast = false;
+		switch (tech) {
+		case PLTF_SIM_TECH_NFCB: r->fdt = 1024; break;
+		case PLTF_SIM_TECH_NFCF: r->fdt = 512 * 64; break;
+		case PLTF_SIM_TECH_NFCV: r->fdt = 4320; break;
+		default: r->fdt = 1172; break;
+		}
+
+		if (!t->receive(t, &req, r))
+			continue;
+		if ((tech == PLTF_SIM_TECH_NFCV) && (bitFc != (r->fast ? 128U : 256U)))
+			continue;
+		res[n++] = r;
+	}
+	if (n == 0)
+		return;
+
+	qsort(res, n, sizeof(res[0]), sim_rx_cmp);
+
+	/* Answers starting before the previous one ended collide */
+	sim_air_timing(c, false, &byteNs, &overNs);
+	for (i = 0; i < n; i = g) {
+		start = c->now + sim_fc2ns(res[i]->fdt);
+		end = start + sim_rx_air_ns(c, res[i], byteNs, overNs);
+		for (g = i + 1; g < n; g++) {
+			s = c->now + sim_fc2ns(res[g]->fdt);
+			if (s >= end)
+				break;
+			if ((s + sim_rx_air_ns(c, res[g], byteNs, overNs)) > end)
+				end = s + sim_rx_air_ns(c, res[g], byteNs, overNs);
+		}
+		sim_rx_build(c, &res[i], g - i, start);
+	}
+}
+
+/*
+ ******************************************************************************
+ * LOCAL FUNCTIONS - CHIP
+ ******************************************************************************
+ */
+static void sim_fifo_push(simChip *c, uint8_t v)
+{
+	if (c->fifoCnt >= SIM_FIFO_DEPTH) {
+		c->fifoStat2 |= ST25R3911_REG_FIFO_RX_STATUS2_fifo_ovr;
+		return;
+	}
+	c->fifo[(c->fifoRd + c->fifoCnt) % SIM_FIFO_DEPTH] = v;
+	c->fifoCnt++;
+}
+
+static uint8_t sim_fifo_pop(simChip *c)
+{
+	uint8_t v;
+
+	if (c->fifoCnt == 0) {
+		c->fifoStat2 |= ST25R3911_REG_FIFO_RX_STATUS2_fifo_unf;
+		return 0;
+	}
+	v = c->fifo[c->fifoRd];
+	c->fifoRd = (c->fifoRd + 1) % SIM_FIFO_DEPTH;
+	c->fifoCnt--;
+	return v;
+}
+
+static void sim_rx_pop(simChip *c)
+{
+	if (c->rxCount == 0)
+		return;
+	c->rxCount--;
+	memmove(&c->rxq[0], &c->rxq[1], c->rxCount * sizeof(c->rxq[0]));
+}
+
+static void sim_rx_abort(simChip *c)
+{
+	c->rxCount = 0;
+	c->rxOn = false;
+	c->rxNextAt = 0;
+}
+
+static void sim_field(simChip *c, bool on)
+{
+	pltfSimTag *t;
+
+	if (on == c->field)
+		return;
+	c->field = on;
+
+	/* Tags entering the field start from their power-on state */
+	if (on) {
+		for (t = c->tags; t != NULL; t = t->next) {
+			if (t->reset != NULL)
+				t->reset(t);
+		}
+	} else {
+		sim_rx_abort(c);
+	}
+}
+
+static void sim_gpt_start(simChip *c)
+{
+	uint16_t gpt = ((uint16_t)sim_reg(c, ST25R3911_REG_GPT1) << 8) | sim_reg(c, ST25R3911_REG_GPT2);
+
+	c->gptEnd = (gpt != 0) ? c->now + sim_fc2ns((uint32_t)gpt * 8) : 0;
+}
+
+static void sim_mrt_start(simChip *c)
+{
+	uint8_t mrt = sim_reg(c, ST25R3911_REG_MASK_RX_TIMER);
+
+	c->mrtEnd = (mrt != 0) ? c->now + sim_fc2ns((uint32_t)mrt * 64) : 0;
+}
+
+static void sim_nrt_start(simChip *c)
+{
+	uint16_t nrt = ((uint16_t)sim_reg(c, ST25R3911_REG_NO_RESPONSE_TIMER1) << 8) | sim_reg(c, ST25R3911_REG_NO_RESPONSE_TIMER2);
+	uint32_t step = (sim_reg(c, ST25R3911_REG_GPT_CONTROL) & ST25R3911_REG_GPT_CONTROL_nrt_step) ? 4096 : 64;
+
+	c->nrtEnd = (nrt != 0) ? c->now + sim_fc2ns((uint64_t)nrt * step) : 0;
+}
+
+static bool sim_gpt_trigger(simChip *c, uint8_t trigger)
+{
+	return ((sim_reg(c, ST25R3911_REG_GPT_CONTROL) & ST25R3911_REG_GPT_CONTROL_gptc_mask) == trigger);
+}
+
+/* Power-on state, also SET_DEFAULT */
+static void sim_reset(simChip *c)
+{
+	sim_field(c, false);
+
+	memset(c->reg, 0, sizeof(c->reg));
+	memset(c->test, 0, sizeof(c->test));
+	c->reg[ST25R3911_REG_MODE] = ST25R3911_REG_MODE_om_iso14443a;
+
+	c->irq = 0;
+	c->fifoRd = 0;
+	c->fifoCnt = 0;
+	c->fifoStat2 = 0;
+	c->colStatus = 0;
+	c->oscAt = 0;
+	c->oscOk = false;
+	c->dctAt = 0;
+	c->mrtEnd = 0;
+	c->nrtEnd = 0;
+	c->gptEnd = 0;
+	c->txOn = false;
+	c->txNextAt = 0;
+	c->txEndAt = 0;
+	c->rxMasked = false;
+	c->rxLocked = false;
+	sim_rx_abort(c);
+	sim_irq_update(c);
+}
+
+static void sim_tx_start(simChip *c, uint8_t cmd)
+{
+	uint16_t nbits;
+	uint64_t overNs;
+
+	if (c->txOn)
+		return;
+
+	/* A new frame ends the previous exchange */
+	sim_rx_abort(c);
+	c->rxLocked = false;
+	c->mrtEnd = 0;
+	c->nrtEnd = 0;
+
+	c->txSent = 0;
+	c->txBroken = false;
+	c->txCrc = false;
+	sim_air_timing(c, true, &c->txByteNs, &overNs);
+
+	if ((cmd == ST25R3911_CMD_TRANSMIT_REQA) || (cmd == ST25R3911_CMD_TRANSMIT_WUPA)) {
+		/* Short frame, not taken from the FIFO */
+		c->txBuf[0] = (cmd == ST25R3911_CMD_TRANSMIT_REQA) ? 0x26 : 0x52;
+		c->txTotal = 1;
+		c->txBits = 7;
+		c->txSent = 1;
+		c->txNextAt = 0;
+		c->txEndAt = c->now + c->txByteNs + overNs;
+	} else {
+		nbits = ((uint16_t)sim_reg(c, ST25R3911_REG_NUM_TX_BYTES1) << 8) | sim_reg(c, ST25R3911_REG_NUM_TX_BYTES2);
+		c->txTotal = (nbits + 7) / 8;
+		c->txBits = nbits % 8;
+		c->txCrc = ((cmd == ST25R3911_CMD_TRANSMIT_WITH_CRC) && !sim_is_stream(c));
+		if ((c->txTotal == 0) || (c->txTotal > SIM_TX_MAX)) {
+			c->txBroken = (c->txTotal != 0);
+			c->txNextAt = 0;
+			c->txEndAt = c->now + overNs;
+		} else {
+			c->txNextAt = c->now;
+			c->txEndAt = 0;
+		}
+	}
+
+	c->txOn = true;
+	c->stats.txFrames++;
+}
+
+static void sim_tx_byte(simChip *c)
+{
+	uint8_t lt = (sim_reg(c, ST25R3911_REG_IO_CONF1) & ST25R3911_REG_IO_CONF1_fifo_lt) ? 16 : 32;
+	uint64_t overNs, byteNs;
+
+	c->txNextAt = 0;
+
+	/* Underflow, the frame is cut */
+	if (c->fifoCnt == 0) {
+		c->fifoStat2 |= ST25R3911_REG_FIFO_RX_STATUS2_fifo_unf;
+		c->txBroken = true;
+		c->txEndAt = c->now;
+		return;
+	}
+
+	c->txBuf[c->txSent++] = sim_fifo_pop(c);
+
+	if (c->txSent < c->txTotal) {
+		c->txNextAt = c->now + c->txByteNs;
+		if ((c->fifoCnt == lt) && ((c->txSent + c->fifoCnt) < c->txTotal))
+			sim_irq_raise(c, ST25R3911_IRQ_MASK_FWL);
+	} else {
+		sim_air_timing(c, true, &byteNs, &overNs);
+		c->txEndAt = c->now + c->txByteNs + overNs + (c->txCrc ? (2 * c->txByteNs) : 0);
+	}
+}
+
+static void sim_tx_end(simChip *c)
+{
+	c->txOn = false;
+	c->txEndAt = 0;
+	sim_irq_raise(c, ST25R3911_IRQ_MASK_TXE);
+
+	sim_mrt_start(c);
+	sim_nrt_start(c);
+	if (sim_gpt_trigger(c, ST25R3911_REG_GPT_CONTROL_gptc_etx_nfc))
+		sim_gpt_start(c);
+
+	if (!c->txBroken)
+		sim_air(c);
+}
+
+static void sim_rx_start(simChip *c)
+{
+	simRx *rx = &c->rxq[0];
+
+	if (!c->field || !(sim_reg(c, ST25R3911_REG_OP_CONTROL) & ST25R3911_REG_OP_CONTROL_rx_en)
+	    || c->rxMasked || c->rxLocked || sim_running(c, c->mrtEnd)) {
+		sim_rx_pop(c);
+		return;
+	}
+
+	/* The receiver starts on an empty FIFO, bytes left from the previous frame are lost */
+	c->fifoRd = 0;
+	c->fifoCnt = 0;
+	c->rxOn = true;
+	c->rxPos = 0;
+	c->rxNextAt = c->now + rx->sofNs + rx->byteNs;
+	c->fifoStat2 &= ~(ST25R3911_REG_FIFO_RX_STATUS2_mask_fifo_lb | ST25R3911_REG_FIFO_RX_STATUS2_np_lb | ST25R3911_REG_FIFO_RX_STATUS2_fifo_ncp);
+	c->stats.rxFrames++;
+
+	sim_irq_raise(c, ST25R3911_IRQ_MASK_RXS);
+	if (!(sim_reg(c, ST25R3911_REG_GPT_CONTROL) & ST25R3911_REG_GPT_CONTROL_nrt_emv))
+		c->nrtEnd = 0;
+	if (sim_gpt_trigger(c, ST25R3911_REG_GPT_CONTROL_gptc_srx))
+		sim_gpt_start(c);
+}
+
+static void sim_rx_byte(simChip *c)
+{
+	uint8_t lr = (sim_reg(c, ST25R3911_REG_IO_CONF1) & ST25R3911_REG_IO_CONF1_fifo_lr) ? 80 : 64;
+	simRx *rx = &c->rxq[0];
+	uint32_t irq;
+
+	if (c->rxPos < rx->len) {
+		sim_fifo_push(c, rx->data[c->rxPos++]);
+		if (c->fifoCnt == lr)
+			sim_irq_raise(c, ST25R3911_IRQ_MASK_FWL);
+		c->rxNextAt = (c->rxPos < rx->len) ? (c->now + rx->byteNs) : c->now;
+		return;
+	}
+
+	/* End of reception, the receiver stays off until UNMASK_RECEIVE_DATA or the next frame */
+	c->fifoStat2 |= (uint8_t)((rx->lb << ST25R3911_REG_FIFO_RX_STATUS2_shift_fifo_lb) | (rx->np ? ST25R3911_REG_FIFO_RX_STATUS2_np_lb : 0));
+	if (rx->irqErr & ST25R3911_IRQ_MASK_COL)
+		c->colStatus = rx->colStatus;
+	irq = ST25R3911_IRQ_MASK_RXE | rx->irqErr;
+
+	c->rxOn = false;
+	c->rxNextAt = 0;
+	c->rxLocked = true;
+	sim_rx_pop(c);
+
+	sim_irq_raise(c, irq);
+	if (sim_gpt_trigger(c, ST25R3911_REG_GPT_CONTROL_gptc_erx))
+		sim_gpt_start(c);
+}
+
+static void sim_dct_end(simChip *c)
+{
+	c->dctAt = 0;
+
+	switch (c->dctCmd) {
+	case ST25R3911_CMD_INITIAL_RF_COLLISION:
+	case ST25R3911_CMD_RESPONSE_RF_COLLISION_N:
+	case ST25R3911_CMD_RESPONSE_RF_COLLISION_0:
+		/* No external field ever, the own field goes on */
+		c->reg[ST25R3911_REG_OP_CONTROL] |= ST25R3911_REG_OP_CONTROL_tx_en;
+		sim_field(c, true);
+		sim_irq_raise(c, ST25R3911_IRQ_MASK_CAT);
+		return;
+	case ST25R3911_CMD_MEASURE_VDD:
+		c->reg[ST25R3911_REG_AD_RESULT] = SIM_VDD_AD;
+		break;
+	case ST25R3911_CMD_ADJUST_REGULATORS:
+		c->reg[ST25R3911_REG_REGULATOR_RESULT] = (SIM_REG_NIBBLE << ST25R3911_REG_REGULATOR_RESULT_shift_reg);
+		break;
+	case ST25R3911_CMD_CALIBRATE_ANTENNA:
+		c->reg[ST25R3911_REG_ANT_CAL_RESULT] = SIM_MEASURE_AD;
+		break;
+	case ST25R3911_CMD_CALIBRATE_MODULATION:
+		c->reg[ST25R3911_REG_AM_MOD_DEPTH_RESULT] = SIM_MEASURE_AD;
+		break;
+	case ST25R3911_CMD_CALIBRATE_C_SENSOR:
+		c->reg[ST25R3911_REG_CAP_SENSOR_RESULT] = ST25R3911_REG_CAP_SENSOR_RESULT_cs_cal_end;
+		break;
+	default:
+		c->reg[ST25R3911_REG_AD_RESULT] = SIM_MEASURE_AD;
+		break;
+	}
+	sim_irq_raise(c, ST25R3911_IRQ_MASK_DCT);
+}
+
+static void sim_command(simChip *c, uint8_t cmd)
+{
+	switch (cmd) {
+	case ST25R3911_CMD_SET_DEFAULT:
+		sim_reset(c);
+		break;
+
+	case ST25R3911_CMD_CLEAR_FIFO:
+		c->fifoRd = 0;
+		c->fifoCnt = 0;
+		c->fifoStat2 = 0;
+		c->colStatus = 0;
+		c->txOn = false;
+		c->txNextAt = 0;
+		c->txEndAt = 0;
+		if (c->rxOn) {
+			c->rxOn = false;
+			c->rxNextAt = 0;
+			sim_rx_pop(c);
+		}
+		break;
+
+	case ST25R3911_CMD_TRANSMIT_WITH_CRC:
+	case ST25R3911_CMD_TRANSMIT_WITHOUT_CRC:
+	case ST25R3911_CMD_TRANSMIT_REQA:
+	case ST25R3911_CMD_TRANSMIT_WUPA:
+		sim_tx_start(c, cmd);
+		break;
+
+	case ST25R3911_CMD_INITIAL_RF_COLLISION:
+	case ST25R3911_CMD_RESPONSE_RF_COLLISION_N:
+	case ST25R3911_CMD_RESPONSE_RF_COLLISION_0:
+		c->dctCmd = cmd;
+		c->dctAt = c->now + SIM_CA_NS;
+		break;
+
+	case ST25R3911_CMD_MASK_RECEIVE_DATA:
+		c->rxMasked = true;
+		break;
+
+	case ST25R3911_CMD_UNMASK_RECEIVE_DATA:
+		c->rxMasked = false;
+		c->rxLocked = false;
+		break;
+
+	case ST25R3911_CMD_MEASURE_AMPLITUDE:
+	case ST25R3911_CMD_ADJUST_REGULATORS:
+	case ST25R3911_CMD_CALIBRATE_MODULATION:
+	case ST25R3911_CMD_CALIBRATE_ANTENNA:
+	case ST25R3911_CMD_MEASURE_PHASE:
+	case ST25R3911_CMD_CALIBRATE_C_SENSOR:
+	case ST25R3911_CMD_MEASURE_CAPACITANCE:
+	case ST25R3911_CMD_MEASURE_VDD:
+		c->dctCmd = cmd;
+		c->dctAt = c->now + SIM_DCT_NS;
+		break;
+
+	case ST25R3911_CMD_START_GP_TIMER:
+		sim_gpt_start(c);
+		break;
+
+	case ST25R3911_CMD_START_MASK_RECEIVE_TIMER:
+		sim_mrt_start(c);
+		break;
+
+	case ST25R3911_CMD_START_NO_RESPONSE_TIMER:
+		sim_nrt_start(c);
+		break;
+
+	default:
+		/* Squelch, RSSI, presets and test commands have no visible effect */
+		break;
+	}
+}
+
+static uint8_t sim_reg_read(simChip *c, uint8_t reg)
+{
+	uint8_t v, shift;
+
+	switch (reg) {
+	case ST25R3911_REG_IRQ_MAIN:
+	case ST25R3911_REG_IRQ_TIMER_NFC:
+	case ST25R3911_REG_IRQ_ERROR_WUP:
+		/* Cleared on read */
+		shift = (uint8_t)((reg - ST25R3911_REG_IRQ_MAIN) * 8);
+		v = (uint8_t)(c->irq >> shift);
+		c->irq &= ~((uint32_t)0xFF << shift);
+		sim_irq_update(c);
+		return v;
+
+	case ST25R3911_REG_FIFO_RX_STATUS1:
+		return c->fifoCnt;
+
+	case ST25R3911_REG_FIFO_RX_STATUS2:
+		return c->fifoStat2;
+
+	case ST25R3911_REG_COLLISION_STATUS:
+		return c->colStatus;
+
+	case ST25R3911_REG_REGULATOR_RESULT:
+		return (c->reg[reg] & ST25R3911_REG_REGULATOR_RESULT_mask_reg)
+			| (sim_running(c, c->mrtEnd) ? ST25R3911_REG_REGULATOR_RESULT_mrt_on : 0)
+			| (sim_running(c, c->nrtEnd) ? ST25R3911_REG_REGULATOR_RESULT_nrt_on : 0)
+			| (sim_running(c, c->gptEnd) ? ST25R3911_REG_REGULATOR_RESULT_gpt_on : 0);
+
+	case ST25R3911_REG_AUX_DISPLAY:
+		return (sim_running(c, c->mrtEnd) ? ST25R3911_REG_AUX_DISPLAY_mrt_on : 0)
+			| (sim_running(c, c->nrtEnd) ? ST25R3911_REG_AUX_DISPLAY_nrt_on : 0)
+			| (sim_running(c, c->gptEnd) ? ST25R3911_REG_AUX_DISPLAY_gpt_on : 0)
+			| (c->rxOn ? ST25R3911_REG_AUX_DISPLAY_rx_on : 0)
+			| (c->oscOk ? ST25R3911_REG_AUX_DISPLAY_osc_ok : 0)
+			| (c->field ? ST25R3911_REG_AUX_DISPLAY_tx_on : 0);
+
+	case ST25R3911_REG_IC_IDENTITY:
+		return ST25R3911_REG_IC_IDENTITY_v2;
+
+	default:
+		return c->reg[reg];
+	}
+}
+
+static void sim_reg_write(simChip *c, uint8_t reg, uint8_t v)
+{
+	uint8_t old = c->reg[reg];
+
+	if (SIM_REG_RO & SIM_REG_BIT(reg))
+		return;
+	c->reg[reg] = v;
+
+	switch (reg) {
+	case ST25R3911_REG_OP_CONTROL:
+		if ((v & ST25R3911_REG_OP_CONTROL_en) && !(old & ST25R3911_REG_OP_CONTROL_en)) {
+			c->oscAt = c->now + SIM_OSC_NS;
+		} else if (!(v & ST25R3911_REG_OP_CONTROL_en)) {
+			c->oscAt = 0;
+			c->oscOk = false;
+		}
+		sim_field(c, (v & ST25R3911_REG_OP_CONTROL_tx_en) != 0);
+		break;
+
+	case ST25R3911_REG_IRQ_MASK_MAIN:
+	case ST25R3911_REG_IRQ_MASK_TIMER_NFC:
+	case ST25R3911_REG_IRQ_MASK_ERROR_WUP:
+		sim_irq_update(c);
+		break;
+
+	default:
+		break;
+	}
+}
+
+/* Handle every event due at the current time, one of each source */
+static void sim_process(simChip *c)
+{
+	uint64_t now = c->now;
+
+	if (c->replay != NULL) {
+		if (!c->lineHigh && (sim_replay_next(c) <= now)) {
+			c->lineHigh = true;
+			c->irqStamp = now;
+		}
+		return;
+	}
+
+	if ((c->oscAt != 0) && (c->oscAt <= now)) {
+		c->oscAt = 0;
+		c->oscOk = true;
+		sim_irq_raise(c, ST25R3911_IRQ_MASK_OSC);
+	}
+	if ((c->dctAt != 0) && (c->dctAt <= now))
+		sim_dct_end(c);
+	if ((c->txNextAt != 0) && (c->txNextAt <= now))
+		sim_tx_byte(c);
+	if ((c->txEndAt != 0) && (c->txEndAt <= now))
+		sim_tx_end(c);
+	if ((c->mrtEnd != 0) && (c->mrtEnd <= now))
+		c->mrtEnd = 0;
+	if ((c->nrtEnd != 0) && (c->nrtEnd <= now)) {
+		c->nrtEnd = 0;
+		sim_irq_raise(c, ST25R3911_IRQ_MASK_NRE);
+	}
+	if ((c->gptEnd != 0) && (c->gptEnd <= now)) {
+		c->gptEnd = 0;
+		sim_irq_raise(c, ST25R3911_IRQ_MASK_GPE);
+	}
+	if (c->rxOn) {
+		if (c->rxNextAt <= now)
+			sim_rx_byte(c);
+	} else if ((c->rxCount != 0) && (c->rxq[0].start <= now)) {
+		sim_rx_start(c);
+	}
+}
+
+static uint64_t sim_real_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ((uint64_t)ts.tv_sec * 1000000000ULL) + (uint64_t)ts.tv_nsec;
+}
+
+/*
+ ******************************************************************************
+ * GLOBAL AND HELPER FUNCTIONS
+ ******************************************************************************
+ */
+simChip *sim_chip(void)
+{
+	return &simChips[pltf_reader_current()];
+}
+
+uint16_t sim_crc16(uint16_t crc, bool reflected, const uint8_t *data, uint16_t len)
+{
+	uint16_t i;
+	uint8_t k;
+
+	for (i = 0; i < len; i++) {
+		if (reflected) {
+			crc ^= data[i];
+			for (k = 0; k < 8; k++)
+				crc = (crc & 1) ? ((crc >> 1) ^ 0x8408) : (crc >> 1);
+		} else {
+			crc ^= ((uint16_t)data[i] << 8);
+			for (k = 0; k < 8; k++)
+				crc = (crc & 0x8000) ? ((crc << 1) ^ 0x1021) : (crc << 1);
+		}
+	}
+	return crc;
+}
+
+uint16_t sim_crc_a(const uint8_t *data, uint16_t len)
+{
+	return sim_crc16(0x6363, true, data, len);
+}
+
+uint16_t sim_crc_b(const uint8_t *data, uint16_t len)
+{
+	return (uint16_t)~sim_crc16(0xFFFF, true, data, len);
+}
+
+uint16_t sim_crc_f(const uint8_t *data, uint16_t len)
+{
+	return sim_crc16(0x0000, false, data, len);
+}
+
+void sim_spi_frame(simChip *c, const uint8_t *tx, uint8_t *rx, uint16_t len)
+{
+	uint8_t b0 = (tx != NULL) ? tx[0] : 0;
+	uint8_t reg, v;
+	uint16_t i;
+
+	if (len == 0)
+		return;
+
+	c->stats.spiFrames++;
+	c->stats.spiBytes += len;
+	if (rx != NULL)
+		rx[0] = 0;
+
+	switch (b0 & SIM_SPI_MODE_MASK) {
+	case SIM_SPI_WRITE:
+		reg = b0 & (SIM_REGS - 1);
+		for (i = 1; (i < len) && (reg < SIM_REGS); i++, reg++)
+			sim_reg_write(c, reg, (tx != NULL) ? tx[i] : 0);
+		break;
+
+	case SIM_SPI_READ:
+		reg = b0 & (SIM_REGS - 1);
+		for (i = 1; i < len; i++, reg++) {
+			v = (reg < SIM_REGS) ? sim_reg_read(c, reg) : 0;
+			if (rx != NULL)
+				rx[i] = v;
+		}
+		break;
+
+	case SIM_SPI_FIFO:
+		if (b0 == SIM_SPI_FIFO_READ) {
+			for (i = 1; i < len; i++) {
+				v = sim_fifo_pop(c);
+				if (rx != NULL)
+					rx[i] = v;
+			}
+		} else if (b0 == SIM_SPI_FIFO) {
+			for (i = 1; i < len; i++)
+				sim_fifo_push(c, (tx != NULL) ? tx[i] : 0);
+		}
+		break;
+
+	default:
+		/* Direct commands, several may follow each other in one frame */
+		for (i = 0; i < len; i++) {
+			v = (tx != NULL) ? tx[i] : 0;
+			if (v == ST25R3911_CMD_TEST_ACCESS) {
+				if ((i + 2) < len) {
+					reg = tx[i + 1] & (SIM_REGS - 1);
+					if (tx[i + 1] & SIM_SPI_READ) {
+						if (rx != NULL)
+							rx[i + 2] = c->test[reg];
+					} else {
+						c->test[reg] = tx[i + 2];
+					}
+				}
+				break;
+			}
+			if ((v & SIM_SPI_MODE_MASK) == SIM_SPI_CMD)
+				sim_command(c, v);
+		}
+		break;
+	}
+}
+
+uint64_t sim_next_event(simChip *c)
+{
+	uint64_t t[] = { c->oscAt, c->dctAt, c->txNextAt, c->txEndAt, c->mrtEnd, c->nrtEnd, c->gptEnd,
+			 c->rxOn ? c->rxNextAt : ((c->rxCount != 0) ? c->rxq[0].start : 0) };
+	uint64_t next = SIM_NONE;
+	uint8_t i;
+
+	/* Replaying, the only event is the next ISR run of the trace */
+	if (c->replay != NULL)
+		return (c->lineHigh ? SIM_NONE : sim_replay_next(c));
+
+	for (i = 0; i < (sizeof(t) / sizeof(t[0])); i++) {
+		if ((t[i] != 0) && (t[i] < next))
+			next = t[i];
+	}
+	return next;
+}
+
+void sim_advance(simChip *c, uint64_t t)
+{
+	uint64_t ev;
+
+	while ((ev = sim_next_event(c)) <= t) {
+		if (ev > c->now)
+			c->now = ev;
+		sim_process(c);
+		sim_service(c);
+	}
+	if (t > c->now)
+		c->now = t;
+}
+
+bool sim_irq_line(simChip *c)
+{
+	return c->lineHigh;
+}
+
+void sim_isr(simChip *c)
+{
+	c->inIsr = true;
+	if (c->replay != NULL)
+		sim_replay_isr(c);
+#ifdef PLATFORM_TRACE
+	pltf_trace_isr_begin();
+#endif /* PLATFORM_TRACE */
+	st25r3911Isr();
+#ifdef PLATFORM_TRACE
+	pltf_trace_isr_end();
+#endif /* PLATFORM_TRACE */
+	c->inIsr = false;
+
+	/* Replaying, the line drops with the run; the next one is due when its time comes */
+	if (c->replay != NULL)
+		c->lineHigh = false;
+
+	c->irqSeq++;
+	c->stats.irqs++;
+}
+
+bool sim_service(simChip *c)
+{
+	if (c->inIsr || (c->depth > 0) || !c->irqReady || c->polled || !c->lineHigh)
+		return false;
+
+	sim_isr(c);
+	return true;
+}
+
+void sim_rt_sync(simChip *c)
+{
+	uint64_t t = sim_real_ns() - c->rtBase;
+
+	if (t > c->now)
+		sim_advance(c, t);
+}
+
+void sim_rt_arm(simChip *c)
+{
+	struct itimerspec its;
+	uint64_t ev;
+	int flags = 0;
+
+	if (c->fdIrq < 0)
+		return;
+
+	memset(&its, 0, sizeof(its));
+	if (c->lineHigh) {
+		its.it_value.tv_nsec = 1;
+	} else if ((ev = sim_next_event(c)) != SIM_NONE) {
+		ev += c->rtBase;
+		its.it_value.tv_sec = (time_t)(ev / 1000000000ULL);
+		its.it_value.tv_nsec = (long)(ev % 1000000000ULL);
+		flags = TFD_TIMER_ABSTIME;
+	}
+	timerfd_settime(c->fdIrq, flags, &its, NULL);
+}
+
+ReturnCode pltf_sim_tag_attach(pltfSimTag *tag)
+{
+	simChip *c = sim_chip();
+	pltfSimTag **pp;
+
+	if ((tag == NULL) || (tag->receive == NULL))
+		return ERR_PARAM;
+
+	pthread_mutex_lock(&c->lock);
+	for (pp = &c->tags; *pp != NULL; pp = &(*pp)->next) {
+		if (*pp == tag) {
+			pthread_mutex_unlock(&c->lock);
+			return ERR_PARAM;
+		}
+	}
+	tag->next = NULL;
+	*pp = tag;
+
+	/* Moved into a field already on */
+	if (c->field && (tag->reset != NULL))
+		tag->reset(tag);
+	pthread_mutex_unlock(&c->lock);
+
+	return ERR_NONE;
+}
+
+void pltf_sim_tag_detach(pltfSimTag *tag)
+{
+	simChip *c = sim_chip();
+	pltfSimTag **pp;
+
+	pthread_mutex_lock(&c->lock);
+	for (pp = &c->tags; *pp != NULL; pp = &(*pp)->next) {
+		if (*pp == tag) {
+			*pp = tag->next;
+			tag->next = NULL;
+			break;
+		}
+	}
+	pthread_mutex_unlock(&c->lock);
+}
+
+uint64_t pltf_sim_time_ns(void)
+{
+	return sim_chip()->now;
+}
+
+void pltf_sim_get_stats(pltfSimStats *stats)
+{
+	simChip *c = sim_chip();
+
+	pthread_mutex_lock(&c->lock);
+	*stats = c->stats;
+	pthread_mutex_unlock(&c->lock);
+}
+
+void pltf_sim_reset_stats(void)
+{
+	simChip *c = sim_chip();
+
+	pthread_mutex_lock(&c->lock);
+	memset(&c->stats, 0, sizeof(c->stats));
+	pthread_mutex_unlock(&c->lock);
+}
+
+uint64_t pltf_sim_clock_ns(void)
+{
+	simChip *c = sim_chip();
+	uint64_t t;
+
+	pthread_mutex_lock(&c->lock);
+	if (c->polled) {
+		sim_rt_sync(c);
+		sim_rt_arm(c);
+	} else if (!c->inIsr) {
+		sim_advance(c, c->now + PLTF_SIM_POLL_NS);
+		sim_service(c);
+	}
+	t = c->now;
+	pthread_mutex_unlock(&c->lock);
+
+	return t;
+}
+
+void pltf_sim_delay_us(uint32_t us)
+{
+	simChip *c = sim_chip();
+	struct timespec ts;
+
+	if (c->polled) {
+		ts.tv_sec = us / 1000000;
+		ts.tv_nsec = (us % 1000000) * 1000;
+		nanosleep(&ts, NULL);
+
+		pthread_mutex_lock(&c->lock);
+		sim_rt_sync(c);
+		sim_rt_arm(c);
+		pthread_mutex_unlock(&c->lock);
+		return;
+	}
+
+	pthread_mutex_lock(&c->lock);
+	sim_advance(c, c->now + ((uint64_t)us * 1000));
+	sim_service(c);
+	pthread_mutex_unlock(&c->lock);
+}
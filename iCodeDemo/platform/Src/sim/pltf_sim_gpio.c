@@ -0,0 +1,266 @@
+
+/******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; COPYRIGHT 2018 STMicroelectronics</center></h2>
+  *
+  * Licensed under ST MYLIBERTY SOFTWARE LICENSE AGREEMENT (the "License");
+  * You may not use this file except in compliance with the License.
+  * You may obtain a copy of the License at:
+  *
+  *        http://www.st.com/myliberty
+  *
+  * Unless required by applicable law or agreed to in writing, software 
+  * distributed under the License is distributed on an "AS IS" BASIS, 
+  * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied,
+  * AND SPECIFICALLY DISCLAIMING THE IMPLIED WARRANTIES OF MERCHANTABILITY,
+  * FITNESS FOR A PARTICULAR PURPOSE, AND NON-INFRINGEMENT.
+  * See the License for the specific language governing permissions and
+  * limitations under the License.
+  *
+******************************************************************************/
+/*! \file pltf_sim_gpio.c
+ *
+ *  \brief GPIO and interrupt functions of the simulated ST25R3911.
+ *  
+ *  The interrupt line is the one of the model. There is no interrupt
+ *  thread: the ISR is run by the thread moving the clock of the reader on,
+ *  or by interrupt_dispatch() for readers served by an event loop.
+ *  
+ */
+
+/*
+ ******************************************************************************
+ * INCLUDES
+ ******************************************************************************
+ */
+#include <stdio.h>
+#include <string.h>
+#include <poll.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/timerfd.h>
+#include "platform.h"
+#include "pltf_gpio.h"
+#include "pltf_sim_int.h"
+
+/*
+ ******************************************************************************
+ * STATIC VARIABLES
+ ******************************************************************************
+ */
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static GPIO_BackendType gpioBackend = GPIO_BACKEND_AUTO;
+static uint64_t outLines;		/* Levels of the output lines (LEDs) */
+static uint64_t outUsed;		/* Lines driven as outputs */
+
+/*
+ ******************************************************************************
+ * LOCAL FUNCTIONS
+ ******************************************************************************
+ */
+/* Wait of a polled reader, the clock follows the real time */
+static bool gpio_irq_poll(simChip *c, uint32_t seq, uint32_t timeout_us)
+{
+	struct timespec ts;
+	uint64_t deadline, wake;
+
+	deadline = c->now + ((uint64_t)timeout_us * 1000);
+	while (true) {
+		sim_rt_sync(c);
+		if (c->lineHigh)
+			sim_isr(c);
+		if ((c->irqSeq != seq) || (c->now >= deadline))
+			break;
+
+		wake = sim_next_event(c);
+		if (wake > deadline)
+			wake = deadline;
+		wake += c->rtBase;
+		ts.tv_sec = (time_t)(wake / 1000000000ULL);
+		ts.tv_nsec = (long)(wake % 1000000000ULL);
+
+		pthread_mutex_unlock(&c->lock);
+		clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL);
+		pthread_mutex_lock(&c->lock);
+	}
+	sim_rt_arm(c);
+
+	return (c->irqSeq != seq);
+}
+
+/*
+ ******************************************************************************
+ * GLOBAL AND HELPER FUNCTIONS
+ ******************************************************************************
+ */
+ReturnCode gpio_init(void)
+{
+	return ERR_NONE;
+}
+
+ReturnCode gpio_select_backend(GPIO_BackendType backend)
+{
+	gpioBackend = backend;
+	return ERR_NONE;
+}
+
+GPIO_BackendType gpio_get_backend(void)
+{
+	return gpioBackend;
+}
+
+/* Virtual time the line rose, real time for polled readers */
+uint64_t gpio_get_irq_timestamp(void)
+{
+	simChip *c = sim_chip();
+
+	return c->irqStamp + (c->polled ? c->rtBase : 0);
+}
+
+GPIO_PinState gpio_readpin(int port, int pin_no)
+{
+	simChip *c;
+	bool high;
+
+	/* Output lines read back their own value, anything else the interrupt line */
+	if ((pin_no >= 0) && (pin_no < 64) && (__atomic_load_n(&outUsed, __ATOMIC_RELAXED) & ((uint64_t)1 << pin_no)))
+		return ((__atomic_load_n(&outLines, __ATOMIC_RELAXED) >> pin_no) & 1) ? GPIO_PIN_SET : GPIO_PIN_RESET;
+
+	c = sim_chip();
+	if ((c->replay != NULL) && c->inIsr)
+		high = sim_replay_line(c);
+	else
+		high = sim_irq_line(c);
+#ifdef PLATFORM_TRACE
+	pltf_trace_line(high);
+#endif /* PLATFORM_TRACE */
+
+	return (high ? GPIO_PIN_SET : GPIO_PIN_RESET);
+}
+
+ReturnCode interrupt_init(void)
+{
+	simChip *c = sim_chip();
+
+	pthread_mutex_lock(&c->lock);
+	c->irqReady = true;
+	sim_service(c);
+	pthread_mutex_unlock(&c->lock);
+
+	return ERR_NONE;
+}
+
+ReturnCode interrupt_init_polled(int *fd, short *events)
+{
+	simChip *c = sim_chip();
+	struct timespec ts;
+
+	pthread_mutex_lock(&c->lock);
+	if (c->fdIrq < 0) {
+		c->fdIrq = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+		if (c->fdIrq < 0) {
+			printf("Error: creating the interrupt fd of the simulated reader\n");
+			pthread_mutex_unlock(&c->lock);
+			return ERR_IO;
+		}
+	}
+
+	/* From now on the virtual clock runs with the real one */
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	c->rtBase = ((uint64_t)ts.tv_sec * 1000000000ULL) + (uint64_t)ts.tv_nsec - c->now;
+	c->polled = true;
+	c->irqReady = true;
+	sim_rt_arm(c);
+	pthread_mutex_unlock(&c->lock);
+
+	if (fd != NULL)
+		*fd = c->fdIrq;
+	if (events != NULL)
+		*events = POLLIN;
+
+	return ERR_NONE;
+}
+
+void interrupt_dispatch(void)
+{
+	simChip *c = sim_chip();
+	uint64_t expired;
+
+	pthread_mutex_lock(&c->lock);
+	if (read(c->fdIrq, &expired, sizeof(expired)) < 0)
+		expired = 0;
+
+	sim_rt_sync(c);
+	if (c->lineHigh)
+		sim_isr(c);
+	sim_rt_arm(c);
+	pthread_mutex_unlock(&c->lock);
+}
+
+void gpio_set(int port, int pin_no)
+{
+	if ((pin_no < 0) || (pin_no >= 64))
+		return;
+	__atomic_or_fetch(&outUsed, (uint64_t)1 << pin_no, __ATOMIC_RELAXED);
+	__atomic_or_fetch(&outLines, (uint64_t)1 << pin_no, __ATOMIC_RELAXED);
+}
+
+void gpio_clear(int port, int pin_no)
+{
+	if ((pin_no < 0) || (pin_no >= 64))
+		return;
+	__atomic_or_fetch(&outUsed, (uint64_t)1 << pin_no, __ATOMIC_RELAXED);
+	__atomic_and_fetch(&outLines, ~((uint64_t)1 << pin_no), __ATOMIC_RELAXED);
+}
+
+void pltf_protect_interrupt_status(void)
+{
+	pthread_mutex_lock(&lock);
+}
+
+void pltf_unprotect_interrupt_status(void)
+{
+	pthread_mutex_unlock(&lock);
+}
+
+uint32_t pltf_irq_sequence(void)
+{
+	return sim_chip()->irqSeq;
+}
+
+/* Moves the clock on to the next event of the chip until the ISR ran or the timeout elapsed */
+bool pltf_irq_wait(uint32_t seq, uint32_t timeout_us)
+{
+	simChip *c = sim_chip();
+	uint64_t deadline, ev;
+	bool ret;
+
+	pthread_mutex_lock(&c->lock);
+	if (c->polled) {
+		ret = gpio_irq_poll(c, seq, timeout_us);
+		pthread_mutex_unlock(&c->lock);
+		return ret;
+	}
+
+	deadline = c->now + ((uint64_t)timeout_us * 1000);
+	sim_service(c);
+	while (c->irqSeq == seq) {
+		ev = sim_next_event(c);
+		if (ev > deadline) {
+			sim_advance(c, deadline);
+			break;
+		}
+		sim_advance(c, ev);
+	}
+	ret = (c->irqSeq != seq);
+	pthread_mutex_unlock(&c->lock);
+
+	return ret;
+}
+
+void pltf_irq_set_spin(uint32_t spin_us)
+{
+	/* Nothing to spin on, the clock is virtual */
+	(void)spin_us;
+}
@@ -0,0 +1,220 @@
+
+/******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; COPYRIGHT 2018 STMicroelectronics</center></h2>
+  *
+  * Licensed under ST MYLIBERTY SOFTWARE LICENSE AGREEMENT (the "License");
+  * You may not use this file except in compliance with the License.
+  * You may obtain a copy of the License at:
+  *
+  *        http://www.st.com/myliberty
+  *
+  * Unless required by applicable law or agreed to in writing, software 
+  * distributed under the License is distributed on an "AS IS" BASIS, 
+  * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied,
+  * AND SPECIFICALLY DISCLAIMING THE IMPLIED WARRANTIES OF MERCHANTABILITY,
+  * FITNESS FOR A PARTICULAR PURPOSE, AND NON-INFRINGEMENT.
+  * See the License for the specific language governing permissions and
+  * limitations under the License.
+  *
+******************************************************************************/
+
+/*! \file pltf_sim_int.h
+ *
+ *  \brief Internals shared by the files of the simulated ST25R3911
+ *
+ */
+
+#ifndef PLATFORMSIMINT_H
+#define PLATFORMSIMINT_H
+
+/*
+ ******************************************************************************
+ * INCLUDES
+ ******************************************************************************
+ */
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include "pltf_sim.h"
+#include "pltf_reader.h"
+#include "pltf_trace.h"
+
+/*
+ ******************************************************************************
+ * GLOBAL DEFINES
+ ******************************************************************************
+ */
+#define SIM_REGS		0x40		/* Register (and test register) space */
+#define SIM_FIFO_DEPTH		96		/* ST25R3911 FIFO, bytes */
+#define SIM_TX_MAX		8192		/* Max frame sent, FIFO bytes (NUM_TX_BYTES range) */
+#define SIM_RX_MAX		(2 * PLTF_SIM_FRAME_MAX + 8)	/* Max frame received, FIFO bytes (NFC-V stream) */
+#define SIM_RX_QUEUE		16		/* Answers pending on air, FeliCa slots */
+#define SIM_AIR_MAX		64		/* Tags answering one frame, the others stay silent */
+
+#define SIM_NONE		UINT64_MAX	/* No event pending; event times of the chip are 0 when idle */
+
+/* Outcome of sim_nfca_receive() */
+#define SIM_NFCA_SILENT		0		/* No answer */
+#define SIM_NFCA_ANSWER		1		/* Answered by the NFC-A layer */
+#define SIM_NFCA_PASS		2		/* Selected tag, the frame is for the upper layer */
+
+/* Clock conversions, carrier 13.56 MHz */
+#define sim_fc2ns(fc)		(((uint64_t)(fc) * 25000) / 339)
+
+/*
+ ******************************************************************************
+ * GLOBAL TYPES
+ ******************************************************************************
+ */
+/* Frame received from the tags, as it goes into the FIFO */
+typedef struct {
+	uint64_t	start;		/* Start of the answer on air (ns) */
+	uint64_t	byteNs;		/* Time per FIFO byte */
+	uint64_t	sofNs;		/* Time from the start to the first byte */
+	uint16_t	len;		/* FIFO bytes, the last one possibly incomplete */
+	uint8_t		lb;		/* Bits of the last byte, 0 if complete */
+	bool		np;		/* Last byte without parity */
+	uint32_t	irqErr;		/* Error IRQs raised on RXE (CRC, COL) */
+	uint8_t		colStatus;	/* COLLISION_STATUS on a collision */
+	uint8_t		data[SIM_RX_MAX];
+}simRx;
+
+/* Trace replayed in place of the model */
+typedef struct {
+	pltfTraceLog	log;
+	uint32_t	*main;		/* Records of the worker, indexes into log.recs */
+	uint32_t	*isr;		/* Records of the ISR */
+	uint32_t	mainCnt;
+	uint32_t	isrCnt;
+	uint32_t	mainPos;	/* Next record of each */
+	uint32_t	isrPos;
+	uint64_t	base;		/* Virtual minus recorded time, modulo 2^64 */
+	bool		reported;	/* First divergence printed */
+	pltfSimReplayResult res;
+}simReplay;
+
+/* Model of one ST25R3911 */
+typedef struct {
+	/* Host side */
+	pthread_mutex_t	lock;		/* Communication protection, recursive */
+	int		depth;		/* Nesting of pltf_protect_com() */
+	bool		inIsr;		/* ISR running, no nested dispatch */
+	bool		irqReady;	/* interrupt_init*() done, the ISR may run */
+	bool		polled;		/* Interrupt fd for an event loop, real time */
+	int		fdIrq;		/* Polled: timerfd signalling the IRQ line */
+	uint64_t	rtBase;		/* Polled: real minus virtual time (ns) */
+	volatile uint32_t irqSeq;	/* Number of ISR runs */
+	uint64_t	irqStamp;	/* Time the line last rose (ns) */
+	bool		lineHigh;
+	pltfSimStats	stats;
+
+	/* Chip */
+	uint64_t	now;		/* Virtual time (ns) */
+	uint8_t		reg[SIM_REGS];
+	uint8_t		test[SIM_REGS];
+	uint32_t	irq;		/* Latched IRQs, IRQ_MAIN in the LSB */
+	uint8_t		fifo[SIM_FIFO_DEPTH];
+	uint8_t		fifoRd;
+	uint8_t		fifoCnt;
+	uint8_t		fifoStat2;	/* lb, np, ovr, unf as in FIFO_RX_STATUS2 */
+	uint8_t		colStatus;
+
+	uint64_t	oscAt;		/* Oscillator stable */
+	bool		oscOk;
+	uint64_t	dctAt;		/* Direct command with result terminates */
+	uint8_t		dctCmd;
+	uint64_t	mrtEnd;
+	uint64_t	nrtEnd;
+	uint64_t	gptEnd;
+	bool		field;
+
+	/* Transmission */
+	bool		txOn;
+	uint16_t	txTotal;	/* Bytes to send */
+	uint8_t		txBits;		/* Bits of the last byte, 0 if complete */
+	uint16_t	txSent;		/* Bytes taken from the FIFO */
+	uint64_t	txByteNs;
+	uint64_t	txNextAt;	/* Next byte taken from the FIFO */
+	uint64_t	txEndAt;	/* TXE */
+	bool		txCrc;
+	bool		txBroken;	/* FIFO underflow, nobody understands the frame */
+	uint8_t		txBuf[SIM_TX_MAX];
+
+	/* Reception */
+	bool		rxMasked;	/* MASK_RECEIVE_DATA */
+	bool		rxLocked;	/* A frame has been received, until UNMASK or the next Tx */
+	bool		rxOn;		/* Frame being received */
+	uint16_t	rxPos;		/* Bytes of rxq[0] put into the FIFO */
+	uint64_t	rxNextAt;	/* Next byte, or RXE once all are in */
+	uint8_t		rxCount;
+	simRx		rxq[SIM_RX_QUEUE];
+	pltfSimFrame	air[SIM_AIR_MAX];	/* Answers of the tags to the last frame */
+	uint8_t		airBits[SIM_AIR_MAX][SIM_RX_MAX];	/* The answers in the FIFO layout */
+
+	pltfSimTag	*tags;
+	bool		envApplied;	/* PLTF_SIM_REPLAY or PLTF_SIM_TAGS applied */
+	simReplay	*replay;	/* Trace replayed, NULL when running the model */
+}simChip;
+
+/*
+ ******************************************************************************
+ * GLOBAL FUNCTION PROTOTYPES
+ ******************************************************************************
+ */
+/* Chip of the reader bound to the calling thread */
+simChip *sim_chip(void);
+
+/* One CS framed SPI frame, tx may be NULL (zeros), rx may be NULL */
+void sim_spi_frame(simChip *c, const uint8_t *tx, uint8_t *rx, uint16_t len);
+
+/* Move the clock on to t, handling the events due and running the ISR */
+void sim_advance(simChip *c, uint64_t t);
+
+/* Time of the next event of the chip, SIM_NONE if none */
+uint64_t sim_next_event(simChip *c);
+
+/* Level of the IRQ line */
+bool sim_irq_line(simChip *c);
+
+/* Run the ISR if the line is high and nothing prevents it, true if it ran */
+bool sim_service(simChip *c);
+
+/* Run the ISR unconditionally */
+void sim_isr(simChip *c);
+
+/* Polled reader: follow the real time, signal the line on the fd */
+void sim_rt_sync(simChip *c);
+void sim_rt_arm(simChip *c);
+
+/* Codecs */
+uint16_t sim_crc16(uint16_t crc, bool reflected, const uint8_t *data, uint16_t len);
+uint16_t sim_crc_a(const uint8_t *data, uint16_t len);
+uint16_t sim_crc_b(const uint8_t *data, uint16_t len);
+uint16_t sim_crc_f(const uint8_t *data, uint16_t len);
+
+/* Built-in tags from PLTF_SIM_TAGS */
+void sim_tags_env(void);
+
+/* NFC-A layer of the built-in tags: REQA/WUPA, anticollision, SELECT, HLTA */
+void sim_nfca_reset(pltfSimNfca *a);
+int sim_nfca_receive(pltfSimNfca *a, const pltfSimFrame *req, pltfSimFrame *res);
+
+/* Replay: an SPI segment of the driver, the line level read by the ISR,
+ * time of the next ISR run (SIM_NONE if not due yet), start of an ISR run */
+void sim_replay_spi(simChip *c, const uint8_t *tx, uint8_t *rx, uint16_t len, bool hold);
+bool sim_replay_line(simChip *c);
+uint64_t sim_replay_next(simChip *c);
+void sim_replay_isr(simChip *c);
+
+/* Replay named by PLTF_SIM_REPLAY, true if started */
+bool sim_replay_env(void);
+
+/* Bit of a buffer, LSB first */
+static inline bool sim_bit(const uint8_t *buf, uint32_t pos)
+{
+	return ((buf[pos / 8] >> (pos % 8)) & 1);
+}
+
+#endif /* PLATFORMSIMINT_H */
@@ -0,0 +1,433 @@
+
+/******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; COPYRIGHT 2018 STMicroelectronics</center></h2>
+  *
+  * Licensed under ST MYLIBERTY SOFTWARE LICENSE AGREEMENT (the "License");
+  * You may not use this file except in compliance with the License.
+  * You may obtain a copy of the License at:
+  *
+  *        http://www.st.com/myliberty
+  *
+  * Unless required by applicable law or agreed to in writing, software 
+  * distributed under the License is distributed on an "AS IS" BASIS, 
+  * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied,
+  * AND SPECIFICALLY DISCLAIMING THE IMPLIED WARRANTIES OF MERCHANTABILITY,
+  * FITNESS FOR A PARTICULAR PURPOSE, AND NON-INFRINGEMENT.
+  * See the License for the specific language governing permissions and
+  * limitations under the License.
+  *
+******************************************************************************/
+/*! \file pltf_sim_nfcv.c
+ *
+ *  \brief Built-in ISO15693 tag of the simulated ST25R3911, modelled on
+ *         the ICODE SLIX.
+ *  
+ */
+
+/*
+ ******************************************************************************
+ * INCLUDES
+ ******************************************************************************
+ */
+#include <string.h>
+#include "pltf_sim_int.h"
+
+/*
+ ******************************************************************************
+ * DEFINES
+ ******************************************************************************
+ */
+/* States */
+#define SIM_NFCV_READY		1
+#define SIM_NFCV_QUIET		2
+#define SIM_NFCV_SELECTED	3
+
+/* Request flags */
+#define SIM_NFCV_FLAG_INVENTORY	0x04
+#define SIM_NFCV_FLAG_SELECT	0x10	/* Inventory: AFI */
+#define SIM_NFCV_FLAG_ADDRESS	0x20	/* Inventory: one slot */
+#define SIM_NFCV_FLAG_OPTION	0x40
+
+#define SIM_NFCV_RES_ERROR	0x01
+
+/* Commands */
+#define SIM_NFCV_INVENTORY		0x01
+#define SIM_NFCV_STAY_QUIET		0x02
+#define SIM_NFCV_READ_SINGLE		0x20
+#define SIM_NFCV_WRITE_SINGLE		0x21
+#define SIM_NFCV_LOCK_BLOCK		0x22
+#define SIM_NFCV_READ_MULTIPLE		0x23
+#define SIM_NFCV_WRITE_MULTIPLE		0x24
+#define SIM_NFCV_SELECT			0x25
+#define SIM_NFCV_RESET_TO_READY		0x26
+#define SIM_NFCV_WRITE_AFI		0x27
+#define SIM_NFCV_LOCK_AFI		0x28
+#define SIM_NFCV_WRITE_DSFID		0x29
+#define SIM_NFCV_LOCK_DSFID		0x2A
+#define SIM_NFCV_GET_SYSTEM_INFO	0x2B
+#define SIM_NFCV_GET_SECURITY		0x2C
+#define SIM_NFCV_INVENTORY_READ		0xA0	/* NXP custom commands */
+#define SIM_NFCV_FAST_INVENTORY_READ	0xA1
+#define SIM_NFCV_FAST_READ_MULTIPLE	0xC3
+#define SIM_NFCV_CUSTOM_FIRST		0xA0
+#define SIM_NFCV_CUSTOM_LAST		0xDF
+
+#define SIM_NFCV_IC_MFG_NXP	0x04
+
+/* Error codes */
+#define SIM_NFCV_ERR_NOT_SUPPORTED	0x01
+#define SIM_NFCV_ERR_FORMAT		0x02
+#define SIM_NFCV_ERR_UNKNOWN		0x0F
+#define SIM_NFCV_ERR_BLOCK		0x10
+#define SIM_NFCV_ERR_LOCKED_ALREADY	0x11
+#define SIM_NFCV_ERR_LOCKED		0x12
+
+#define SIM_NFCV_FDT		4320			/* t1 nominal, 1/fc */
+#define SIM_NFCV_WRITE_FDT	(4320 + 67800)		/* t1 plus 5 ms of programming */
+
+/*
+ ******************************************************************************
+ * LOCAL FUNCTIONS
+ ******************************************************************************
+ */
+static bool sim_nfcv_error(pltfSimFrame *res, uint8_t code)
+{
+	res->data[0] = SIM_NFCV_RES_ERROR;
+	res->data[1] = code;
+	res->len = 2;
+	return true;
+}
+
+/* Answer once the blocks are programmed, or hold the answer for an EOF
+ * after that when the option flag asks so */
+static bool sim_nfcv_write_done(pltfSimNfcv *v, uint8_t flags, uint16_t blocks, pltfSimFrame *res)
+{
+	uint32_t prog = blocks * (v->writeFdt - SIM_NFCV_FDT);
+
+	res->fdt = SIM_NFCV_FDT + prog;
+	if (!(flags & SIM_NFCV_FLAG_OPTION))
+		return true;
+
+	v->pending = *res;
+	v->eofPending = true;
+	v->busyUntil = sim_chip()->now + sim_fc2ns(prog);
+	return false;
+}
+
+/* Blocks with optional security status, for READ and INVENTORY READ */
+static bool sim_nfcv_read_blocks(pltfSimNfcv *v, uint16_t first, uint16_t n, bool status, pltfSimFrame *res)
+{
+	uint16_t b;
+
+	if ((n == 0) || ((first + n) > v->blocks))
+		return sim_nfcv_error(res, SIM_NFCV_ERR_BLOCK);
+	if ((1 + (n * (v->blockSize + 1))) > PLTF_SIM_FRAME_MAX)
+		return sim_nfcv_error(res, SIM_NFCV_ERR_UNKNOWN);
+
+	res->data[0] = 0x00;
+	res->len = 1;
+	for (b = first; b < (first + n); b++) {
+		if (status)
+			res->data[res->len++] = v->locked[b] ? 0x01 : 0x00;
+		memcpy(&res->data[res->len], v->mem[b], v->blockSize);
+		res->len += v->blockSize;
+	}
+	return true;
+}
+
+/* INVENTORY READ with the option flag: the UID bits past the mask and the
+ * slot number, rounded up to whole bytes, go ahead of the blocks */
+static void sim_nfcv_uid_rest(pltfSimNfcv *v, uint8_t skip, pltfSimFrame *res)
+{
+	uint8_t n = (64 - skip + 7) / 8;
+	uint8_t i;
+
+	if ((res->data[0] & SIM_NFCV_RES_ERROR) || ((res->len + n) > PLTF_SIM_FRAME_MAX))
+		return;
+
+	memmove(&res->data[1 + n], &res->data[1], res->len - 1);
+	memset(&res->data[1], 0, n);
+	for (i = 0; (skip + i) < 64; i++)
+		res->data[1 + (i / 8)] |= (uint8_t)(sim_bit(v->uid, skip + i) << (i % 8));
+	res->len += n;
+}
+
+static bool sim_nfcv_inventory(pltfSimNfcv *v, const pltfSimFrame *req, pltfSimFrame *res)
+{
+	uint8_t flags = req->data[0];
+	uint8_t cmd = req->data[1];
+	uint16_t p = 2;
+	uint8_t maskLen, i;
+
+	if (v->state == SIM_NFCV_QUIET)
+		return false;
+
+	if ((cmd == SIM_NFCV_INVENTORY_READ) || (cmd == SIM_NFCV_FAST_INVENTORY_READ)) {
+		if ((req->len < 3) || (req->data[2] != SIM_NFCV_IC_MFG_NXP))
+			return false;
+		p = 3;
+	} else if (cmd != SIM_NFCV_INVENTORY) {
+		return false;
+	}
+
+	if (flags & SIM_NFCV_FLAG_SELECT) {
+		if ((p >= req->len) || ((req->data[p] != 0) && (req->data[p] != v->afi)))
+			return false;
+		p++;
+	}
+
+	if (p >= req->len)
+		return false;
+	maskLen = req->data[p++];
+	if ((maskLen > 64) || ((p + ((maskLen + 7) / 8)) > req->len))
+		return false;
+	for (i = 0; i < maskLen; i++) {
+		if (sim_bit(&req->data[p], i) != sim_bit(v->uid, i))
+			return false;
+	}
+	p += (maskLen + 7) / 8;
+
+	if (cmd == SIM_NFCV_INVENTORY) {
+		res->data[0] = 0x00;
+		res->data[1] = v->dsfid;
+		memcpy(&res->data[2], v->uid, 8);
+		res->len = 10;
+	} else {
+		if ((p + 2) > req->len)
+			return false;
+		sim_nfcv_read_blocks(v, req->data[p], req->data[p + 1] + 1, false, res);
+		if (flags & SIM_NFCV_FLAG_OPTION)
+			sim_nfcv_uid_rest(v, maskLen + ((flags & SIM_NFCV_FLAG_ADDRESS) ? 0 : 4), res);
+		res->fast = (cmd == SIM_NFCV_FAST_INVENTORY_READ);
+	}
+
+	if (flags & SIM_NFCV_FLAG_ADDRESS)
+		return true;
+
+	/* 16 slots: the UID nibble after the mask, later slots are opened by EOFs */
+	v->slot = 0;
+	for (i = 0; i < 4; i++)
+		v->slot |= (int8_t)((maskLen + i) < 64 ? (sim_bit(v->uid, maskLen + i) << i) : 0);
+	if (v->slot == 0) {
+		v->slot = -1;
+		return true;
+	}
+	v->slotNow = 0;
+	v->pending = *res;
+	return false;
+}
+
+static void sim_nfcv_reset(pltfSimTag *tag)
+{
+	pltfSimNfcv *v = (pltfSimNfcv *)tag;
+
+	v->state = SIM_NFCV_READY;
+	v->slot = -1;
+	v->eofPending = false;
+}
+
+static bool sim_nfcv_receive(pltfSimTag *tag, const pltfSimFrame *req, pltfSimFrame *res)
+{
+	pltfSimNfcv *v = (pltfSimNfcv *)tag;
+	uint8_t flags, cmd;
+	uint16_t p, blk, n, b;
+	bool addressed;
+
+	/* EOF alone: the answer held for it, or the next inventory slot */
+	if (req->len == 0) {
+		if (v->eofPending) {
+			if (sim_chip()->now < v->busyUntil)
+				return false;
+			v->eofPending = false;
+			*res = v->pending;
+			res->fdt = SIM_NFCV_FDT;
+			return true;
+		}
+		if ((v->slot > 0) && (++v->slotNow == v->slot)) {
+			v->slot = -1;
+			*res = v->pending;
+			return true;
+		}
+		return false;
+	}
+
+	v->slot = -1;
+	v->eofPending = false;
+	if (!req->crc || (req->len < 2))
+		return false;
+
+	flags = req->data[0];
+	cmd = req->data[1];
+	if (flags & SIM_NFCV_FLAG_INVENTORY)
+		return sim_nfcv_inventory(v, req, res);
+
+	p = 2;
+	if ((cmd >= SIM_NFCV_CUSTOM_FIRST) && (cmd <= SIM_NFCV_CUSTOM_LAST)) {
+		if ((req->len < 3) || (req->data[2] != SIM_NFCV_IC_MFG_NXP))
+			return false;
+		p = 3;
+	}
+
+	addressed = (flags & SIM_NFCV_FLAG_ADDRESS);
+	if (addressed) {
+		if ((req->len < (p + 8)) || memcmp(&req->data[p], v->uid, 8)) {
+			/* Selecting another tag deselects this one */
+			if ((cmd == SIM_NFCV_SELECT) && (v->state == SIM_NFCV_SELECTED))
+				v->state = SIM_NFCV_READY;
+			return false;
+		}
+		p += 8;
+	} else if (flags & SIM_NFCV_FLAG_SELECT) {
+		if (v->state != SIM_NFCV_SELECTED)
+			return false;
+	} else if (v->state == SIM_NFCV_QUIET) {
+		return false;
+	}
+
+	res->data[0] = 0x00;
+	res->len = 1;
+	res->fdt = SIM_NFCV_FDT;
+
+	switch (cmd) {
+	case SIM_NFCV_STAY_QUIET:
+		if (addressed)
+			v->state = SIM_NFCV_QUIET;
+		return false;
+
+	case SIM_NFCV_SELECT:
+		if (!addressed)
+			return sim_nfcv_error(res, SIM_NFCV_ERR_FORMAT);
+		v->state = SIM_NFCV_SELECTED;
+		return true;
+
+	case SIM_NFCV_RESET_TO_READY:
+		v->state = SIM_NFCV_READY;
+		return true;
+
+	case SIM_NFCV_READ_SINGLE:
+		if (req->len != (p + 1))
+			return sim_nfcv_error(res, SIM_NFCV_ERR_FORMAT);
+		return sim_nfcv_read_blocks(v, req->data[p], 1, (flags & SIM_NFCV_FLAG_OPTION), res);
+
+	case SIM_NFCV_FAST_READ_MULTIPLE:
+		res->fast = true;
+		/* fall through */
+	case SIM_NFCV_READ_MULTIPLE:
+		if (req->len != (p + 2))
+			return sim_nfcv_error(res, SIM_NFCV_ERR_FORMAT);
+		return sim_nfcv_read_blocks(v, req->data[p], req->data[p + 1] + 1, (flags & SIM_NFCV_FLAG_OPTION), res);
+
+	case SIM_NFCV_WRITE_SINGLE:
+	case SIM_NFCV_WRITE_MULTIPLE:
+		blk = req->data[p++];
+		n = 1;
+		if (cmd == SIM_NFCV_WRITE_MULTIPLE) {
+			if (!v->writeMultiple)
+				return sim_nfcv_error(res, SIM_NFCV_ERR_NOT_SUPPORTED);
+			n = (p < req->len) ? (req->data[p++] + 1) : 0;
+		}
+		if ((n == 0) || (req->len != (p + (n * v->blockSize))))
+			return sim_nfcv_error(res, SIM_NFCV_ERR_FORMAT);
+		if ((blk + n) > v->blocks)
+			return sim_nfcv_error(res, SIM_NFCV_ERR_BLOCK);
+		for (b = blk; b < (blk + n); b++) {
+			if (v->locked[b])
+				return sim_nfcv_error(res, SIM_NFCV_ERR_LOCKED);
+		}
+		for (b = blk; b < (blk + n); b++, p += v->blockSize)
+			memcpy(v->mem[b], &req->data[p], v->blockSize);
+		return sim_nfcv_write_done(v, flags, n, res);
+
+	case SIM_NFCV_LOCK_BLOCK:
+		if (req->len != (p + 1))
+			return sim_nfcv_error(res, SIM_NFCV_ERR_FORMAT);
+		blk = req->data[p];
+		if (blk >= v->blocks)
+			return sim_nfcv_error(res, SIM_NFCV_ERR_BLOCK);
+		if (v->locked[blk])
+			return sim_nfcv_error(res, SIM_NFCV_ERR_LOCKED_ALREADY);
+		v->locked[blk] = true;
+		return sim_nfcv_write_done(v, flags, 1, res);
+
+	case SIM_NFCV_WRITE_AFI:
+	case SIM_NFCV_WRITE_DSFID:
+		if (req->len != (p + 1))
+			return sim_nfcv_error(res, SIM_NFCV_ERR_FORMAT);
+		if (cmd == SIM_NFCV_WRITE_AFI)
+			v->afi = req->data[p];
+		else
+			v->dsfid = req->data[p];
+		return sim_nfcv_write_done(v, flags, 1, res);
+
+	case SIM_NFCV_LOCK_AFI:
+	case SIM_NFCV_LOCK_DSFID:
+		return sim_nfcv_write_done(v, flags, 1, res);
+
+	case SIM_NFCV_GET_SYSTEM_INFO:
+		res->data[1] = 0x0F;		/* DSFID, AFI, memory size and IC reference follow */
+		memcpy(&res->data[2], v->uid, 8);
+		res->data[10] = v->dsfid;
+		res->data[11] = v->afi;
+		res->data[12] = (uint8_t)(v->blocks - 1);
+		res->data[13] = (uint8_t)((v->blockSize - 1) & 0x1F);
+		res->data[14] = v->icRef;
+		res->len = 15;
+		return true;
+
+	case SIM_NFCV_GET_SECURITY:
+		if (req->len != (p + 2))
+			return sim_nfcv_error(res, SIM_NFCV_ERR_FORMAT);
+		blk = req->data[p];
+		n = req->data[p + 1] + 1;
+		if ((blk + n) > v->blocks)
+			return sim_nfcv_error(res, SIM_NFCV_ERR_BLOCK);
+		for (b = blk; b < (blk + n); b++)
+			res->data[res->len++] = v->locked[b] ? 0x01 : 0x00;
+		return true;
+
+	default:
+		return sim_nfcv_error(res, SIM_NFCV_ERR_NOT_SUPPORTED);
+	}
+}
+
+/*
+ ******************************************************************************
+ * GLOBAL AND HELPER FUNCTIONS
+ ******************************************************************************
+ */
+void pltf_sim_nfcv_init(pltfSimNfcv *tag, const uint8_t uid[8], uint16_t blocks, uint8_t blockSize)
+{
+	uint16_t b;
+	uint8_t k;
+
+	memset(tag, 0, sizeof(*tag));
+	tag->tag.tech = PLTF_SIM_TECH_NFCV;
+	tag->tag.reset = sim_nfcv_reset;
+	tag->tag.receive = sim_nfcv_receive;
+
+	memcpy(tag->uid, uid, 8);
+	tag->blocks = ((blocks == 0) || (blocks > PLTF_SIM_NFCV_BLOCKS_MAX)) ? PLTF_SIM_NFCV_BLOCKS_MAX : blocks;
+	tag->blockSize = ((blockSize == 0) || (blockSize > PLTF_SIM_NFCV_BLOCK_MAX)) ? 4 : blockSize;
+	tag->icRef = 0x01;
+	tag->writeFdt = SIM_NFCV_WRITE_FDT;
+	tag->writeMultiple = true;
+
+	for (b = 0; b < tag->blocks; b++) {
+		for (k = 0; k < tag->blockSize; k++)
+			tag->mem[b][k] = (uint8_t)((b * tag->blockSize) + k) ^ uid[0];
+	}
+
+	/* Capability container and an empty NDEF message */
+	tag->mem[0][0] = 0xE1;
+	tag->mem[0][1] = 0x40;
+	tag->mem[0][2] = (uint8_t)((tag->blocks * tag->blockSize) / 8);
+	tag->mem[0][3] = 0x01;
+	tag->mem[1][0] = 0x03;
+	tag->mem[1][1] = 0x00;
+	tag->mem[1][2] = 0xFE;
+	tag->mem[1][3] = 0x00;
+
+	sim_nfcv_reset(&tag->tag);
+}
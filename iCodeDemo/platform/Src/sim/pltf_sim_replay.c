@@ -0,0 +1,319 @@
+
+/******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; COPYRIGHT 2018 STMicroelectronics</center></h2>
+  *
+  * Licensed under ST MYLIBERTY SOFTWARE LICENSE AGREEMENT (the "License");
+  * You may not use this file except in compliance with the License.
+  * You may obtain a copy of the License at:
+  *
+  *        http://www.st.com/myliberty
+  *
+  * Unless required by applicable law or agreed to in writing, software 
+  * distributed under the License is distributed on an "AS IS" BASIS, 
+  * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied,
+  * AND SPECIFICALLY DISCLAIMING THE IMPLIED WARRANTIES OF MERCHANTABILITY,
+  * FITNESS FOR A PARTICULAR PURPOSE, AND NON-INFRINGEMENT.
+  * See the License for the specific language governing permissions and
+  * limitations under the License.
+  *
+******************************************************************************/
+/*! \file pltf_sim_replay.c
+ *
+ *  \brief Replay of a recorded trace in place of the simulated ST25R3911
+ *  
+ *  The records of the reader are split into the ones of the worker and
+ *  the ones of the ISR, each consumed in order by the SPI accesses and
+ *  line reads of the driver. An ISR run of the trace is started once its
+ *  time has come and the worker has got past the records it made before
+ *  the ISR got hold of the SPI, i.e. where the recorded ISR could run.
+ *  
+ *  Replies come from the trace, whatever the driver sends: after a
+ *  divergence the counters tell how far the driver followed the trace.
+ *  
+ */
+
+/*
+ ******************************************************************************
+ * INCLUDES
+ ******************************************************************************
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "pltf_sim_int.h"
+
+/*
+ ******************************************************************************
+ * LOCAL FUNCTIONS
+ ******************************************************************************
+ */
+/* Next record of the worker or of the ISR, NULL at the end of the trace */
+static const pltfTraceRec *replay_peek(simReplay *r, bool isr, uint32_t *idx)
+{
+	if (isr) {
+		if (r->isrPos >= r->isrCnt)
+			return NULL;
+		*idx = r->isr[r->isrPos];
+	} else {
+		if (r->mainPos >= r->mainCnt)
+			return NULL;
+		*idx = r->main[r->mainPos];
+	}
+	return &r->log.recs[*idx];
+}
+
+/* Record consumed, the clock catches up with it */
+static void replay_take(simChip *c, bool isr, const pltfTraceRec *rec)
+{
+	simReplay *r = c->replay;
+	uint64_t t = rec->t + r->base;
+
+	if (isr)
+		r->isrPos++;
+	else
+		r->mainPos++;
+	r->res.replayed++;
+
+	if (t > c->now)
+		c->now = t;
+
+	if (r->res.replayed == r->res.records)
+		printf("Replay of reader %d done: %u records, %u SPI segments checked, %u mismatches\n",
+		       (int)pltf_reader_current(), r->res.records, r->res.spiChecked, r->res.mismatches);
+}
+
+static void replay_diverge(simChip *c, uint32_t idx, const char *what)
+{
+	simReplay *r = c->replay;
+
+	r->res.mismatches++;
+	if (r->res.firstMismatch == UINT32_MAX)
+		r->res.firstMismatch = idx;
+	if (!r->reported) {
+		r->reported = true;
+		printf("Error: replay of reader %d diverges at record %u: %s\n", (int)pltf_reader_current(), idx, what);
+	}
+}
+
+static void replay_overrun(simChip *c)
+{
+	simReplay *r = c->replay;
+
+	r->res.overrun++;
+	if (!r->reported) {
+		r->reported = true;
+		printf("Error: replay of reader %d went past the end of the trace\n", (int)pltf_reader_current());
+	}
+}
+
+static void replay_free(simReplay *r)
+{
+	pltf_trace_unload(&r->log);
+	free(r->main);
+	free(r->isr);
+	free(r);
+}
+
+/*
+ ******************************************************************************
+ * GLOBAL FUNCTIONS
+ ******************************************************************************
+ */
+void sim_replay_spi(simChip *c, const uint8_t *tx, uint8_t *rx, uint16_t len, bool hold)
+{
+	simReplay *r = c->replay;
+	const pltfTraceRec *rec;
+	uint32_t idx;
+	uint16_t i;
+	bool same;
+
+	rec = replay_peek(r, c->inIsr, &idx);
+	if ((rec == NULL) || (rec->type != PLTF_TRACE_SPI)) {
+		if (rec == NULL)
+			replay_overrun(c);
+		else
+			replay_diverge(c, idx, (c->inIsr ? "SPI access where the ISR read the line" : "SPI access where the ISR ran"));
+		if (rx != NULL)
+			memset(rx, 0, len);
+		return;
+	}
+
+	/* Compared before the reply overwrites an in place buffer */
+	r->res.spiChecked++;
+	/* A truncated record only holds the first bytes of the segment */
+	if (rec->flags & PLTF_TRACE_FLAG_TRUNC)
+		same = (rec->len <= len);
+	else
+		same = (rec->len == len);
+	same = (same && (((rec->flags & PLTF_TRACE_FLAG_HOLD) != 0) == hold));
+	for (i = 0; same && (i < rec->len); i++)
+		same = (((tx != NULL) ? tx[i] : 0) == ((rec->tx != NULL) ? rec->tx[i] : 0));
+	if (!same)
+		replay_diverge(c, idx, "SPI segment differs");
+
+	if (rx != NULL) {
+		memset(rx, 0, len);
+		if (rec->rx != NULL)
+			memcpy(rx, rec->rx, ((rec->len < len) ? rec->len : len));
+	}
+	replay_take(c, c->inIsr, rec);
+}
+
+bool sim_replay_line(simChip *c)
+{
+	const pltfTraceRec *rec;
+	uint32_t idx;
+
+	rec = replay_peek(c->replay, true, &idx);
+	if ((rec == NULL) || (rec->type != PLTF_TRACE_LINE)) {
+		if (rec == NULL)
+			replay_overrun(c);
+		else
+			replay_diverge(c, idx, "line read where the ISR accessed SPI");
+		return false;
+	}
+
+	replay_take(c, true, rec);
+	return (rec->len != 0);
+}
+
+uint64_t sim_replay_next(simChip *c)
+{
+	simReplay *r = c->replay;
+	const pltfTraceRec *rec;
+	uint32_t idx, gate, i;
+
+	rec = replay_peek(r, true, &idx);
+	if ((rec == NULL) || (rec->type != PLTF_TRACE_IRQ))
+		return SIM_NONE;
+
+	/* The worker must have done what it did before the ISR took the SPI */
+	gate = idx;
+	for (i = r->isrPos + 1; i < r->isrCnt; i++) {
+		if (r->log.recs[r->isr[i]].type == PLTF_TRACE_IRQ)
+			break;
+		if (r->log.recs[r->isr[i]].type == PLTF_TRACE_SPI) {
+			gate = r->isr[i];
+			break;
+		}
+	}
+	if ((r->mainPos < r->mainCnt) && (r->main[r->mainPos] < gate))
+		return SIM_NONE;
+
+	return (rec->t + r->base);
+}
+
+void sim_replay_isr(simChip *c)
+{
+	const pltfTraceRec *rec;
+	uint32_t idx;
+
+	rec = replay_peek(c->replay, true, &idx);
+	if ((rec != NULL) && (rec->type == PLTF_TRACE_IRQ))
+		replay_take(c, true, rec);
+}
+
+bool sim_replay_env(void)
+{
+	const char *path = getenv(PLTF_SIM_REPLAY_ENV);
+
+	if ((path == NULL) || (*path == '\0'))
+		return false;
+
+	if (pltf_sim_replay_start(path) != ERR_NONE) {
+		printf("Error: replay of %s could not be started\n", path);
+		return false;
+	}
+	return true;
+}
+
+ReturnCode pltf_sim_replay_start(const char *path)
+{
+	simChip *c = sim_chip();
+	uint8_t reader = (uint8_t)(pltf_reader_current() & PLTF_TRACE_FLAG_READER);
+	simReplay *r;
+	ReturnCode err;
+	uint32_t i;
+
+	if (c->replay != NULL)
+		return ERR_WRONG_STATE;
+
+	r = calloc(1, sizeof(simReplay));
+	if (r == NULL)
+		return ERR_NOMEM;
+
+	err = pltf_trace_load(path, &r->log);
+	if (err != ERR_NONE) {
+		free(r);
+		return err;
+	}
+
+	r->main = malloc((r->log.count + 1) * sizeof(uint32_t));
+	r->isr = malloc((r->log.count + 1) * sizeof(uint32_t));
+	if ((r->main == NULL) || (r->isr == NULL)) {
+		replay_free(r);
+		return ERR_NOMEM;
+	}
+
+	for (i = 0; i < r->log.count; i++) {
+		if ((r->log.recs[i].flags & PLTF_TRACE_FLAG_READER) != reader)
+			continue;
+		if (r->log.recs[i].flags & PLTF_TRACE_FLAG_ISR)
+			r->isr[r->isrCnt++] = i;
+		else
+			r->main[r->mainCnt++] = i;
+	}
+	if ((r->mainCnt + r->isrCnt) == 0) {
+		replay_free(r);
+		return ERR_NOTFOUND;
+	}
+
+	r->res.records = r->mainCnt + r->isrCnt;
+	r->res.firstMismatch = UINT32_MAX;
+	r->res.lost = r->log.lost;
+
+	pthread_mutex_lock(&c->lock);
+	/* Recorded time of the first record is now */
+	i = ((r->mainCnt > 0) && ((r->isrCnt == 0) || (r->main[0] < r->isr[0]))) ? r->main[0] : r->isr[0];
+	r->base = c->now - r->log.recs[i].t;
+	c->lineHigh = false;
+	c->replay = r;
+	pthread_mutex_unlock(&c->lock);
+
+	return ERR_NONE;
+}
+
+void pltf_sim_replay_stop(void)
+{
+	simChip *c = sim_chip();
+	simReplay *r;
+
+	pthread_mutex_lock(&c->lock);
+	r = c->replay;
+	c->replay = NULL;
+	c->lineHigh = false;
+	pthread_mutex_unlock(&c->lock);
+
+	if (r != NULL)
+		replay_free(r);
+}
+
+bool pltf_sim_replay_result(pltfSimReplayResult *res)
+{
+	simChip *c = sim_chip();
+	bool ok = false;
+
+	pthread_mutex_lock(&c->lock);
+	if (c->replay != NULL) {
+		*res = c->replay->res;
+		ok = ((res->mismatches == 0) && (res->overrun == 0) && (res->replayed == res->records));
+	} else {
+		memset(res, 0, sizeof(*res));
+		res->firstMismatch = UINT32_MAX;
+	}
+	pthread_mutex_unlock(&c->lock);
+
+	return ok;
+}
@@ -0,0 +1,183 @@
+
+/******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; COPYRIGHT 2018 STMicroelectronics</center></h2>
+  *
+  * Licensed under ST MYLIBERTY SOFTWARE LICENSE AGREEMENT (the "License");
+  * You may not use this file except in compliance with the License.
+  * You may obtain a copy of the License at:
+  *
+  *        http://www.st.com/myliberty
+  *
+  * Unless required by applicable law or agreed to in writing, software 
+  * distributed under the License is distributed on an "AS IS" BASIS, 
+  * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied,
+  * AND SPECIFICALLY DISCLAIMING THE IMPLIED WARRANTIES OF MERCHANTABILITY,
+  * FITNESS FOR A PARTICULAR PURPOSE, AND NON-INFRINGEMENT.
+  * See the License for the specific language governing permissions and
+  * limitations under the License.
+  *
+******************************************************************************/
+/*! \file pltf_sim_spi.c
+ *
+ *  \brief SPI functions of the simulated ST25R3911.
+ *  
+ *  Frames go to the model instead of spidev. Each call costs the bus time
+ *  of a Raspberry Pi on the virtual clock.
+ *  
+ */
+
+/*
+ ******************************************************************************
+ * INCLUDES
+ ******************************************************************************
+ */
+#include <stdio.h>
+#include <string.h>
+#include "pltf_spi.h"
+#include "pltf_sim_int.h"
+
+/*
+ ******************************************************************************
+ * DEFINES
+ ******************************************************************************
+ */
+#define SPI_MAX_FREQ		6000000		/* As pltf_spi.c */
+#define SPI_FRAME_MAX		512		/* Longest CS framed frame gathered from segments */
+
+#define spi_bus_ns(len)		(((uint64_t)(len) * 8 * 1000000000ULL) / SPI_MAX_FREQ)
+
+/*
+ ******************************************************************************
+ * LOCAL FUNCTIONS
+ ******************************************************************************
+ */
+/* Bus time, polled readers follow the real time instead */
+static void spi_cost(simChip *c, uint64_t ns)
+{
+	if (c->polled)
+		sim_rt_arm(c);
+	else
+		sim_advance(c, c->now + ns);
+}
+
+/*
+ ******************************************************************************
+ * GLOBAL AND HELPER FUNCTIONS
+ ******************************************************************************
+ */
+ReturnCode spi_init(void)
+{
+	simChip *c = sim_chip();
+
+	if (!c->envApplied) {
+		c->envApplied = true;
+		if (!sim_replay_env())
+			sim_tags_env();
+	}
+	return ERR_NONE;
+}
+
+HAL_statusTypeDef spiTxRx(const uint8_t *txData, uint8_t *rxData, uint8_t length)
+{
+	simChip *c = sim_chip();
+
+	pthread_mutex_lock(&c->lock);
+	if (c->polled)
+		sim_rt_sync(c);
+
+	c->stats.spiCalls++;
+	if (c->replay != NULL) {
+		/* The clock follows the trace */
+		sim_replay_spi(c, txData, rxData, length, false);
+		sim_advance(c, c->now);
+	} else {
+		sim_spi_frame(c, txData, rxData, length);
+		spi_cost(c, PLTF_SIM_SPI_CALL_NS + spi_bus_ns(length));
+	}
+	pthread_mutex_unlock(&c->lock);
+
+	return HAL_OK;
+}
+
+HAL_statusTypeDef spiTxRxMulti(const spiSegmentTypeDef *segs, uint8_t count)
+{
+	simChip *c = sim_chip();
+	uint8_t tx[SPI_FRAME_MAX];
+	uint8_t rx[SPI_FRAME_MAX];
+	uint64_t ns = PLTF_SIM_SPI_CALL_NS;
+	uint16_t len, pos;
+	uint8_t first, last, i;
+
+	if ((segs == NULL) || (count == 0) || (count > SPI_MAX_SEGMENTS)) {
+		printf("Error: invalid SPI segment count=%d\n", count);
+		return HAL_ERROR;
+	}
+
+	pthread_mutex_lock(&c->lock);
+	if (c->polled)
+		sim_rt_sync(c);
+	c->stats.spiCalls++;
+
+	if (c->replay != NULL) {
+		for (i = 0; i < count; i++)
+			sim_replay_spi(c, segs[i].txData, segs[i].rxData, segs[i].length, segs[i].csHold);
+		sim_advance(c, c->now);
+		pthread_mutex_unlock(&c->lock);
+		return HAL_OK;
+	}
+
+	/* Gather the segments of each CS framed frame, hand it over, scatter the answer */
+	for (first = 0; first < count; first = last + 1) {
+		len = 0;
+		for (last = first; last < count; last++) {
+			if ((len + segs[last].length) > SPI_FRAME_MAX) {
+				printf("Error: SPI frame longer than %d bytes\n", SPI_FRAME_MAX);
+				pthread_mutex_unlock(&c->lock);
+				return HAL_ERROR;
+			}
+			if (segs[last].txData != NULL)
+				memcpy(&tx[len], segs[last].txData, segs[last].length);
+			else
+				memset(&tx[len], 0, segs[last].length);
+			len += segs[last].length;
+			if (!segs[last].csHold)
+				break;
+		}
+		if (last == count)
+			last--;
+
+		sim_spi_frame(c, tx, rx, len);
+
+		for (pos = 0, i = first; i <= last; i++) {
+			if (segs[i].rxData != NULL)
+				memcpy(segs[i].rxData, &rx[pos], segs[i].length);
+			pos += segs[i].length;
+		}
+		ns += PLTF_SIM_SPI_GAP_NS + spi_bus_ns(len);
+	}
+
+	spi_cost(c, ns);
+	pthread_mutex_unlock(&c->lock);
+
+	return HAL_OK;
+}
+
+void pltf_protect_com(void)
+{
+	simChip *c = sim_chip();
+
+	pthread_mutex_lock(&c->lock);
+	c->depth++;
+}
+
+/* Leaving the outermost protection lets an IRQ raised meanwhile through */
+void pltf_unprotect_com(void)
+{
+	simChip *c = sim_chip();
+
+	if (--c->depth == 0)
+		sim_service(c);
+	pthread_mutex_unlock(&c->lock);
+}
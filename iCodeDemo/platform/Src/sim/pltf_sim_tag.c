@@ -0,0 +1,642 @@
+
+/******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; COPYRIGHT 2018 STMicroelectronics</center></h2>
+  *
+  * Licensed under ST MYLIBERTY SOFTWARE LICENSE AGREEMENT (the "License");
+  * You may not use this file except in compliance with the License.
+  * You may obtain a copy of the License at:
+  *
+  *        http://www.st.com/myliberty
+  *
+  * Unless required by applicable law or agreed to in writing, software 
+  * distributed under the License is distributed on an "AS IS" BASIS, 
+  * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied,
+  * AND SPECIFICALLY DISCLAIMING THE IMPLIED WARRANTIES OF MERCHANTABILITY,
+  * FITNESS FOR A PARTICULAR PURPOSE, AND NON-INFRINGEMENT.
+  * See the License for the specific language governing permissions and
+  * limitations under the License.
+  *
+******************************************************************************/
+/*! \file pltf_sim_tag.c
+ *
+ *  \brief Built-in NFC-A, T2T, ISO-DEP and FeliCa tags of the simulated
+ *         ST25R3911, and the PLTF_SIM_TAGS list.
+ *  
+ */
+
+/*
+ ******************************************************************************
+ * INCLUDES
+ ******************************************************************************
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "pltf_sim_int.h"
+
+/*
+ ******************************************************************************
+ * DEFINES
+ ******************************************************************************
+ */
+/* NFC-A states */
+#define SIM_NFCA_IDLE		0
+#define SIM_NFCA_READY		1
+#define SIM_NFCA_ACTIVE		2
+#define SIM_NFCA_HALT		3
+
+#define SIM_NFCA_REQA		0x26
+#define SIM_NFCA_WUPA		0x52
+#define SIM_NFCA_HLTA		0x50
+#define SIM_NFCA_SEL_CL1	0x93
+#define SIM_NFCA_SEL_CL3	0x97
+#define SIM_NFCA_CT		0x88	/* Cascade tag */
+#define SIM_NFCA_NVB_SELECT	0x70
+#define SIM_NFCA_SAK_CASCADE	0x04
+
+/* T2T */
+#define SIM_T2T_READ		0x30
+#define SIM_T2T_WRITE		0xA2
+#define SIM_T2T_GET_VERSION	0x60
+#define SIM_T2T_ACK		0x0A
+#define SIM_T2T_NAK		0x00
+
+/* ISO-DEP */
+#define SIM_ISODEP_RATS		0xE0
+#define SIM_ISODEP_PPS		0xD0
+#define SIM_ISODEP_I_CHAIN	0x10
+#define SIM_ISODEP_R_ACK	0xA2
+#define SIM_ISODEP_R_NAK	0x10
+#define SIM_ISODEP_S_DESELECT	0xC2
+#define SIM_ISODEP_S_WTX	0xF2
+
+/* FeliCa */
+#define SIM_FELICA_POLLING	0x00
+#define SIM_FELICA_READ		0x06
+#define SIM_FELICA_WRITE	0x08
+#define SIM_FELICA_SLOT_FC	(256 * 64)
+#define SIM_FELICA_RES_FC	(512 * 64)
+
+/*
+ ******************************************************************************
+ * LOCAL FUNCTIONS - NFC-A
+ ******************************************************************************
+ */
+static uint8_t sim_nfca_levels(const pltfSimNfca *a)
+{
+	return (a->uidLen == 4) ? 1 : ((a->uidLen == 7) ? 2 : 3);
+}
+
+/* UID part of a cascade level with the BCC */
+static void sim_nfca_cascade(const pltfSimNfca *a, uint8_t level, uint8_t cl[5])
+{
+	uint8_t pos = level * 3;
+
+	if ((level + 1) < sim_nfca_levels(a)) {
+		cl[0] = SIM_NFCA_CT;
+		memcpy(&cl[1], &a->uid[pos], 3);
+	} else {
+		memcpy(cl, &a->uid[pos], 4);
+	}
+	cl[4] = cl[0] ^ cl[1] ^ cl[2] ^ cl[3];
+}
+
+/*
+ ******************************************************************************
+ * LOCAL FUNCTIONS - T2T
+ ******************************************************************************
+ */
+static bool sim_t2t_ack(pltfSimFrame *res, uint8_t ack)
+{
+	res->data[0] = ack;
+	res->len = 0;
+	res->bits = 4;
+	res->crc = false;
+	return true;
+}
+
+static void sim_t2t_reset(pltfSimTag *tag)
+{
+	sim_nfca_reset(&((pltfSimT2t *)tag)->nfca);
+}
+
+static bool sim_t2t_receive(pltfSimTag *tag, const pltfSimFrame *req, pltfSimFrame *res)
+{
+	static const uint8_t version[] = { 0x00, 0x04, 0x04, 0x02, 0x01, 0x00, 0x0F, 0x03 };
+	pltfSimT2t *t = (pltfSimT2t *)tag;
+	uint8_t page, i;
+	int r;
+
+	r = sim_nfca_receive(&t->nfca, req, res);
+	if (r != SIM_NFCA_PASS)
+		return (r == SIM_NFCA_ANSWER);
+
+	if (!req->crc)
+		return sim_t2t_ack(res, SIM_T2T_NAK);
+
+	page = (req->len > 1) ? req->data[1] : 0;
+	switch (req->data[0]) {
+	case SIM_T2T_READ:
+		if ((req->len != 2) || (page >= PLTF_SIM_T2T_PAGES))
+			return sim_t2t_ack(res, SIM_T2T_NAK);
+		/* Four pages, rolling over to page 0 */
+		for (i = 0; i < 16; i++)
+			res->data[i] = t->mem[(page + (i / 4)) % PLTF_SIM_T2T_PAGES][i % 4];
+		res->len = 16;
+		return true;
+
+	case SIM_T2T_WRITE:
+		if ((req->len != 6) || (page < 2) || (page >= PLTF_SIM_T2T_PAGES))
+			return sim_t2t_ack(res, SIM_T2T_NAK);
+		memcpy(t->mem[page], &req->data[2], 4);
+		return sim_t2t_ack(res, SIM_T2T_ACK);
+
+	case SIM_T2T_GET_VERSION:
+		memcpy(res->data, version, sizeof(version));
+		res->len = sizeof(version);
+		return true;
+
+	default:
+		t->nfca.state = SIM_NFCA_IDLE;
+		return sim_t2t_ack(res, SIM_T2T_NAK);
+	}
+}
+
+/*
+ ******************************************************************************
+ * LOCAL FUNCTIONS - ISO-DEP
+ ******************************************************************************
+ */
+static void sim_isodep_reset(pltfSimTag *tag)
+{
+	pltfSimIsoDep *t = (pltfSimIsoDep *)tag;
+
+	sim_nfca_reset(&t->nfca);
+	t->active = false;
+	t->cmdLen = 0;
+	t->rspLen = 0;
+	t->rspPos = 0;
+}
+
+/* Next part of the response, chained if it does not fit the FSD */
+static bool sim_isodep_send(pltfSimIsoDep *t, uint8_t bn, pltfSimFrame *res)
+{
+	uint16_t n = t->rspLen - t->rspPos;
+	uint16_t max = t->fsd - 3;
+	bool more = (n > max);
+
+	if (more)
+		n = max;
+
+	res->data[0] = (more ? (0x02 | SIM_ISODEP_I_CHAIN) : 0x02) | bn;
+	memcpy(&res->data[1], &t->rsp[t->rspPos], n);
+	res->len = n + 1;
+	t->rspPos += n;
+
+	t->last = *res;
+	return true;
+}
+
+static bool sim_isodep_receive(pltfSimTag *tag, const pltfSimFrame *req, pltfSimFrame *res)
+{
+	static const uint8_t ats[] = { 0x05, 0x78, 0x80, 0x70, 0x00 };
+	static const uint16_t fsdTable[] = { 16, 24, 32, 40, 48, 64, 96, 128, 256 };
+	pltfSimIsoDep *t = (pltfSimIsoDep *)tag;
+	uint16_t inf, n;
+	uint8_t pcb;
+	int r;
+
+	r = sim_nfca_receive(&t->nfca, req, res);
+	if (r != SIM_NFCA_PASS) {
+		if (t->nfca.state != SIM_NFCA_ACTIVE)
+			t->active = false;
+		return (r == SIM_NFCA_ANSWER);
+	}
+
+	if (!req->crc || (req->len == 0))
+		return false;
+
+	pcb = req->data[0];
+	if (!t->active) {
+		if ((pcb != SIM_ISODEP_RATS) || (req->len != 2))
+			return false;
+		t->fsd = fsdTable[((req->data[1] >> 4) < 8) ? (req->data[1] >> 4) : 8];
+		t->active = true;
+		t->cmdLen = 0;
+		t->rspLen = 0;
+		t->rspPos = 0;
+		memcpy(res->data, ats, sizeof(ats));
+		res->len = sizeof(ats);
+		return true;
+	}
+
+	/* PPS */
+	if ((pcb & 0xF0) == SIM_ISODEP_PPS) {
+		res->data[0] = pcb;
+		res->len = 1;
+		return true;
+	}
+
+	/* I-block, the response carries the block number received */
+	if ((pcb & 0xE2) == 0x02) {
+		inf = 1 + ((pcb & 0x08) ? 1 : 0) + ((pcb & 0x04) ? 1 : 0);
+		n = (req->len > inf) ? (req->len - inf) : 0;
+		if ((t->cmdLen + n) > sizeof(t->cmd))
+			n = sizeof(t->cmd) - t->cmdLen;
+		memcpy(&t->cmd[t->cmdLen], &req->data[inf], n);
+		t->cmdLen += n;
+
+		if (pcb & SIM_ISODEP_I_CHAIN) {
+			res->data[0] = SIM_ISODEP_R_ACK | (pcb & 1);
+			res->len = 1;
+			t->last = *res;
+			return true;
+		}
+
+		if (t->apdu != NULL) {
+			t->rspLen = t->apdu(t, t->cmd, t->cmdLen, t->rsp, sizeof(t->rsp));
+		} else {
+			n = (t->cmdLen > (sizeof(t->rsp) - 2)) ? (sizeof(t->rsp) - 2) : t->cmdLen;
+			memcpy(t->rsp, t->cmd, n);
+			t->rsp[n++] = 0x90;
+			t->rsp[n++] = 0x00;
+			t->rspLen = n;
+		}
+		t->rspPos = 0;
+		t->cmdLen = 0;
+		return sim_isodep_send(t, pcb & 1, res);
+	}
+
+	/* R-block: ACK with a new block number asks for the next part, anything else repeats the last block */
+	if ((pcb & 0xE6) == SIM_ISODEP_R_ACK) {
+		if (!(pcb & SIM_ISODEP_R_NAK) && ((pcb & 1) != (t->last.data[0] & 1)) && (t->rspPos < t->rspLen))
+			return sim_isodep_send(t, pcb & 1, res);
+		*res = t->last;
+		return true;
+	}
+
+	if ((pcb & 0xF7) == SIM_ISODEP_S_DESELECT) {
+		res->data[0] = pcb;
+		res->len = 1;
+		t->active = false;
+		t->nfca.state = SIM_NFCA_HALT;
+		return true;
+	}
+
+	return false;
+}
+
+/*
+ ******************************************************************************
+ * LOCAL FUNCTIONS - FELICA
+ ******************************************************************************
+ */
+/* Block list of a Check or Update command, returns the position after it or 0 */
+static uint16_t sim_felica_blocks(const pltfSimFrame *req, uint16_t p, uint8_t *blocks, uint8_t *n)
+{
+	uint8_t i;
+
+	if (p >= req->len)
+		return 0;
+	*n = req->data[p++];
+	if ((*n == 0) || (*n > PLTF_SIM_FELICA_BLOCKS))
+		return 0;
+
+	for (i = 0; i < *n; i++) {
+		if ((p + 2) > req->len)
+			return 0;
+		if (req->data[p] & 0x80) {
+			blocks[i] = req->data[p + 1];
+			p += 2;
+		} else {
+			if (((p + 3) > req->len) || (req->data[p + 2] != 0))
+				return 0;
+			blocks[i] = req->data[p + 1];
+			p += 3;
+		}
+		if (blocks[i] >= PLTF_SIM_FELICA_BLOCKS)
+			return 0;
+	}
+	return p;
+}
+
+static bool sim_felica_receive(pltfSimTag *tag, const pltfSimFrame *req, pltfSimFrame *res)
+{
+	pltfSimFelica *t = (pltfSimFelica *)tag;
+	uint8_t blocks[PLTF_SIM_FELICA_BLOCKS];
+	uint8_t n = 0, i;
+	uint16_t p;
+
+	if (!req->crc || (req->len == 0))
+		return false;
+
+	switch (req->data[0]) {
+	case SIM_FELICA_POLLING:
+		if (req->len != 5)
+			return false;
+		if (((req->data[1] != 0xFF) && (req->data[1] != (t->sysCode >> 8)))
+		    || ((req->data[2] != 0xFF) && (req->data[2] != (t->sysCode & 0xFF))))
+			return false;
+
+		res->data[0] = SIM_FELICA_POLLING + 1;
+		memcpy(&res->data[1], t->idm, 8);
+		memcpy(&res->data[9], t->pmm, 8);
+		res->len = 17;
+		if (req->data[3] == 0x01) {
+			res->data[res->len++] = (uint8_t)(t->sysCode >> 8);
+			res->data[res->len++] = (uint8_t)(t->sysCode & 0xFF);
+		}
+		/* Time slot from the IDm, TSN is a number of slots minus one */
+		res->fdt = SIM_FELICA_RES_FC + ((t->idm[7] & req->data[4]) * SIM_FELICA_SLOT_FC);
+		return true;
+
+	case SIM_FELICA_READ:
+	case SIM_FELICA_WRITE:
+		if ((req->len < 11) || memcmp(&req->data[1], t->idm, 8))
+			return false;
+		p = sim_felica_blocks(req, 10 + (2 * req->data[9]), blocks, &n);
+
+		res->data[0] = req->data[0] + 1;
+		memcpy(&res->data[1], t->idm, 8);
+		res->data[9] = 0x00;
+		res->data[10] = 0x00;
+		res->len = 11;
+
+		if ((p == 0) || ((req->data[0] == SIM_FELICA_WRITE) && ((p + (16 * n)) != req->len))) {
+			res->data[9] = 0x01;
+			res->data[10] = 0xA8;
+			return true;
+		}
+
+		if (req->data[0] == SIM_FELICA_READ) {
+			res->data[res->len++] = n;
+			for (i = 0; i < n; i++, res->len += 16)
+				memcpy(&res->data[res->len], t->mem[blocks[i]], 16);
+		} else {
+			for (i = 0; i < n; i++, p += 16)
+				memcpy(t->mem[blocks[i]], &req->data[p], 16);
+		}
+		return true;
+
+	default:
+		return false;
+	}
+}
+
+/*
+ ******************************************************************************
+ * GLOBAL AND HELPER FUNCTIONS
+ ******************************************************************************
+ */
+void sim_nfca_reset(pltfSimNfca *a)
+{
+	a->state = SIM_NFCA_IDLE;
+	a->level = 0;
+}
+
+int sim_nfca_receive(pltfSimNfca *a, const pltfSimFrame *req, pltfSimFrame *res)
+{
+	uint8_t cl[5];
+	uint8_t level, nvb;
+	uint32_t known, i;
+
+	/* Short frame */
+	if ((req->len == 0) && (req->bits == 7)) {
+		if ((req->data[0] != SIM_NFCA_REQA) && (req->data[0] != SIM_NFCA_WUPA))
+			return SIM_NFCA_SILENT;
+		if ((req->data[0] == SIM_NFCA_REQA) && (a->state == SIM_NFCA_HALT))
+			return SIM_NFCA_SILENT;
+
+		a->state = SIM_NFCA_READY;
+		a->level = 0;
+		res->data[0] = a->atqa[0];
+		res->data[1] = a->atqa[1];
+		res->len = 2;
+		res->crc = false;
+		return SIM_NFCA_ANSWER;
+	}
+
+	if (req->len == 0)
+		return SIM_NFCA_SILENT;
+
+	if (req->crc && (req->len == 2) && (req->data[0] == SIM_NFCA_HLTA) && (req->data[1] == 0x00)) {
+		if (a->state == SIM_NFCA_ACTIVE)
+			a->state = SIM_NFCA_HALT;
+		return SIM_NFCA_SILENT;
+	}
+
+	if ((a->state == SIM_NFCA_READY) && (req->len >= 2) && (req->data[0] >= SIM_NFCA_SEL_CL1)
+	    && (req->data[0] <= SIM_NFCA_SEL_CL3) && (req->data[0] & 1)) {
+		level = (req->data[0] - SIM_NFCA_SEL_CL1) / 2;
+		if (level != a->level)
+			return SIM_NFCA_SILENT;
+		sim_nfca_cascade(a, level, cl);
+		nvb = req->data[1];
+
+		if (nvb == SIM_NFCA_NVB_SELECT) {
+			if (!req->crc || (req->len != 7) || memcmp(&req->data[2], cl, 5))
+				return SIM_NFCA_SILENT;
+			if ((level + 1) < sim_nfca_levels(a)) {
+				res->data[0] = SIM_NFCA_SAK_CASCADE;
+				a->level++;
+			} else {
+				res->data[0] = a->sak;
+				a->state = SIM_NFCA_ACTIVE;
+			}
+			res->len = 1;
+			return SIM_NFCA_ANSWER;
+		}
+
+		/* Anticollision: tags whose UID starts with the bits sent answer the remaining ones */
+		if ((nvb >> 4) < 2)
+			return SIM_NFCA_SILENT;
+		known = (((nvb >> 4) - 2) * 8) + (nvb & 0x0F);
+		if ((known > 40) || (known != (((uint32_t)req->len * 8) + req->bits - 16)))
+			return SIM_NFCA_SILENT;
+		for (i = 0; i < known; i++) {
+			if (sim_bit(req->data, 16 + i) != sim_bit(cl, i))
+				return SIM_NFCA_SILENT;
+		}
+
+		memset(res->data, 0, 5);
+		for (i = known; i < 40; i++) {
+			if (sim_bit(cl, i))
+				res->data[(i - known) / 8] |= (1 << ((i - known) % 8));
+		}
+		res->len = (uint16_t)((40 - known) / 8);
+		res->bits = (uint8_t)((40 - known) % 8);
+		res->crc = false;
+		return SIM_NFCA_ANSWER;
+	}
+
+	if (a->state == SIM_NFCA_ACTIVE)
+		return SIM_NFCA_PASS;
+
+	if (a->state == SIM_NFCA_READY)
+		a->state = SIM_NFCA_IDLE;
+	return SIM_NFCA_SILENT;
+}
+
+void pltf_sim_t2t_init(pltfSimT2t *tag, const uint8_t uid[7])
+{
+	uint8_t p;
+
+	memset(tag, 0, sizeof(*tag));
+	tag->tag.tech = PLTF_SIM_TECH_NFCA;
+	tag->tag.reset = sim_t2t_reset;
+	tag->tag.receive = sim_t2t_receive;
+
+	memcpy(tag->nfca.uid, uid, 7);
+	tag->nfca.uidLen = 7;
+	tag->nfca.atqa[0] = 0x44;
+	tag->nfca.atqa[1] = 0x00;
+	tag->nfca.sak = 0x00;
+
+	/* UID and BCCs, internal and lock bytes, capability container, empty NDEF */
+	tag->mem[0][0] = uid[0];
+	tag->mem[0][1] = uid[1];
+	tag->mem[0][2] = uid[2];
+	tag->mem[0][3] = SIM_NFCA_CT ^ uid[0] ^ uid[1] ^ uid[2];
+	memcpy(tag->mem[1], &uid[3], 4);
+	tag->mem[2][0] = uid[3] ^ uid[4] ^ uid[5] ^ uid[6];
+	tag->mem[2][1] = 0x48;
+	tag->mem[3][0] = 0xE1;
+	tag->mem[3][1] = 0x10;
+	tag->mem[3][2] = 0x12;
+	tag->mem[4][0] = 0x03;
+	tag->mem[4][1] = 0x00;
+	tag->mem[4][2] = 0xFE;
+	for (p = 5; p < (PLTF_SIM_T2T_PAGES - 5); p++)
+		memset(tag->mem[p], p, 4);
+
+	sim_t2t_reset(&tag->tag);
+}
+
+void pltf_sim_isodep_init(pltfSimIsoDep *tag, const uint8_t uid[4])
+{
+	memset(tag, 0, sizeof(*tag));
+	tag->tag.tech = PLTF_SIM_TECH_NFCA;
+	tag->tag.reset = sim_isodep_reset;
+	tag->tag.receive = sim_isodep_receive;
+
+	memcpy(tag->nfca.uid, uid, 4);
+	tag->nfca.uidLen = 4;
+	tag->nfca.atqa[0] = 0x04;
+	tag->nfca.atqa[1] = 0x00;
+	tag->nfca.sak = 0x20;
+	tag->fsd = 256;
+
+	sim_isodep_reset(&tag->tag);
+}
+
+void pltf_sim_felica_init(pltfSimFelica *tag, const uint8_t idm[8])
+{
+	static const uint8_t pmm[8] = { 0x00, 0xF0, 0x00, 0x00, 0x02, 0x06, 0x03, 0x00 };
+	uint8_t b;
+
+	memset(tag, 0, sizeof(*tag));
+	tag->tag.tech = PLTF_SIM_TECH_NFCF;
+	tag->tag.receive = sim_felica_receive;
+
+	memcpy(tag->idm, idm, 8);
+	memcpy(tag->pmm, pmm, 8);
+	tag->sysCode = 0x12FC;
+
+	/* Attribute information block of an empty T3T */
+	tag->mem[0][0] = 0x10;
+	tag->mem[0][1] = 0x04;
+	tag->mem[0][2] = 0x01;
+	tag->mem[0][4] = PLTF_SIM_FELICA_BLOCKS - 1;
+	tag->mem[0][9] = 0x00;
+	tag->mem[0][10] = 0x01;
+	for (b = 1; b < PLTF_SIM_FELICA_BLOCKS; b++)
+		memset(tag->mem[b], b, 16);
+}
+
+ReturnCode pltf_sim_tags_add(const char *spec)
+{
+	pltfReader r = pltf_reader_current();
+	const char *p = spec;
+	char type[16];
+	uint8_t id[8];
+	unsigned long count, i;
+	pltfSimTag *tag;
+	ReturnCode err;
+	size_t n;
+	char *end;
+
+	while ((p != NULL) && (*p != '\0')) {
+		n = strcspn(p, "=,");
+		if ((n == 0) || (n >= sizeof(type)))
+			return ERR_PARAM;
+		memcpy(type, p, n);
+		type[n] = '\0';
+		p += n;
+
+		count = 1;
+		if (*p == '=') {
+			count = strtoul(p + 1, &end, 10);
+			if ((end == (p + 1)) || (count > 16))
+				return ERR_PARAM;
+			p = end;
+		}
+		if (*p == ',')
+			p++;
+		else if (*p != '\0')
+			return ERR_PARAM;
+
+		/* UIDs from the reader and the index, NFC-V tags differ in their slot nibble */
+		for (i = 0; i < count; i++) {
+			if (!strcmp(type, "nfcv")) {
+				uint8_t uid[8] = { (uint8_t)((i << 4) | i), (uint8_t)r, 0xA5, 0x5A, 0x00, 0x01, 0x04, 0xE0 };
+				tag = calloc(1, sizeof(pltfSimNfcv));
+				if (tag != NULL)
+					pltf_sim_nfcv_init((pltfSimNfcv *)tag, uid, 80, 4);
+			} else if (!strcmp(type, "t2t")) {
+				uint8_t uid[7] = { 0x04, 0x53, (uint8_t)r, (uint8_t)i, 0x1A, 0x2B, 0x80 };
+				tag = calloc(1, sizeof(pltfSimT2t));
+				if (tag != NULL)
+					pltf_sim_t2t_init((pltfSimT2t *)tag, uid);
+			} else if (!strcmp(type, "isodep")) {
+				uint8_t uid[4] = { 0x08, (uint8_t)r, (uint8_t)i, 0x3C };
+				tag = calloc(1, sizeof(pltfSimIsoDep));
+				if (tag != NULL)
+					pltf_sim_isodep_init((pltfSimIsoDep *)tag, uid);
+			} else if (!strcmp(type, "felica")) {
+				memset(id, 0, sizeof(id));
+				id[0] = 0x01;
+				id[1] = 0x2E;
+				id[2] = (uint8_t)r;
+				id[7] = (uint8_t)i;
+				tag = calloc(1, sizeof(pltfSimFelica));
+				if (tag != NULL)
+					pltf_sim_felica_init((pltfSimFelica *)tag, id);
+			} else {
+				return ERR_PARAM;
+			}
+
+			if (tag == NULL)
+				return ERR_NOMEM;
+			err = pltf_sim_tag_attach(tag);
+			if (err != ERR_NONE) {
+				free(tag);
+				return err;
+			}
+		}
+	}
+
+	return ERR_NONE;
+}
+
+void sim_tags_env(void)
+{
+	const char *spec = getenv(PLTF_SIM_TAGS_ENV);
+
+	if ((spec == NULL) || (*spec == '\0'))
+		return;
+
+	if (pltf_sim_tags_add(spec) != ERR_NONE)
+		printf("Error: invalid %s list \"%s\"\n", PLTF_SIM_TAGS_ENV, spec);
+}
@@ -68,6 +68,20 @@
  */
 #define RFAL_NFCV_UID_LEN                           8    /*!< NFC-V UID length  */
 #define RFAL_NFCV_MAX_BLOCK_LEN           32    /*!< Max Block size: can be of up to 256 bits  ISO 15693 2000  5       */
+#define RFAL_NFCV_MAX_BLOCKS              256   /*!< Max number of blocks: block numbers are a byte  ISO 15693 2000  5 */
+#define RFAL_NFCV_MAX_WR_MULTIPLE_LEN     128   /*!< Max data of a Write Multiple Blocks request                         */
+#define RFAL_NFCV_MAX_REQ_LEN             (2 + RFAL_NFCV_UID_LEN + 2 + RFAL_NFCV_MAX_WR_MULTIPLE_LEN) /*!< Max request length: flags, command, UID, two parameters and the data written */
+#define RFAL_NFCV_MAX_RES_LEN             RFAL_NFCV_MAX_RX_LEN  /*!< Max response length (RES_FLAGS and data) received by the RF layer    */
+
+#ifndef RFAL_NFCV_DUMP_RETRIES
+  #define RFAL_NFCV_DUMP_RETRIES          2     /*!< Retries of a memory dump chunk after a transmission error           */
+#endif
+
+#ifndef RFAL_NFCV_WRITE_RETRIES
+  #define RFAL_NFCV_WRITE_RETRIES         2     /*!< Retries of a memory write chunk after a transmission error          */
+#endif
+
+#define RFAL_NFCV_IC_MFG_NXP              0x04  /*!< IC manufacturer code of NXP, sent with the ICODE custom commands    */
 
 
 
@@ -125,7 +139,18 @@ enum
     RFAL_NFCF_CMD_SELECT                 = 0x25,      /*!< Select command                                               */
     RFAL_NFCF_CMD_RESET_TO_READY         = 0x26,      /*!< Reset To Ready command                                       */
     RFAL_NFCF_CMD_GET_SYS_INFO           = 0x2B,      /*!< Get System Information command                               */
-    RFAL_NFCF_CMD_EXTENDED_GET_SYS_INFO  = 0x2B       /*!< Extended Get System Information command (ST Proprietary)     */
+    RFAL_NFCF_CMD_EXTENDED_GET_SYS_INFO  = 0x2B,      /*!< Extended Get System Information command (ST Proprietary)     */
+    RFAL_NFCF_CMD_INVENTORY_READ         = 0xA0,      /*!< Inventory Read command (NXP ICODE custom)                    */
+    RFAL_NFCF_CMD_FAST_INVENTORY_READ    = 0xA1,      /*!< Fast Inventory Read command (NXP ICODE custom)               */
+    RFAL_NFCF_CMD_FAST_READ_MULTIPLE_BLOCKS = 0xC3    /*!< Fast Read multiple blocks command (NXP ICODE custom)         */
+};
+
+/*! NFC-V Get System Information INFO_FLAGS   ISO15693 2000 10.4.12 */
+enum{
+    RFAL_NFCV_SYSINFO_DSFID              = 0x01,       /*!< DSFID present                   */
+    RFAL_NFCV_SYSINFO_AFI                = 0x02,       /*!< AFI present                     */
+    RFAL_NFCV_SYSINFO_MEMSIZE            = 0x04,       /*!< VICC memory size present        */
+    RFAL_NFCV_SYSINFO_ICREF              = 0x08,       /*!< IC reference present            */
 };
 
 /*
@@ -159,6 +184,19 @@ typedef struct
 } rfalNfcvInventoryRes;
 
 
+/*! NFC-V System Information, from the Get System Information response   ISO15693 2000 10.4.12 */
+typedef struct
+{
+    uint8_t  infoFlags;                 /*!< INFO_FLAGS: fields present     */
+    uint8_t  UID[RFAL_NFCV_UID_LEN];    /*!< NFC-V device UID               */
+    uint8_t  DSFID;                     /*!< Data Storage Format Identifier */
+    uint8_t  AFI;                       /*!< Application Family Identifier  */
+    uint16_t numBlocks;                 /*!< Number of blocks               */
+    uint8_t  blockLen;                  /*!< Block size in bytes            */
+    uint8_t  icRef;                     /*!< IC reference                   */
+} rfalNfcvSystemInfo;
+
+
 /*! NFC-V listener device (VICC) struct  */
 typedef struct
 {
@@ -325,6 +363,9 @@ ReturnCode rfalNfvPollerReadSingleBlock( uint8_t flags, uint8_t* uid, uint8_t bl
  *  
  * Writes a Single Block from a device (VICC)
  *
+ * With the Option flag set the device answers once the block is 
+ * programmed and an EOF received: EOFs are sent until it does
+ *
  * \param[in]  flags        : Flags to be used: Sub-carrier; Data_rate; Option
  *                            for NFC-Forum use: RFAL_NFCV_REQ_FLAG_DEFAULT
  * \param[in]  uid          : UID of the device to be put to be read
@@ -372,6 +413,251 @@ ReturnCode rfalNfvPollerWriteSingleBlock( uint8_t flags, uint8_t* uid, uint8_t b
  */
 ReturnCode rfalNfvPollerReadMultipleBlocks( uint8_t flags, uint8_t* uid, uint8_t firstBlockNum, uint8_t numOfBlocks, uint8_t* rxBuf, uint16_t rxBufLen, uint16_t *rcvLen );
 
+/*! 
+ *****************************************************************************
+ * \brief  NFC-V Poller Write Multiple Blocks
+ *  
+ * Writes Multiple Blocks to a device (VICC)
+ *
+ * With the Option flag set the device answers once the blocks are 
+ * programmed and an EOF received: EOFs are sent until it does
+ *
+ * \param[in]  flags          : Flags to be used: Sub-carrier; Data_rate; Option
+ *                              for NFC-Forum use: RFAL_NFCV_REQ_FLAG_DEFAULT
+ * \param[in]  uid            : UID of the device to be written
+ *                               if not provided Select mode will be used 
+ * \param[in]  firstBlockNum  : first block to be written
+ * \param[in]  numOfBlocks    : number of blocks to be written minus one, as sent
+ * \param[in]  wrData         : data to be written, blockLen bytes per block
+ * \param[in]  blockLen       : number of bytes of a block
+ *  
+ * \return ERR_WRONG_STATE    : RFAL not initialized or incorrect mode
+ * \return ERR_PARAM          : Invalid parameters or more than RFAL_NFCV_MAX_WR_MULTIPLE_LEN bytes
+ * \return ERR_NOTSUPP        : Command or option not supported by the device
+ * \return ERR_IO             : Generic internal error 
+ * \return ERR_CRC            : CRC error detected
+ * \return ERR_FRAMING        : Framing error detected
+ * \return ERR_PROTO          : Protocol error detected
+ * \return ERR_TIMEOUT        : Timeout error
+ * \return ERR_NONE           : No error
+ *****************************************************************************
+ */
+ReturnCode rfalNfvPollerWriteMultipleBlocks( uint8_t flags, uint8_t* uid, uint8_t firstBlockNum, uint8_t numOfBlocks, const uint8_t* wrData, uint8_t blockLen );
+
+/*! 
+ *****************************************************************************
+ * \brief  NFC-V Poller Get System Information
+ *  
+ * Retrieves the System Information of a device (VICC): UID, DSFID, AFI,
+ * IC reference and memory geometry. The fields the device does not 
+ * report are left at 0, see infoFlags
+ *
+ * \param[in]  flags          : Flags to be used: Sub-carrier; Data_rate
+ *                              for NFC-Forum use: RFAL_NFCV_REQ_FLAG_DEFAULT
+ * \param[in]  uid            : UID of the device to be queried
+ *                               if not provided Select mode will be used 
+ * \param[out] sysInfo        : location to place the System Information
+ *  
+ * \return ERR_WRONG_STATE    : RFAL not initialized or incorrect mode
+ * \return ERR_PARAM          : Invalid parameters
+ * \return ERR_IO             : Generic internal error 
+ * \return ERR_CRC            : CRC error detected
+ * \return ERR_FRAMING        : Framing error detected
+ * \return ERR_PROTO          : Protocol error detected
+ * \return ERR_TIMEOUT        : Timeout error
+ * \return ERR_NONE           : No error
+ *****************************************************************************
+ */
+ReturnCode rfalNfcvPollerGetSystemInformation( uint8_t flags, uint8_t* uid, rfalNfcvSystemInfo *sysInfo );
+
+/*! 
+ *****************************************************************************
+ * \brief  NFC-V Poller Dump Memory
+ *  
+ * Reads the whole memory of a device (VICC). The geometry is taken from
+ * Get System Information, the blocks are then read with Read Multiple 
+ * Blocks in the largest chunks whose response fits RFAL_NFCV_MAX_RES_LEN.
+ * A chunk failing on a transmission error is retried up to 
+ * RFAL_NFCV_DUMP_RETRIES times; one the device rejects is read again
+ * in halves. Chunks already read are not read again.
+ *
+ * \param[in]  flags          : Flags to be used: Sub-carrier; Data_rate
+ *                              for NFC-Forum use: RFAL_NFCV_REQ_FLAG_DEFAULT
+ * \param[in]  uid            : UID of the device to be read
+ *                               if not provided Select mode will be used 
+ * \param[out] sysInfo        : System Information of the device, may be NULL
+ * \param[out] data           : buffer to store the memory content, without RES_FLAGS
+ * \param[in]  dataLen        : length of data
+ * \param[out] secStatus      : buffer to store the block security status, 
+ *                              one byte per block, NULL not to request it 
+ * \param[in]  secStatusLen   : length of secStatus
+ * \param[out] rcvLen         : number of bytes stored in data
+ *  
+ * \return ERR_WRONG_STATE    : RFAL not initialized or incorrect mode
+ * \return ERR_PARAM          : Invalid parameters
+ * \return ERR_NOTSUPP        : Memory size not reported by the device
+ * \return ERR_NOMEM          : Memory does not fit in data or secStatus
+ * \return ERR_IO             : Generic internal error 
+ * \return ERR_CRC            : CRC error detected
+ * \return ERR_FRAMING        : Framing error detected
+ * \return ERR_PROTO          : Protocol error detected
+ * \return ERR_TIMEOUT        : Timeout error
+ * \return ERR_NONE           : No error
+ *****************************************************************************
+ */
+ReturnCode rfalNfcvPollerDumpMemory( uint8_t flags, uint8_t* uid, rfalNfcvSystemInfo *sysInfo, uint8_t* data, uint16_t dataLen, uint8_t* secStatus, uint16_t secStatusLen, uint16_t *rcvLen );
+
+/*! 
+ *****************************************************************************
+ * \brief  NFC-V Poller Write Memory
+ *  
+ * Writes consecutive blocks of a device (VICC) with Write Multiple Blocks,
+ * in chunks of up to RFAL_NFCV_MAX_WR_MULTIPLE_LEN bytes. Devices which do
+ * not support it are written one block at a time, chunks a device rejects
+ * are written again in halves. A chunk failing on a transmission error is
+ * retried up to RFAL_NFCV_WRITE_RETRIES times.
+ *
+ * With the Option flag set the end of each write is polled with EOFs.
+ * On request the blocks written are read back with Read Multiple Blocks
+ * and compared.
+ *
+ * \param[in]  flags          : Flags to be used: Sub-carrier; Data_rate; Option
+ *                              for NFC-Forum use: RFAL_NFCV_REQ_FLAG_DEFAULT
+ * \param[in]  uid            : UID of the device to be written
+ *                               if not provided Select mode will be used 
+ * \param[in]  firstBlockNum  : first block to be written
+ * \param[in]  numBlocks      : number of blocks to be written
+ * \param[in]  blockLen       : number of bytes of a block
+ * \param[in]  wrData         : data to be written, numBlocks * blockLen bytes
+ * \param[in]  verify         : read the blocks back once written
+ *  
+ * \return ERR_WRONG_STATE    : RFAL not initialized or incorrect mode
+ * \return ERR_PARAM          : Invalid parameters
+ * \return ERR_NOTSUPP        : Command or option not supported by the device
+ * \return ERR_WRITE          : Write failed, or data read back differs
+ * \return ERR_REQUEST        : Write rejected by the device (e.g. block locked)
+ * \return ERR_IO             : Generic internal error 
+ * \return ERR_CRC            : CRC error detected
+ * \return ERR_FRAMING        : Framing error detected
+ * \return ERR_PROTO          : Protocol error detected
+ * \return ERR_TIMEOUT        : Timeout error
+ * \return ERR_NONE           : No error
+ *****************************************************************************
+ */
+ReturnCode rfalNfcvPollerWriteMemory( uint8_t flags, uint8_t* uid, uint8_t firstBlockNum, uint16_t numBlocks, uint8_t blockLen, const uint8_t* wrData, bool verify );
+
+/*! 
+ *****************************************************************************
+ * \brief  NFC-V Poller Inventory Read (NXP ICODE)
+ *  
+ * Sends the INVENTORY READ custom command with one slot: the devices 
+ * matching the mask answer with their blocks, saving the inventory and the
+ * Read Multiple Blocks of an identification to a single frame
+ *
+ * The FAST INVENTORY READ variant is answered at 53kbps, the Rx bit rate is
+ * switched to RFAL_BR_52p97 for the response and restored afterwards
+ *
+ * When uid is provided the Option flag is set: the device also sends the 
+ * part of its UID past the mask, and uid is completed from maskVal
+ *
+ * \param[in]  fast           : true to send FAST INVENTORY READ
+ * \param[in]  maskLen        : Number bits on the Mask value
+ * \param[in]  maskVal        : location of the Mask value
+ * \param[in]  firstBlockNum  : first block to be read
+ * \param[in]  numOfBlocks    : number of blocks to be read minus one, as sent
+ * \param[out] uid            : location to place the UID of the device, may be NULL
+ * \param[out] rxBuf          : buffer to store the blocks (with RES_FLAGS)
+ * \param[in]  rxBufLen       : length of rxBuf
+ * \param[out] rcvLen         : number of bytes placed in rxBuf
+ *  
+ * \return ERR_WRONG_STATE    : RFAL not initialized or incorrect mode
+ * \return ERR_PARAM          : Invalid parameters
+ * \return ERR_NOMEM          : Blocks do not fit in rxBuf
+ * \return ERR_IO             : Generic internal error 
+ * \return ERR_RF_COLLISION   : Collision detected, see rfalNfcvPollerCollisionResolution()
+ * \return ERR_CRC            : CRC error detected
+ * \return ERR_FRAMING        : Framing error detected
+ * \return ERR_PROTO          : Protocol error detected
+ * \return ERR_TIMEOUT        : No device answered
+ * \return ERR_NONE           : No error
+ *****************************************************************************
+ */
+ReturnCode rfalNfcvPollerInventoryRead( bool fast, uint8_t maskLen, const uint8_t* maskVal, uint8_t firstBlockNum, uint8_t numOfBlocks, uint8_t* uid, uint8_t* rxBuf, uint16_t rxBufLen, uint16_t *rcvLen );
+
+/*! 
+ *****************************************************************************
+ * \brief  NFC-V Poller Fast Read Multiple Blocks (NXP ICODE)
+ *  
+ * Reads Multiple Blocks from a device (VICC) with the FAST READ MULTIPLE
+ * BLOCKS custom command, answered at 53kbps: the Rx bit rate is switched
+ * to RFAL_BR_52p97 for the response and restored afterwards
+ *
+ * \param[in]  flags          : Flags to be used: Sub-carrier; Data_rate; Option
+ *                              for NFC-Forum use: RFAL_NFCV_REQ_FLAG_DEFAULT
+ * \param[in]  uid            : UID of the device to be read
+ *                               if not provided Select mode will be used 
+ * \param[in]  firstBlockNum  : first block to be read
+ * \param[in]  numOfBlocks    : number of blocks to be read minus one, as sent
+ * \param[out] rxBuf          : buffer to store response (also with RES_FLAGS)
+ * \param[in]  rxBufLen       : length of rxBuf
+ * \param[out] rcvLen         : number of bytes received
+ *  
+ * \return ERR_WRONG_STATE    : RFAL not initialized or incorrect mode
+ * \return ERR_PARAM          : Invalid parameters
+ * \return ERR_NOTSUPP        : Command not supported by the device
+ * \return ERR_IO             : Generic internal error 
+ * \return ERR_CRC            : CRC error detected
+ * \return ERR_FRAMING        : Framing error detected
+ * \return ERR_PROTO          : Protocol error detected
+ * \return ERR_TIMEOUT        : Timeout error
+ * \return ERR_NONE           : No error
+ *****************************************************************************
+ */
+ReturnCode rfalNfcvPollerFastReadMultipleBlocks( uint8_t flags, uint8_t* uid, uint8_t firstBlockNum, uint8_t numOfBlocks, uint8_t* rxBuf, uint16_t rxBufLen, uint16_t *rcvLen );
+
+/*! 
+ *****************************************************************************
+ * \brief  NFC-V Poller Build Request
+ *  
+ * Builds the request of a command without transmitting it, for callers 
+ * which run the exchange themselves (e.g. the transceive queue)
+ *
+ * \param[in]  flags          : Flags to be used: Sub-carrier; Data_rate; Option
+ *                              for NFC-Forum use: RFAL_NFCV_REQ_FLAG_DEFAULT
+ * \param[in]  cmd            : Command code
+ * \param[in]  uid            : UID of the device addressed
+ *                               if not provided Select mode will be used 
+ * \param[in]  param          : command parameters following the UID, may be NULL
+ * \param[in]  paramLen       : length of param
+ * \param[out] req            : buffer to store the request
+ * \param[in]  reqBufLen      : length of req
+ * \param[out] reqLen         : length of the request in bytes
+ *  
+ * \return ERR_PARAM          : Invalid parameters
+ * \return ERR_NOMEM          : Request does not fit in req
+ * \return ERR_NONE           : No error
+ *****************************************************************************
+ */
+ReturnCode rfalNfcvPollerBuildRequest( uint8_t flags, uint8_t cmd, const uint8_t* uid, const uint8_t* param, uint8_t paramLen, uint8_t* req, uint16_t reqBufLen, uint16_t* reqLen );
+
+/*! 
+ *****************************************************************************
+ * \brief  NFC-V Poller Check Response
+ *  
+ * Checks the response of a request built by rfalNfcvPollerBuildRequest()
+ *
+ * \param[in]  rxBuf          : response received (with RES_FLAGS)
+ * \param[in]  rcvLen         : number of bytes received
+ *  
+ * \return ERR_PROTO          : Response too short or command not recognized
+ * \return ERR_NOTSUPP        : Command or option not supported
+ * \return ERR_WRITE          : Write failed
+ * \return ERR_REQUEST        : Other error signalled by the device
+ * \return ERR_NONE           : No error
+ *****************************************************************************
+ */
+ReturnCode rfalNfcvPollerCheckResponse( const uint8_t* rxBuf, uint16_t rcvLen );
+
 #endif /* RFAL_NFCV_H */
 
 /**
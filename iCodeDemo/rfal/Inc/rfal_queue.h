@@ -0,0 +1,220 @@
+
+/******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; COPYRIGHT 2018 STMicroelectronics</center></h2>
+  *
+  * Licensed under ST MYLIBERTY SOFTWARE LICENSE AGREEMENT (the "License");
+  * You may not use this file except in compliance with the License.
+  * You may obtain a copy of the License at:
+  *
+  *        http://www.st.com/myliberty
+  *
+  * Unless required by applicable law or agreed to in writing, software 
+  * distributed under the License is distributed on an "AS IS" BASIS, 
+  * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied,
+  * AND SPECIFICALLY DISCLAIMING THE IMPLIED WARRANTIES OF MERCHANTABILITY,
+  * FITNESS FOR A PARTICULAR PURPOSE, AND NON-INFRINGEMENT.
+  * See the License for the specific language governing permissions and
+  * limitations under the License.
+  *
+******************************************************************************/
+
+
+/*
+ *      PROJECT:   ST25R391x firmware
+ *      $Revision: $
+ *      LANGUAGE:  ISO C99
+ */
+
+/*! \file rfal_queue.h
+ *
+ *  \brief Transceive queue with completion callbacks
+ *
+ *  Requests (raw transceives, NFC-V commands and ISO-DEP APDUs) are
+ *  submitted with their buffers and a completion callback, and are run
+ *  one after the other, in submission order, by rfalQueueWorker().
+ *
+ *  The worker is non-blocking: it is meant to be called from the handler
+ *  of the reader's event loop (see pltf_evloop.h), which runs on every
+ *  IRQ and timer deadline of the reader. As soon as a request completes
+ *  its callback is called and the next request is started within the
+ *  same worker run, its NFC-V request frame having been built on
+ *  submission and coded (rfalPreCodeTransceive()) while the previous
+ *  request waited for its response. rfalQueueRunBlocking() drains the
+ *  queue for callers without an event loop.
+ *
+ *  There is one queue per reader; requests must be submitted, and the
+ *  worker run, from a thread bound to that reader. The buffers of a
+ *  request belong to the queue until its callback has been called.
+ *
+ *
+ * @addtogroup RFAL
+ * @{
+ *
+ * @addtogroup RFAL-AL
+ * @brief RFAL Abstraction Layer
+ * @{
+ *
+ * @addtogroup Queue
+ * @brief RFAL Transceive Queue Module
+ * @{
+ *
+ */
+
+#ifndef RFAL_QUEUE_H
+#define RFAL_QUEUE_H
+
+/*
+ ******************************************************************************
+ * INCLUDES
+ ******************************************************************************
+ */
+#include "platform.h"
+#include "st_errno.h"
+#include "rfal_rf.h"
+#include "rfal_nfcv.h"
+#include "rfal_isoDep.h"
+
+/*
+ ******************************************************************************
+ * GLOBAL DEFINES
+ ******************************************************************************
+ */
+#ifndef RFAL_QUEUE_DEPTH
+  #define RFAL_QUEUE_DEPTH                  8         /*!< Max number of requests queued per reader                          */
+#endif
+
+#define RFAL_QUEUE_NFCV_FWT_DEFAULT         rfalConvMsTo1fc(20) /*!< FWT of NFC-V requests submitted without one     */
+
+/*
+******************************************************************************
+* GLOBAL TYPES
+******************************************************************************
+*/
+
+/*! Type of a queued request */
+typedef enum
+{
+    RFAL_QUEUE_REQ_TXRX    = 0,                        /*!< Raw transceive, see rfalStartTransceive()                      */
+    RFAL_QUEUE_REQ_NFCV    = 1,                        /*!< NFC-V command, request built by rfalNfcvPollerBuildRequest()   */
+    RFAL_QUEUE_REQ_ISODEP  = 2,                        /*!< ISO-DEP APDU, see rfalIsoDepStartApduTransceive()              */
+} rfalQueueReqType;
+
+
+/*! NFC-V command of a queued request */
+typedef struct
+{
+    uint8_t               flags;                       /*!< (In)  Request flags, Address/Select set from uid          */
+    uint8_t               cmd;                         /*!< (In)  Command code                                        */
+    const uint8_t*        uid;                         /*!< (In)  UID addressed, NULL for Select mode                 */
+    const uint8_t*        param;                       /*!< (In)  Command parameters following the UID, may be NULL   */
+    uint8_t               paramLen;                    /*!< (In)  Length of param                                     */
+    uint8_t*              rxBuf;                       /*!< (Out) Buffer to store the response (with RES_FLAGS)       */
+    uint16_t              rxBufLen;                    /*!< (In)  Length of rxBuf in bytes                            */
+    uint32_t              fwt;                         /*!< (In)  FWT in 1/fc, 0 for RFAL_QUEUE_NFCV_FWT_DEFAULT      */
+} rfalQueueNfcvCmd;
+
+
+typedef struct rfalQueueReq rfalQueueReq;
+
+/*! Completion callback, req is valid only during the call */
+typedef void (* rfalQueueCallback)( rfalQueueReq *req, ReturnCode ret );
+
+
+/*! Queued request */
+struct rfalQueueReq
+{
+    rfalQueueReqType      type;                        /*!< (In)  Request type                                        */
+    union
+    {
+        rfalTransceiveContext    txRx;                 /*!< (In)  Raw transceive, rxRcvdLen may be NULL               */
+        rfalQueueNfcvCmd         nfcv;                 /*!< (In)  NFC-V command                                       */
+        rfalIsoDepApduTxRxParam  isoDep;               /*!< (In)  ISO-DEP APDU, rxLen may be NULL                     */
+    } cmd;
+    rfalQueueCallback     callback;                    /*!< (In)  Called on completion, may be NULL                   */
+    void*                 arg;                         /*!< (In)  Passed to the callback through req                  */
+    uint16_t              rcvLen;                      /*!< (Out) Received length in bytes, set before the callback   */
+};
+
+
+/*
+******************************************************************************
+* GLOBAL FUNCTION PROTOTYPES
+******************************************************************************
+*/
+
+/*!
+ *****************************************************************************
+ * \brief  Initialize the transceive queue
+ *
+ * Empties the queue of the current reader; the callbacks of the dropped
+ * requests are not called. A request already started is left to RFAL.
+ *
+ *****************************************************************************
+ */
+void rfalQueueInitialize( void );
+
+/*!
+ *****************************************************************************
+ * \brief  Submit a request
+ *
+ * Copies the request to the end of the queue. NFC-V request frames are
+ * built here so that the request can be started as soon as the previous
+ * one completes. The request is started by the next rfalQueueWorker() run.
+ * Callbacks may submit further requests.
+ *
+ * \param[in]  req            : request to queue
+ *
+ * \return ERR_PARAM          : Invalid request
+ * \return ERR_NOMEM          : Queue full, or NFC-V request too long
+ * \return ERR_NONE           : Request queued
+ *****************************************************************************
+ */
+ReturnCode rfalQueueSubmit( const rfalQueueReq *req );
+
+/*!
+ *****************************************************************************
+ * \brief  Run the transceive queue
+ *
+ * Runs the RFAL worker for the request in progress. Each request that
+ * completes is removed, its callback called and the next request started,
+ * until one is in progress or the queue is empty. A request that fails to
+ * start completes with the error of its start.
+ *
+ * \return ERR_BUSY           : A request is in progress
+ * \return ERR_NONE           : Queue empty
+ *****************************************************************************
+ */
+ReturnCode rfalQueueWorker( void );
+
+/*!
+ *****************************************************************************
+ * \brief  Run the transceive queue until it is empty
+ *
+ * Runs rfalQueueWorker(), sleeping until the next IRQ while a request is
+ * in progress, including the requests submitted by callbacks meanwhile.
+ *
+ *****************************************************************************
+ */
+void rfalQueueRunBlocking( void );
+
+/*!
+ *****************************************************************************
+ * \brief  Number of queued requests
+ *
+ * \return the number of requests of the current reader not yet completed,
+ *         including the one in progress
+ *****************************************************************************
+ */
+uint8_t rfalQueueGetCount( void );
+
+#endif /* RFAL_QUEUE_H */
+
+/**
+  * @}
+  *
+  * @}
+  *
+  * @}
+  */
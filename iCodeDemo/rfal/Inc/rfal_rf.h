@@ -107,6 +107,7 @@
 #define RFAL_BITS_IN_BYTE                          (uint16_t)8        /*!< Number of bits in one byte           */
 
 #define RFAL_CRC_LEN                               2                  /*!< RF CRC LEN                           */
+#define RFAL_NFCV_MAX_RX_LEN                       255                /*!< Max NFC-V frame received (flags and data, CRC excluded): bounded by the decoding buffer */
 
 /*! Default TxRx flags: Tx CRC automatic, Rx CRC removed, NFCIP1 mode off, AGC On, Tx Parity automatic, Rx Parity removed */
 #define RFAL_TXRX_FLAGS_DEFAULT                    ( RFAL_TXRX_FLAGS_CRC_TX_AUTO | RFAL_TXRX_FLAGS_CRC_RX_REMV | RFAL_TXRX_FLAGS_NFCIP1_OFF | RFAL_TXRX_FLAGS_AGC_ON | RFAL_TXRX_FLAGS_PAR_RX_REMV | RFAL_TXRX_FLAGS_PAR_TX_AUTO | RFAL_TXRX_FLAGS_NFCV_FLAG_AUTO)
@@ -163,12 +164,41 @@
 #define rfalConv1fcToMs( t )                 (uint32_t)( (t) / RFAL_1MS_IN_1FC )                               /*!< Converts the given t from 1/fc to ms       */
 #define rfalConvMsTo1fc( t )                 (uint32_t)( (t) * RFAL_1MS_IN_1FC )                               /*!< Converts the given t from ms to 1/fc       */
 
-#define rfalConv1fcToUs( t )                 (uint32_t)( (t * RFAL_US_IN_MS) / RFAL_1MS_IN_1FC)                /*!< Converts the given t from 1/fc to us       */
-#define rfalConvUsTo1fc( t )                 (uint32_t)( (t * RFAL_1MS_IN_1FC) / RFAL_US_IN_MS)                /*!< Converts the given t from us to 1/fc       */
+#define rfalConv1fcToUs( t )                 (uint32_t)( ((uint64_t)(t) * RFAL_US_IN_MS) / RFAL_1MS_IN_1FC)    /*!< Converts the given t from 1/fc to us       */
+#define rfalConvUsTo1fc( t )                 (uint32_t)( ((uint64_t)(t) * RFAL_1MS_IN_1FC) / RFAL_US_IN_MS)    /*!< Converts the given t from us to 1/fc       */
 
 #define rfalConv64fcToMs( t )                (uint32_t)( (t) / (RFAL_1MS_IN_1FC / RFAL_1FC_IN_64FC) )          /*!< Converts the given t from 64/fc to ms      */
 #define rfalConvMsTo64fc( t )                (uint32_t)( (t) * (RFAL_1MS_IN_1FC / RFAL_1FC_IN_64FC) )          /*!< Converts the given t from ms to 64/fc      */
 
+/* Platforms providing only ms timers: round us up to the next ms */
+#ifndef platformTimerCreateUs
+  #define platformTimerCreateUs( t )         platformTimerCreate( (((t) + (RFAL_US_IN_MS - 1)) / RFAL_US_IN_MS) ) /*!< Create a timer with the given time (us) */
+#endif
+#ifndef platformDelayUs
+  #define platformDelayUs( t )               platformDelay( (((t) + (RFAL_US_IN_MS - 1)) / RFAL_US_IN_MS) )       /*!< Performs a delay for the given time (us)  */
+#endif
+
+/* Platforms without IRQ wake-up support keep polling */
+#ifndef platformIrqSequence
+  #define platformIrqSequence()              (0U)                                                              /*!< IRQ sequence number not available          */
+#endif
+#ifndef platformIrqWait
+  #define platformIrqWait( seq, us )         (false)                                                           /*!< Return immediately, caller polls           */
+#endif
+#ifndef platformTimerNextDeadline
+  #define platformTimerNextDeadline( since, d ) (false)                                                        /*!< SW timer deadlines not followed            */
+#endif
+#ifndef platformGetTimeUs
+  #define platformGetTimeUs()                (platformGetSysTick() * 1000U)                                    /*!< Timestamps with the system tick resolution */
+#endif
+#define RFAL_IRQ_WAIT_SLICE_US               (1000U)                                                           /*!< Max time a blocking loop sleeps in platformIrqWait() before re-checking its timers */
+
+/* Platforms driving a single reader */
+#ifndef platformReaderId
+  #define platformReaderId()                 (0)                                                               /*!< Reader the calling thread works on         */
+  #define PLATFORM_READERS                   (1)                                                               /*!< Number of reader contexts                  */
+#endif
+
 #define rfalConvBitsToBytes( n )             (uint32_t)( (n+(RFAL_BITS_IN_BYTE-1)) / (RFAL_BITS_IN_BYTE) )     /*!< Converts the given n from bits to bytes    */
 #define rfalConvBytesToBits( n )             (uint32_t)( (n) * (RFAL_BITS_IN_BYTE) )                           /*!< Converts the given n from bytes to bits    */
 
@@ -404,6 +434,13 @@ typedef struct {
 } rfalTransceiveContext;
 
 
+/*! State of a blocking loop between a worker run and its IRQ wait, see rfalIrqWaitNext() */
+typedef struct {
+    uint32_t              seq;                /*!< IRQ sequence number read before the run              */
+    uint32_t              start;              /*!< Time the run started (us)                            */
+} rfalIrqWaiter;
+
+
 /*! System callback to indicate an event that requires a system reRun        */
 typedef void (* rfalUpperLayerCallback)(void);
 
@@ -1056,6 +1093,28 @@ rfalTrasceiveState rfalGetTransceiveState( void );
 ReturnCode rfalGetTransceiveStatus( void );
 
 
+/*! 
+ *****************************************************************************
+ * \brief  Code a frame ahead of its Transceive
+ *  
+ * In the modes where the host codes the frames (NFC-V, PicoPass) this codes
+ * the start of the frame of a following Transceive, so that its transmission
+ * only has to load the FIFO. It is meant to be called while the current 
+ * Transceive waits for its response, e.g. by the transceive queue for the 
+ * next request. The frame must not change until it has been transmitted,
+ * otherwise it is coded again. In the other modes this does nothing.
+ * 
+ * \param[in]  ctx : the context of the following Transceive
+ *
+ * \return ERR_PARAM       : Invalid context
+ * \return ERR_BUSY        : A Transceive is transmitting, try again later
+ * \return ERR_NOMEM       : Frame cannot be coded
+ * \return ERR_NONE        : Frame coded, or nothing to code in this mode
+ *****************************************************************************
+ */
+ReturnCode rfalPreCodeTransceive( rfalTransceiveContext *ctx );
+
+
 /*! 
  *****************************************************************************
  *  \brief RFAL Worker
@@ -1069,6 +1128,36 @@ ReturnCode rfalGetTransceiveStatus( void );
 void rfalWorker( void );
 
 
+/*! 
+ *****************************************************************************
+ *  \brief Prepare an IRQ wait
+ *  
+ *  Blocking loops call this before running the worker, so that an IRQ
+ *  handled meanwhile is not missed by the following rfalIrqWaitNext()
+ *
+ *  \param[out] w : wait state to be passed to rfalIrqWaitNext()
+ *
+ *****************************************************************************
+ */
+void rfalIrqWaitPrepare( rfalIrqWaiter *w );
+
+
+/*! 
+ *****************************************************************************
+ *  \brief Wait for the next event of a blocking loop
+ *  
+ *  To be called when the worker made no progress. Sleeps until an IRQ is
+ *  handled after rfalIrqWaitPrepare() or the earliest SW timer created
+ *  since then expires, at most RFAL_IRQ_WAIT_SLICE_US. Returns at once if
+ *  such a timer has already expired.
+ *
+ *  \param[in]  w : wait state filled by rfalIrqWaitPrepare()
+ *
+ *****************************************************************************
+ */
+void rfalIrqWaitNext( const rfalIrqWaiter *w );
+
+
 /*****************************************************************************
  *  ISO1443A                                                                 *  
  *****************************************************************************/
@@ -46,6 +46,27 @@
 ******************************************************************************
 */
 #include "platform.h"
+#include "st_errno.h"
+
+/*
+******************************************************************************
+* GLOBAL TYPES
+******************************************************************************
+*/
+/*! CRC-CCITT engine, see rfalCrcSetEngineCcitt() */
+typedef enum
+{
+    RFAL_CRC_ENGINE_AUTO   = 0,  /*!< Fastest engine the CPU supports for the length, PMULL excluded */
+    RFAL_CRC_ENGINE_BYTE   = 1,  /*!< A byte at a time, shifts and XORs                 */
+    RFAL_CRC_ENGINE_SLICE8 = 2,  /*!< 8 bytes at a time, table lookups                  */
+    RFAL_CRC_ENGINE_CLMUL  = 3,  /*!< 16 bytes at a time, folding with PCLMULQDQ/PMULL  */
+} rfalCrcEngine;
+
+/*! CRC calculation over data handed over in pieces, see rfalCrcInitCcitt() */
+typedef struct
+{
+    uint16_t crc;        /*!< CRC of the data so far */
+} rfalCrcContext;
 
 /*
 ******************************************************************************
@@ -71,5 +92,92 @@
  */
 extern uint16_t rfalCrcCalculateCcitt(uint16_t preloadValue, const uint8_t* buf, uint16_t length);
 
+/*! 
+ *****************************************************************************
+ *  \brief  Start a CRC calculation according to CCITT standard.
+ *
+ *  Starts the calculation of a CRC over data handed over in pieces, e.g.
+ *  as the blocks of a response arrive. rfalCrcUpdateCcitt() adds the
+ *  pieces and rfalCrcGetCcitt() returns the CRC: the result is that of
+ *  rfalCrcCalculateCcitt() over all the pieces in a row.
+ *
+ *  \param[out] ctx : context of the calculation.
+ *  \param[in] preloadValue : Initial value of CRC calculation.
+ *
+ *****************************************************************************
+ */
+extern void rfalCrcInitCcitt(rfalCrcContext* ctx, uint16_t preloadValue);
+
+/*! 
+ *****************************************************************************
+ *  \brief  Add data to a CRC calculation according to CCITT standard.
+ *
+ *  \param[in,out] ctx : context of the calculation.
+ *  \param[in] buf : data following the one added so far.
+ *  \param[in] length : size of the buffer.
+ *
+ *****************************************************************************
+ */
+extern void rfalCrcUpdateCcitt(rfalCrcContext* ctx, const uint8_t* buf, uint16_t length);
+
+/*! 
+ *****************************************************************************
+ *  \brief  Get the CRC of the data added so far.
+ *
+ *  The calculation may go on afterwards.
+ *
+ *  \param[in] ctx : context of the calculation.
+ *
+ *  \return 16 bit long crc value.
+ *
+ *****************************************************************************
+ */
+extern uint16_t rfalCrcGetCcitt(const rfalCrcContext* ctx);
+
+/*! 
+ *****************************************************************************
+ *  \brief  Select the CRC-CCITT engine.
+ *
+ *  All engines give the same CRC. By default the fastest one the CPU
+ *  supports is used for each length; forcing one is meant for tests and
+ *  benchmarks. The selection is common to all readers.
+ *  On AArch64 the PMULL folding is left out of the default selection until
+ *  it has been checked against the reference; RFAL_CRC_ENGINE_CLMUL
+ *  enables it.
+ *
+ *  \param[in] engine : engine to use by rfalCrcUpdateCcitt() and
+ *                      rfalCrcCalculateCcitt().
+ *
+ *  \return ERR_NOTSUPP : the CPU has no carry-less multiply.
+ *  \return ERR_PARAM : unknown engine.
+ *  \return ERR_NONE : engine selected.
+ *
+ *****************************************************************************
+ */
+extern ReturnCode rfalCrcSetEngineCcitt(rfalCrcEngine engine);
+
+/*! 
+ *****************************************************************************
+ *  \brief  Add a byte to a CRC according to CCITT standard.
+ *
+ *  Inline for callers adding single bytes; the byte at a time engine.
+ *
+ *  \param[in] crc : CRC so far.
+ *  \param[in] dat : byte to add.
+ *
+ *  \return 16 bit long crc value.
+ *
+ *****************************************************************************
+ */
+static inline uint16_t rfalCrcUpdateCcittByte(uint16_t crc, uint8_t dat)
+{
+    dat ^= ((uint8_t)crc) & 0xFF;
+    dat ^= dat << 4;
+
+    crc = (crc >> 8)^(((uint16_t) dat) << 8)^(((uint16_t) dat) << 3)^(((uint16_t) dat) >> 4);
+
+    return crc;
+}
+
 #endif /* RFAL_CRC_H_ */
 
@@ -64,10 +64,22 @@
  ******************************************************************************
  */
 
-static uint8_t* gRfalCurrentDynamicPower;
-static uint8_t  gRfalDynamicPowerTableEntries;
-static uint8_t  gRfalDynamicPower[RFAL_DYNAMIC_POWER_TABLE_SIZE_MAX];
-static uint8_t  gRfalTableEntry;
+/*! Dynamic Power state of one reader */
+typedef struct {
+    uint8_t* current;                                     /*!< Table in use, NULL when disabled    */
+    uint8_t  tableEntries;                                /*!< Number of entries of the table      */
+    uint8_t  table[RFAL_DYNAMIC_POWER_TABLE_SIZE_MAX];    /*!< Loaded table                        */
+    uint8_t  tableEntry;                                  /*!< Entry currently applied             */
+} rfalDynamicPowerCtx;
+
+/*
+ ******************************************************************************
+ * LOCAL VARIABLES
+ ******************************************************************************
+ */
+
+static rfalDynamicPowerCtx gRfalDynPwrInstance[PLATFORM_READERS];      /*!< Dynamic Power states, one per reader          */
+#define gRfalDynPwr   (gRfalDynPwrInstance[platformReaderId()])        /*!< Dynamic Power state of the current reader     */
 
 /*
  ******************************************************************************
@@ -77,12 +89,12 @@ static uint8_t  gRfalTableEntry;
 void rfalDynamicPowerInitialize( void )
 {
     /* Use the default Dynamic Power values */
-    gRfalCurrentDynamicPower = (uint8_t*) rfalDynamicPowerDefaultSettings;
-    gRfalDynamicPowerTableEntries = (sizeof(rfalDynamicPowerDefaultSettings) / RFAL_DYNAMIC_POWER_TABLE_PAPAMETER);
+    gRfalDynPwr.current = (uint8_t*) rfalDynamicPowerDefaultSettings;
+    gRfalDynPwr.tableEntries = (sizeof(rfalDynamicPowerDefaultSettings) / RFAL_DYNAMIC_POWER_TABLE_PAPAMETER);
     
-    ST_MEMCPY( gRfalDynamicPower, gRfalCurrentDynamicPower, sizeof(rfalDynamicPowerDefaultSettings) );
+    ST_MEMCPY( gRfalDynPwr.table, gRfalDynPwr.current, sizeof(rfalDynamicPowerDefaultSettings) );
     
-    gRfalTableEntry = 0;
+    gRfalDynPwr.tableEntry = 0;
 }
 
 /*******************************************************************************/
@@ -111,9 +123,9 @@ ReturnCode rfalDynamicPowerTableLoad( rfalDynamicPowerEntry* powerTbl, uint8_t p
         }
     }
     
-    ST_MEMCPY( gRfalDynamicPower, powerTbl, (powerTblEntries * RFAL_DYNAMIC_POWER_TABLE_PAPAMETER) );
-    gRfalCurrentDynamicPower = gRfalDynamicPower;
-    gRfalDynamicPowerTableEntries = powerTblEntries;
+    ST_MEMCPY( gRfalDynPwr.table, powerTbl, (powerTblEntries * RFAL_DYNAMIC_POWER_TABLE_PAPAMETER) );
+    gRfalDynPwr.current = gRfalDynPwr.table;
+    gRfalDynPwr.tableEntries = powerTblEntries;
     
     return ERR_NONE;
 }
@@ -121,14 +133,14 @@ ReturnCode rfalDynamicPowerTableLoad( rfalDynamicPowerEntry* powerTbl, uint8_t p
 /*******************************************************************************/
 ReturnCode rfalDynamicPowerTableRead( rfalDynamicPowerEntry* tblBuf, uint8_t tblBufEntries, uint8_t* tableEntries )
 {
-    if( (tblBuf == NULL) || (tblBufEntries < gRfalDynamicPowerTableEntries) || (tableEntries == NULL) )
+    if( (tblBuf == NULL) || (tblBufEntries < gRfalDynPwr.tableEntries) || (tableEntries == NULL) )
     {
         return ERR_PARAM;
     }
         
     /* Copy the whole Table to the given buffer */
-    ST_MEMCPY( tblBuf, gRfalCurrentDynamicPower, (tblBufEntries * RFAL_DYNAMIC_POWER_TABLE_PAPAMETER) );
-    *tableEntries = gRfalDynamicPowerTableEntries;
+    ST_MEMCPY( tblBuf, gRfalDynPwr.current, (tblBufEntries * RFAL_DYNAMIC_POWER_TABLE_PAPAMETER) );
+    *tableEntries = gRfalDynPwr.tableEntries;
     
     return ERR_NONE;
 }
@@ -137,10 +149,10 @@ ReturnCode rfalDynamicPowerTableRead( rfalDynamicPowerEntry* tblBuf, uint8_t tbl
 void rfalDynamicPowerAdjust( void )
 {
     uint8_t amplitude = 0;
-    rfalDynamicPowerEntry* dynamicPowerTable = (rfalDynamicPowerEntry*) gRfalCurrentDynamicPower;
+    rfalDynamicPowerEntry* dynamicPowerTable = (rfalDynamicPowerEntry*) gRfalDynPwr.current;
     
     /* Check if the Power Adjustment is disabled */
-    if( gRfalCurrentDynamicPower == NULL )
+    if( gRfalDynPwr.current == NULL )
     {
         return;
     }
@@ -149,31 +161,31 @@ void rfalDynamicPowerAdjust( void )
     rfalMeasureRF( &amplitude );
     
     /* increase the output power */
-    if( amplitude >= dynamicPowerTable[gRfalTableEntry].inc )
+    if( amplitude >= dynamicPowerTable[gRfalDynPwr.tableEntry].inc )
     {
         
         /* the top of the table represents the highest amplitude value*/
-        if( gRfalTableEntry == 0 )
+        if( gRfalDynPwr.tableEntry == 0 )
         {
             /* check if the maximum driver value has been reached */
             return;
         }
         /* go up in the table to decrease the driver resistance */
-        gRfalTableEntry--;
+        gRfalDynPwr.tableEntry--;
     }
     else
     {
         /* decrease the output power */
-        if(amplitude <= dynamicPowerTable[gRfalTableEntry].dec)
+        if(amplitude <= dynamicPowerTable[gRfalDynPwr.tableEntry].dec)
         {
             /* The bottom is the highest possible value */
-            if( gRfalTableEntry == gRfalDynamicPowerTableEntries)
+            if( gRfalDynPwr.tableEntry == gRfalDynPwr.tableEntries)
             {
                 /* check if the minimum driver value has been reached */
                 return;
             }
             /* go down in the table to increase the driver resistance */
-            gRfalTableEntry++;
+            gRfalDynPwr.tableEntry++;
         }
         else
         {
@@ -183,21 +195,21 @@ void rfalDynamicPowerAdjust( void )
     }
     
     /* get the new value for RFO resistance form the table and apply the new RFO resistance setting */ 
-    rfalSetModulatedRFO( dynamicPowerTable[gRfalTableEntry].rfoRes );
+    rfalSetModulatedRFO( dynamicPowerTable[gRfalDynPwr.tableEntry].rfoRes );
 }
 
 
 /*******************************************************************************/
 void rfalDynamicPowerEnable( void )
 {
-    gRfalCurrentDynamicPower = gRfalDynamicPower;
+    gRfalDynPwr.current = gRfalDynPwr.table;
 }
 
 
 /*******************************************************************************/
 void rfalDynamicPowerDisable( void )
 {
-    gRfalCurrentDynamicPower = NULL;
+    gRfalDynPwr.current = NULL;
 }
 
 #endif /* RFAL_FEATURE_DYNAMIC_POWER */
@@ -40,6 +40,7 @@
 ******************************************************************************
 */
 #include "rfal_iso15693_2.h"
+#include "rfal_rf.h"
 #include "rfal_crc.h"
 #include "utils.h"
 
@@ -85,6 +86,10 @@
 
 #define ISO15693_PHY_DAT_MANCHESTER_1 0xaaaa
 
+#define ISO15693_CODE_LEN_1_4    4  /*!< Coded bytes per data byte in 1 of 4   */
+#define ISO15693_CODE_LEN_1_256  64 /*!< Coded bytes per data byte in 1 of 256 */
+#define ISO15693_CRC_SLICE       32 /*!< Decoded bytes handed to the CRC at once */
+
 #define ISO15693_PHY_BIT_BUFFER_SIZE 1000 /*!< 
                                 size of the receiving buffer. Might be adjusted
                                 if longer datastreams are expected. */
@@ -95,23 +100,64 @@
 * LOCAL VARIABLES
 ******************************************************************************
 */
-static iso15693PhyConfig_t iso15693PhyConfig; /*!< current phy configuration */
+static iso15693PhyConfig_t iso15693PhyConfigInstance[PLATFORM_READERS];       /*!< current phy configurations, one per reader */
+#define iso15693PhyConfig   (iso15693PhyConfigInstance[platformReaderId()])    /*!< current phy configuration of the current reader */
+
+/* Pulse of a 2 bit pair in 1 of 4, also the pulse in a 1 of 256 slot quadruple */
+#define ISO15693_PULSE(p)        ((uint8_t)(ISO15693_DAT_00_1_4 << (2 * ((p) & 0x3))))
+
+/* 1 of 4 code of byte d, LSB pair first, and of 4/16/64 consecutive bytes */
+#define ISO15693_1OF4(d)         { ISO15693_PULSE(d), ISO15693_PULSE((d) >> 2), ISO15693_PULSE((d) >> 4), ISO15693_PULSE((d) >> 6) }
+#define ISO15693_1OF4_4(d)       ISO15693_1OF4(d), ISO15693_1OF4((d) + 1), ISO15693_1OF4((d) + 2), ISO15693_1OF4((d) + 3)
+#define ISO15693_1OF4_16(d)      ISO15693_1OF4_4(d), ISO15693_1OF4_4((d) + 4), ISO15693_1OF4_4((d) + 8), ISO15693_1OF4_4((d) + 12)
+#define ISO15693_1OF4_64(d)      ISO15693_1OF4_16(d), ISO15693_1OF4_16((d) + 16), ISO15693_1OF4_16((d) + 32), ISO15693_1OF4_16((d) + 48)
+
+/*! 1 of 4 code of every byte value */
+static const uint8_t iso15693PhyVCD1Of4Table[256][ISO15693_CODE_LEN_1_4] = {
+    ISO15693_1OF4_64(0), ISO15693_1OF4_64(64), ISO15693_1OF4_64(128), ISO15693_1OF4_64(192)
+};
+
+/* Manchester pair i of the 4 in byte b, first bit of the pair in bit 0 */
+#define ISO15693_MAN_PAIR(b, i)  (((b) >> (2 * (i))) & 0x3)
+
+/* Data bit of pair i of b, logic 1 being (0,1), and collision bit of the pair, (0,0) or (1,1) */
+#define ISO15693_MAN_DEC(b, i)   ( ((ISO15693_MAN_PAIR(b, i) == 0x2) ? (0x01 << (i)) : 0) \
+                                 | (((ISO15693_MAN_PAIR(b, i) == 0x0) || (ISO15693_MAN_PAIR(b, i) == 0x3)) ? (0x10 << (i)) : 0) )
+
+/* Decode of the 4 Manchester pairs of byte b, and of 4/16/64 consecutive bytes */
+#define ISO15693_MAN(b)          ((uint8_t)(ISO15693_MAN_DEC(b, 0) | ISO15693_MAN_DEC(b, 1) | ISO15693_MAN_DEC(b, 2) | ISO15693_MAN_DEC(b, 3)))
+#define ISO15693_MAN_4(b)        ISO15693_MAN(b), ISO15693_MAN((b) + 1), ISO15693_MAN((b) + 2), ISO15693_MAN((b) + 3)
+#define ISO15693_MAN_16(b)       ISO15693_MAN_4(b), ISO15693_MAN_4((b) + 4), ISO15693_MAN_4((b) + 8), ISO15693_MAN_4((b) + 12)
+#define ISO15693_MAN_64(b)       ISO15693_MAN_16(b), ISO15693_MAN_16((b) + 16), ISO15693_MAN_16((b) + 32), ISO15693_MAN_16((b) + 48)
+
+/*! Manchester decode of 4 pairs: data nibble in the low nibble, collision mask in the high nibble */
+static const uint8_t iso15693PhyVICCManTable[256] = {
+    ISO15693_MAN_64(0), ISO15693_MAN_64(64), ISO15693_MAN_64(128), ISO15693_MAN_64(192)
+};
 
 /*
 ******************************************************************************
 * LOCAL FUNCTION PROTOTYPES
 ******************************************************************************
 */
-static ReturnCode iso15693PhyVCDCode1Of4(const uint8_t data, uint8_t* outbuf, uint16_t maxOutBufLen, uint16_t* outBufLen);
-static ReturnCode iso15693PhyVCDCode1Of256(const uint8_t data, uint8_t* outbuf, uint16_t maxOutBufLen, uint16_t* outBufLen);
+static void iso15693PhyVCDCode1Of4(const uint8_t* data, uint16_t length, uint8_t* outbuf);
+static void iso15693PhyVCDCode1Of256(const uint8_t* data, uint16_t length, uint8_t* outbuf);
 
-static struct iso15693StreamConfig stream_config = {
+/* Read only, shared by all readers: the fast mode one is selected, not patched in */
+static const struct iso15693StreamConfig stream_config = {
     .useBPSK = 0, /* 0: subcarrier, 1:BPSK */
     .din = 5, /* 2^5*fc = 423750 Hz: divider for the in subcarrier frequency */
     .dout = 7, /*!< 2^7*fc = 105937 : divider for the in subcarrier frequency */
     .report_period_length = 3, /*!< 8=2^3 the length of the reporting period */
 };
 
+static const struct iso15693StreamConfig stream_config_fast = {
+    .useBPSK = 0, /* 0: subcarrier, 1:BPSK */
+    .din = 5, /* 2^5*fc = 423750 Hz: divider for the in subcarrier frequency */
+    .dout = 7, /*!< 2^7*fc = 105937 : divider for the in subcarrier frequency */
+    .report_period_length = 2, /*!< 4=2^2 the length of the reporting period, half in fast mode */
+};
+
 /*
 ******************************************************************************
 * GLOBAL FUNCTIONS
@@ -124,9 +170,7 @@ ReturnCode iso15693PhyConfigure(const iso15693PhyConfig_t* config, const struct
     ST_MEMCPY(&iso15693PhyConfig, (uint8_t*)config, sizeof(iso15693PhyConfig_t));
     
     /* If in fast mode the report period is half: 4=2^2 */
-    stream_config.report_period_length = ( config->fastMode ? 2 : 3 );
-
-    *needed_stream_config = &stream_config;
+    *needed_stream_config = ( config->fastMode ? &stream_config_fast : &stream_config );
 
     return ERR_NONE;
 }
@@ -142,11 +186,14 @@ ReturnCode iso15693VCDCode(uint8_t* buffer, uint16_t length, bool sendCrc, bool
                    uint16_t *subbit_total_length, uint16_t *offset,
                    uint8_t* outbuf, uint16_t outBufSize, uint16_t* actOutBufSize)
 {
-    ReturnCode err = ERR_NONE;
     uint8_t eof, sof;
     uint8_t transbuf[2];
-    uint16_t crc = 0;
-    ReturnCode (*txFunc)(const uint8_t, uint8_t*, uint16_t, uint16_t*);
+    uint16_t crc;
+    rfalCrcContext crcCtx;
+    uint16_t codeLen;
+    uint16_t n;
+    uint16_t skip;
+    void (*txFunc)(const uint8_t*, uint16_t, uint8_t*);
     uint8_t crc_len;
 
     crc_len = ((sendCrc)?2:0);
@@ -158,6 +205,7 @@ ReturnCode iso15693VCDCode(uint8_t* buffer, uint16_t length, bool sendCrc, bool
         sof = ISO15693_DAT_SOF_1_4;
         eof = ISO15693_DAT_EOF_1_4;
         txFunc = iso15693PhyVCDCode1Of4;
+        codeLen = ISO15693_CODE_LEN_1_4;
         *subbit_total_length = (
                 ( 1  /* SOF */
                   + (length + crc_len) * 4 
@@ -171,6 +219,7 @@ ReturnCode iso15693VCDCode(uint8_t* buffer, uint16_t length, bool sendCrc, bool
         sof = ISO15693_DAT_SOF_1_256;
         eof = ISO15693_DAT_EOF_1_256;
         txFunc = iso15693PhyVCDCode1Of256;
+        codeLen = ISO15693_CODE_LEN_1_256;
         *subbit_total_length = (
                 ( 1  /* SOF */
                   + (length + crc_len) * 64 
@@ -211,51 +260,52 @@ ReturnCode iso15693VCDCode(uint8_t* buffer, uint16_t length, bool sendCrc, bool
         outbuf++;
     }
 
-    while (*offset < length && err == ERR_NONE)
+    /* send data: as many whole bytes as the buffer takes, in one go */
+    if (*offset < length)
     {
-        uint16_t filled_size;
-        /* send data */
-        err = txFunc(buffer[*offset], outbuf, outBufSize, &filled_size);
-        (*actOutBufSize) += filled_size;
-        outbuf+=filled_size;
-        outBufSize -= filled_size;
-        if (!err) (*offset)++;
+        n = MIN((length - *offset), (outBufSize / codeLen));
+        txFunc(&buffer[*offset], n, outbuf);
+        (*actOutBufSize) += (n * codeLen);
+        outbuf += (n * codeLen);
+        outBufSize -= (n * codeLen);
+        (*offset) += n;
+
+        if (*offset < length)
+        {
+            return ERR_AGAIN;
+        }
     }
-    if (err) return ERR_AGAIN;
 
-    while (!err && sendCrc && *offset < length + 2)
+    if (sendCrc && (*offset < length + 2))
     {
-        uint16_t filled_size;
-        if (0==crc)
+        /* The data is all coded: CRC of the whole frame in one pass of the CRC engine */
+        skip = ((picopassMode) ? 1 : 0);                                       /* CMD byte is not taken into account in PicoPass mode */
+        rfalCrcInitCcitt( &crcCtx, ((picopassMode) ? 0xE012 : 0xFFFF) );       /* In PicoPass Mode a different Preset Value is used   */
+        if (length > skip)
         {
-            crc = rfalCrcCalculateCcitt( ((picopassMode) ? 0xE012 : 0xFFFF),         /* In PicoPass Mode a different Preset Value is used   */
-                                         ((picopassMode) ? (buffer + 1) : buffer),   /* CMD byte is not taken into account in PicoPass mode */
-                                         ((picopassMode) ? (length - 1) : length));  /* CMD byte is not taken into account in PicoPass mode */
-            
-            crc = ((picopassMode) ? crc : ~crc);
+            rfalCrcUpdateCcitt( &crcCtx, (buffer + skip), (length - skip) );
         }
+        crc = rfalCrcGetCcitt( &crcCtx );
+        crc = ((picopassMode) ? crc : ~crc);
+
         /* send crc */
         transbuf[0] = crc & 0xff;
         transbuf[1] = (crc >> 8) & 0xff;
-        err = txFunc(transbuf[*offset - length], outbuf, outBufSize, &filled_size);
-        (*actOutBufSize) += filled_size;
-        outbuf+=filled_size;
-        outBufSize -= filled_size;
-        if(!err) (*offset)++;
-    }
-    if (err) return ERR_AGAIN;
 
-    if ((!sendCrc && (*offset) == length)
-            || (sendCrc && (*offset) == length + 2))
-    {
-        *outbuf = eof; 
-        (*actOutBufSize)++;
-        outBufSize--;
-        outbuf++;
+        n = MIN((length + 2 - *offset), (outBufSize / codeLen));
+        txFunc(&transbuf[*offset - length], n, outbuf);
+        (*actOutBufSize) += (n * codeLen);
+        outbuf += (n * codeLen);
+        outBufSize -= (n * codeLen);
+        (*offset) += n;
+
+        if (*offset < length + 2) return ERR_AGAIN;
     }
-    else return ERR_AGAIN;
 
-    return err;
+    *outbuf = eof; 
+    (*actOutBufSize)++;
+
+    return ERR_NONE;
 }
 
 ReturnCode iso15693VICCDecode(uint8_t *inBuf,
@@ -271,6 +321,9 @@ ReturnCode iso15693VICCDecode(uint8_t *inBuf,
     uint16_t crc;
     uint16_t mp; /* Current bit position in manchester bit inBuf*/
     uint16_t bp; /* Current bit postion in outBuf */
+    uint8_t lo, hi;
+    rfalCrcContext crcCtx;
+    uint16_t crcPos; /* Bytes of outBuf in crcCtx, never the last two decoded: the CRC received */
 
     *bitsBeforeCol = 0;
     *outBufPos = 0;
@@ -292,11 +345,53 @@ ReturnCode iso15693VICCDecode(uint8_t *inBuf,
     mp = 5; /* 5 bits were SOF, now manchester starts: 2 bits per payload bit */
     bp = 0;
 
+    /* The CRC is calculated along with the decoding */
+    rfalCrcInitCcitt(&crcCtx, ((picopassMode) ? 0xE012 : 0xFFFF));
+    crcPos = 0;
+
     memset(outBuf,0,outBufLen);
 
     for ( ; mp < inBufLen * 8 - 2; mp+=2 )
     {
         uint8_t man;
+
+        /* At a byte boundary, with the byte's 8 pairs received, decode them at once
+         * through the table: bp%8 == 0 means mp%8 == 5, the pairs being bits 5..7
+         * of three consecutive bytes. A collision among them is left to the pair
+         * by pair decoding below */
+        if ((bp%8 == 0) && (mp + 14 < inBufLen * 8 - 2))
+        {
+            lo = iso15693PhyVICCManTable[(uint8_t)((inBuf[mp/8]   >> 5) | (inBuf[mp/8+1] << 3))];
+            hi = iso15693PhyVICCManTable[(uint8_t)((inBuf[mp/8+1] >> 5) | (inBuf[mp/8+2] << 3))];
+
+            if (((lo | hi) & 0xf0) == 0)
+            {
+                outBuf[bp/8] = (uint8_t)((lo & 0x0f) | (hi << 4));
+                bp += 8;
+
+                /* Hand the CRC the bytes decoded while they are hot, in slices for its engine */
+                if (crcPos + 2 + ISO15693_CRC_SLICE <= bp/8)
+                {
+                    rfalCrcUpdateCcitt(&crcCtx, &outBuf[crcPos], ISO15693_CRC_SLICE);
+                    crcPos += ISO15693_CRC_SLICE;
+                }
+                mp += 14; /* now at the last pair of the byte, as the pair by pair EOF check */
+
+                ISO_15693_DEBUG("ceof %hhx %hhx\n", inBuf[mp/8], inBuf[mp/8+1]);
+                if ( ((inBuf[mp/8]   & 0xe0) == 0xa0)
+                   &&(inBuf[mp/8+1] == 0x03))
+                { /* Now we know that it was 10111000 = EOF */
+                    ISO_15693_DEBUG("EOF\n");
+                    break;
+                }
+                if (bp >= outBufLen * 8)
+                { /* Don't write beyond the end */
+                    break;
+                }
+                continue;
+            }
+        }
+
         man  = (inBuf[mp/8] >> mp%8) & 0x1;
         man |= ((inBuf[(mp+1)/8] >> (mp+1)%8) & 0x1) << 1;
         if (1 == man)
@@ -351,7 +446,10 @@ ReturnCode iso15693VICCDecode(uint8_t *inBuf,
         ISO_15693_DEBUG("Calculate CRC, val: 0x%x, outBufLen: ", *outBuf);
         ISO_15693_DEBUG("0x%x ", *outBufPos - 2);
         
-        crc = rfalCrcCalculateCcitt( ((picopassMode) ? 0xE012 : 0xFFFF), outBuf, *outBufPos - 2);
+        /* The bytes decoded since the last slice */
+        rfalCrcUpdateCcitt(&crcCtx, &outBuf[crcPos], (*outBufPos - 2 - crcPos));
+
+        crc = rfalCrcGetCcitt(&crcCtx);
         crc = ((picopassMode) ? crc : ~crc);
         
         if (((crc & 0xff) == outBuf[*outBufPos-2]) &&
@@ -382,110 +480,53 @@ out:
 */
 /*! 
  *****************************************************************************
- *  \brief  Perform 1 of 4 coding and send coded data
+ *  \brief  Perform 1 of 4 coding
  *
- *  This function takes \a length bytes from \a buffer, perform 1 of 4 coding
- *  (see ISO15693-2 specification) and sends the data using stream mode.
+ *  This function takes \a length bytes from \a data, performs 1 of 4 coding
+ *  (see ISO15693-2 specification) and stores the 4 coded bytes of each data
+ *  byte, as found in iso15693PhyVCD1Of4Table, into \a outbuf.
  *
- *  \param[in] sendSof : send SOF prior to data.
- *  \param[in] buffer : data to send.
- *  \param[in] length : number of bytes to send.
- *
- *  \return ERR_IO : Error during communication.
- *  \return ERR_NONE : No error.
+ *  \param[in] data : data to code.
+ *  \param[in] length : number of bytes to code.
+ *  \param[out] outbuf : coded data, 4 * \a length bytes.
  *
  *****************************************************************************
  */
-static ReturnCode iso15693PhyVCDCode1Of4(const uint8_t data, uint8_t* outbuf, uint16_t maxOutBufLen, uint16_t* outBufLen)
+static void iso15693PhyVCDCode1Of4(const uint8_t* data, uint16_t length, uint8_t* outbuf)
 {
-    uint8_t tmp;
-    ReturnCode err = ERR_NONE;
     uint16_t a;
 
-    *outBufLen = 0;
-
-    if (maxOutBufLen < 4)
-        return ERR_NOMEM;
-
-    tmp = data;
-    for (a = 0; a < 4; a++)
+    for (a = 0; a < length; a++)
     {
-        switch (tmp & 0x3)
-        {
-            case 0:
-                *outbuf = ISO15693_DAT_00_1_4;
-                break;
-            case 1:
-                *outbuf = ISO15693_DAT_01_1_4;
-                break;
-            case 2:
-                *outbuf = ISO15693_DAT_10_1_4;
-                break;
-            case 3:
-                *outbuf = ISO15693_DAT_11_1_4;
-                break;
-        }
-        outbuf++;
-        (*outBufLen)++;
-        tmp >>= 2;
+        ST_MEMCPY(outbuf, iso15693PhyVCD1Of4Table[data[a]], ISO15693_CODE_LEN_1_4);
+        outbuf += ISO15693_CODE_LEN_1_4;
     }
-    return err;
 }
 
 /*! 
  *****************************************************************************
- *  \brief  Perform 1 of 256 coding and send coded data
+ *  \brief  Perform 1 of 256 coding
  *
- *  This function takes \a length bytes from \a buffer, perform 1 of 256 coding
- *  (see ISO15693-2 specification) and sends the data using stream mode.
- *  \note This function sends SOF prior to the data.
+ *  This function takes \a length bytes from \a data, performs 1 of 256 coding
+ *  (see ISO15693-2 specification) and stores the 64 coded bytes of each data
+ *  byte into \a outbuf: a single pulse, at the slot given by the data value.
  *
- *  \param[in] sendSof : send SOF prior to data.
- *  \param[in] buffer : data to send.
- *  \param[in] length : number of bytes to send.
- *
- *  \return ERR_IO : Error during communication.
- *  \return ERR_NONE : No error.
+ *  \param[in] data : data to code.
+ *  \param[in] length : number of bytes to code.
+ *  \param[out] outbuf : coded data, 64 * \a length bytes.
  *
  *****************************************************************************
  */
-static ReturnCode iso15693PhyVCDCode1Of256(const uint8_t data, uint8_t* outbuf, uint16_t maxOutBufLen, uint16_t* outBufLen)
+static void iso15693PhyVCDCode1Of256(const uint8_t* data, uint16_t length, uint8_t* outbuf)
 {
-    uint8_t tmp;
-    ReturnCode err = ERR_NONE;
     uint16_t a;
 
-    *outBufLen = 0;
+    ST_MEMSET(outbuf, 0x00, (length * ISO15693_CODE_LEN_1_256));
 
-    if (maxOutBufLen < 64)
-        return ERR_NOMEM;
-
-    tmp = data;
-    for (a = 0; a < 64; a++)
+    for (a = 0; a < length; a++)
     {
-        switch (tmp)
-        {
-            case 0:
-                *outbuf = ISO15693_DAT_SLOT0_1_256;
-                break;
-            case 1:
-                *outbuf = ISO15693_DAT_SLOT1_1_256;
-                break;
-            case 2:
-                *outbuf = ISO15693_DAT_SLOT2_1_256;
-                break;
-            case 3:
-                *outbuf = ISO15693_DAT_SLOT3_1_256;
-                break;
-            default:
-                *outbuf = 0;
-        }
-        outbuf++;
-        (*outBufLen)++;
-        tmp -= 4;
+        outbuf[(a * ISO15693_CODE_LEN_1_256) + (data[a] >> 2)] = ISO15693_PULSE(data[a]);
     }
-
-    return err;
 }
 
 #endif /* RFAL_FEATURE_NFCV */
@@ -398,7 +398,8 @@ typedef struct{
  ******************************************************************************
  */
 
-static rfalIsoDep gIsoDep;    /*!< ISO-DEP Module instance               */
+static rfalIsoDep gIsoDepInstance[PLATFORM_READERS];      /*!< ISO-DEP Module instances, one per reader      */
+#define gIsoDep   (gIsoDepInstance[platformReaderId()])    /*!< ISO-DEP Module instance of the current reader */
 
 /*
  ******************************************************************************
@@ -922,6 +923,7 @@ ReturnCode rfalIsoDepDeselect( void )
 {
     ReturnCode ret;
     uint32_t   cntRerun;
+    rfalIrqWaiter w;
     bool       dummyB;
     uint16_t   tmpRcvdLen;
     uint8_t    tmpRxBuf[ISODEP_CONTROLMSG_BUF_LEN];
@@ -947,8 +949,15 @@ ReturnCode rfalIsoDepDeselect( void )
     /* Send DSL request and run protocol until get a response, error or "timeout" */    
     EXIT_ON_ERR( ret, isoDepHandleControlMsg( ISODEP_S_DSL, RFAL_ISODEP_NO_PARAM ) );
     do{
+        rfalIrqWaitPrepare( &w );
         ret = isoDepDataExchangePCD( gIsoDep.rxLen, &dummyB );
         rfalWorker();
+        
+        /* Waiting for the response: sleep until the next IRQ or SW timer */
+        if( ERR_NO_MASK(ret) == ERR_BUSY )
+        {
+            rfalIrqWaitNext( &w );
+        }
     }
     while( (ERR_NO_MASK(ret) == ERR_BUSY) && cntRerun--);
         
@@ -340,7 +340,8 @@ typedef struct{
  ******************************************************************************
  */
 
-static rfalNfcDep gNfcip;              /*!< NFCIP module instance                          */
+static rfalNfcDep gNfcipInstance[PLATFORM_READERS];       /*!< NFCIP module instances, one per reader         */
+#define gNfcip   (gNfcipInstance[platformReaderId()])      /*!< NFCIP module instance of the current reader    */
 
 
 /*
@@ -495,6 +496,7 @@ static ReturnCode nfcipTxRx( rfalNfcDepCmd cmd, uint8_t* txBuf, uint32_t fwt, ui
 {
     ReturnCode ret;
     uint32_t   reRun;
+    rfalIrqWaiter w;
     
     reRun = NFCIP_LOOP_MAX;                                          /* set maximum loop reRuns */
     
@@ -522,9 +524,16 @@ static ReturnCode nfcipTxRx( rfalNfcDepCmd cmd, uint8_t* txBuf, uint32_t fwt, ui
 	/*******************************************************************************/
     do                                                               /* call Rx() until done or max reRuns reached */
     {
+        rfalIrqWaitPrepare( &w );
         ret = nfcipDataRx();
         
         rfalWorker();        
+        
+        /* Waiting for the response: sleep until the next IRQ or SW timer */
+        if( ret == ERR_NO_MASK(ERR_BUSY) )
+        {
+            rfalIrqWaitNext( &w );
+        }
              
         if( !reRun-- )                                               /* if max reRuns reached return error */
         {
@@ -148,7 +148,8 @@ static ReturnCode rfalNfcbCheckSensbRes( rfalNfcbSensbRes *sensbRes, uint8_t sen
 /*! TR2 Table according to Digital 1.1 Table 33 */
 static const uint16_t rfalNfcbTr2Table[] = { 1792, 3328, 5376, 9472 };
 
-rfalNfcb gRfalNfcb; /*!< RFAL NFC-B Instance */
+static rfalNfcb gRfalNfcbInstance[PLATFORM_READERS];                 /*!< RFAL NFC-B Instances, one per reader      */
+#define gRfalNfcb   (gRfalNfcbInstance[platformReaderId()])           /*!< RFAL NFC-B Instance of the current reader */
 
 
 /*
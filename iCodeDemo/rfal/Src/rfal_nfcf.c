@@ -111,7 +111,8 @@ typedef struct
 * LOCAL VARIABLES
 ******************************************************************************
 */
-static rfalNfcfGreedyF gRfalNfcfGreedyF;   /*!< Activity's NFCF Greedy collection */
+static rfalNfcfGreedyF gRfalNfcfGreedyFInstance[PLATFORM_READERS];            /*!< Activity's NFCF Greedy collection, one per reader */
+#define gRfalNfcfGreedyF   (gRfalNfcfGreedyFInstance[platformReaderId()])      /*!< Activity's NFCF Greedy collection of the current reader */
 
 
 /*
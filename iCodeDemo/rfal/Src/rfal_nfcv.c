@@ -46,6 +46,7 @@
 #include <stdio.h>
  
 #include "rfal_nfcv.h"
+#include "rfal_iso15693_2.h"
 #include "utils.h"
 
 /*
@@ -84,13 +85,21 @@
 
 #define RFAL_NFCV_MAX_COLL_SUPPORTED      16    /*!< Maximum number of collisions supported by the Anticollision loop  */
 
+#define RFAL_NFCV_INFO_FLAGS_LEN          1     /*!< Get System Information INFO_FLAGS length                          */
+#define RFAL_NFCV_MEMSIZE_LEN             2     /*!< Get System Information VICC memory size length                    */
+#define RFAL_NFCV_SYSINFO_RES_MAX_LEN     15    /*!< Get System Information response length with all fields present    */
+#define RFAL_NFCV_BLOCK_LEN_MASK          0x1F  /*!< Block size in the VICC memory size: bytes minus one               */
+#define RFAL_NFCV_SEC_STATUS_LEN          1     /*!< Block security status length                                      */
+#define RFAL_NFCV_IC_MFG_LEN              1     /*!< IC manufacturer code length, after the command code of custom commands */
+
 #define RFAL_FDT_POLL_MAX                 rfalConvMsTo1fc(20) /*!< */
+#define RFAL_NFCV_WRITE_TIMEOUT_MS        20    /*!< Max programming time of a block, in ms                             */
 
 
 
 /*! Time between EOFs - ISO 15693 defines t3min depending on modulation depth and data rate
  *                    - NFC Forum defines FDTV,EOF = [10 ; 20]ms    ISO15693 2000 8.4   Digital 2.0  9.7.4 */ 
-#define RFAL_NFCV_FDT_EOF                 5
+#define RFAL_NFCV_FDT_EOF_US              5000
 
 
 
@@ -160,6 +169,9 @@ typedef struct
 ******************************************************************************
 */
 static ReturnCode rfalNfvParseError( uint8_t err );
+static ReturnCode rfalNfcvPollerTransceiveWrite( uint8_t* req, uint16_t reqLen, uint16_t numBlocks );
+static ReturnCode rfalNfcvPollerReadBlocks( uint8_t flags, uint8_t* uid, uint8_t firstBlockNum, uint16_t numBlocks, uint8_t blockLen, uint8_t* data, uint8_t* secStatus, bool verify );
+static ReturnCode rfalNfcvPollerTransceiveCustom( uint8_t* req, uint16_t reqLen, bool fast, uint8_t* rxBuf, uint16_t rxBufLen, uint16_t* rcvLen );
 
 /*
 ******************************************************************************
@@ -193,6 +205,170 @@ static ReturnCode rfalNfvParseError( uint8_t err )
     }
 }
 
+/*******************************************************************************/
+static ReturnCode rfalNfcvPollerTransceiveWrite( uint8_t* req, uint16_t reqLen, uint16_t numBlocks )
+{
+    ReturnCode         ret;
+    uint8_t            res[RFAL_NFCV_FLAG_LEN + 1 + RFAL_CRC_LEN];
+    uint16_t           rcvLen;
+    uint32_t           timer;
+    
+    /* Option flag not set: the device answers once the blocks are programmed */
+    if( !(req[0] & RFAL_NFCV_REQ_FLAG_OPTION) )
+    {
+        ret = rfalTransceiveBlockingTxRx( req, reqLen, res, sizeof(res), &rcvLen, RFAL_TXRX_FLAGS_DEFAULT, (rfalConvMsTo1fc(RFAL_NFCV_WRITE_TIMEOUT_MS) * numBlocks) );
+        if( ret != ERR_NONE )
+        {
+            return ret;
+        }
+        
+        return rfalNfcvPollerCheckResponse( res, rcvLen );
+    }
+    
+    /* Option flag set: errors are answered right away, otherwise the answer *
+     * comes on an EOF once programmed. Poll with EOFs, spaced so that the    *
+     * tag programs undisturbed, until the max programming time has elapsed  */
+    timer = platformTimerCreate( (uint16_t)(RFAL_NFCV_WRITE_TIMEOUT_MS * numBlocks) );
+    ret   = rfalTransceiveBlockingTxRx( req, reqLen, res, sizeof(res), &rcvLen, RFAL_TXRX_FLAGS_DEFAULT, rfalConv64fcTo1fc(ISO15693_NO_RESPONSE_TIME) );
+    
+    while( (ret == ERR_TIMEOUT) && !platformTimerIsExpired( timer ) )
+    {
+        platformDelayUs( RFAL_NFCV_FDT_EOF_US );
+        ret = rfalISO15693TransceiveEOF( res, sizeof(res), &rcvLen );
+    }
+    
+    if( ret != ERR_NONE )
+    {
+        return ret;
+    }
+    
+    return rfalNfcvPollerCheckResponse( res, rcvLen );
+}
+
+/*******************************************************************************/
+static ReturnCode rfalNfcvPollerReadBlocks( uint8_t flags, uint8_t* uid, uint8_t firstBlockNum, uint16_t numBlocks, uint8_t blockLen, uint8_t* data, uint8_t* secStatus, bool verify )
+{
+    ReturnCode          ret;
+    uint8_t             rxBuf[RFAL_NFCV_MAX_RES_LEN + RFAL_CRC_LEN];
+    uint16_t            rxLen;
+    uint16_t            resBlockLen;
+    uint16_t            chunk;
+    uint16_t            blk;
+    uint16_t            n;
+    uint16_t            i;
+    uint8_t             retries;
+    
+    /* The option flag requests the security status, one byte ahead of each block */
+    resBlockLen = (blockLen + ((secStatus != NULL) ? RFAL_NFCV_SEC_STATUS_LEN : 0));
+    flags       = ((secStatus != NULL) ? (flags | RFAL_NFCV_REQ_FLAG_OPTION) : (flags & ~RFAL_NFCV_REQ_FLAG_OPTION));
+    
+    /* Largest chunk whose response the RF layer can receive */
+    chunk = MIN( ((RFAL_NFCV_MAX_RES_LEN - RFAL_NFCV_FLAG_LEN) / resBlockLen), RFAL_NFCV_MAX_BLOCKS );
+    
+    blk     = 0;
+    retries = 0;
+    while( blk < numBlocks )
+    {
+        n   = MIN( chunk, (numBlocks - blk) );
+        ret = rfalNfvPollerReadMultipleBlocks( flags, uid, (uint8_t)(firstBlockNum + blk), (uint8_t)(n - 1), rxBuf, sizeof(rxBuf), &rxLen );
+        if( (ret == ERR_NONE) && (rxLen != (RFAL_NFCV_FLAG_LEN + (n * resBlockLen))) )
+        {
+            ret = ERR_PROTO;
+        }
+        
+        if( ret != ERR_NONE )
+        {
+            /* Chunk rejected by the device, possibly above its limit: use halves from now on */
+            if( (ret == ERR_REQUEST) && (n > 1) )
+            {
+                chunk   = (n / 2);
+                retries = 0;
+                continue;
+            }
+            
+            /* Transmission error: read the same chunk again */
+            if( (ret != ERR_REQUEST) && (ret != ERR_NOTSUPP) && (retries < RFAL_NFCV_DUMP_RETRIES) )
+            {
+                retries++;
+                continue;
+            }
+            
+            return ret;
+        }
+        
+        /* Compare or store the blocks, splitting off the security status if requested */
+        if( verify )
+        {
+            if( ST_BYTECMP( &data[blk * blockLen], &rxBuf[RFAL_NFCV_FLAG_LEN], (n * blockLen) ) != 0 )
+            {
+                return ERR_WRITE;
+            }
+        }
+        else if( secStatus != NULL )
+        {
+            for( i = 0; i < n; i++ )
+            {
+                secStatus[blk + i] = rxBuf[RFAL_NFCV_FLAG_LEN + (i * resBlockLen)];
+                ST_MEMCPY( &data[(blk + i) * blockLen], &rxBuf[RFAL_NFCV_FLAG_LEN + (i * resBlockLen) + RFAL_NFCV_SEC_STATUS_LEN], blockLen );
+            }
+        }
+        else
+        {
+            ST_MEMCPY( &data[blk * blockLen], &rxBuf[RFAL_NFCV_FLAG_LEN], (n * blockLen) );
+        }
+        
+        blk    += n;
+        retries = 0;
+    }
+    
+    return ERR_NONE;
+}
+
+/*******************************************************************************/
+static ReturnCode rfalNfcvPollerTransceiveCustom( uint8_t* req, uint16_t reqLen, bool fast, uint8_t* rxBuf, uint16_t rxBufLen, uint16_t* rcvLen )
+{
+    ReturnCode         ret;
+    rfalBitRate        txBR;
+    rfalBitRate        rxBR;
+    uint16_t           rxBits;
+    
+    EXIT_ON_ERR( ret, rfalGetBitRate( &txBR, &rxBR ) );
+    
+    /* Fast commands are answered at twice the data rate: receive at 53kbps for this exchange only */
+    if( fast )
+    {
+        EXIT_ON_ERR( ret, rfalSetBitRate( RFAL_BR_KEEP, RFAL_BR_52p97 ) );
+    }
+    
+    if( req[0] & RFAL_NFCV_REQ_FLAG_INVENTORY )
+    {
+        /* Answered in an anticollision round: collisions are reported, the CRC is kept */
+        ret     = rfalISO15693TransceiveAnticollisionFrame( req, (uint8_t)reqLen, rxBuf, (uint8_t)MIN( rxBufLen, RFAL_NFCV_MAX_RES_LEN ), &rxBits );
+        *rcvLen = rfalConvBitsToBytes( rxBits );
+        if( ret == ERR_NONE )
+        {
+            ret      = ((*rcvLen < (RFAL_NFCV_FLAG_LEN + RFAL_CRC_LEN)) ? ERR_PROTO : ERR_NONE);
+            *rcvLen -= MIN( *rcvLen, RFAL_CRC_LEN );
+        }
+    }
+    else
+    {
+        ret = rfalTransceiveBlockingTxRx( req, reqLen, rxBuf, rxBufLen, rcvLen, RFAL_TXRX_FLAGS_DEFAULT, RFAL_FDT_POLL_MAX );
+    }
+    
+    if( fast )
+    {
+        rfalSetBitRate( RFAL_BR_KEEP, rxBR );
+    }
+    
+    if( ret != ERR_NONE )
+    {
+        return ret;
+    }
+    
+    return rfalNfcvPollerCheckResponse( rxBuf, *rcvLen );
+}
+
 /*
 ******************************************************************************
 * GLOBAL FUNCTIONS
@@ -384,7 +560,7 @@ ReturnCode rfalNfcvPollerCollisionResolution( uint8_t devLimit, rfalNfcvListenDe
                 return ERR_NONE;
             }
             
-            platformDelay(RFAL_NFCV_FDT_EOF); /* Fulfil FDT EOF */
+            platformDelayUs(RFAL_NFCV_FDT_EOF_US); /* Fulfil FDT EOF */
             ret = rfalISO15693TransceiveAnticollisionEOF( (uint8_t*)&nfcvDevList[(*devCnt)].InvRes, sizeof(rfalNfcvInventoryRes), &rcvdLen );
             slotNum++;
             
@@ -484,7 +660,7 @@ ReturnCode rfalNfvPollerReadSingleBlock( uint8_t flags, uint8_t* uid, uint8_t bl
         req.REQ_FLAG |= RFAL_NFCV_REQ_FLAG_ADDRESS;
         ST_MEMCPY( req.payload.UID, uid, RFAL_NFCV_UID_LEN );
         msgIt += RFAL_NFCV_UID_LEN;
-        req.payload.data[ (RFAL_NFCV_UID_LEN + msgIt++) ] = blockNum;
+        req.payload.data[msgIt++] = blockNum;
     }
     else
     {
@@ -517,10 +693,7 @@ ReturnCode rfalNfvPollerReadSingleBlock( uint8_t flags, uint8_t* uid, uint8_t bl
 /*******************************************************************************/
 ReturnCode rfalNfvPollerWriteSingleBlock( uint8_t flags, uint8_t* uid, uint8_t blockNum, uint8_t* wrData, uint8_t blockLen )
 {
-    ReturnCode         ret;
-    uint16_t           rcvLen;
     rfalNfcvGenericReq req;
-    rfalNfcvGenericRes res;
     uint8_t            msgIt;
 
     if( blockLen > RFAL_NFCV_MAX_BLOCK_LEN )
@@ -553,30 +726,11 @@ ReturnCode rfalNfvPollerWriteSingleBlock( uint8_t flags, uint8_t* uid, uint8_t b
     }
     
     /* Transceive Command */
-    ret = rfalTransceiveBlockingTxRx( (uint8_t*)&req, (RFAL_CMD_LEN + RFAL_NFCV_FLAG_LEN + msgIt), (uint8_t*)&res, sizeof(rfalNfcvGenericRes), &rcvLen, RFAL_TXRX_FLAGS_DEFAULT, RFAL_FDT_POLL_MAX );
-    
-    if( ret != ERR_NONE )
-    {
-        return ret;
-    }
-    
-    /* Check if the response minimum length has been received */
-    if( rcvLen < RFAL_NFCV_FLAG_LEN )
-    {
-        return ERR_PROTO;
-    }
-    
-    /* Check if an error has been signalled */
-    if( res.RES_FLAG & RFAL_NFCV_RES_FLAG_ERROR )
-    {
-        return rfalNfvParseError( *res.data );
-    }
-    
-    return ERR_NONE;
+    return rfalNfcvPollerTransceiveWrite( (uint8_t*)&req, (RFAL_CMD_LEN + RFAL_NFCV_FLAG_LEN + msgIt), 1 );
 }
 
 /*******************************************************************************/
-ReturnCode rfalNfvReadMultipleBlocks( uint8_t flags, uint8_t* uid, uint8_t firstBlockNum, uint8_t numOfBlocks, uint8_t* rxBuf, uint16_t rxBufLen, uint16_t *rcvLen )
+ReturnCode rfalNfvPollerReadMultipleBlocks( uint8_t flags, uint8_t* uid, uint8_t firstBlockNum, uint8_t numOfBlocks, uint8_t* rxBuf, uint16_t rxBufLen, uint16_t *rcvLen )
 {
     ReturnCode          ret;
     rfalNfcvGenericReq  req;
@@ -596,8 +750,8 @@ ReturnCode rfalNfvReadMultipleBlocks( uint8_t flags, uint8_t* uid, uint8_t first
         req.REQ_FLAG |= RFAL_NFCV_REQ_FLAG_ADDRESS;
         ST_MEMCPY( req.payload.UID, uid, RFAL_NFCV_UID_LEN );
         msgIt += RFAL_NFCV_UID_LEN;
-        req.payload.data[ (RFAL_NFCV_UID_LEN + msgIt++) ] = firstBlockNum;
-        req.payload.data[ (RFAL_NFCV_UID_LEN + msgIt++) ] = numOfBlocks;
+        req.payload.data[msgIt++] = firstBlockNum;
+        req.payload.data[msgIt++] = numOfBlocks;
     }
     else
     {
@@ -628,4 +782,357 @@ ReturnCode rfalNfvReadMultipleBlocks( uint8_t flags, uint8_t* uid, uint8_t first
     return ERR_NONE;
 }
 
+/*******************************************************************************/
+ReturnCode rfalNfvPollerWriteMultipleBlocks( uint8_t flags, uint8_t* uid, uint8_t firstBlockNum, uint8_t numOfBlocks, const uint8_t* wrData, uint8_t blockLen )
+{
+    ReturnCode          ret;
+    uint8_t             req[RFAL_NFCV_MAX_REQ_LEN];
+    uint8_t             param[2];
+    uint16_t            reqLen;
+    uint16_t            dataLen;
+    
+    dataLen = ((numOfBlocks + 1) * blockLen);
+    if( (wrData == NULL) || (blockLen == 0) || (blockLen > RFAL_NFCV_MAX_BLOCK_LEN) || (dataLen > RFAL_NFCV_MAX_WR_MULTIPLE_LEN) )
+    {
+        return ERR_PARAM;
+    }
+    
+    /* Compute Request Command, the data follows the parameters */
+    param[0] = firstBlockNum;
+    param[1] = numOfBlocks;
+    EXIT_ON_ERR( ret, rfalNfcvPollerBuildRequest( flags, RFAL_NFCF_CMD_WRITE_MULTIPLE_BLOCKS, uid, param, sizeof(param), req, (sizeof(req) - dataLen), &reqLen ) );
+    ST_MEMCPY( &req[reqLen], wrData, dataLen );
+    reqLen += dataLen;
+    
+    /* Transceive Command */
+    return rfalNfcvPollerTransceiveWrite( req, reqLen, (numOfBlocks + 1) );
+}
+
+/*******************************************************************************/
+ReturnCode rfalNfcvPollerGetSystemInformation( uint8_t flags, uint8_t* uid, rfalNfcvSystemInfo *sysInfo )
+{
+    ReturnCode          ret;
+    uint8_t             req[RFAL_NFCV_MAX_REQ_LEN];
+    uint8_t             res[RFAL_NFCV_SYSINFO_RES_MAX_LEN + RFAL_CRC_LEN];
+    uint16_t            reqLen;
+    uint16_t            rcvLen;
+    uint16_t            msgIt;
+    
+    if( sysInfo == NULL )
+    {
+        return ERR_PARAM;
+    }
+    
+    /* Compute Request Command, Get System Information has no option */
+    EXIT_ON_ERR( ret, rfalNfcvPollerBuildRequest( (flags & ~RFAL_NFCV_REQ_FLAG_OPTION), RFAL_NFCF_CMD_GET_SYS_INFO, uid, NULL, 0, req, sizeof(req), &reqLen ) );
+    
+    /* Transceive Command */
+    ret = rfalTransceiveBlockingTxRx( req, reqLen, res, sizeof(res), &rcvLen, RFAL_TXRX_FLAGS_DEFAULT, RFAL_FDT_POLL_MAX );
+    if( ret != ERR_NONE )
+    {
+        return ret;
+    }
+    
+    EXIT_ON_ERR( ret, rfalNfcvPollerCheckResponse( res, rcvLen ) );
+    
+    /* Check if INFO_FLAGS and UID have been received */
+    if( rcvLen < (RFAL_NFCV_FLAG_LEN + RFAL_NFCV_INFO_FLAGS_LEN + RFAL_NFCV_UID_LEN) )
+    {
+        return ERR_PROTO;
+    }
+    
+    ST_MEMSET( sysInfo, 0x00, sizeof(rfalNfcvSystemInfo) );
+    msgIt              = RFAL_NFCV_FLAG_LEN;
+    sysInfo->infoFlags = res[msgIt++];
+    ST_MEMCPY( sysInfo->UID, &res[msgIt], RFAL_NFCV_UID_LEN );
+    msgIt += RFAL_NFCV_UID_LEN;
+    
+    /* Optional fields follow in the order of INFO_FLAGS */
+    if( sysInfo->infoFlags & RFAL_NFCV_SYSINFO_DSFID )
+    {
+        sysInfo->DSFID = ((msgIt < rcvLen) ? res[msgIt] : 0);
+        msgIt += RFAL_NFCV_DSFI_LEN;
+    }
+    
+    if( sysInfo->infoFlags & RFAL_NFCV_SYSINFO_AFI )
+    {
+        sysInfo->AFI = ((msgIt < rcvLen) ? res[msgIt] : 0);
+        msgIt++;
+    }
+    
+    if( sysInfo->infoFlags & RFAL_NFCV_SYSINFO_MEMSIZE )
+    {
+        if( (msgIt + RFAL_NFCV_MEMSIZE_LEN) > rcvLen )
+        {
+            return ERR_PROTO;
+        }
+        sysInfo->numBlocks = (res[msgIt] + 1);
+        sysInfo->blockLen  = ((res[msgIt + 1] & RFAL_NFCV_BLOCK_LEN_MASK) + 1);
+        msgIt += RFAL_NFCV_MEMSIZE_LEN;
+    }
+    
+    if( sysInfo->infoFlags & RFAL_NFCV_SYSINFO_ICREF )
+    {
+        sysInfo->icRef = ((msgIt < rcvLen) ? res[msgIt] : 0);
+    }
+    
+    return ERR_NONE;
+}
+
+/*******************************************************************************/
+ReturnCode rfalNfcvPollerDumpMemory( uint8_t flags, uint8_t* uid, rfalNfcvSystemInfo *sysInfo, uint8_t* data, uint16_t dataLen, uint8_t* secStatus, uint16_t secStatusLen, uint16_t *rcvLen )
+{
+    ReturnCode          ret;
+    rfalNfcvSystemInfo  info;
+    
+    if( (data == NULL) || (rcvLen == NULL) )
+    {
+        return ERR_PARAM;
+    }
+    
+    *rcvLen = 0;
+    
+    /* Retrieve the memory geometry */
+    EXIT_ON_ERR( ret, rfalNfcvPollerGetSystemInformation( flags, uid, &info ) );
+    if( sysInfo != NULL )
+    {
+        *sysInfo = info;
+    }
+    
+    if( !(info.infoFlags & RFAL_NFCV_SYSINFO_MEMSIZE) )
+    {
+        return ERR_NOTSUPP;
+    }
+    
+    if( ((info.numBlocks * info.blockLen) > dataLen) || ((secStatus != NULL) && (info.numBlocks > secStatusLen)) )
+    {
+        return ERR_NOMEM;
+    }
+    
+    /* Read all blocks, in as few Read Multiple Blocks as possible */
+    EXIT_ON_ERR( ret, rfalNfcvPollerReadBlocks( flags, uid, 0, info.numBlocks, info.blockLen, data, secStatus, false ) );
+    
+    *rcvLen = (info.numBlocks * info.blockLen);
+    return ERR_NONE;
+}
+
+/*******************************************************************************/
+ReturnCode rfalNfcvPollerWriteMemory( uint8_t flags, uint8_t* uid, uint8_t firstBlockNum, uint16_t numBlocks, uint8_t blockLen, const uint8_t* wrData, bool verify )
+{
+    ReturnCode          ret;
+    uint16_t            chunk;
+    uint16_t            blk;
+    uint16_t            n;
+    uint8_t             retries;
+    
+    if( (wrData == NULL) || (blockLen == 0) || (blockLen > RFAL_NFCV_MAX_BLOCK_LEN) || (numBlocks == 0) || ((firstBlockNum + numBlocks) > RFAL_NFCV_MAX_BLOCKS) )
+    {
+        return ERR_PARAM;
+    }
+    
+    /* Largest chunk that fits a Write Multiple Blocks request */
+    chunk   = MIN( (RFAL_NFCV_MAX_WR_MULTIPLE_LEN / blockLen), numBlocks );
+    blk     = 0;
+    retries = 0;
+    while( blk < numBlocks )
+    {
+        n = MIN( chunk, (numBlocks - blk) );
+        if( n > 1 )
+        {
+            ret = rfalNfvPollerWriteMultipleBlocks( flags, uid, (uint8_t)(firstBlockNum + blk), (uint8_t)(n - 1), &wrData[blk * blockLen], blockLen );
+        }
+        else
+        {
+            ret = rfalNfvPollerWriteSingleBlock( flags, uid, (uint8_t)(firstBlockNum + blk), (uint8_t*)&wrData[blk * blockLen], blockLen );
+        }
+        
+        if( ret != ERR_NONE )
+        {
+            /* Write Multiple Blocks not supported: one block at a time from now on */
+            if( (ret == ERR_NOTSUPP) && (n > 1) )
+            {
+                chunk   = 1;
+                retries = 0;
+                continue;
+            }
+            
+            /* Chunk rejected by the device, possibly above its limit: use halves from now on */
+            if( (ret == ERR_REQUEST) && (n > 1) )
+            {
+                chunk   = (n / 2);
+                retries = 0;
+                continue;
+            }
+            
+            /* Transmission error: write the same chunk again */
+            if( (ret != ERR_REQUEST) && (ret != ERR_NOTSUPP) && (ret != ERR_WRITE) && (retries < RFAL_NFCV_WRITE_RETRIES) )
+            {
+                retries++;
+                continue;
+            }
+            
+            return ret;
+        }
+        
+        blk    += n;
+        retries = 0;
+    }
+    
+    if( !verify )
+    {
+        return ERR_NONE;
+    }
+    
+    /* Read back all blocks written, in as few Read Multiple Blocks as possible */
+    return rfalNfcvPollerReadBlocks( flags, uid, firstBlockNum, numBlocks, blockLen, (uint8_t*)wrData, NULL, true );
+}
+
+/*******************************************************************************/
+ReturnCode rfalNfcvPollerInventoryRead( bool fast, uint8_t maskLen, const uint8_t* maskVal, uint8_t firstBlockNum, uint8_t numOfBlocks, uint8_t* uid, uint8_t* rxBuf, uint16_t rxBufLen, uint16_t *rcvLen )
+{
+    ReturnCode          ret;
+    uint8_t             req[RFAL_NFCV_INV_REQ_HEADER_LEN + RFAL_NFCV_IC_MFG_LEN + RFAL_NFCV_MASKVAL_MAX_LEN + 2];
+    uint8_t             res[RFAL_NFCV_MAX_RES_LEN];
+    uint16_t            reqLen;
+    uint16_t            resLen;
+    uint16_t            uidLen;
+    uint16_t            bit;
+    uint16_t            i;
+    
+    if( ((maskVal == NULL) && (maskLen != 0)) || (maskLen > RFAL_NFCV_MASKVAL_MAX_1SLOT_LEN) || (rxBuf == NULL) || (rcvLen == NULL) )
+    {
+        return ERR_PARAM;
+    }
+    
+    *rcvLen = 0;
+    
+    /* Compute Request Command: one slot, the Option flag asks for the UID past the mask */
+    reqLen        = 0;
+    req[reqLen++] = (RFAL_NFCV_INV_REQ_FLAG | RFAL_NFCV_NUM_SLOTS_1 | ((uid != NULL) ? RFAL_NFCV_REQ_FLAG_OPTION : 0));
+    req[reqLen++] = (fast ? RFAL_NFCF_CMD_FAST_INVENTORY_READ : RFAL_NFCF_CMD_INVENTORY_READ);
+    req[reqLen++] = RFAL_NFCV_IC_MFG_NXP;
+    req[reqLen++] = maskLen;
+    ST_MEMCPY( &req[reqLen], maskVal, rfalConvBitsToBytes(maskLen) );
+    reqLen       += rfalConvBitsToBytes(maskLen);
+    req[reqLen++] = firstBlockNum;
+    req[reqLen++] = numOfBlocks;
+    
+    EXIT_ON_ERR( ret, rfalNfcvPollerTransceiveCustom( req, reqLen, fast, res, sizeof(res), &resLen ) );
+    
+    /* The UID bits past the mask come first, rounded up to whole bytes */
+    uidLen = ((uid != NULL) ? rfalConvBitsToBytes( RFAL_NFCV_MASKVAL_MAX_1SLOT_LEN - maskLen ) : 0);
+    if( resLen < (RFAL_NFCV_FLAG_LEN + uidLen) )
+    {
+        return ERR_PROTO;
+    }
+    
+    if( (resLen - uidLen) > rxBufLen )
+    {
+        return ERR_NOMEM;
+    }
+    
+    if( uid != NULL )
+    {
+        ST_MEMSET( uid, 0x00, RFAL_NFCV_UID_LEN );
+        for( i = 0; i < RFAL_NFCV_MASKVAL_MAX_1SLOT_LEN; i++ )
+        {
+            bit = ((i < maskLen) ? (maskVal[i / 8] >> (i % 8)) : (res[RFAL_NFCV_FLAG_LEN + ((i - maskLen) / 8)] >> ((i - maskLen) % 8)));
+            uid[i / 8] |= (uint8_t)((bit & 0x01) << (i % 8));
+        }
+    }
+    
+    /* Hand over the blocks as a Read Multiple Blocks response */
+    rxBuf[0] = res[0];
+    ST_MEMCPY( &rxBuf[RFAL_NFCV_FLAG_LEN], &res[RFAL_NFCV_FLAG_LEN + uidLen], (resLen - RFAL_NFCV_FLAG_LEN - uidLen) );
+    *rcvLen  = (resLen - uidLen);
+    
+    return ERR_NONE;
+}
+
+/*******************************************************************************/
+ReturnCode rfalNfcvPollerFastReadMultipleBlocks( uint8_t flags, uint8_t* uid, uint8_t firstBlockNum, uint8_t numOfBlocks, uint8_t* rxBuf, uint16_t rxBufLen, uint16_t *rcvLen )
+{
+    ReturnCode          ret;
+    uint8_t             req[RFAL_NFCV_FLAG_LEN + RFAL_CMD_LEN + RFAL_NFCV_IC_MFG_LEN + RFAL_NFCV_UID_LEN + 2];
+    uint8_t             param[2];
+    uint16_t            reqLen;
+    
+    if( (rxBuf == NULL) || (rcvLen == NULL) )
+    {
+        return ERR_PARAM;
+    }
+    
+    /* Compute Request Command, the IC manufacturer code goes between the command code and the UID */
+    param[0] = firstBlockNum;
+    param[1] = numOfBlocks;
+    EXIT_ON_ERR( ret, rfalNfcvPollerBuildRequest( flags, RFAL_NFCF_CMD_FAST_READ_MULTIPLE_BLOCKS, uid, param, sizeof(param), req, (sizeof(req) - RFAL_NFCV_IC_MFG_LEN), &reqLen ) );
+    ST_MEMMOVE( &req[RFAL_NFCV_FLAG_LEN + RFAL_CMD_LEN + RFAL_NFCV_IC_MFG_LEN], &req[RFAL_NFCV_FLAG_LEN + RFAL_CMD_LEN], (reqLen - RFAL_NFCV_FLAG_LEN - RFAL_CMD_LEN) );
+    req[RFAL_NFCV_FLAG_LEN + RFAL_CMD_LEN] = RFAL_NFCV_IC_MFG_NXP;
+    reqLen += RFAL_NFCV_IC_MFG_LEN;
+    
+    /* Transceive Command */
+    return rfalNfcvPollerTransceiveCustom( req, reqLen, true, rxBuf, rxBufLen, rcvLen );
+}
+
+/*******************************************************************************/
+ReturnCode rfalNfcvPollerBuildRequest( uint8_t flags, uint8_t cmd, const uint8_t* uid, const uint8_t* param, uint8_t paramLen, uint8_t* req, uint16_t reqBufLen, uint16_t* reqLen )
+{
+    uint16_t msgIt;
+    
+    if( (req == NULL) || (reqLen == NULL) || ((param == NULL) && (paramLen > 0)) )
+    {
+        return ERR_PARAM;
+    }
+    
+    if( (RFAL_NFCV_FLAG_LEN + RFAL_CMD_LEN + ((uid != NULL) ? RFAL_NFCV_UID_LEN : 0) + paramLen) > reqBufLen )
+    {
+        return ERR_NOMEM;
+    }
+    
+    msgIt = 0;
+    
+    /* Compute Request Command */
+    req[msgIt++] = (flags & (~RFAL_NFCV_REQ_FLAG_ADDRESS & ~RFAL_NFCV_REQ_FLAG_SELECT));
+    req[msgIt++] = cmd;
+    
+    /* Check if request is to be sent in Addressed or Selected mode */
+    if( uid != NULL )
+    {
+        req[0] |= RFAL_NFCV_REQ_FLAG_ADDRESS;
+        ST_MEMCPY( &req[msgIt], uid, RFAL_NFCV_UID_LEN );
+        msgIt += RFAL_NFCV_UID_LEN;
+    }
+    else
+    {
+        req[0] |= RFAL_NFCV_REQ_FLAG_SELECT;
+    }
+    
+    if( paramLen > 0 )
+    {
+        ST_MEMCPY( &req[msgIt], param, paramLen );
+        msgIt += paramLen;
+    }
+    
+    *reqLen = msgIt;
+    return ERR_NONE;
+}
+
+/*******************************************************************************/
+ReturnCode rfalNfcvPollerCheckResponse( const uint8_t* rxBuf, uint16_t rcvLen )
+{
+    /* Check if the response minimum length has been received */
+    if( (rxBuf == NULL) || (rcvLen < RFAL_NFCV_FLAG_LEN) )
+    {
+        return ERR_PROTO;
+    }
+    
+    /* Check if an error has been signalled */
+    if( rxBuf[0] & RFAL_NFCV_RES_FLAG_ERROR )
+    {
+        return ((rcvLen > RFAL_NFCV_FLAG_LEN) ? rfalNfvParseError( rxBuf[1] ) : ERR_REQUEST);
+    }
+    
+    return ERR_NONE;
+}
+
 #endif /* RFAL_FEATURE_NFCV */
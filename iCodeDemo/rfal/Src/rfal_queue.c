@@ -0,0 +1,360 @@
+
+/******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; COPYRIGHT 2018 STMicroelectronics</center></h2>
+  *
+  * Licensed under ST MYLIBERTY SOFTWARE LICENSE AGREEMENT (the "License");
+  * You may not use this file except in compliance with the License.
+  * You may obtain a copy of the License at:
+  *
+  *        http://www.st.com/myliberty
+  *
+  * Unless required by applicable law or agreed to in writing, software 
+  * distributed under the License is distributed on an "AS IS" BASIS, 
+  * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied,
+  * AND SPECIFICALLY DISCLAIMING THE IMPLIED WARRANTIES OF MERCHANTABILITY,
+  * FITNESS FOR A PARTICULAR PURPOSE, AND NON-INFRINGEMENT.
+  * See the License for the specific language governing permissions and
+  * limitations under the License.
+  *
+******************************************************************************/
+
+
+/*
+ *      PROJECT:   ST25R391x firmware
+ *      $Revision: $
+ *      LANGUAGE:  ISO C99
+ */
+
+/*! \file rfal_queue.c
+ *
+ *  \brief Implementation of the transceive queue
+ *
+ *  Each reader has a ring of RFAL_QUEUE_DEPTH slots; the slot at the head
+ *  is the request in progress. Requests are copied into their slot on
+ *  submission, so the RFAL transceive context and the NFC-V request frame
+ *  of a request stay valid while it runs.
+ *
+ */
+
+/*
+ ******************************************************************************
+ * INCLUDES
+ ******************************************************************************
+ */
+#include "rfal_queue.h"
+#include "utils.h"
+
+/*
+ ******************************************************************************
+ * ENABLE SWITCH
+ ******************************************************************************
+ */
+
+#ifndef RFAL_FEATURE_QUEUE
+    #error " RFAL: Module configuration missing. Please enable/disable the transceive queue by setting: RFAL_FEATURE_QUEUE "
+#endif
+
+#if RFAL_FEATURE_QUEUE
+
+/*
+******************************************************************************
+* LOCAL DATA TYPES
+******************************************************************************
+*/
+
+/*! Queue slot */
+typedef struct
+{
+    rfalQueueReq          req;                         /*!< Request as submitted                                      */
+    uint16_t*             txRxRcvdLen;                 /*!< Caller's rxRcvdLen of a raw transceive                    */
+    uint16_t              rxBits;                      /*!< Received bits of raw transceives and NFC-V commands       */
+    uint16_t              isoDepRxLen;                 /*!< Received bytes of APDUs submitted without rxLen           */
+    uint8_t               frame[RFAL_NFCV_MAX_REQ_LEN];/*!< NFC-V request frame                                       */
+    uint16_t              frameLen;                    /*!< NFC-V request frame length in bytes                       */
+} rfalQueueSlot;
+
+
+/*! Transceive queue of a reader */
+typedef struct
+{
+    rfalQueueSlot         slot[RFAL_QUEUE_DEPTH];      /*!< Ring of queued requests                                   */
+    uint8_t               head;                        /*!< Slot of the oldest request                                */
+    uint8_t               count;                       /*!< Number of queued requests                                 */
+    bool                  started;                     /*!< Request at the head has been started                      */
+    uint32_t              completed;                   /*!< Number of requests completed so far                       */
+} rfalQueue;
+
+/*
+******************************************************************************
+* LOCAL VARIABLES
+******************************************************************************
+*/
+
+static rfalQueue gRfalQueueInstance[PLATFORM_READERS];          /*!< Transceive queues, one per reader           */
+#define gRfalQueue   (gRfalQueueInstance[platformReaderId()])   /*!< Transceive queue of the current reader      */
+
+/*
+******************************************************************************
+* LOCAL FUNCTION PROTOTYPES
+******************************************************************************
+*/
+static bool rfalQueueTxRxContext( rfalQueueSlot *s, rfalTransceiveContext *ctx );
+static ReturnCode rfalQueueStart( rfalQueueSlot *s );
+static ReturnCode rfalQueueGetStatus( rfalQueueSlot *s );
+static void rfalQueueComplete( rfalQueueSlot *s, ReturnCode ret );
+
+/*
+******************************************************************************
+* LOCAL FUNCTIONS
+******************************************************************************
+*/
+
+/*******************************************************************************/
+static bool rfalQueueTxRxContext( rfalQueueSlot *s, rfalTransceiveContext *ctx )
+{
+    switch( s->req.type )
+    {
+        case RFAL_QUEUE_REQ_TXRX:
+            *ctx           = s->req.cmd.txRx;
+            ctx->rxRcvdLen = &s->rxBits;
+            return true;
+
+        case RFAL_QUEUE_REQ_NFCV:
+            rfalCreateByteFlagsTxRxContext( (*ctx), s->frame, s->frameLen, s->req.cmd.nfcv.rxBuf, s->req.cmd.nfcv.rxBufLen, &s->rxBits, RFAL_TXRX_FLAGS_DEFAULT,
+                                            ((s->req.cmd.nfcv.fwt != 0) ? s->req.cmd.nfcv.fwt : RFAL_QUEUE_NFCV_FWT_DEFAULT) );
+            return true;
+
+        default:
+            return false;
+    }
+}
+
+
+/*******************************************************************************/
+static ReturnCode rfalQueueStart( rfalQueueSlot *s )
+{
+    rfalTransceiveContext ctx;
+
+    s->rxBits = 0;
+
+    switch( s->req.type )
+    {
+        case RFAL_QUEUE_REQ_TXRX:
+        case RFAL_QUEUE_REQ_NFCV:
+            rfalQueueTxRxContext( s, &ctx );
+            return rfalStartTransceive( &ctx );
+
+    #if RFAL_FEATURE_ISO_DEP
+        case RFAL_QUEUE_REQ_ISODEP:
+            *s->req.cmd.isoDep.rxLen = 0;
+            return rfalIsoDepStartApduTransceive( s->req.cmd.isoDep );
+    #endif /* RFAL_FEATURE_ISO_DEP */
+
+        default:
+            return ERR_PARAM;
+    }
+}
+
+
+/*******************************************************************************/
+static ReturnCode rfalQueueGetStatus( rfalQueueSlot *s )
+{
+    rfalWorker();
+
+    #if RFAL_FEATURE_ISO_DEP
+    if( s->req.type == RFAL_QUEUE_REQ_ISODEP )
+    {
+        return rfalIsoDepGetApduTransceiveStatus();
+    }
+    #endif /* RFAL_FEATURE_ISO_DEP */
+
+    return rfalGetTransceiveStatus();
+}
+
+
+/*******************************************************************************/
+static void rfalQueueComplete( rfalQueueSlot *s, ReturnCode ret )
+{
+    rfalQueueReq req;
+
+    switch( s->req.type )
+    {
+        case RFAL_QUEUE_REQ_TXRX:
+            s->req.rcvLen = rfalConvBitsToBytes( s->rxBits );
+            if( s->txRxRcvdLen != NULL )
+            {
+                *s->txRxRcvdLen = s->rxBits;
+            }
+            break;
+
+        case RFAL_QUEUE_REQ_NFCV:
+            s->req.rcvLen = rfalConvBitsToBytes( s->rxBits );
+            if( ret == ERR_NONE )
+            {
+                ret = rfalNfcvPollerCheckResponse( s->req.cmd.nfcv.rxBuf, s->req.rcvLen );
+            }
+            break;
+
+        case RFAL_QUEUE_REQ_ISODEP:
+            s->req.rcvLen = *s->req.cmd.isoDep.rxLen;
+            break;
+
+        default:
+            break;
+    }
+
+    /* Free the slot first, the callback may submit into it */
+    req = s->req;
+    gRfalQueue.head    = ((gRfalQueue.head + 1) % RFAL_QUEUE_DEPTH);
+    gRfalQueue.count--;
+    gRfalQueue.started = false;
+    gRfalQueue.completed++;
+
+    if( req.callback != NULL )
+    {
+        req.callback( &req, ret );
+    }
+}
+
+
+/*
+******************************************************************************
+* GLOBAL FUNCTIONS
+******************************************************************************
+*/
+
+/*******************************************************************************/
+void rfalQueueInitialize( void )
+{
+    gRfalQueue.head    = 0;
+    gRfalQueue.count   = 0;
+    gRfalQueue.started = false;
+}
+
+
+/*******************************************************************************/
+ReturnCode rfalQueueSubmit( const rfalQueueReq *req )
+{
+    rfalQueueSlot *s;
+    ReturnCode     ret;
+
+    if( req == NULL )
+    {
+        return ERR_PARAM;
+    }
+
+    if( gRfalQueue.count >= RFAL_QUEUE_DEPTH )
+    {
+        return ERR_NOMEM;
+    }
+
+    s      = &gRfalQueue.slot[ ((gRfalQueue.head + gRfalQueue.count) % RFAL_QUEUE_DEPTH) ];
+    s->req = *req;
+    s->req.rcvLen = 0;
+
+    switch( req->type )
+    {
+        case RFAL_QUEUE_REQ_TXRX:
+            s->txRxRcvdLen = req->cmd.txRx.rxRcvdLen;
+            break;
+
+        case RFAL_QUEUE_REQ_NFCV:
+            if( req->cmd.nfcv.rxBuf == NULL )
+            {
+                return ERR_PARAM;
+            }
+
+            /* Built now, the request is ready when the previous one completes */
+            EXIT_ON_ERR( ret, rfalNfcvPollerBuildRequest( req->cmd.nfcv.flags, req->cmd.nfcv.cmd, req->cmd.nfcv.uid, req->cmd.nfcv.param, req->cmd.nfcv.paramLen, s->frame, sizeof(s->frame), &s->frameLen ) );
+            break;
+
+    #if RFAL_FEATURE_ISO_DEP
+        case RFAL_QUEUE_REQ_ISODEP:
+            if( s->req.cmd.isoDep.rxLen == NULL )
+            {
+                s->req.cmd.isoDep.rxLen = &s->isoDepRxLen;
+            }
+            break;
+    #endif /* RFAL_FEATURE_ISO_DEP */
+
+        default:
+            return ERR_PARAM;
+    }
+
+    gRfalQueue.count++;
+    return ERR_NONE;
+}
+
+
+/*******************************************************************************/
+ReturnCode rfalQueueWorker( void )
+{
+    rfalTransceiveContext ctx;
+    rfalQueueSlot        *s;
+    ReturnCode            ret;
+
+    while( gRfalQueue.count > 0 )
+    {
+        s = &gRfalQueue.slot[gRfalQueue.head];
+
+        if( !gRfalQueue.started )
+        {
+            ret = rfalQueueStart( s );
+            gRfalQueue.started = (ret == ERR_NONE);
+        }
+
+        if( gRfalQueue.started )
+        {
+            ret = rfalQueueGetStatus( s );
+            if( ret == ERR_BUSY )
+            {
+                /* Waiting for the response: code the next frame meanwhile */
+                if( (gRfalQueue.count > 1) && rfalIsTransceiveInRx() && rfalQueueTxRxContext( &gRfalQueue.slot[ ((gRfalQueue.head + 1) % RFAL_QUEUE_DEPTH) ], &ctx ) )
+                {
+                    rfalPreCodeTransceive( &ctx );
+                }
+                return ERR_BUSY;
+            }
+        }
+
+        rfalQueueComplete( s, ret );
+    }
+
+    return ERR_NONE;
+}
+
+
+/*******************************************************************************/
+void rfalQueueRunBlocking( void )
+{
+    rfalTrasceiveState state;
+    uint32_t           completed;
+    rfalIrqWaiter      w;
+    ReturnCode         ret;
+
+    do{
+        rfalIrqWaitPrepare( &w );
+        state     = rfalGetTransceiveState();
+        completed = gRfalQueue.completed;
+
+        ret = rfalQueueWorker();
+
+        /* No progress: wait for an IRQ or a SW timer */
+        if( (ret == ERR_BUSY) && (state == rfalGetTransceiveState()) && (completed == gRfalQueue.completed) )
+        {
+            rfalIrqWaitNext( &w );
+        }
+    }
+    while( ret == ERR_BUSY );
+}
+
+
+/*******************************************************************************/
+uint8_t rfalQueueGetCount( void )
+{
+    return gRfalQueue.count;
+}
+
+#endif /* RFAL_FEATURE_QUEUE */
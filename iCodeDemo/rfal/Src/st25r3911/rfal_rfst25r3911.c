@@ -148,11 +148,34 @@ typedef struct{
  *    
  *    ISO15693 frame: SOF + Flags + Data + CRC + EOF  
  */
+/*! Struct that holds the start of an NFC-V frame coded ahead of its transmission
+ *
+ * The first FIFO load of a frame is coded while waiting for the GT/FDT or, for
+ * the next frame of a caller, during the FWT of the current one; codingBuffer
+ * then holds the response being received. The rest of the frame is coded from 
+ * the caller's buffer on the FIFO water level, as before.
+ *    - the source bytes coded are kept to check the frame transmitted is the one coded
+ *    - 1 of 4: up to 23 data bytes fit on the FIFO; 1 of 256: 1 data byte
+ */
+typedef struct{
+    bool                  valid;                                /*!< A frame start is coded                              */
+    rfalMode              mode;                                 /*!< Mode the frame was coded in                         */
+    uint32_t              flags;                                /*!< CRC and NFC-V flag handling of the frame coded      */
+    uint16_t              length;                               /*!< Length of the frame coded in bytes                  */
+    uint8_t               txData[(ST25R3911_FIFO_DEPTH / 4)];   /*!< Source bytes coded                                  */
+    uint8_t               codingBuffer[ST25R3911_FIFO_DEPTH];   /*!< Coded start of the frame                            */
+    uint16_t              bytesTotal;                           /*!< Coded length of the whole frame                     */
+    uint16_t              bytesWritten;                         /*!< Coded bytes in codingBuffer                         */
+    uint16_t              nfcvOffset;                           /*!< Coding offset after codingBuffer                    */
+} rfalNfcvPreCoded;
+
+
 typedef struct{    
-    uint8_t               codingBuffer[((2 + 255 + 3)*2)];/*!< Coding buffer,   length MUST be above 64: [65; ...]                   */
+    uint8_t               codingBuffer[((2 + RFAL_NFCV_MAX_RX_LEN + 3)*2)];/*!< Coding buffer,   length MUST be above 64: [65; ...]  */
     uint16_t              nfcvOffset;                    /*!< Offset needed for ISO15693 coding function                             */
     rfalTransceiveContext origCtx;                       /*!< Context provided by user                                               */
     uint16_t              ignoreBits;                    /*!< Number of bits at the beginning of a frame to be ignored when decoding */
+    rfalNfcvPreCoded      preCoded;                      /*!< Start of the next frame, coded ahead                                   */
 } rfalNfcvWorkingData;
 
 
@@ -226,8 +249,9 @@ typedef enum
 #define RFAL_ST25R3911_MRT_MAX_1FC      rfalConv64fcTo1fc( 0x00FF )                  /*!< Max MRT steps in 1fc (0x00FF steps of 64/fc   => 0x00FF * 4.72us = 1.2ms )      */
 #define RFAL_ST25R3911_MRT_MIN_1FC      rfalConv64fcTo1fc( 0x0004 )                  /*!< Min MRT steps in 1fc ( 0<=mrt<=4 ; 4 (64/fc)  => 0x0004 * 4.72us = 18.88us )    */
 #define RFAL_ST25R3911_GT_MAX_1FC       rfalConvMsTo1fc( 5000 )                      /*!< Max GT value allowed in 1/fc                                                    */
-#define RFAL_ST25R3911_GT_MIN_1FC       rfalConvMsTo1fc(RFAL_ST25R3911_SW_TMR_MIN_1MS)/*!< Min GT value allowed in 1/fc                                                   */
+#define RFAL_ST25R3911_GT_MIN_1FC       rfalConvUsTo1fc(RFAL_ST25R3911_SW_TMR_MIN_US)/*!< Min GT value allowed in 1/fc                                                    */
 #define RFAL_ST25R3911_SW_TMR_MIN_1MS   1                                            /*!< Min value of a SW timer in ms                                                   */
+#define RFAL_ST25R3911_SW_TMR_MIN_US    100                                          /*!< Min value of a SW timer in us                                                   */
 
 #define RFAL_OBSMODE_DISABLE            0x00                                         /*!< Observation Mode disabled                                                       */
 
@@ -235,7 +259,7 @@ typedef enum
 #define RFAL_EMVCO_RX_MAXLEN            4                                            /*!< Maximum value where EMVCo to apply special error handling                       */
 #define RFAL_EMVCO_RX_MINLEN            2                                            /*!< Minimum value where EMVCo to apply special error handling                       */
 
-#define RFAL_NORXE_TOUT                 10                                           /*!< Timeout to be used on a potential missing RXE - Silicon ST25R3911B Errata #1.1  */
+#define RFAL_NORXE_TOUT_US              10000                                        /*!< Timeout to be used on a potential missing RXE - Silicon ST25R3911B Errata #1.1  */
 
 #define RFAL_ISO14443A_SDD_RES_LEN      5                                            /*!< SDD_RES | Anticollision (UID CLn) length  -  rfalNfcaSddRes                     */
 
@@ -317,7 +341,7 @@ typedef enum
 
 #define rfalCalcNumBytes( nBits )                (uint32_t)( (nBits + 7) / 8 )        /*!< Returns the number of bytes required to fit given the number of bits */
 
-#define rfalTimerStart( timer, time_ms )         timer = platformTimerCreate(time_ms) /*!< Configures and starts the RTOX timer          */
+#define rfalTimerStart( timer, time_us )         timer = platformTimerCreateUs(time_us) /*!< Configures and starts the given timer (us)   */
 #define rfalTimerisExpired( timer )              platformTimerIsExpired( timer )      /*!< Checks if timer has expired                   */
 
 #define rfalST25R3911ObsModeDisable()            st25r3911WriteTestRegister(0x01, 0x00)                  /*!< Disable ST25R3911 Observation mode                                                               */
@@ -347,7 +371,8 @@ typedef enum
  ******************************************************************************
  */
 
-static rfal gRFAL;              /*!< RFAL module instance               */
+static rfal gRFALInstance[PLATFORM_READERS];              /*!< RFAL module instances, one per reader      */
+#define gRFAL   (gRFALInstance[platformReaderId()])        /*!< RFAL module instance of the current reader */
 
 /*
 ******************************************************************************
@@ -358,6 +383,7 @@ static rfal gRFAL;              /*!< RFAL module instance               */
 static void rfalTransceiveTx( void );
 static void rfalTransceiveRx( void );
 static ReturnCode rfalTransceiveRunBlockingTx( void );
+static void rfalRunBlockingWorker( void );
 static void rfalPrepareTransceive( void );
 static void rfalCleanupTransceive( void );
 static void rfalErrorHandling( void );
@@ -371,6 +397,12 @@ static bool rfalFIFOStatusIsMissingPar( void );
 static bool rfalFIFOStatusIsIncompleteByte( void );
 static uint8_t rfalFIFOStatusGetNumBytes( void );
 static uint8_t rfalFIFOGetNumIncompleteBits( void );
+static void rfalST25R3911SetOpMode( uint8_t modeReg );
+
+#if RFAL_FEATURE_NFCV
+static ReturnCode rfalNfcvPreCode( uint8_t* txBuf, uint16_t txBufLen, uint32_t flags );
+static bool rfalNfcvIsPreCoded( const uint8_t* txBuf, uint16_t txBufLen, uint32_t flags );
+#endif /* RFAL_FEATURE_NFCV */
 
 
 /*
@@ -445,7 +477,8 @@ ReturnCode rfalInitialize( void )
     
 #if RFAL_FEATURE_NFCV    
     /* Initialize NFC-V Data */
-    gRFAL.nfcvData.ignoreBits = 0;
+    gRFAL.nfcvData.ignoreBits     = 0;
+    gRFAL.nfcvData.preCoded.valid = false;
 #endif /* RFAL_FEATURE_NFCV */
     
     /* Initialize Listen Mode */
@@ -610,11 +643,8 @@ ReturnCode rfalSetMode( rfalMode mode, rfalBitRate txBR, rfalBitRate rxBR )
         /*******************************************************************************/
         case RFAL_MODE_POLL_NFCA:
             
-            /* Disable wake up mode, if set */
-            st25r3911ClrRegisterBits( ST25R3911_REG_OP_CONTROL, ST25R3911_REG_OP_CONTROL_wu );
-            
-            /* Enable ISO14443A mode */
-            st25r3911WriteRegister(ST25R3911_REG_MODE, ST25R3911_REG_MODE_om_iso14443a);
+            /* Disable wake up mode, if set, and enable ISO14443A mode */
+            rfalST25R3911SetOpMode( ST25R3911_REG_MODE_om_iso14443a );
             
             /* Set Analog configurations for this mode and bit rate */
             rfalSetAnalogConfig( (RFAL_ANALOG_CONFIG_POLL | RFAL_ANALOG_CONFIG_TECH_NFCA | RFAL_ANALOG_CONFIG_BITRATE_COMMON | RFAL_ANALOG_CONFIG_TX) );
@@ -623,11 +653,8 @@ ReturnCode rfalSetMode( rfalMode mode, rfalBitRate txBR, rfalBitRate rxBR )
             
         /*******************************************************************************/
         case RFAL_MODE_POLL_NFCA_T1T:
-            /* Disable wake up mode, if set */
-            st25r3911ClrRegisterBits( ST25R3911_REG_OP_CONTROL, ST25R3911_REG_OP_CONTROL_wu );
-            
-            /* Enable Topaz mode */
-            st25r3911WriteRegister( ST25R3911_REG_MODE, ST25R3911_REG_MODE_om_topaz );
+            /* Disable wake up mode, if set, and enable Topaz mode */
+            rfalST25R3911SetOpMode( ST25R3911_REG_MODE_om_topaz );
             
             /* Set Analog configurations for this mode and bit rate */
             rfalSetAnalogConfig( (RFAL_ANALOG_CONFIG_POLL | RFAL_ANALOG_CONFIG_TECH_NFCA | RFAL_ANALOG_CONFIG_BITRATE_COMMON | RFAL_ANALOG_CONFIG_TX) );
@@ -637,11 +664,8 @@ ReturnCode rfalSetMode( rfalMode mode, rfalBitRate txBR, rfalBitRate rxBR )
         /*******************************************************************************/
         case RFAL_MODE_POLL_NFCB:
             
-            /* Disable wake up mode, if set */
-            st25r3911ClrRegisterBits( ST25R3911_REG_OP_CONTROL, ST25R3911_REG_OP_CONTROL_wu );
-            
-            /* Enable ISO14443B mode */
-            st25r3911WriteRegister(ST25R3911_REG_MODE, ST25R3911_REG_MODE_om_iso14443b);
+            /* Disable wake up mode, if set, and enable ISO14443B mode */
+            rfalST25R3911SetOpMode( ST25R3911_REG_MODE_om_iso14443b );
             
             /* Set the EGT, SOF, EOF and EOF */
             st25r3911ChangeRegisterBits(  ST25R3911_REG_ISO14443B_1, 
@@ -662,11 +686,8 @@ ReturnCode rfalSetMode( rfalMode mode, rfalBitRate txBR, rfalBitRate rxBR )
         /*******************************************************************************/
         case RFAL_MODE_POLL_B_PRIME:
             
-            /* Disable wake up mode, if set */
-            st25r3911ClrRegisterBits( ST25R3911_REG_OP_CONTROL, ST25R3911_REG_OP_CONTROL_wu );
-            
-            /* Enable ISO14443B mode */
-            st25r3911WriteRegister(ST25R3911_REG_MODE, ST25R3911_REG_MODE_om_iso14443b);
+            /* Disable wake up mode, if set, and enable ISO14443B mode */
+            rfalST25R3911SetOpMode( ST25R3911_REG_MODE_om_iso14443b );
             
             /* Set the EGT, SOF, EOF and EOF */
             st25r3911ChangeRegisterBits(  ST25R3911_REG_ISO14443B_1, 
@@ -687,11 +708,8 @@ ReturnCode rfalSetMode( rfalMode mode, rfalBitRate txBR, rfalBitRate rxBR )
         /*******************************************************************************/
         case RFAL_MODE_POLL_B_CTS:
             
-            /* Disable wake up mode, if set */
-            st25r3911ClrRegisterBits( ST25R3911_REG_OP_CONTROL, ST25R3911_REG_OP_CONTROL_wu );
-            
-            /* Enable ISO14443B mode */
-            st25r3911WriteRegister(ST25R3911_REG_MODE, ST25R3911_REG_MODE_om_iso14443b);
+            /* Disable wake up mode, if set, and enable ISO14443B mode */
+            rfalST25R3911SetOpMode( ST25R3911_REG_MODE_om_iso14443b );
             
             /* Set the EGT, SOF, EOF and EOF */
             st25r3911ChangeRegisterBits(  ST25R3911_REG_ISO14443B_1, 
@@ -712,11 +730,8 @@ ReturnCode rfalSetMode( rfalMode mode, rfalBitRate txBR, rfalBitRate rxBR )
         /*******************************************************************************/
         case RFAL_MODE_POLL_NFCF:
             
-            /* Disable wake up mode, if set */
-            st25r3911ClrRegisterBits( ST25R3911_REG_OP_CONTROL, ST25R3911_REG_OP_CONTROL_wu );
-            
-            /* Enable FeliCa mode */
-            st25r3911WriteRegister( ST25R3911_REG_MODE, ST25R3911_REG_MODE_om_felica );
+            /* Disable wake up mode, if set, and enable FeliCa mode */
+            rfalST25R3911SetOpMode( ST25R3911_REG_MODE_om_felica );
             
             /* Set Analog configurations for this mode and bit rate */
             rfalSetAnalogConfig( (RFAL_ANALOG_CONFIG_POLL | RFAL_ANALOG_CONFIG_TECH_NFCF | RFAL_ANALOG_CONFIG_BITRATE_COMMON | RFAL_ANALOG_CONFIG_TX) );
@@ -871,6 +886,9 @@ ReturnCode rfalSetBitRate( rfalBitRate txBR, rfalBitRate rxBR )
                     
                     iso15693PhyConfigure(&config, &stream_config);
                     st25r3911StreamConfigure((struct st25r3911StreamConfig*)stream_config);
+                    
+                    /* A frame coded ahead may use the previous coding */
+                    gRFAL.nfcvData.preCoded.valid = false;
                 }
     
                 /* Set Analog configurations for this bit rate */
@@ -1032,10 +1050,19 @@ bool rfalIsGTExpired( void )
 ReturnCode rfalFieldOnAndStartGT( void )
 {
     ReturnCode ret;
+    uint8_t    opCtrl;
+    
+    if( gRFAL.state < RFAL_STATE_INIT )
+    {
+        return ERR_WRONG_STATE;
+    }
+    
+    /* Oscillator and Tx state are both in Operation Control register, read it once */
+    st25r3911ReadRegister( ST25R3911_REG_OP_CONTROL, &opCtrl );
     
     /* Check if RFAL has been initialized (Oscillator should be running) and also
      * if a direct register access has been performed and left the Oscillator Off */
-    if( (gRFAL.state < RFAL_STATE_INIT) || !st25r3911IsOscOn() )
+    if( !(opCtrl & ST25R3911_REG_OP_CONTROL_en) )
     {
         return ERR_WRONG_STATE;
     }
@@ -1044,7 +1071,7 @@ ReturnCode rfalFieldOnAndStartGT( void )
     
     /*******************************************************************************/
     /* Perform collision avoidance and turn field On if not already On */
-    if( !gRFAL.field || !st25r3911IsTxEnabled() )
+    if( !gRFAL.field || !(opCtrl & ST25R3911_REG_OP_CONTROL_tx_en) )
     {
         /* Use Thresholds set by AnalogConfig */
         ret = st25r3911PerformCollisionAvoidance( ST25R3911_CMD_RESPONSE_RF_COLLISION_0, ST25R3911_THRESHOLD_DO_NOT_SET, ST25R3911_THRESHOLD_DO_NOT_SET, 0 );
@@ -1063,7 +1090,7 @@ ReturnCode rfalFieldOnAndStartGT( void )
     if( (gRFAL.timings.GT != RFAL_TIMING_NONE) )
     {
         /* Ensure that a SW timer doesn't have a lower value then the minimum  */
-        rfalTimerStart( gRFAL.tmr.GT, rfalConv1fcToMs( MAX( (gRFAL.timings.GT), RFAL_ST25R3911_GT_MIN_1FC) ) );
+        rfalTimerStart( gRFAL.tmr.GT, rfalConv1fcToUs( MAX( (gRFAL.timings.GT), RFAL_ST25R3911_GT_MIN_1FC) ) );
     }
     
     return ret;
@@ -1104,6 +1131,9 @@ ReturnCode rfalStartTransceive( rfalTransceiveContext *ctx )
         
         gRFAL.TxRx.ctx = *ctx;
         
+        /* MRT and NRT settings are sent together */
+        st25r3911TxnBegin();
+        
         /*******************************************************************************/
         if( gRFAL.timings.FDTListen != RFAL_TIMING_NONE )
         {
@@ -1115,7 +1145,7 @@ ReturnCode rfalStartTransceive( rfalTransceiveContext *ctx )
             
             
             /* Set Minimum FDT(Listen) in which PICC is not allowed to send a response */
-            st25r3911WriteRegister( ST25R3911_REG_MASK_RX_TIMER, rfalConv1fcTo64fc( (FxTAdj > gRFAL.timings.FDTListen) ? RFAL_ST25R3911_MRT_MIN_1FC : (gRFAL.timings.FDTListen - FxTAdj) ) );
+            st25r3911TxnWriteRegister( ST25R3911_REG_MASK_RX_TIMER, rfalConv1fcTo64fc( (FxTAdj > gRFAL.timings.FDTListen) ? RFAL_ST25R3911_MRT_MIN_1FC : (gRFAL.timings.FDTListen - FxTAdj) ) );
         }
         
         /*******************************************************************************/
@@ -1155,6 +1185,8 @@ ReturnCode rfalStartTransceive( rfalTransceiveContext *ctx )
             /* In Active Mode No Response Timer cannot be used to measure FWT a SW timer is used instead */
         }
         
+        st25r3911TxnCommit();
+        
         gRFAL.state       = RFAL_STATE_TXRX;
         gRFAL.TxRx.state  = RFAL_TXRX_STATE_TX_IDLE;
         gRFAL.TxRx.status = ERR_BUSY;
@@ -1194,11 +1226,15 @@ ReturnCode rfalStartTransceive( rfalTransceiveContext *ctx )
             /* Clear FIFO, Clear and Enable the Interrupts */
             rfalPrepareTransceive( );
             
+            st25r3911TxnBegin();
+            
             /* No Tx done, enable the Receiver */
-            st25r3911ExecuteCommand( ST25R3911_CMD_UNMASK_RECEIVE_DATA );
+            st25r3911TxnExecuteCommand( ST25R3911_CMD_UNMASK_RECEIVE_DATA );
 
             /* Start NRT manually, if FWT = 0 (wait endlessly for Rx) chip will ignore anyhow */
-            st25r3911ExecuteCommand( ST25R3911_CMD_START_NO_RESPONSE_TIMER );
+            st25r3911TxnExecuteCommand( ST25R3911_CMD_START_NO_RESPONSE_TIMER );
+            
+            st25r3911TxnCommit();
             
             gRFAL.TxRx.state  = RFAL_TXRX_STATE_RX_IDLE;
         }
@@ -1229,7 +1265,7 @@ static ReturnCode rfalTransceiveRunBlockingTx( void )
     ReturnCode ret;
         
     do{
-        rfalWorker();
+        rfalRunBlockingWorker();
     }
     while( ((ret = rfalGetTransceiveStatus() ) == ERR_BUSY) && rfalIsTransceiveInTx() );
     
@@ -1248,7 +1284,7 @@ ReturnCode rfalTransceiveBlockingRx( void )
     ReturnCode ret;
     
     do{
-        rfalWorker();
+        rfalRunBlockingWorker();
     }
     while( ((ret = rfalGetTransceiveStatus() ) == ERR_BUSY) && rfalIsTransceiveInRx() );    
         
@@ -1274,6 +1310,59 @@ ReturnCode rfalTransceiveBlockingTxRx( uint8_t* txBuf, uint16_t txBufLen, uint8_
 }
 
 
+/*******************************************************************************/
+void rfalIrqWaitPrepare( rfalIrqWaiter *w )
+{
+    /* Sequence first: an IRQ handled from now on ends the wait */
+    w->seq   = platformIrqSequence();
+    w->start = platformGetTimeUs();
+}
+
+
+/*******************************************************************************/
+void rfalIrqWaitNext( const rfalIrqWaiter *w )
+{
+    uint32_t deadline;
+    uint32_t waitUs;
+    int32_t  left;
+    
+    waitUs = RFAL_IRQ_WAIT_SLICE_US;
+    
+    /* Timers not raising an IRQ (GT, RXE, FWT...) are only seen by the next  *
+     * run: wake up when the earliest one created since the run began expires */
+    if( platformTimerNextDeadline( w->start, &deadline ) )
+    {
+        left = (int32_t)(deadline - platformGetTimeUs());
+        if( left <= 0 )
+        {
+            return;
+        }
+        waitUs = MIN( waitUs, (uint32_t)left );
+    }
+    
+    platformIrqWait( w->seq, waitUs );
+}
+
+
+/*******************************************************************************/
+static void rfalRunBlockingWorker( void )
+{
+    rfalIrqWaiter      w;
+    rfalTrasceiveState state;
+    
+    rfalIrqWaitPrepare( &w );
+    state = gRFAL.TxRx.state;
+    
+    rfalWorker();
+    
+    /* No progress: the state machine waits for an IRQ or a SW timer */
+    if( (gRFAL.TxRx.state == state) && (rfalGetTransceiveStatus() == ERR_BUSY) )
+    {
+        rfalIrqWaitNext( &w );
+    }
+}
+
+
 /*******************************************************************************/
 static ReturnCode rfalRunTransceiveWorker( void )
 {
@@ -1306,6 +1395,35 @@ ReturnCode rfalGetTransceiveStatus( void )
 }
 
 
+/*******************************************************************************/
+ReturnCode rfalPreCodeTransceive( rfalTransceiveContext *ctx )
+{
+#if RFAL_FEATURE_NFCV
+    if( (ctx == NULL) || (ctx->txBuf == NULL) )
+    {
+        return ERR_PARAM;
+    }
+    
+    /* Only the streamed modes code frames on the host */
+    if( (RFAL_MODE_POLL_NFCV != gRFAL.mode) && (RFAL_MODE_POLL_PICOPASS != gRFAL.mode) )
+    {
+        return ERR_NONE;
+    }
+    
+    /* The frame being transmitted may still use the coded start */
+    if( (gRFAL.state == RFAL_STATE_TXRX) && rfalIsTransceiveInTx() )
+    {
+        return ERR_BUSY;
+    }
+    
+    return rfalNfcvPreCode( ctx->txBuf, ctx->txBufLen, ctx->flags );
+#else
+    NO_WARNING(ctx);
+    return ERR_NONE;
+#endif /* RFAL_FEATURE_NFCV */
+}
+
+
 /*******************************************************************************/
 void rfalWorker( void )
 {
@@ -1437,17 +1555,32 @@ static void rfalPrepareTransceive( void )
 {
     uint32_t maskInterrupts;
     uint8_t  reg;
+    uint16_t gpt;
+    uint8_t  gptCtrl;
+    uint8_t  isoANfc;
+    uint8_t  rxConf2;
+    
+    /*******************************************************************************/
+    /* Fetch the registers to be modified with a single SPI transaction            */
+    st25r3911TxnBegin();
+    st25r3911TxnReadRegister( ST25R3911_REG_GPT_CONTROL, &gptCtrl );
+    st25r3911TxnReadRegister( ST25R3911_REG_ISO14443A_NFC, &isoANfc );
+    st25r3911TxnReadRegister( ST25R3911_REG_RX_CONF2, &rxConf2 );
+    st25r3911TxnCommit();
+    
+    st25r3911TxnBegin();
     
     /*******************************************************************************/
     /* In the EMVCo mode the NRT will continue to run.                             *
      * For the clear to stop it, the EMV mode has to be disabled before            */
-    st25r3911ClrRegisterBits( ST25R3911_REG_GPT_CONTROL, ST25R3911_REG_GPT_CONTROL_nrt_emv );
+    gptCtrl &= ~ST25R3911_REG_GPT_CONTROL_nrt_emv;
+    st25r3911TxnWriteRegister( ST25R3911_REG_GPT_CONTROL, gptCtrl );
     
     /* Reset receive logic */
-    st25r3911ExecuteCommand( ST25R3911_CMD_CLEAR_FIFO );
+    st25r3911TxnExecuteCommand( ST25R3911_CMD_CLEAR_FIFO );
     
     /* Reset Rx Gain */
-    st25r3911ExecuteCommand( ST25R3911_CMD_CLEAR_SQUELCH );
+    st25r3911TxnExecuteCommand( ST25R3911_CMD_CLEAR_SQUELCH );
     
     
     /*******************************************************************************/
@@ -1459,7 +1592,12 @@ static void rfalPrepareTransceive( void )
        if( gRFAL.timings.FDTPoll != RFAL_TIMING_NONE )
        {
            /* Configure GPT to start at RX end */
-           st25r3911StartGPTimer_8fcs( rfalConv1fcTo8fc( MIN( gRFAL.timings.FDTPoll, (gRFAL.timings.FDTPoll - RFAL_FDT_POLL_ADJUSTMENT) ) ), ST25R3911_REG_GPT_CONTROL_gptc_erx );
+           gpt     = rfalConv1fcTo8fc( MIN( gRFAL.timings.FDTPoll, (gRFAL.timings.FDTPoll - RFAL_FDT_POLL_ADJUSTMENT) ) );
+           gptCtrl = ((gptCtrl & ~ST25R3911_REG_GPT_CONTROL_gptc_mask) | ST25R3911_REG_GPT_CONTROL_gptc_erx);
+           
+           st25r3911TxnWriteRegister( ST25R3911_REG_GPT1, (uint8_t)(gpt >> 8) );
+           st25r3911TxnWriteRegister( ST25R3911_REG_GPT2, (uint8_t)(gpt & 0xff) );
+           st25r3911TxnWriteRegister( ST25R3911_REG_GPT_CONTROL, gptCtrl );
        }
     }
     
@@ -1469,7 +1607,18 @@ static void rfalPrepareTransceive( void )
     /*******************************************************************************/
     if( gRFAL.callbacks.preTxRx != NULL )
     {
+        /* Callback may access the chip: send what is queued and refresh the copies */
+        st25r3911TxnCommit();
+        
         gRFAL.callbacks.preTxRx();
+        
+        st25r3911TxnBegin();
+        st25r3911TxnReadRegister( ST25R3911_REG_GPT_CONTROL, &gptCtrl );
+        st25r3911TxnReadRegister( ST25R3911_REG_ISO14443A_NFC, &isoANfc );
+        st25r3911TxnReadRegister( ST25R3911_REG_RX_CONF2, &rxConf2 );
+        st25r3911TxnCommit();
+        
+        st25r3911TxnBegin();
     }
     /*******************************************************************************/
     
@@ -1479,6 +1628,12 @@ static void rfalPrepareTransceive( void )
                        ST25R3911_IRQ_MASK_PAR  | ST25R3911_IRQ_MASK_CRC  |
                        ST25R3911_IRQ_MASK_ERR1 | ST25R3911_IRQ_MASK_ERR2  );
     
+    /* GPT measuring FDT Poll: its expiry wakes up the blocking waits before the next TX */
+    if( rfalIsModePassiveComm( gRFAL.mode ) && (gRFAL.timings.FDTPoll != RFAL_TIMING_NONE) )
+    {
+        maskInterrupts |= ST25R3911_IRQ_MASK_GPE;
+    }
+    
     
     /*******************************************************************************/
     /* Transceive flags                                                            */
@@ -1505,18 +1660,21 @@ static void rfalPrepareTransceive( void )
     }
     
     /* Apply current TxRx flags on ISO14443A and NFC 106kb/s Settings Register */
-    st25r3911ChangeRegisterBits( ST25R3911_REG_ISO14443A_NFC, (ST25R3911_REG_ISO14443A_NFC_no_tx_par | ST25R3911_REG_ISO14443A_NFC_no_rx_par | ST25R3911_REG_ISO14443A_NFC_nfc_f0), reg );
+    isoANfc &= ~(ST25R3911_REG_ISO14443A_NFC_no_tx_par | ST25R3911_REG_ISO14443A_NFC_no_rx_par | ST25R3911_REG_ISO14443A_NFC_nfc_f0);
+    isoANfc |= reg;
+    st25r3911TxnWriteRegister( ST25R3911_REG_ISO14443A_NFC, isoANfc );
     
     
     /* Check if AGC is to be disabled */
     if( (gRFAL.TxRx.ctx.flags & RFAL_TXRX_FLAGS_AGC_OFF) )
     {
-        st25r3911ClrRegisterBits( ST25R3911_REG_RX_CONF2, ST25R3911_REG_RX_CONF2_agc_en );
+        rxConf2 &= ~ST25R3911_REG_RX_CONF2_agc_en;
     }
     else
     {
-        st25r3911SetRegisterBits( ST25R3911_REG_RX_CONF2, ST25R3911_REG_RX_CONF2_agc_en );
+        rxConf2 |= ST25R3911_REG_RX_CONF2_agc_en;
     }
+    st25r3911TxnWriteRegister( ST25R3911_REG_RX_CONF2, rxConf2 );
     /*******************************************************************************/
     
     
@@ -1526,14 +1684,16 @@ static void rfalPrepareTransceive( void )
     /*******************************************************************************/
     if( gRFAL.conf.eHandling == RFAL_ERRORHANDLING_EMVCO )
     {
-        st25r3911SetRegisterBits( ST25R3911_REG_GPT_CONTROL, ST25R3911_REG_GPT_CONTROL_nrt_emv );
+        gptCtrl |= ST25R3911_REG_GPT_CONTROL_nrt_emv;
     }
     else
     {
-        st25r3911ClrRegisterBits( ST25R3911_REG_GPT_CONTROL, ST25R3911_REG_GPT_CONTROL_nrt_emv );
+        gptCtrl &= ~ST25R3911_REG_GPT_CONTROL_nrt_emv;
     }
+    st25r3911TxnWriteRegister( ST25R3911_REG_GPT_CONTROL, gptCtrl );
     /*******************************************************************************/
     
+    st25r3911TxnCommit();
     
     
     /* In Active comms enable also External Field interrupts  */
@@ -1552,6 +1712,53 @@ static void rfalPrepareTransceive( void )
     rfalFIFOStatusClear();
 }
 
+#if RFAL_FEATURE_NFCV
+/*******************************************************************************/
+static bool rfalNfcvIsPreCoded( const uint8_t* txBuf, uint16_t txBufLen, uint32_t flags )
+{
+    rfalNfcvPreCoded *pre = &gRFAL.nfcvData.preCoded;
+    
+    flags &= (RFAL_TXRX_FLAGS_CRC_TX_MANUAL | RFAL_TXRX_FLAGS_NFCV_FLAG_MANUAL);
+    
+    return ( pre->valid && (pre->mode == gRFAL.mode) && (pre->flags == flags) && (pre->length == rfalConvBitsToBytes(txBufLen))
+             && (ST_BYTECMP( pre->txData, txBuf, MIN( pre->nfcvOffset, pre->length ) ) == 0) );
+}
+
+
+/*******************************************************************************/
+static ReturnCode rfalNfcvPreCode( uint8_t* txBuf, uint16_t txBufLen, uint32_t flags )
+{
+    rfalNfcvPreCoded *pre = &gRFAL.nfcvData.preCoded;
+    ReturnCode        ret;
+    
+    if( rfalNfcvIsPreCoded( txBuf, txBufLen, flags ) )
+    {
+        return ERR_NONE;
+    }
+    
+    pre->valid      = false;
+    pre->mode       = gRFAL.mode;
+    pre->flags      = (flags & (RFAL_TXRX_FLAGS_CRC_TX_MANUAL | RFAL_TXRX_FLAGS_NFCV_FLAG_MANUAL));
+    pre->length     = rfalConvBitsToBytes(txBufLen);
+    pre->nfcvOffset = 0;
+    
+    /* Code the first FIFO load, the coder also adapts the request flags of txBuf */
+    ret = iso15693VCDCode( txBuf, pre->length, ((flags & RFAL_TXRX_FLAGS_CRC_TX_MANUAL)?false:true), ((flags & RFAL_TXRX_FLAGS_NFCV_FLAG_MANUAL)?false:true), (RFAL_MODE_POLL_PICOPASS == gRFAL.mode),
+                           &pre->bytesTotal, &pre->nfcvOffset, pre->codingBuffer, sizeof(pre->codingBuffer), &pre->bytesWritten );
+    
+    if( (ret != ERR_NONE) && (ret != ERR_AGAIN) )
+    {
+        return ret;
+    }
+    
+    ST_MEMCPY( pre->txData, txBuf, MIN( pre->nfcvOffset, pre->length ) );
+    pre->valid = true;
+    
+    return ERR_NONE;
+}
+#endif /* RFAL_FEATURE_NFCV */
+
+
 /*******************************************************************************/
 static void rfalTransceiveTx( void )
 {
@@ -1585,6 +1792,13 @@ static void rfalTransceiveTx( void )
             
             if( !rfalIsGTExpired() )
             {
+            #if RFAL_FEATURE_NFCV
+                /* Code the frame meanwhile, TX then only loads the FIFO */
+                if( (RFAL_MODE_POLL_NFCV == gRFAL.mode) || (RFAL_MODE_POLL_PICOPASS == gRFAL.mode) )
+                {
+                    rfalNfcvPreCode( gRFAL.TxRx.ctx.txBuf, gRFAL.TxRx.ctx.txBufLen, gRFAL.nfcvData.origCtx.flags );
+                }
+            #endif /* RFAL_FEATURE_NFCV */
                 break;
             }
             
@@ -1601,7 +1815,14 @@ static void rfalTransceiveTx( void )
             if( rfalIsModePassiveComm( gRFAL.mode ) )
             {
                 if( st25r3911IsGPTRunning() )
-                {                
+                {
+                #if RFAL_FEATURE_NFCV
+                    /* Code the frame meanwhile, TX then only loads the FIFO */
+                    if( (RFAL_MODE_POLL_NFCV == gRFAL.mode) || (RFAL_MODE_POLL_PICOPASS == gRFAL.mode) )
+                    {
+                        rfalNfcvPreCode( gRFAL.TxRx.ctx.txBuf, gRFAL.TxRx.ctx.txBufLen, gRFAL.nfcvData.origCtx.flags );
+                    }
+                #endif /* RFAL_FEATURE_NFCV */
                    break;
                 }
             }
@@ -1630,27 +1851,37 @@ static void rfalTransceiveTx( void )
                 st25r3911ExecuteCommand( ST25R3911_CMD_CLEAR_FIFO );
 #endif
                 /* Calculate the bytes needed to be Written into FIFO (a incomplete byte will be added as 1byte) */
-                gRFAL.nfcvData.nfcvOffset = 0;
-                ret = iso15693VCDCode(gRFAL.TxRx.ctx.txBuf, rfalConvBitsToBytes(gRFAL.TxRx.ctx.txBufLen), ((gRFAL.nfcvData.origCtx.flags & RFAL_TXRX_FLAGS_CRC_TX_MANUAL)?false:true),((gRFAL.nfcvData.origCtx.flags & RFAL_TXRX_FLAGS_NFCV_FLAG_MANUAL)?false:true), (RFAL_MODE_POLL_PICOPASS == gRFAL.mode),
-                          &gRFAL.fifo.bytesTotal, &gRFAL.nfcvData.nfcvOffset, gRFAL.nfcvData.codingBuffer, MIN( ST25R3911_FIFO_DEPTH, sizeof(gRFAL.nfcvData.codingBuffer) ), &gRFAL.fifo.bytesWritten);
+                ret = rfalNfcvPreCode( gRFAL.TxRx.ctx.txBuf, gRFAL.TxRx.ctx.txBufLen, gRFAL.nfcvData.origCtx.flags );
+                
+                /* The coded start is used once, whether coded ahead or just now */
+                gRFAL.nfcvData.preCoded.valid = false;
 
-                if( (ret != ERR_NONE) && (ret != ERR_AGAIN) )
+                if( ret != ERR_NONE )
                 {
                     gRFAL.TxRx.status = ret;
                     gRFAL.TxRx.state  = RFAL_TXRX_STATE_TX_FAIL;
                     break;
                 }
+                
+                gRFAL.fifo.bytesTotal     = gRFAL.nfcvData.preCoded.bytesTotal;
+                gRFAL.fifo.bytesWritten   = gRFAL.nfcvData.preCoded.bytesWritten;
+                gRFAL.nfcvData.nfcvOffset = gRFAL.nfcvData.preCoded.nfcvOffset;
+                
+                st25r3911TxnBegin();
+                
                 /* Set the number of full bytes and bits to be transmitted */
                 st25r3911SetNumTxBits( rfalConvBytesToBits(gRFAL.fifo.bytesTotal) );
 
                 /* Load FIFO with coded bytes */
-                st25r3911WriteFifo( gRFAL.nfcvData.codingBuffer, gRFAL.fifo.bytesWritten );
+                st25r3911TxnWriteFifo( gRFAL.nfcvData.preCoded.codingBuffer, gRFAL.fifo.bytesWritten );
 
             }
             /*******************************************************************************/
             else
         #endif /* RFAL_FEATURE_NFCV */
             {
+                st25r3911TxnBegin();
+                
                 /* Calculate the bytes needed to be Written into FIFO (a incomplete byte will be added as 1byte) */
                 gRFAL.fifo.bytesTotal = rfalCalcNumBytes(gRFAL.TxRx.ctx.txBufLen);
                 
@@ -1659,7 +1890,7 @@ static void rfalTransceiveTx( void )
                 
                 /* Load FIFO with total length or FIFO's maximum */
                 gRFAL.fifo.bytesWritten = MIN( gRFAL.fifo.bytesTotal, ST25R3911_FIFO_DEPTH );
-                st25r3911WriteFifo( gRFAL.TxRx.ctx.txBuf, gRFAL.fifo.bytesWritten );
+                st25r3911TxnWriteFifo( gRFAL.TxRx.ctx.txBuf, gRFAL.fifo.bytesWritten );
             }
         
             /*Check if Observation Mode is enabled and set it on ST25R391x */
@@ -1669,12 +1900,15 @@ static void rfalTransceiveTx( void )
             /* Trigger/Start transmission                                                  */
             if( gRFAL.TxRx.ctx.flags & RFAL_TXRX_FLAGS_CRC_TX_MANUAL )
             {
-                st25r3911ExecuteCommand( ST25R3911_CMD_TRANSMIT_WITHOUT_CRC );
+                st25r3911TxnExecuteCommand( ST25R3911_CMD_TRANSMIT_WITHOUT_CRC );
             }
             else
             {
-                st25r3911ExecuteCommand( ST25R3911_CMD_TRANSMIT_WITH_CRC );
+                st25r3911TxnExecuteCommand( ST25R3911_CMD_TRANSMIT_WITH_CRC );
             }
+            
+            /* Send TX length, FIFO data and transmit command in a single SPI transaction */
+            st25r3911TxnCommit();
              
             /* Check if a WL level is expected or TXE should come */
             gRFAL.TxRx.state = (( gRFAL.fifo.bytesWritten < gRFAL.fifo.bytesTotal ) ? RFAL_TXRX_STATE_TX_WAIT_WL : RFAL_TXRX_STATE_TX_WAIT_TXE);
@@ -1763,7 +1997,7 @@ static void rfalTransceiveTx( void )
                 /* In Active comm start SW timer to measure FWT */
                 if( rfalIsModeActiveComm( gRFAL.mode) && (gRFAL.TxRx.ctx.fwt != RFAL_FWT_NONE) && (gRFAL.TxRx.ctx.fwt != 0) ) 
                 {
-                    rfalTimerStart( gRFAL.tmr.FWT, rfalConv1fcToMs( gRFAL.TxRx.ctx.fwt ) );
+                    rfalTimerStart( gRFAL.tmr.FWT, rfalConv1fcToUs( gRFAL.TxRx.ctx.fwt ) );
                 }
                 
                 gRFAL.TxRx.state = RFAL_TXRX_STATE_TX_DONE;
@@ -1925,7 +2159,7 @@ static void rfalTransceiveRx( void )
                     /* REMARK: Silicon workaround ST25R3911 Errata #1.1                            */
                     /* Rarely on corrupted frames I_rxs gets signaled but I_rxe is not signaled    */
                     /* Use a SW timer to handle an eventual missing RXE                            */
-                    rfalTimerStart( gRFAL.tmr.RXE, RFAL_NORXE_TOUT );
+                    rfalTimerStart( gRFAL.tmr.RXE, RFAL_NORXE_TOUT_US );
                     /*******************************************************************************/
                     
                     gRFAL.TxRx.state  = RFAL_TXRX_STATE_RX_WAIT_RXE;
@@ -2195,7 +2429,7 @@ static void rfalTransceiveRx( void )
             /* ST25R3911 may indicate RXS without RXE afterwards, this happens rarely on   */
             /* corrupted frames.                                                           */
             /* Re-Start SW timer to handle an eventual missing RXE                         */
-            rfalTimerStart( gRFAL.tmr.RXE, RFAL_NORXE_TOUT );
+            rfalTimerStart( gRFAL.tmr.RXE, RFAL_NORXE_TOUT_US );
             /*******************************************************************************/        
                     
         
@@ -2301,12 +2535,30 @@ static void rfalTransceiveRx( void )
     }    
 }
 
+/*******************************************************************************/
+static void rfalST25R3911SetOpMode( uint8_t modeReg )
+{
+    uint8_t regs[2];
+    
+    /* Operation Control and Mode registers are consecutive, write both in a single frame */
+    st25r3911ReadRegister( ST25R3911_REG_OP_CONTROL, &regs[0] );
+    regs[0] &= ~ST25R3911_REG_OP_CONTROL_wu;
+    regs[1]  = modeReg;
+    
+    st25r3911WriteMultipleRegisters( ST25R3911_REG_OP_CONTROL, regs, sizeof(regs) );
+}
+
+
 /*******************************************************************************/
 static void rfalFIFOStatusUpdate( void )
 {
     if(gRFAL.fifo.status[RFAL_FIFO_STATUS_REG2] == RFAL_FIFO_STATUS_INVALID)
     {
-        st25r3911ReadMultipleRegisters( ST25R3911_REG_FIFO_RX_STATUS1, gRFAL.fifo.status, ST25R3911_FIFO_STATUS_LEN );
+        /* Use the FIFO status read by the ISR if the FIFO was not accessed since */
+        if( !st25r3911GetFifoStatus( gRFAL.fifo.status ) )
+        {
+            st25r3911ReadMultipleRegisters( ST25R3911_REG_FIFO_RX_STATUS1, gRFAL.fifo.status, ST25R3911_FIFO_STATUS_LEN );
+        }
     }
 }
 
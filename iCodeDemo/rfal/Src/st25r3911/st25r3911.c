@@ -60,7 +60,8 @@
 * LOCAL VARIABLES
 ******************************************************************************
 */
-static uint32_t st25r3911NoResponseTime_64fcs;
+static uint32_t st25r3911NoResponseTimeInstance_64fcs[PLATFORM_READERS];
+#define st25r3911NoResponseTime_64fcs   (st25r3911NoResponseTimeInstance_64fcs[platformReaderId()])
 
 /*
 ******************************************************************************
@@ -116,6 +117,9 @@ void st25r3911Initialize()
 
     /* first, reset the st25r3911 */
     st25r3911ExecuteCommand(ST25R3911_CMD_SET_DEFAULT);
+    
+    /* register content is back to defaults, drop the cached values */
+    st25r3911ShadowInvalidate();
 
         
     /* enable pull downs on miso line */
@@ -318,21 +322,32 @@ uint32_t st25r3911GetNoResponseTime_64fcs()
 
 void st25r3911StartGPTimer_8fcs(uint16_t gpt_8fcs, uint8_t trigger_source)
 {
-    st25r3911SetGPTime_8fcs(gpt_8fcs);
-
-    st25r3911ModifyRegister(ST25R3911_REG_GPT_CONTROL, 
-            ST25R3911_REG_GPT_CONTROL_gptc_mask, 
-            trigger_source);
+    uint8_t gptRegs[3];
+    
+    st25r3911ReadRegister(ST25R3911_REG_GPT_CONTROL, &gptRegs[0]);
+    
+    /* GPT control and GPT1/2 are consecutive, write them in a single frame */
+    gptRegs[0] = ((gptRegs[0] & ~ST25R3911_REG_GPT_CONTROL_gptc_mask) | trigger_source);
+    gptRegs[1] = (uint8_t)(gpt_8fcs >> 8);
+    gptRegs[2] = (uint8_t)(gpt_8fcs & 0xff);
+    
+    st25r3911TxnBegin();
+    st25r3911TxnWriteMultipleRegisters(ST25R3911_REG_GPT_CONTROL, gptRegs, sizeof(gptRegs));
     if (!trigger_source)
-        st25r3911ExecuteCommand(ST25R3911_CMD_START_GP_TIMER);
+        st25r3911TxnExecuteCommand(ST25R3911_CMD_START_GP_TIMER);
+    st25r3911TxnCommit();
 
     return;
 }
 
 void st25r3911SetGPTime_8fcs(uint16_t gpt_8fcs)
 {
-    st25r3911WriteRegister(ST25R3911_REG_GPT1, gpt_8fcs >> 8);
-    st25r3911WriteRegister(ST25R3911_REG_GPT2, gpt_8fcs & 0xff);
+    uint8_t gptRegs[2];
+    
+    gptRegs[0] = (uint8_t)(gpt_8fcs >> 8);
+    gptRegs[1] = (uint8_t)(gpt_8fcs & 0xff);
+    
+    st25r3911WriteMultipleRegisters(ST25R3911_REG_GPT1, gptRegs, sizeof(gptRegs));
 
     return;
 }
@@ -373,6 +388,7 @@ ReturnCode st25r3911SetNoResponseTime_64fcs(uint32_t nrt_64fcs)
 {
     ReturnCode err = ERR_NONE;
     uint8_t nrt_step = 0;
+    uint8_t nrtRegs[3];
 
     st25r3911NoResponseTime_64fcs = nrt_64fcs;
     if (nrt_64fcs > USHRT_MAX)
@@ -387,9 +403,15 @@ ReturnCode st25r3911SetNoResponseTime_64fcs(uint32_t nrt_64fcs)
         st25r3911NoResponseTime_64fcs = 64 * nrt_64fcs;
     }
 
-    st25r3911ModifyRegister(ST25R3911_REG_GPT_CONTROL, ST25R3911_REG_GPT_CONTROL_nrt_step, nrt_step);
-    st25r3911WriteRegister(ST25R3911_REG_NO_RESPONSE_TIMER1, nrt_64fcs >> 8);
-    st25r3911WriteRegister(ST25R3911_REG_NO_RESPONSE_TIMER2, nrt_64fcs & 0xff);
+    /* NRT1/2 and GPT control are consecutive, write them in a single frame */
+    st25r3911ReadRegister(ST25R3911_REG_GPT_CONTROL, &nrtRegs[2]);
+    nrtRegs[0] = (uint8_t)(nrt_64fcs >> 8);
+    nrtRegs[1] = (uint8_t)(nrt_64fcs & 0xff);
+    nrtRegs[2] = ((nrtRegs[2] & ~ST25R3911_REG_GPT_CONTROL_nrt_step) | nrt_step);
+    
+    st25r3911TxnBegin();
+    st25r3911TxnWriteMultipleRegisters(ST25R3911_REG_NO_RESPONSE_TIMER1, nrtRegs, sizeof(nrtRegs));
+    st25r3911TxnCommit();
 
     return err;
 }
@@ -398,11 +420,13 @@ ReturnCode st25r3911SetStartNoResponseTime_64fcs(uint32_t nrt_64fcs)
 {
     ReturnCode err;
     
+    st25r3911TxnBegin();
     err = st25r3911SetNoResponseTime_64fcs( nrt_64fcs );
     if(err == ERR_NONE)
     {
-        st25r3911ExecuteCommand(ST25R3911_CMD_START_NO_RESPONSE_TIMER);
+        st25r3911TxnExecuteCommand(ST25R3911_CMD_START_NO_RESPONSE_TIMER);
     }
+    st25r3911TxnCommit();
     
     return err;
 }
@@ -492,8 +516,15 @@ ReturnCode st25r3911GetRegsDump(uint8_t* resRegDump, uint8_t* sizeRegDump)
 
 void st25r3911SetNumTxBits( uint32_t nBits )
 {
-    st25r3911WriteRegister(ST25R3911_REG_NUM_TX_BYTES2, (uint8_t)((nBits >> 0) & 0xff)); 
-    st25r3911WriteRegister(ST25R3911_REG_NUM_TX_BYTES1, (uint8_t)((nBits >> 8) & 0xff));    
+    uint8_t numTx[2];
+    
+    numTx[0] = (uint8_t)((nBits >> 8) & 0xff);
+    numTx[1] = (uint8_t)((nBits >> 0) & 0xff);
+    
+    /* Queued when called within a transaction, e.g. right before the FIFO load */
+    st25r3911TxnBegin();
+    st25r3911TxnWriteMultipleRegisters(ST25R3911_REG_NUM_TX_BYTES1, numTx, sizeof(numTx));
+    st25r3911TxnCommit();
 }
 
 
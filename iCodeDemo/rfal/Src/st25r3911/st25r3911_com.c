@@ -42,6 +42,7 @@
 */
 #include "st25r3911_com.h"
 #include "st25r3911.h"
+#include "st25r3911_interrupt.h"
 #include "utils.h"
 
 
@@ -60,20 +61,173 @@
 #define ST25R3911_CMD_LEN     (1)                           /*!< ST25R3911 CMD length                                           */
 #define ST25R3911_BUF_LEN     (ST25R3911_CMD_LEN+ST25R3911_FIFO_DEPTH) /*!< ST25R3911 communication buffer: CMD + FIFO length   */
 
+#ifdef platformSpiTxRxMulti
+  #define ST25R3911_COM_SCATTER                             /*!< Command byte and payload are sent from separate buffers within one SPI frame */
+#endif /* platformSpiTxRxMulti */
+
+#define ST25R3911_TXN_BUF_LEN (3 * ST25R3911_BUF_LEN)       /*!< ST25R3911 transaction buffer: room for a FIFO load plus register accesses */
+#ifdef PLATFORM_SPI_MAX_SEGMENTS
+  #define ST25R3911_TXN_MAX_SEG   PLATFORM_SPI_MAX_SEGMENTS /*!< ST25R3911 transaction: maximum number of queued SPI frames              */
+#else
+  #define ST25R3911_TXN_MAX_SEG   (16)                      /*!< ST25R3911 transaction: maximum number of queued SPI frames              */
+#endif /* PLATFORM_SPI_MAX_SEGMENTS */
+
+/*! Commands after which the FIFO is empty */
+#define st25r3911FifoIsCleared( cmd )    ( ((cmd) == ST25R3911_CMD_CLEAR_FIFO) || ((cmd) == ST25R3911_CMD_SET_DEFAULT) )
+
+#ifdef ST25R391X_COM_SHADOW
+
+#define ST25R3911_SHADOW_LEN  (ST25R3911_REG_IC_IDENTITY + 1) /*!< ST25R3911 shadow: number of (test) registers held          */
+#define ST25R3911_SHADOW_BIT(r)  ((uint64_t)1 << (r))       /*!< ST25R3911 shadow: register bit on the valid/volatile masks  */
+
+/*! Registers which are never cached: updated by the chip itself (OP_CONTROL on field on/off by collision avoidance or 
+ *  wake-up, interrupts, FIFO and collision status, displays and measurement results)                                  */
+#define ST25R3911_SHADOW_VOLATILE ( ST25R3911_SHADOW_BIT(ST25R3911_REG_OP_CONTROL)                 |                 \
+                                    ST25R3911_SHADOW_BIT(ST25R3911_REG_IRQ_MAIN)                   |                 \
+                                    ST25R3911_SHADOW_BIT(ST25R3911_REG_IRQ_TIMER_NFC)              |                 \
+                                    ST25R3911_SHADOW_BIT(ST25R3911_REG_IRQ_ERROR_WUP)              |                 \
+                                    ST25R3911_SHADOW_BIT(ST25R3911_REG_FIFO_RX_STATUS1)            |                 \
+                                    ST25R3911_SHADOW_BIT(ST25R3911_REG_FIFO_RX_STATUS2)            |                 \
+                                    ST25R3911_SHADOW_BIT(ST25R3911_REG_COLLISION_STATUS)           |                 \
+                                    ST25R3911_SHADOW_BIT(ST25R3911_REG_NFCIP1_BIT_RATE)            |                 \
+                                    ST25R3911_SHADOW_BIT(ST25R3911_REG_AD_RESULT)                  |                 \
+                                    ST25R3911_SHADOW_BIT(ST25R3911_REG_ANT_CAL_RESULT)             |                 \
+                                    ST25R3911_SHADOW_BIT(ST25R3911_REG_AM_MOD_DEPTH_RESULT)        |                 \
+                                    ST25R3911_SHADOW_BIT(ST25R3911_REG_REGULATOR_RESULT)           |                 \
+                                    ST25R3911_SHADOW_BIT(ST25R3911_REG_RSSI_RESULT)                |                 \
+                                    ST25R3911_SHADOW_BIT(ST25R3911_REG_GAIN_RED_STATE)             |                 \
+                                    ST25R3911_SHADOW_BIT(ST25R3911_REG_CAP_SENSOR_RESULT)          |                 \
+                                    ST25R3911_SHADOW_BIT(ST25R3911_REG_AUX_DISPLAY)                |                 \
+                                    ST25R3911_SHADOW_BIT(ST25R3911_REG_AMPLITUDE_MEASURE_AA_RESULT)|                 \
+                                    ST25R3911_SHADOW_BIT(ST25R3911_REG_AMPLITUDE_MEASURE_RESULT)   |                 \
+                                    ST25R3911_SHADOW_BIT(ST25R3911_REG_PHASE_MEASURE_AA_RESULT)    |                 \
+                                    ST25R3911_SHADOW_BIT(ST25R3911_REG_PHASE_MEASURE_RESULT)       |                 \
+                                    ST25R3911_SHADOW_BIT(ST25R3911_REG_CAPACITANCE_MEASURE_AA_RESULT) |              \
+                                    ST25R3911_SHADOW_BIT(ST25R3911_REG_CAPACITANCE_MEASURE_RESULT) )
+
+#endif /* ST25R391X_COM_SHADOW */
+
+/*
+******************************************************************************
+* LOCAL DATA TYPES
+******************************************************************************
+*/
+
+/*! Single SPI frame queued on a transaction */
+typedef struct
+{
+    uint16_t  offset;                                       /*!< Offset of the frame within the transaction buffer              */
+    uint16_t  length;                                       /*!< Frame length including the command byte                        */
+    uint8_t*  rdDest;                                       /*!< Destination of the read data, NULL for write/command frames    */
+    const uint8_t* txExt;                                   /*!< Data sent from the caller buffer instead of buf, NULL if none  */
+    bool      csHold;                                       /*!< Frame continues on the next segment (CS kept asserted)         */
+}t_st25r3911TxnSeg;
+
+/*! Queue of SPI frames to be sent to the ST25R3911 in a single platform transfer */
+typedef struct
+{
+    uint8_t            depth;                               /*!< Nesting level of st25r3911TxnBegin() calls                     */
+    uint8_t            nSeg;                                /*!< Number of queued frames                                        */
+    uint16_t           bufLen;                              /*!< Used bytes in buf                                              */
+    bool               fifoClr;                             /*!< A queued command clears the FIFO                               */
+    ReturnCode         err;                                 /*!< First error of the flushes so far, returned by the commit      */
+    t_st25r3911TxnSeg  seg[ST25R3911_TXN_MAX_SEG];          /*!< Queued frames                                                  */
+    uint8_t            buf[ST25R3911_TXN_BUF_LEN];          /*!< Frames data, transmitted and received in place                 */
+}t_st25r3911Txn;
+
+#ifdef ST25R391X_COM_SHADOW
+/*! Write-through copy of the ST25R3911 register space */
+typedef struct
+{
+    uint8_t   regs[ST25R3911_SHADOW_LEN];                   /*!< Last known register values                                     */
+    uint8_t   testRegs[ST25R3911_SHADOW_LEN];               /*!< Last known test register values                                */
+    uint64_t  valid;                                        /*!< Registers whose value in regs is known                         */
+    uint64_t  testValid;                                    /*!< Test registers whose value in testRegs is known                */
+    uint32_t  hits;                                         /*!< Reads served from the shadow                                   */
+    uint32_t  misses;                                       /*!< Reads of cacheable registers which needed SPI access           */
+}t_st25r3911Shadow;
+#endif /* ST25R391X_COM_SHADOW */
+
+#ifdef ST25R391X_COM_FIFO_DRAIN
+/*! FIFO bytes moved to host memory by the ISR, ahead of the bytes still in the chip FIFO */
+typedef struct
+{
+    uint8_t   buf[ST25R3911_FIFO_DEPTH];                    /*!< Drained bytes                                                  */
+    uint8_t   len;                                          /*!< Used bytes in buf                                              */
+    uint8_t   pos;                                          /*!< Next byte to be delivered by st25r3911ReadFifo()               */
+}t_st25r3911FifoDrain;
+#endif /* ST25R391X_COM_FIFO_DRAIN */
+
 /*
 ******************************************************************************
 * LOCAL VARIABLES
 ******************************************************************************
 */
 #ifdef ST25R391X_COM_SINGLETXRX
-static uint8_t comBuf[ST25R3911_BUF_LEN];
+static uint8_t comBufInstance[PLATFORM_READERS][ST25R3911_BUF_LEN];
+#define comBuf                 (comBufInstance[platformReaderId()])
 #endif /* ST25R391X_COM_SINGLETXRX */
 
+/* One set per reader, the names below refer to the one of the current reader */
+static t_st25r3911Txn st25r3911TxnInstance[PLATFORM_READERS];             /*!< Current ST25R3911 transaction                                  */
+#define st25r3911Txn           (st25r3911TxnInstance[platformReaderId()])
+
+#ifdef ST25R391X_COM_SHADOW
+static t_st25r3911Shadow st25r3911ShadowInstance[PLATFORM_READERS];       /*!< ST25R3911 register shadow                                      */
+#define st25r3911Shadow        (st25r3911ShadowInstance[platformReaderId()])
+#endif /* ST25R391X_COM_SHADOW */
+
+static uint32_t st25r3911FifoGenInstance[PLATFORM_READERS];               /*!< FIFO generation, changes whenever the host alters the FIFO     */
+#define st25r3911FifoGen       (st25r3911FifoGenInstance[platformReaderId()])
+
+#ifdef ST25R391X_COM_FIFO_DRAIN
+static t_st25r3911FifoDrain st25r3911FifoDrainInstance[PLATFORM_READERS]; /*!< FIFO bytes drained by the ISR, not yet read by the host        */
+#define st25r3911FifoDrain     (st25r3911FifoDrainInstance[platformReaderId()])
+#endif /* ST25R391X_COM_FIFO_DRAIN */
+
 /*
 ******************************************************************************
 * LOCAL FUNCTION PROTOTYPES
 ******************************************************************************
 */
+static ReturnCode st25r3911TxnFlush( void );
+static uint8_t* st25r3911TxnQueue( uint16_t length, uint8_t* rdDest );
+static void st25r3911ReadSpi( uint8_t cmd, uint8_t* rxData, uint8_t length );
+static void st25r3911FifoChanged( bool cleared );
+#ifdef ST25R3911_COM_SCATTER
+static void st25r3911TxRxScatter( uint8_t cmd, const uint8_t* txData, uint8_t* rxData, uint8_t length );
+#endif /* ST25R3911_COM_SCATTER */
+
+#ifdef ST25R391X_COM_SHADOW
+static bool st25r3911ShadowGet( uint8_t reg, uint8_t* val, uint8_t length );
+static void st25r3911ShadowSet( uint8_t reg, const uint8_t* val, uint8_t length );
+static void st25r3911ShadowForget( uint8_t reg, uint8_t length );
+static bool st25r3911ShadowTestGet( uint8_t reg, uint8_t* val );
+static void st25r3911ShadowTestSet( uint8_t reg, uint8_t val );
+static void st25r3911ShadowCheckCommand( uint8_t cmd );
+
+#define st25r3911ShadowIsKnown( reg )         ( ((reg) < ST25R3911_SHADOW_LEN) && (st25r3911Shadow.valid & ST25R3911_SHADOW_BIT(reg)) )      /*!< Register value is held in the shadow      */
+#define st25r3911ShadowTestIsKnown( reg )     ( ((reg) < ST25R3911_SHADOW_LEN) && (st25r3911Shadow.testValid & ST25R3911_SHADOW_BIT(reg)) )  /*!< Test register value is held in the shadow */
+#else
+  #define st25r3911ShadowGet( reg, val, length )      (false)
+  #define st25r3911ShadowSet( reg, val, length )
+  #define st25r3911ShadowForget( reg, length )
+  #define st25r3911ShadowTestGet( reg, val )          (false)
+  #define st25r3911ShadowTestSet( reg, val )
+  #define st25r3911ShadowCheckCommand( cmd )
+  #define st25r3911ShadowIsKnown( reg )               (false)
+  #define st25r3911ShadowTestIsKnown( reg )           (false)
+#endif /* ST25R391X_COM_SHADOW */
+
+#ifdef ST25R391X_COM_FIFO_DRAIN
+static uint8_t st25r3911FifoDrainGet( uint8_t* buf, uint8_t length );
+static void st25r3911FifoDrainFill( uint8_t count );
+static void st25r3911FifoDrainAdjust( uint8_t reg, uint8_t* val, uint8_t length );
+#else
+  #define st25r3911FifoDrainGet( buf, length )        (0)
+  #define st25r3911FifoDrainFill( count )
+  #define st25r3911FifoDrainAdjust( reg, val, length )
+#endif /* ST25R391X_COM_FIFO_DRAIN */
 
 static inline void st25r3911CheckFieldSetLED(uint8_t val)
 {
@@ -102,6 +256,16 @@ void st25r3911ReadRegister(uint8_t reg, uint8_t* val)
 #else  /* ST25R391X_COM_SINGLETXRX */
     uint8_t  buf[2];
 #endif  /* ST25R391X_COM_SINGLETXRX */
+    uint8_t  tmp;
+  
+    if( st25r3911ShadowGet( reg, &tmp, 1 ) )
+    {
+        if(val != NULL)
+        {
+          *val = tmp;
+        }
+        return;
+    }
   
     platformProtectST25R391xComm();
     platformSpiSelect();
@@ -112,8 +276,11 @@ void st25r3911ReadRegister(uint8_t reg, uint8_t* val)
     platformSpiTxRx(buf, buf, 2);
   
     platformSpiDeselect();
+    st25r3911FifoDrainAdjust( reg, &buf[1], 1 );
     platformUnprotectST25R391xComm();
   
+    st25r3911ShadowSet( reg, &buf[1], 1 );
+  
     if(val != NULL)
     {
       *val = buf[1];
@@ -124,34 +291,62 @@ void st25r3911ReadRegister(uint8_t reg, uint8_t* val)
 
 void st25r3911ReadMultipleRegisters(uint8_t reg, uint8_t* val, uint8_t length)
 {
-#if !defined(ST25R391X_COM_SINGLETXRX)
-    uint8_t cmd = (reg | ST25R3911_READ_MODE);
-#endif  /* !ST25R391X_COM_SINGLETXRX */
+    if( st25r3911ShadowGet( reg, val, length ) )
+    {
+        return;
+    }
   
     platformProtectST25R391xComm();
-    platformSpiSelect();
-  
-#ifdef ST25R391X_COM_SINGLETXRX
-  
-    ST_MEMSET( comBuf, 0x00, (ST25R3911_CMD_LEN + length) );
-    comBuf[0] = (reg | ST25R3911_READ_MODE);
     
-    platformSpiTxRx(comBuf, comBuf, (ST25R3911_CMD_LEN + length) );           /* Transceive as a single SPI call                        */
-    ST_MEMCPY( val, &comBuf[ST25R3911_CMD_LEN], length );                     /* Copy from local buf to output buffer and skip cmd byte */
-  
-#else  /* ST25R391X_COM_SINGLETXRX */
-  
-    /* Since the result comes one byte later, let's first transmit the adddress with discarding the result */
-    platformSpiTxRx(&cmd, NULL, ST25R3911_CMD_LEN);
-    platformSpiTxRx(NULL, val, length);  
-  
-#endif  /* ST25R391X_COM_SINGLETXRX */
-
-    platformSpiDeselect();
+    st25r3911ReadSpi( (reg | ST25R3911_READ_MODE), val, length );
+    st25r3911FifoDrainAdjust( reg, val, length );
+    
     platformUnprotectST25R391xComm();
+    
+    st25r3911ShadowSet( reg, val, length );
     return;
 }
 
+
+void st25r3911ReadIrqFifoStatus(uint8_t* regs, uint32_t* fifoGen)
+{
+    uint8_t count;
+    
+    platformProtectST25R391xComm();
+    
+    /* IRQ Main, IRQ Timer and NFC, IRQ Error and Wake-up, FIFO Status 1 and 2 are consecutive */
+    st25r3911ReadSpi( (ST25R3911_REG_IRQ_MAIN | ST25R3911_READ_MODE), regs, ST25R3911_IRQ_FIFO_BURST_LEN );
+    
+    /* The chip starts a reception on an empty FIFO: drained bytes the host left unread are gone too */
+    if( regs[0] & ST25R3911_IRQ_MASK_RXS )
+    {
+        st25r3911FifoChanged( true );
+    }
+    
+    count = regs[ST25R3911_REG_FIFO_RX_STATUS1 - ST25R3911_REG_IRQ_MAIN];
+    st25r3911FifoDrainAdjust( ST25R3911_REG_IRQ_MAIN, regs, ST25R3911_IRQ_FIFO_BURST_LEN );
+    
+    /* On end of receive the whole frame is in the FIFO: fetch it while the bus is held anyway */
+    if( regs[0] & ST25R3911_IRQ_MASK_RXE )
+    {
+        st25r3911FifoDrainFill( count );
+    }
+    NO_WARNING(count);
+    
+    if( fifoGen != NULL )
+    {
+        *fifoGen = st25r3911FifoGen;
+    }
+    
+    platformUnprotectST25R391xComm();
+}
+
+
+uint32_t st25r3911GetFifoGeneration( void )
+{
+    return st25r3911FifoGen;
+}
+
 void st25r3911ReadTestRegister(uint8_t reg, uint8_t* val)
 {
   
@@ -160,6 +355,16 @@ void st25r3911ReadTestRegister(uint8_t reg, uint8_t* val)
 #else  /* ST25R391X_COM_SINGLETXRX */
     uint8_t  buf[3];
 #endif  /* ST25R391X_COM_SINGLETXRX */
+    uint8_t  tmp;
+
+    if( st25r3911ShadowTestGet( reg, &tmp ) )
+    {
+        if(val != NULL)
+        {
+          *val = tmp;
+        }
+        return;
+    }
 
     platformProtectST25R391xComm();
     platformSpiSelect();
@@ -173,6 +378,8 @@ void st25r3911ReadTestRegister(uint8_t reg, uint8_t* val)
     platformSpiDeselect();
     platformUnprotectST25R391xComm();
     
+    st25r3911ShadowTestSet( reg, buf[2] );
+    
     if(val != NULL)
     {
       *val = buf[2];
@@ -200,6 +407,8 @@ void st25r3911WriteTestRegister(uint8_t reg, uint8_t val)
   
     platformSpiDeselect();
     platformUnprotectST25R391xComm();
+    
+    st25r3911ShadowTestSet( reg, val );
 
     return;
 }
@@ -227,31 +436,21 @@ void st25r3911WriteRegister(uint8_t reg, uint8_t val)
     
     platformSpiDeselect();
     platformUnprotectST25R391xComm();
+    
+    st25r3911ShadowSet( reg, &val, 1 );
 
     return;
 }
 
 void st25r3911ClrRegisterBits( uint8_t reg, uint8_t clr_mask )
 {
-    uint8_t tmp;
-
-    st25r3911ReadRegister(reg, &tmp);
-    tmp &= ~clr_mask;
-    st25r3911WriteRegister(reg, tmp);
-    
-    return;
+    st25r3911ModifyRegister(reg, clr_mask, 0x00);
 }
 
 
 void st25r3911SetRegisterBits( uint8_t reg, uint8_t set_mask )
 {
-    uint8_t tmp;
-
-    st25r3911ReadRegister(reg, &tmp);
-    tmp |= set_mask;
-    st25r3911WriteRegister(reg, tmp);
-    
-    return;
+    st25r3911ModifyRegister(reg, 0x00, set_mask);
 }
 
 void st25r3911ChangeRegisterBits(uint8_t reg, uint8_t valueMask, uint8_t value)
@@ -261,14 +460,22 @@ void st25r3911ChangeRegisterBits(uint8_t reg, uint8_t valueMask, uint8_t value)
 
 void st25r3911ModifyRegister(uint8_t reg, uint8_t clr_mask, uint8_t set_mask)
 {
+    uint8_t rdVal;
     uint8_t tmp;
 
-    st25r3911ReadRegister(reg, &tmp);
+    st25r3911ReadRegister(reg, &rdVal);
 
     /* mask out the bits we don't want to change */
-    tmp &= ~clr_mask;
+    tmp = (rdVal & ~clr_mask);
     /* set the new value */
     tmp |= set_mask;
+    
+    /* Skip the write if the (cached) register already holds the value */
+    if( (tmp == rdVal) && st25r3911ShadowIsKnown( reg ) )
+    {
+        return;
+    }
+    
     st25r3911WriteRegister(reg, tmp);
 
     return;
@@ -286,6 +493,12 @@ void st25r3911ChangeTestRegisterBits( uint8_t reg, uint8_t valueMask, uint8_t va
     wrVal  = (rdVal & ~valueMask);
     wrVal |= (value & valueMask);
     
+    /* Skip the write if the (cached) register already holds the value */
+    if( (wrVal == rdVal) && st25r3911ShadowTestIsKnown( reg ) )
+    {
+        return;
+    }
+    
     /* Write new reg value */
     st25r3911WriteTestRegister(reg, wrVal );
     
@@ -294,9 +507,9 @@ void st25r3911ChangeTestRegisterBits( uint8_t reg, uint8_t valueMask, uint8_t va
 
 void st25r3911WriteMultipleRegisters(uint8_t reg, const uint8_t* values, uint8_t length)
 { 
-#if !defined(ST25R391X_COM_SINGLETXRX)
+#if !defined(ST25R3911_COM_SCATTER) && !defined(ST25R391X_COM_SINGLETXRX)
     uint8_t cmd = (reg | ST25R3911_WRITE_MODE);
-#endif  /* !ST25R391X_COM_SINGLETXRX */
+#endif  /* !ST25R3911_COM_SCATTER && !ST25R391X_COM_SINGLETXRX */
 
     if (reg <= ST25R3911_REG_OP_CONTROL && reg+length >= ST25R3911_REG_OP_CONTROL)
     {
@@ -309,7 +522,11 @@ void st25r3911WriteMultipleRegisters(uint8_t reg, const uint8_t* values, uint8_t
         platformProtectST25R391xComm();
         platformSpiSelect();
     
-#ifdef ST25R391X_COM_SINGLETXRX
+#if defined(ST25R3911_COM_SCATTER)
+        
+        st25r3911TxRxScatter( (reg | ST25R3911_WRITE_MODE), values, NULL, length );
+        
+#elif defined(ST25R391X_COM_SINGLETXRX)
       
         comBuf[0] = (reg | ST25R3911_WRITE_MODE);
         ST_MEMCPY( &comBuf[ST25R3911_CMD_LEN], values, length );
@@ -325,6 +542,8 @@ void st25r3911WriteMultipleRegisters(uint8_t reg, const uint8_t* values, uint8_t
     
         platformSpiDeselect();
         platformUnprotectST25R391xComm();
+        
+        st25r3911ShadowSet( reg, values, length );
     }
     
     return;
@@ -333,16 +552,20 @@ void st25r3911WriteMultipleRegisters(uint8_t reg, const uint8_t* values, uint8_t
 
 void st25r3911WriteFifo(const uint8_t* values, uint8_t length)
 {
-#if !defined(ST25R391X_COM_SINGLETXRX)
+#if !defined(ST25R3911_COM_SCATTER) && !defined(ST25R391X_COM_SINGLETXRX)
     uint8_t cmd = ST25R3911_FIFO_LOAD;
-#endif  /* !ST25R391X_COM_SINGLETXRX */
+#endif  /* !ST25R3911_COM_SCATTER && !ST25R391X_COM_SINGLETXRX */
 
     if (length > 0)
     {  
         platformProtectST25R391xComm();
         platformSpiSelect();
   
-#ifdef ST25R391X_COM_SINGLETXRX
+#if defined(ST25R3911_COM_SCATTER)
+        
+        st25r3911TxRxScatter( ST25R3911_FIFO_LOAD, values, NULL, length );   /* Load straight from the caller buffer */
+        
+#elif defined(ST25R391X_COM_SINGLETXRX)
   
         comBuf[0] = ST25R3911_FIFO_LOAD;
         ST_MEMCPY( &comBuf[ST25R3911_CMD_LEN], values, length );
@@ -357,6 +580,7 @@ void st25r3911WriteFifo(const uint8_t* values, uint8_t length)
 #endif  /*ST25R391X_COM_SINGLETXRX*/
   
         platformSpiDeselect();
+        st25r3911FifoChanged( false );
         platformUnprotectST25R391xComm();
     }
 
@@ -365,31 +589,21 @@ void st25r3911WriteFifo(const uint8_t* values, uint8_t length)
 
 void st25r3911ReadFifo(uint8_t* buf, uint8_t length)
 {
-#if !defined(ST25R391X_COM_SINGLETXRX)
-    uint8_t cmd = ST25R3911_FIFO_READ;
-#endif  /* !ST25R391X_COM_SINGLETXRX */
+    uint8_t drained;
     
     if(length > 0)
     {
         platformProtectST25R391xComm();
-        platformSpiSelect();
-
-#ifdef ST25R391X_COM_SINGLETXRX
-      
-        ST_MEMSET( comBuf, 0x00, (ST25R3911_CMD_LEN + length) );
-        comBuf[0] = ST25R3911_FIFO_READ;
-      
-        platformSpiTxRx( comBuf, comBuf, (ST25R3911_CMD_LEN + length) );         /* Transceive as a single SPI call                        */
-        ST_MEMCPY( buf, &comBuf[ST25R3911_CMD_LEN], length );                    /* Copy from local buf to output buffer and skip cmd byte */
-  
-#else  /*ST25R391X_COM_SINGLETXRX*/
-  
-        platformSpiTxRx( &cmd, NULL, ST25R3911_CMD_LEN );
-        platformSpiTxRx( NULL, buf, length );
-  
-#endif  /*ST25R391X_COM_SINGLETXRX*/
-      
-        platformSpiDeselect();
+        
+        /* Bytes already drained by the ISR precede those still in the chip FIFO */
+        drained = st25r3911FifoDrainGet( buf, length );
+        
+        if( length > drained )
+        {
+            st25r3911ReadSpi( ST25R3911_FIFO_READ, ((buf != NULL) ? &buf[drained] : NULL), (length - drained) );
+        }
+        
+        st25r3911FifoChanged( false );
         platformUnprotectST25R391xComm();
     }
 
@@ -405,6 +619,8 @@ void st25r3911ExecuteCommand(uint8_t cmd)
     }
 #endif /* PLATFORM_LED_FIELD_PIN */
     
+    st25r3911ShadowCheckCommand( cmd );
+    
     cmd |= ST25R3911_CMD_MODE;
 
     platformProtectST25R391xComm();
@@ -413,6 +629,7 @@ void st25r3911ExecuteCommand(uint8_t cmd)
     platformSpiTxRx( &cmd, NULL, ST25R3911_CMD_LEN );
     
     platformSpiDeselect();
+    st25r3911FifoChanged( st25r3911FifoIsCleared( cmd ) );
     platformUnprotectST25R391xComm();
 
     return;
@@ -421,17 +638,206 @@ void st25r3911ExecuteCommand(uint8_t cmd)
 
 void st25r3911ExecuteCommands(uint8_t *cmds, uint8_t length)
 {
+    uint8_t i;
+    bool    cleared;
+    
+    cleared = false;
+    for( i = 0; i < length; i++ )
+    {
+        st25r3911ShadowCheckCommand( cmds[i] );
+        cleared |= st25r3911FifoIsCleared( cmds[i] );
+    }
+    
     platformProtectST25R391xComm();
     platformSpiSelect();
     
     platformSpiTxRx( cmds, NULL, length );
     
     platformSpiDeselect();
+    st25r3911FifoChanged( cleared );
     platformUnprotectST25R391xComm();
 
     return;
 }
 
+void st25r3911TxnBegin( void )
+{
+    if( st25r3911Txn.depth == 0 )
+    {
+        st25r3911Txn.nSeg    = 0;
+        st25r3911Txn.bufLen  = 0;
+        st25r3911Txn.fifoClr = false;
+        st25r3911Txn.err     = ERR_NONE;
+    }
+    st25r3911Txn.depth++;
+}
+
+void st25r3911TxnWriteRegister( uint8_t reg, uint8_t val )
+{
+    st25r3911TxnWriteMultipleRegisters( reg, &val, 1 );
+}
+
+void st25r3911TxnWriteMultipleRegisters( uint8_t reg, const uint8_t* values, uint8_t length )
+{
+    uint8_t* buf;
+    
+    if( length == 0 )
+    {
+        return;
+    }
+    
+    if (reg <= ST25R3911_REG_OP_CONTROL && reg+length > ST25R3911_REG_OP_CONTROL)
+    {
+        st25r3911CheckFieldSetLED(values[ST25R3911_REG_OP_CONTROL-reg]);
+    }
+    
+    buf = st25r3911TxnQueue( (ST25R3911_CMD_LEN + length), NULL );
+    buf[0] = (reg | ST25R3911_WRITE_MODE);
+    ST_MEMCPY( &buf[ST25R3911_CMD_LEN], values, length );
+    
+    /* The shadow takes the values once they reached the chip, reads queued meanwhile go to the chip */
+    st25r3911ShadowForget( reg, length );
+}
+
+void st25r3911TxnReadRegister( uint8_t reg, uint8_t* val )
+{
+    st25r3911TxnReadMultipleRegisters( reg, val, 1 );
+}
+
+void st25r3911TxnReadMultipleRegisters( uint8_t reg, uint8_t* values, uint8_t length )
+{
+    uint8_t* buf;
+    
+    if( (length == 0) || (values == NULL) )
+    {
+        return;
+    }
+    
+    /* Cached registers are provided right away, no frame needed */
+    if( st25r3911ShadowGet( reg, values, length ) )
+    {
+        return;
+    }
+    
+    buf = st25r3911TxnQueue( (ST25R3911_CMD_LEN + length), values );
+    ST_MEMSET( buf, 0x00, (ST25R3911_CMD_LEN + length) );
+    buf[0] = (reg | ST25R3911_READ_MODE);
+}
+
+void st25r3911TxnWriteFifo( const uint8_t* values, uint8_t length )
+{
+    uint8_t* buf;
+    
+    if( length == 0 )
+    {
+        return;
+    }
+    
+#ifdef ST25R3911_COM_SCATTER
+    
+    /* Keep command byte and payload on the same flush */
+    if( (st25r3911Txn.nSeg + 2) > ST25R3911_TXN_MAX_SEG )
+    {
+        st25r3911TxnFlush();
+    }
+    
+    buf = st25r3911TxnQueue( ST25R3911_CMD_LEN, NULL );
+    buf[0] = ST25R3911_FIFO_LOAD;
+    
+    /* Payload is sent straight from the caller buffer within the same frame */
+    st25r3911Txn.seg[st25r3911Txn.nSeg - 1].csHold = true;
+    
+    st25r3911Txn.seg[st25r3911Txn.nSeg].offset = st25r3911Txn.bufLen;
+    st25r3911Txn.seg[st25r3911Txn.nSeg].length = length;
+    st25r3911Txn.seg[st25r3911Txn.nSeg].rdDest = NULL;
+    st25r3911Txn.seg[st25r3911Txn.nSeg].txExt  = values;
+    st25r3911Txn.seg[st25r3911Txn.nSeg].csHold = false;
+    st25r3911Txn.nSeg++;
+    
+#else  /* ST25R3911_COM_SCATTER */
+    
+    buf = st25r3911TxnQueue( (ST25R3911_CMD_LEN + length), NULL );
+    buf[0] = ST25R3911_FIFO_LOAD;
+    ST_MEMCPY( &buf[ST25R3911_CMD_LEN], values, length );
+    
+#endif /* ST25R3911_COM_SCATTER */
+}
+
+void st25r3911TxnExecuteCommand( uint8_t cmd )
+{
+    uint8_t* buf;
+    
+#ifdef PLATFORM_LED_FIELD_PIN
+    if ( cmd >= ST25R3911_CMD_TRANSMIT_WITH_CRC && cmd <= ST25R3911_CMD_RESPONSE_RF_COLLISION_0)
+    {
+        platformLedOff(PLATFORM_LED_FIELD_PORT, PLATFORM_LED_FIELD_PIN);
+    }
+#endif /* PLATFORM_LED_FIELD_PIN */
+    
+    st25r3911ShadowCheckCommand( cmd );
+    st25r3911Txn.fifoClr |= st25r3911FifoIsCleared( cmd );
+    
+    buf = st25r3911TxnQueue( ST25R3911_CMD_LEN, NULL );
+    buf[0] = (cmd | ST25R3911_CMD_MODE);
+}
+
+ReturnCode st25r3911TxnCommit( void )
+{
+    if( st25r3911Txn.depth == 0 )
+    {
+        return ERR_WRONG_STATE;
+    }
+    
+    /* Only the outermost commit sends the queued frames */
+    if( --st25r3911Txn.depth > 0 )
+    {
+        return ERR_NONE;
+    }
+    
+    /* Also reports the failure of a flush done while queuing */
+    st25r3911TxnFlush();
+    return st25r3911Txn.err;
+}
+
+void st25r3911ShadowInvalidate( void )
+{
+#ifdef ST25R391X_COM_SHADOW
+    st25r3911Shadow.valid     = 0;
+    st25r3911Shadow.testValid = 0;
+#endif /* ST25R391X_COM_SHADOW */
+}
+
+void st25r3911ShadowGetStats( uint32_t* hits, uint32_t* misses )
+{
+#ifdef ST25R391X_COM_SHADOW
+    if( hits != NULL )
+    {
+        *hits = st25r3911Shadow.hits;
+    }
+    if( misses != NULL )
+    {
+        *misses = st25r3911Shadow.misses;
+    }
+#else
+    if( hits != NULL )
+    {
+        *hits = 0;
+    }
+    if( misses != NULL )
+    {
+        *misses = 0;
+    }
+#endif /* ST25R391X_COM_SHADOW */
+}
+
+void st25r3911ShadowResetStats( void )
+{
+#ifdef ST25R391X_COM_SHADOW
+    st25r3911Shadow.hits   = 0;
+    st25r3911Shadow.misses = 0;
+#endif /* ST25R391X_COM_SHADOW */
+}
+
 bool st25r3911IsRegValid( uint8_t reg )
 {
     if( !(( (int8_t)reg >= ST25R3911_REG_IO_CONF1) && (reg <= ST25R3911_REG_CAPACITANCE_MEASURE_RESULT)) && 
@@ -448,3 +854,486 @@ bool st25r3911IsRegValid( uint8_t reg )
 ******************************************************************************
 */
 
+/*! 
+ *****************************************************************************
+ *  \brief  Sends all queued frames of the current transaction
+ *
+ *  Transfers the queued frames with a single platform SPI call (when
+ *  available), copies the data of the read frames to their destination and
+ *  empties the queue. The shadow takes the registers read and written; if
+ *  the transfer failed it is invalidated instead and the error kept for
+ *  st25r3911TxnCommit().
+ *
+ *  \return ERR_IO   : SPI transfer failed
+ *  \return ERR_NONE : No error
+ *****************************************************************************
+ */
+static ReturnCode st25r3911TxnFlush( void )
+{
+    ReturnCode ret;
+    uint8_t    i;
+    uint8_t    cmds[ST25R3911_TXN_MAX_SEG];
+#ifdef platformSpiTxRxMulti
+    platformSpiSegment segs[ST25R3911_TXN_MAX_SEG];
+#endif /* platformSpiTxRxMulti */
+    
+    if( st25r3911Txn.nSeg == 0 )
+    {
+        return ERR_NONE;
+    }
+    
+    ret = ERR_NONE;
+    
+    /* Read frames are received in place over their command byte */
+    for( i = 0; i < st25r3911Txn.nSeg; i++ )
+    {
+        cmds[i] = ((st25r3911Txn.seg[i].txExt != NULL) ? ST25R3911_FIFO_LOAD : st25r3911Txn.buf[st25r3911Txn.seg[i].offset]);
+    }
+    
+    platformProtectST25R391xComm();
+    
+#ifdef platformSpiTxRxMulti
+    for( i = 0; i < st25r3911Txn.nSeg; i++ )
+    {
+        segs[i].txData = ((st25r3911Txn.seg[i].txExt != NULL) ? st25r3911Txn.seg[i].txExt : &st25r3911Txn.buf[st25r3911Txn.seg[i].offset]);
+        segs[i].rxData = ((st25r3911Txn.seg[i].rdDest != NULL) ? &st25r3911Txn.buf[st25r3911Txn.seg[i].offset] : NULL);
+        segs[i].length = st25r3911Txn.seg[i].length;
+        segs[i].csHold = st25r3911Txn.seg[i].csHold;
+    }
+    
+    if( platformSpiTxRxMulti( segs, st25r3911Txn.nSeg ) != 0 )
+    {
+        ret = ERR_IO;
+    }
+#else  /* platformSpiTxRxMulti */
+    for( i = 0; i < st25r3911Txn.nSeg; i++ )
+    {
+        platformSpiSelect();
+        platformSpiTxRx( &st25r3911Txn.buf[st25r3911Txn.seg[i].offset], ((st25r3911Txn.seg[i].rdDest != NULL) ? &st25r3911Txn.buf[st25r3911Txn.seg[i].offset] : NULL), st25r3911Txn.seg[i].length );
+        platformSpiDeselect();
+    }
+#endif /* platformSpiTxRxMulti */
+    
+    /* Queued frames may have loaded or cleared the FIFO */
+    st25r3911FifoChanged( st25r3911Txn.fifoClr );
+    platformUnprotectST25R391xComm();
+    
+    /* Copy read data to the caller buffers, skipping the cmd byte */
+    for( i = 0; i < st25r3911Txn.nSeg; i++ )
+    {
+        if( st25r3911Txn.seg[i].rdDest != NULL )
+        {
+            ST_MEMCPY( st25r3911Txn.seg[i].rdDest, &st25r3911Txn.buf[st25r3911Txn.seg[i].offset + ST25R3911_CMD_LEN], (st25r3911Txn.seg[i].length - ST25R3911_CMD_LEN) );
+        }
+    }
+    
+    if( ret != ERR_NONE )
+    {
+        /* Unknown which frames reached the chip */
+        st25r3911ShadowInvalidate();
+        if( st25r3911Txn.err == ERR_NONE )
+        {
+            st25r3911Txn.err = ret;
+        }
+    }
+    else
+    {
+        for( i = 0; i < st25r3911Txn.nSeg; i++ )
+        {
+            if( ((cmds[i] & ST25R3911_CMD_MODE) == ST25R3911_WRITE_MODE) || ((cmds[i] & ST25R3911_CMD_MODE) == ST25R3911_READ_MODE) )
+            {
+                st25r3911ShadowSet( (cmds[i] & ~ST25R3911_CMD_MODE), &st25r3911Txn.buf[st25r3911Txn.seg[i].offset + ST25R3911_CMD_LEN], (st25r3911Txn.seg[i].length - ST25R3911_CMD_LEN) );
+            }
+        }
+    }
+    
+    st25r3911Txn.nSeg    = 0;
+    st25r3911Txn.bufLen  = 0;
+    st25r3911Txn.fifoClr = false;
+    
+    return ret;
+}
+
+/*! 
+ *****************************************************************************
+ *  \brief  Reserves a frame on the current transaction
+ *
+ *  If the frame does not fit anymore the already queued frames are sent
+ *  first, a failure of that flush is returned by st25r3911TxnCommit().
+ *  Shall only be called between st25r3911TxnBegin() and 
+ *  st25r3911TxnCommit().
+ *
+ *  \param[in]  length : frame length including the command byte
+ *  \param[in]  rdDest : destination of the read data, NULL if none
+ *
+ *  \return pointer to the frame data in the transaction buffer
+ *****************************************************************************
+ */
+static uint8_t* st25r3911TxnQueue( uint16_t length, uint8_t* rdDest )
+{
+    uint8_t* buf;
+    
+    if( (st25r3911Txn.nSeg >= ST25R3911_TXN_MAX_SEG) || ((st25r3911Txn.bufLen + length) > ST25R3911_TXN_BUF_LEN) )
+    {
+        st25r3911TxnFlush();
+    }
+    
+    buf = &st25r3911Txn.buf[st25r3911Txn.bufLen];
+    
+    st25r3911Txn.seg[st25r3911Txn.nSeg].offset = st25r3911Txn.bufLen;
+    st25r3911Txn.seg[st25r3911Txn.nSeg].length = length;
+    st25r3911Txn.seg[st25r3911Txn.nSeg].rdDest = rdDest;
+    st25r3911Txn.seg[st25r3911Txn.nSeg].txExt  = NULL;
+    st25r3911Txn.seg[st25r3911Txn.nSeg].csHold = false;
+    
+    st25r3911Txn.nSeg++;
+    st25r3911Txn.bufLen += length;
+    
+    return buf;
+}
+
+#ifdef ST25R3911_COM_SCATTER
+/*! 
+ *****************************************************************************
+ *  \brief  Command byte plus payload in a single SPI frame
+ *
+ *  Sends the command byte and the payload as two segments of one platform
+ *  SPI transfer with CS held in between, so that the payload is transferred
+ *  directly from/to the caller's buffer without going through comBuf.
+ *  Shall be called with the communication protected.
+ *
+ *  \param[in]   cmd    : command byte (register address + mode, FIFO load/read)
+ *  \param[in]   txData : payload to be sent, NULL to clock out zeros
+ *  \param[out]  rxData : buffer for the received payload, NULL to discard
+ *  \param[in]   length : payload length
+ *****************************************************************************
+ */
+static void st25r3911TxRxScatter( uint8_t cmd, const uint8_t* txData, uint8_t* rxData, uint8_t length )
+{
+    platformSpiSegment segs[2];
+    
+    segs[0].txData = &cmd;
+    segs[0].rxData = NULL;
+    segs[0].length = ST25R3911_CMD_LEN;
+    segs[0].csHold = true;
+    
+    segs[1].txData = txData;
+    segs[1].rxData = rxData;
+    segs[1].length = length;
+    segs[1].csHold = false;
+    
+    platformSpiTxRxMulti( segs, ((length > 0) ? 2 : 1) );
+}
+#endif /* ST25R3911_COM_SCATTER */
+
+/*! 
+ *****************************************************************************
+ *  \brief  Read data following a command byte in a single SPI frame
+ *
+ *  Shall be called with the communication protected.
+ *
+ *  \param[in]   cmd    : command byte (register address + read mode, FIFO read)
+ *  \param[out]  rxData : buffer for the received data, NULL to discard
+ *  \param[in]   length : number of bytes to read
+ *****************************************************************************
+ */
+static void st25r3911ReadSpi( uint8_t cmd, uint8_t* rxData, uint8_t length )
+{
+    platformSpiSelect();
+  
+#if defined(ST25R3911_COM_SCATTER)
+    
+    st25r3911TxRxScatter( cmd, NULL, rxData, length );                        /* Read straight into the output buffer                   */
+    
+#elif defined(ST25R391X_COM_SINGLETXRX)
+  
+    ST_MEMSET( comBuf, 0x00, (ST25R3911_CMD_LEN + length) );
+    comBuf[0] = cmd;
+    
+    platformSpiTxRx( comBuf, comBuf, (ST25R3911_CMD_LEN + length) );          /* Transceive as a single SPI call                        */
+    if( rxData != NULL )
+    {
+        ST_MEMCPY( rxData, &comBuf[ST25R3911_CMD_LEN], length );              /* Copy from local buf to output buffer and skip cmd byte */
+    }
+  
+#else  /* ST25R391X_COM_SINGLETXRX */
+  
+    /* Since the result comes one byte later, let's first transmit the adddress with discarding the result */
+    platformSpiTxRx( &cmd, NULL, ST25R3911_CMD_LEN );
+    platformSpiTxRx( NULL, rxData, length );
+  
+#endif  /* ST25R391X_COM_SINGLETXRX */
+
+    platformSpiDeselect();
+}
+
+/*! 
+ *****************************************************************************
+ *  \brief  Note a FIFO access by the host
+ *
+ *  Moves the FIFO generation on, which invalidates FIFO status values read
+ *  before. Shall be called with the communication protected.
+ *
+ *  \param[in]  cleared : the FIFO was emptied, drop any drained bytes
+ *****************************************************************************
+ */
+static void st25r3911FifoChanged( bool cleared )
+{
+    st25r3911FifoGen++;
+    
+#ifdef ST25R391X_COM_FIFO_DRAIN
+    if( cleared )
+    {
+        st25r3911FifoDrain.len = 0;
+        st25r3911FifoDrain.pos = 0;
+    }
+#else
+    NO_WARNING(cleared);
+#endif /* ST25R391X_COM_FIFO_DRAIN */
+}
+
+#ifdef ST25R391X_COM_FIFO_DRAIN
+
+/*! 
+ *****************************************************************************
+ *  \brief  Deliver drained FIFO bytes
+ *
+ *  Shall be called with the communication protected.
+ *
+ *  \param[out]  buf    : destination, NULL to discard
+ *  \param[in]   length : number of bytes wanted
+ *
+ *  \return number of bytes taken from the drain buffer
+ *****************************************************************************
+ */
+static uint8_t st25r3911FifoDrainGet( uint8_t* buf, uint8_t length )
+{
+    uint8_t n;
+    
+    n = MIN( length, (uint8_t)(st25r3911FifoDrain.len - st25r3911FifoDrain.pos) );
+    if( (n > 0) && (buf != NULL) )
+    {
+        ST_MEMCPY( buf, &st25r3911FifoDrain.buf[st25r3911FifoDrain.pos], n );
+    }
+    st25r3911FifoDrain.pos += n;
+    
+    return n;
+}
+
+/*! 
+ *****************************************************************************
+ *  \brief  Move bytes from the chip FIFO to the drain buffer
+ *
+ *  Shall be called with the communication protected.
+ *
+ *  \param[in]  count : number of bytes in the chip FIFO
+ *****************************************************************************
+ */
+static void st25r3911FifoDrainFill( uint8_t count )
+{
+    uint8_t pending;
+    
+    pending = (st25r3911FifoDrain.len - st25r3911FifoDrain.pos);
+    if( st25r3911FifoDrain.pos > 0 )
+    {
+        ST_MEMMOVE( st25r3911FifoDrain.buf, &st25r3911FifoDrain.buf[st25r3911FifoDrain.pos], pending );
+        st25r3911FifoDrain.len = pending;
+        st25r3911FifoDrain.pos = 0;
+    }
+    
+    count = MIN( count, (uint8_t)(ST25R3911_FIFO_DEPTH - st25r3911FifoDrain.len) );
+    if( count > 0 )
+    {
+        st25r3911ReadSpi( ST25R3911_FIFO_READ, &st25r3911FifoDrain.buf[st25r3911FifoDrain.len], count );
+        st25r3911FifoDrain.len += count;
+    }
+}
+
+/*! 
+ *****************************************************************************
+ *  \brief  Account drained bytes in a read of the FIFO status
+ *
+ *  The FIFO byte count read from the chip misses the drained bytes not yet
+ *  delivered; they are added so callers see the FIFO as if nothing had been
+ *  drained. Shall be called with the communication protected.
+ *
+ *  \param[in]      reg    : address of the first register read
+ *  \param[in,out]  val    : values read from the chip
+ *  \param[in]      length : number of consecutive registers read
+ *****************************************************************************
+ */
+static void st25r3911FifoDrainAdjust( uint8_t reg, uint8_t* val, uint8_t length )
+{
+    if( (reg <= ST25R3911_REG_FIFO_RX_STATUS1) && ((reg + length) > ST25R3911_REG_FIFO_RX_STATUS1) )
+    {
+        val[ST25R3911_REG_FIFO_RX_STATUS1 - reg] += (st25r3911FifoDrain.len - st25r3911FifoDrain.pos);
+    }
+}
+
+#endif /* ST25R391X_COM_FIFO_DRAIN */
+
+#ifdef ST25R391X_COM_SHADOW
+
+/*! 
+ *****************************************************************************
+ *  \brief  Get register values from the shadow
+ *
+ *  \param[in]   reg: Address of the first register
+ *  \param[out]  val: Returned values
+ *  \param[in]   length: Number of consecutive registers
+ *
+ *  \return true  : all registers are cacheable and known, \a val is filled
+ *  \return false : registers need to be read from the chip
+ *****************************************************************************
+ */
+static bool st25r3911ShadowGet( uint8_t reg, uint8_t* val, uint8_t length )
+{
+    uint64_t mask;
+    
+    if( (length == 0) || ((reg + length) > ST25R3911_SHADOW_LEN) )
+    {
+        return false;
+    }
+    
+    mask = ((length < 64) ? ((ST25R3911_SHADOW_BIT(length) - 1) << reg) : ~(uint64_t)0);
+    
+    /* Volatile registers are neither hits nor misses */
+    if( (mask & ST25R3911_SHADOW_VOLATILE) != 0 )
+    {
+        return false;
+    }
+    
+    if( (st25r3911Shadow.valid & mask) != mask )
+    {
+        st25r3911Shadow.misses++;
+        return false;
+    }
+    
+    st25r3911Shadow.hits++;
+    if( val != NULL )
+    {
+        ST_MEMCPY( val, &st25r3911Shadow.regs[reg], length );
+    }
+    return true;
+}
+
+/*! 
+ *****************************************************************************
+ *  \brief  Update the shadow with values read from/written to the chip
+ *
+ *  \param[in]  reg: Address of the first register
+ *  \param[in]  val: Register values
+ *  \param[in]  length: Number of consecutive registers
+ *****************************************************************************
+ */
+static void st25r3911ShadowSet( uint8_t reg, const uint8_t* val, uint8_t length )
+{
+    uint8_t i;
+    
+    if( val == NULL )
+    {
+        return;
+    }
+    
+    for( i = 0; (i < length) && ((reg + i) < ST25R3911_SHADOW_LEN); i++ )
+    {
+        if( (ST25R3911_SHADOW_BIT(reg + i) & ST25R3911_SHADOW_VOLATILE) == 0 )
+        {
+            st25r3911Shadow.regs[reg + i] = val[i];
+            st25r3911Shadow.valid        |= ST25R3911_SHADOW_BIT(reg + i);
+        }
+    }
+}
+
+/*! 
+ *****************************************************************************
+ *  \brief  Drop registers from the shadow, their value is not known yet
+ *
+ *  \param[in]  reg: Address of the first register
+ *  \param[in]  length: Number of consecutive registers
+ *****************************************************************************
+ */
+static void st25r3911ShadowForget( uint8_t reg, uint8_t length )
+{
+    uint8_t i;
+    
+    for( i = 0; (i < length) && ((reg + i) < ST25R3911_SHADOW_LEN); i++ )
+    {
+        st25r3911Shadow.valid &= ~ST25R3911_SHADOW_BIT(reg + i);
+    }
+}
+
+/*! 
+ *****************************************************************************
+ *  \brief  Get a test register value from the shadow
+ *
+ *  \param[in]   reg: Address of the test register
+ *  \param[out]  val: Returned value
+ *
+ *  \return true  : value is known, \a val is filled
+ *  \return false : register needs to be read from the chip
+ *****************************************************************************
+ */
+static bool st25r3911ShadowTestGet( uint8_t reg, uint8_t* val )
+{
+    if( reg >= ST25R3911_SHADOW_LEN )
+    {
+        return false;
+    }
+    
+    if( !(st25r3911Shadow.testValid & ST25R3911_SHADOW_BIT(reg)) )
+    {
+        st25r3911Shadow.misses++;
+        return false;
+    }
+    
+    st25r3911Shadow.hits++;
+    *val = st25r3911Shadow.testRegs[reg];
+    return true;
+}
+
+/*! 
+ *****************************************************************************
+ *  \brief  Update the shadow with a test register value
+ *
+ *  \param[in]  reg: Address of the test register
+ *  \param[in]  val: Register value
+ *****************************************************************************
+ */
+static void st25r3911ShadowTestSet( uint8_t reg, uint8_t val )
+{
+    if( reg < ST25R3911_SHADOW_LEN )
+    {
+        st25r3911Shadow.testRegs[reg] = val;
+        st25r3911Shadow.testValid    |= ST25R3911_SHADOW_BIT(reg);
+    }
+}
+
+/*! 
+ *****************************************************************************
+ *  \brief  Invalidate the shadow on direct commands which change registers
+ *
+ *  \param[in]  cmd: direct command to be executed (with or without mode bits)
+ *****************************************************************************
+ */
+static void st25r3911ShadowCheckCommand( uint8_t cmd )
+{
+    switch( (cmd | ST25R3911_CMD_MODE) )
+    {
+        case ST25R3911_CMD_SET_DEFAULT:
+        case ST25R3911_CMD_ANALOG_PRESET:
+        case ST25R3911_CMD_LOAD_PPROM:
+            st25r3911ShadowInvalidate();
+            break;
+            
+        case ST25R3911_CMD_TEST_CLEARA:
+        case ST25R3911_CMD_TEST_CLEARB:
+            st25r3911Shadow.testValid = 0;
+            break;
+            
+        default:
+            break;
+    }
+}
+
+#endif /* ST25R391X_COM_SHADOW */
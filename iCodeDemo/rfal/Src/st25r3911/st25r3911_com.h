@@ -83,6 +83,13 @@
 */
 
 #define ST25R3911_FIFO_STATUS_LEN                  2           /*!< Number of FIFO Status Register */
+#define ST25R3911_IRQ_FIFO_BURST_LEN               5           /*!< Number of Interrupt and FIFO Status Registers, consecutive from IRQ Main */
+
+/* Platforms driving a single reader */
+#ifndef platformReaderId
+  #define platformReaderId()                       (0)         /*!< Reader the calling thread works on */
+  #define PLATFORM_READERS                         (1)         /*!< Number of reader contexts          */
+#endif
 
 
 
@@ -738,11 +745,45 @@ extern void st25r3911WriteFifo(const uint8_t* values, uint8_t length);
  *  \param[in]  length: Number of bytes to read. (= size of \a buf)
  *  \note: This function doesn't check whether \a length is really the
  *  number of available bytes in FIFO
+ *  \note: Bytes drained by st25r3911ReadIrqFifoStatus() are delivered first
  *
  *****************************************************************************
  */
 extern void st25r3911ReadFifo(uint8_t* buf, uint8_t length);
 
+/*! 
+ *****************************************************************************
+ *  \brief  Read the interrupt and FIFO status registers in one burst
+ *
+ *  Reads IRQ Main, IRQ Timer and NFC, IRQ Error and Wake-up, FIFO Status 1
+ *  and FIFO Status 2 in a single SPI frame. Reading the interrupt registers
+ *  clears them on the chip.
+ *  With ST25R391X_COM_FIFO_DRAIN, if end of receive is signalled, the FIFO
+ *  content is moved to host memory within the same critical section;
+ *  st25r3911ReadFifo() then delivers it without SPI access.
+ *
+ *  \param[out]  regs    : ST25R3911_IRQ_FIFO_BURST_LEN register values
+ *  \param[out]  fifoGen : FIFO generation the FIFO status belongs to, 
+ *                         see st25r3911GetFifoGeneration(). May be NULL
+ *
+ *****************************************************************************
+ */
+extern void st25r3911ReadIrqFifoStatus(uint8_t* regs, uint32_t* fifoGen);
+
+/*! 
+ *****************************************************************************
+ *  \brief  Get the FIFO generation
+ *
+ *  The FIFO generation changes whenever the host loads, reads or clears the
+ *  FIFO. A FIFO status read under a generation equal to the current one
+ *  still tells the bytes to be read.
+ *
+ *  \return the current FIFO generation
+ *
+ *****************************************************************************
+ */
+extern uint32_t st25r3911GetFifoGeneration( void );
+
 /*! 
  *****************************************************************************
  *  \brief  Execute a direct command
@@ -772,6 +813,149 @@ extern void st25r3911ExecuteCommand(uint8_t cmd);
  */
 extern void st25r3911ExecuteCommands(uint8_t *cmds, uint8_t length);
 
+/*! 
+ *****************************************************************************
+ *  \brief  Begin a ST25R3911 SPI transaction
+ *
+ *  Opens a transaction on which register accesses, FIFO loads and direct
+ *  commands are queued instead of being sent one by one. The queued frames
+ *  are sent in order with a single platform SPI transfer by 
+ *  st25r3911TxnCommit(), each frame keeping its own chip select.
+ *
+ *  Transactions may be nested, only the outermost commit sends the frames.
+ *
+ *  \warning Only one transaction can be built at a time, it shall not be 
+ *           used concurrently from multiple contexts (task, ISR, thread)
+ *
+ *****************************************************************************
+ */
+extern void st25r3911TxnBegin( void );
+
+/*! 
+ *****************************************************************************
+ *  \brief  Queue a register write on the current transaction
+ *
+ *  \param[in]  reg: Address of the register to write.
+ *  \param[in]  val: Value to be written.
+ *
+ *****************************************************************************
+ */
+extern void st25r3911TxnWriteRegister( uint8_t reg, uint8_t val );
+
+/*! 
+ *****************************************************************************
+ *  \brief  Queue a multiple register write on the current transaction
+ *
+ *  Uses the auto-increment feature, see st25r3911WriteMultipleRegisters()
+ *
+ *  \param[in]  reg: Address of the frist register to write.
+ *  \param[in]  values: pointer to a buffer containing the values to be written.
+ *  \param[in]  length: Number of values to be written.
+ *
+ *****************************************************************************
+ */
+extern void st25r3911TxnWriteMultipleRegisters( uint8_t reg, const uint8_t* values, uint8_t length );
+
+/*! 
+ *****************************************************************************
+ *  \brief  Queue a register read on the current transaction
+ *
+ *  \param[in]   reg: Address of the register to read.
+ *  \param[out]  val: Returned value, only valid after the outermost
+ *                    st25r3911TxnCommit()
+ *
+ *****************************************************************************
+ */
+extern void st25r3911TxnReadRegister( uint8_t reg, uint8_t* val );
+
+/*! 
+ *****************************************************************************
+ *  \brief  Queue a multiple register read on the current transaction
+ *
+ *  Uses the auto-increment feature, see st25r3911ReadMultipleRegisters()
+ *
+ *  \param[in]   reg: Address of the frist register to read from.
+ *  \param[out]  values: buffer where the result shall be written to, only
+ *                       valid after the outermost st25r3911TxnCommit()
+ *  \param[in]   length: Number of registers to be read out.
+ *
+ *****************************************************************************
+ */
+extern void st25r3911TxnReadMultipleRegisters( uint8_t reg, uint8_t* values, uint8_t length );
+
+/*! 
+ *****************************************************************************
+ *  \brief  Queue a FIFO load on the current transaction
+ *
+ *  \note When the platform supports scatter-gather SPI the data is sent 
+ *        directly from \a values, which shall then remain valid until the
+ *        outermost st25r3911TxnCommit()
+ *
+ *  \param[in]  values: pointer to a buffer containing the values to be written
+ *                      to the FIFO.
+ *  \param[in]  length: Number of values to be written.
+ *
+ *****************************************************************************
+ */
+extern void st25r3911TxnWriteFifo( const uint8_t* values, uint8_t length );
+
+/*! 
+ *****************************************************************************
+ *  \brief  Queue a direct command on the current transaction
+ *
+ *  \param[in]  cmd : code of the direct command to be executed.
+ *
+ *****************************************************************************
+ */
+extern void st25r3911TxnExecuteCommand( uint8_t cmd );
+
+/*! 
+ *****************************************************************************
+ *  \brief  Commit the current ST25R3911 SPI transaction
+ *
+ *  Closes the transaction opened by st25r3911TxnBegin(). On the outermost
+ *  level all queued frames are sent and the read destinations are updated.
+ *
+ *  \return ERR_WRONG_STATE : No transaction has been started
+ *  \return ERR_IO          : SPI transfer failed
+ *  \return ERR_NONE        : No error
+ *
+ *****************************************************************************
+ */
+extern ReturnCode st25r3911TxnCommit( void );
+
+/*! 
+ *****************************************************************************
+ *  \brief  Invalidate the register shadow
+ *
+ *  Drops all cached (test) register values, the next accesses are read
+ *  from the ST25R3911. Shall be called whenever the chip registers may have
+ *  changed behind the driver's back, e.g. after a reset.
+ *  Only effective if ST25R391X_COM_SHADOW is defined.
+ *
+ *****************************************************************************
+ */
+extern void st25r3911ShadowInvalidate( void );
+
+/*! 
+ *****************************************************************************
+ *  \brief  Get the register shadow statistics
+ *
+ *  \param[out]  hits   : reads served from the shadow without SPI access
+ *  \param[out]  misses : reads of cacheable registers which needed SPI access
+ *
+ *****************************************************************************
+ */
+extern void st25r3911ShadowGetStats( uint32_t* hits, uint32_t* misses );
+
+/*! 
+ *****************************************************************************
+ *  \brief  Reset the register shadow statistics
+ *
+ *****************************************************************************
+ */
+extern void st25r3911ShadowResetStats( void );
+
 /*! 
  *****************************************************************************
  *  \brief  Check if register ID is valid
@@ -40,7 +40,9 @@
 * INCLUDES
 ******************************************************************************
 */
+#include <stdatomic.h>
 #include "st25r3911_interrupt.h"
+#include "rfal_rf.h"
 #include "st25r3911_com.h"
 #include "st25r3911.h"
 #include "st_errno.h"
@@ -55,6 +57,10 @@
 /*! Length of the interrupt registers       */
 #define ST25R3911_INT_REGS_LEN          ( (ST25R3911_REG_IRQ_ERROR_WUP - ST25R3911_REG_IRQ_MAIN) + 1 )
 
+/*! FIFO status snapshot: valid flag, FIFO generation, FIFO Status 2 and FIFO Status 1 */
+#define ST25R3911_FIFO_SNAP_VALID       ( (uint64_t)1 << 48 )
+#define ST25R3911_FIFO_SNAP_GEN_SHIFT   ( 16 )
+
 /*
  ******************************************************************************
  * LOCAL DATA TYPES
@@ -66,7 +72,10 @@ typedef struct s_st25r3911Interrupt
 {
     void      (*prevCallback)(); /*!< call back function for 3911 interrupt               */
     void      (*callback)();     /*!< call back function for 3911 interrupt               */
-    uint32_t  status;            /*!< latest interrupt status                             */
+    atomic_uint_least32_t status;/*!< latest interrupt status, ORed by ISR, consumed with atomic AND */
+    atomic_uint_least32_t seq;   /*!< incremented each time the ISR latches new status    */
+    atomic_uint_least32_t stamp[ST25R3911_IRQ_NUM]; /*!< time (us) each status bit was last latched */
+    atomic_uint_least64_t fifo;  /*!< FIFO status read together with the latest interrupts */
     uint32_t  mask;              /*!< Interrupt mask. Negative mask = ST25R3911 mask regs */
 }t_st25r3911Interrupt;
 
@@ -76,7 +85,8 @@ typedef struct s_st25r3911Interrupt
 ******************************************************************************
 */
 
-volatile t_st25r3911Interrupt st25r3911interrupt; /*!< Instance of ST25R3911 interrupt*/
+static volatile t_st25r3911Interrupt st25r3911interruptInstance[PLATFORM_READERS]; /*!< Instances of ST25R3911 interrupt, one per reader */
+#define st25r3911interrupt (st25r3911interruptInstance[platformReaderId()])           /*!< Instance of ST25R3911 interrupt of the current reader */
 
 /*
 ******************************************************************************
@@ -90,8 +100,9 @@ void st25r3911InitInterrupts( void )
     
     st25r3911interrupt.callback     = NULL;
     st25r3911interrupt.prevCallback = NULL;
-    st25r3911interrupt.status       = 0;
     st25r3911interrupt.mask         = 0;
+    atomic_store( &st25r3911interrupt.status, 0 );
+    atomic_store( &st25r3911interrupt.fifo, 0 );
     
     /* Initialize LEDs if existing and defined */
     platformLedsInitialize();
@@ -115,15 +126,24 @@ void st25r3911Isr( void )
 
 void st25r3911CheckForReceivedInterrupts( void )
 {
-    uint8_t  iregs[ST25R3911_INT_REGS_LEN];
+    uint8_t  iregs[ST25R3911_IRQ_FIFO_BURST_LEN];
     uint32_t irqStatus;
+    uint32_t fifoGen;
+    uint32_t now;
+    int      i;
 
     ST_MEMSET( iregs, (uint8_t)ST25R3911_IRQ_MASK_ALL, ST25R3911_INT_REGS_LEN );
         
    /* In case the IRQ is Edge (not Level) triggered read IRQs until done */
    while( platformGpioIsHigh( ST25R391X_INT_PORT, ST25R391X_INT_PIN ) )
    {
-       st25r3911ReadMultipleRegisters(ST25R3911_REG_IRQ_MAIN, iregs, sizeof(iregs));
+       /* FIFO status comes along in the same frame, sparing the worker its own read */
+       st25r3911ReadIrqFifoStatus( iregs, &fifoGen );
+       
+       atomic_store_explicit( &st25r3911interrupt.fifo, ( ST25R3911_FIFO_SNAP_VALID                                 |
+                                                          ((uint64_t)fifoGen << ST25R3911_FIFO_SNAP_GEN_SHIFT)      |
+                                                          ((uint64_t)iregs[ST25R3911_INT_REGS_LEN + 1] << 8)        |
+                                                          (uint64_t)iregs[ST25R3911_INT_REGS_LEN] ), memory_order_release );
        
 #ifdef PLATFORM_LED_FIELD_PIN         
        if (iregs[0] & ST25R3911_IRQ_MASK_TXE)
@@ -146,8 +166,24 @@ void st25r3911CheckForReceivedInterrupts( void )
        irqStatus  = (uint32_t)iregs[0];
        irqStatus |= (uint32_t)iregs[1]<<8;
        irqStatus |= (uint32_t)iregs[2]<<16;
+       if( !irqStatus )
+       {
+           continue;
+       }
+       
+       /* Timestamps are stored before the status bits are published (release) */
+       now = platformGetTimeUs();
+       for( i = 0; i < ST25R3911_IRQ_NUM; i++ )
+       {
+           if( irqStatus & ((uint32_t)1 << i) )
+           {
+               atomic_store_explicit( &st25r3911interrupt.stamp[i], now, memory_order_relaxed );
+           }
+       }
+       
        /* forward all interrupts, even masked ones to application. */
-       st25r3911interrupt.status |= irqStatus;
+       atomic_fetch_or_explicit( &st25r3911interrupt.status, irqStatus, memory_order_release );
+       atomic_fetch_add_explicit( &st25r3911interrupt.seq, 1, memory_order_release );
    }
 }
 
@@ -162,31 +198,39 @@ void st25r3911ModifyInterrupts(uint32_t clr_mask, uint32_t set_mask)
     new_mask = (~old_mask & set_mask) | (old_mask & clr_mask);
     st25r3911interrupt.mask &= ~clr_mask;
     st25r3911interrupt.mask |= set_mask;
+    
+    st25r3911TxnBegin();
     for (i=0; i<3 ; i++)
     { 
         if (! ((new_mask >> (8*i)) & 0xff)) continue;
-        st25r3911WriteRegister(ST25R3911_REG_IRQ_MASK_MAIN + i,(st25r3911interrupt.mask>>(8*i))&0xff);
+        st25r3911TxnWriteRegister(ST25R3911_REG_IRQ_MASK_MAIN + i,(st25r3911interrupt.mask>>(8*i))&0xff);
     }
+    st25r3911TxnCommit();
     return;
 }
 
 
 uint32_t st25r3911WaitForInterruptsTimed(uint32_t mask, uint16_t tmo)
 {
-    uint32_t tmr;
-    uint32_t status;
+    uint32_t      tmr;
+    uint32_t      status;
+    rfalIrqWaiter w;
    
     tmr = platformTimerCreate(tmo);
     do 
     {
-        status = st25r3911interrupt.status & mask;
+        /* Prepare first so an IRQ handled after the check wakes us */
+        rfalIrqWaitPrepare( &w );
+        status = atomic_load_explicit( &st25r3911interrupt.status, memory_order_acquire ) & mask;
+        
+        if( (!status) && !platformTimerIsExpired(tmr) )
+        {
+            rfalIrqWaitNext( &w );
+        }
     } while ((!status) && !platformTimerIsExpired(tmr));
 
-    status = st25r3911interrupt.status & mask;
-    
-    platformProtectST25R391xIrqStatus();
-    st25r3911interrupt.status &= ~status;
-    platformUnprotectST25R391xIrqStatus();
+    /* Consume the awaited bits, including any latched since the last check */
+    status = atomic_fetch_and_explicit( &st25r3911interrupt.status, ~mask, memory_order_acq_rel ) & mask;
     
     return status;
 }
@@ -194,15 +238,49 @@ uint32_t st25r3911WaitForInterruptsTimed(uint32_t mask, uint16_t tmo)
 
 uint32_t st25r3911GetInterrupt(uint32_t mask)
 {
-    mask &= st25r3911interrupt.status;
+    /* Plain load first: the common case of no pending bit needs no atomic RMW */
+    if( !(atomic_load_explicit( &st25r3911interrupt.status, memory_order_acquire ) & mask) )
+    {
+        return 0;
+    }
+    
+    return (atomic_fetch_and_explicit( &st25r3911interrupt.status, ~mask, memory_order_acq_rel ) & mask);
+}
 
-    if (mask)
+uint32_t st25r3911GetInterruptSequence( void )
+{
+    return atomic_load_explicit( &st25r3911interrupt.seq, memory_order_acquire );
+}
+
+uint32_t st25r3911GetInterruptTimestamp(uint32_t mask)
+{
+    int i;
+    
+    for( i = 0; i < ST25R3911_IRQ_NUM; i++ )
+    {
+        if( mask & ((uint32_t)1 << i) )
+        {
+            return atomic_load_explicit( &st25r3911interrupt.stamp[i], memory_order_relaxed );
+        }
+    }
+    return 0;
+}
+
+bool st25r3911GetFifoStatus(uint8_t* status)
+{
+    uint64_t snap;
+    
+    snap = atomic_load_explicit( &st25r3911interrupt.fifo, memory_order_acquire );
+    
+    /* Only usable if the FIFO was not touched by the host since it was read */
+    if( !(snap & ST25R3911_FIFO_SNAP_VALID) || ((uint32_t)(snap >> ST25R3911_FIFO_SNAP_GEN_SHIFT) != st25r3911GetFifoGeneration()) )
     {
-        platformProtectST25R391xIrqStatus();
-        st25r3911interrupt.status &= ~mask;
-        platformUnprotectST25R391xIrqStatus();
+        return false;
     }
-    return mask;
+    
+    status[0] = (uint8_t)snap;
+    status[1] = (uint8_t)(snap >> 8);
+    return true;
 }
 
 void st25r3911EnableInterrupts(uint32_t mask)
@@ -221,9 +299,7 @@ void st25r3911ClearInterrupts( void )
 
     st25r3911ReadMultipleRegisters(ST25R3911_REG_IRQ_MAIN, iregs, 3);
 
-    platformProtectST25R391xIrqStatus();
-    st25r3911interrupt.status = 0;
-    platformUnprotectST25R391xIrqStatus();
+    atomic_store_explicit( &st25r3911interrupt.status, 0, memory_order_release );
     return;
 }
 
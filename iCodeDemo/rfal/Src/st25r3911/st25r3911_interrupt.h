@@ -101,6 +101,8 @@
 #define ST25R3911_IRQ_MASK_TIM             (0x02)               /*!< additional interrupts in ST25R3911_REG_IRQ_TIMER_NFC */
 #define ST25R3911_IRQ_MASK_ERR             (0x01)               /*!< additional interrupts in ST25R3911_REG_IRQ_ERROR_WUP */
 
+#define ST25R3911_IRQ_NUM                  24                   /*!< Number of ST25R3911 interrupt sources */
+
 
 /*
 ******************************************************************************
@@ -144,6 +146,53 @@ extern uint32_t st25r3911WaitForInterruptsTimed(uint32_t mask, uint16_t tmo);
  */
 extern uint32_t st25r3911GetInterrupt(uint32_t mask);
 
+/*! 
+ *****************************************************************************
+ *  \brief  Get the interrupt sequence number
+ *
+ *  The sequence number is incremented each time the ISR latches new
+ *  interrupt status bits. Comparing it with a previously read value tells,
+ *  without any lock, whether interrupts arrived in between.
+ *
+ *  \return the current interrupt sequence number
+ *
+ *****************************************************************************
+ */
+extern uint32_t st25r3911GetInterruptSequence( void );
+
+/*! 
+ *****************************************************************************
+ *  \brief  Get the time an interrupt was latched
+ *
+ *  Returns the time, as given by platformGetTimeUs(), at which the ISR last
+ *  latched the interrupt given by \a mask. If \a mask holds several
+ *  interrupts the lowest one is used.
+ *
+ *  \param[in] mask : mask indicating the interrupt
+ *
+ *  \return the timestamp in us, 0 if \a mask is empty
+ *
+ *****************************************************************************
+ */
+extern uint32_t st25r3911GetInterruptTimestamp(uint32_t mask);
+
+/*! 
+ *****************************************************************************
+ *  \brief  Get the FIFO status read along with the latest interrupts
+ *
+ *  The ISR reads FIFO Status 1 and 2 in the same SPI frame as the interrupt
+ *  registers. The values are returned as long as the host did not load,
+ *  read or clear the FIFO since, so they still tell the bytes to be read.
+ *
+ *  \param[out] status : ST25R3911_FIFO_STATUS_LEN FIFO status register values
+ *
+ *  \return true  : \a status is filled
+ *  \return false : no current FIFO status, read it from the chip
+ *
+ *****************************************************************************
+ */
+extern bool st25r3911GetFifoStatus(uint8_t* status);
+
 
 /*! 
  *****************************************************************************